@@ -0,0 +1,1124 @@
+#include "Common.h"
+#include "Themes.h"
+#include "Utils.h"
+#include "Menu.h"
+#include "Api.h"
+#include "Ring.h"
+#include "Metrics.h"
+#include "Astro.h"
+#include <ESPAsyncWebServer.h>
+#include <memory>
+
+extern String loginUsername;
+extern String loginPassword;
+
+static Metric metricCommands("atsmini_remote_commands_total", "Remote commands that changed the receiver", METRIC_COUNTER, "source=\"web\"");
+
+// Changes passed to the main loop
+#define API_CMD_TUNE     0 // Band (index, -1 to keep), mode (mode, -1 to keep), frequency (value, 0 to keep)
+#define API_CMD_VOLUME   1
+#define API_CMD_SQUELCH  2
+#define API_CMD_MEMORY   3 // Memory slot (index)
+#define API_CMD_SETTING  4 // Setting (index)
+
+typedef struct
+{
+  uint8_t type;
+  int8_t mode;
+  int16_t index;
+  int32_t value;
+  Memory memory;
+} ApiCommand;
+
+static CommandRing<ApiCommand, API_QUEUE> apiRing;
+static AsyncWebSocket apiSocket("/api/v1/ws");
+
+//
+// Settings available through the API, with their largest (and
+// smallest, if not 0) values. Optional settings also take
+// ASTRO_NO_LOCATION for "not set".
+//
+typedef struct
+{
+  const char *name;
+  int (*maximum)();
+  int (*get)();
+  void (*set)(int value);
+  int (*minimum)();
+  bool optional;
+} ApiSetting;
+
+static const ApiSetting apiSettings[] =
+{
+  {
+    "brightness", []() { return(255); }, []() { return((int)currentBrt); },
+    [](int v) { currentBrt = max(v, 10); if(!sleepOn()) ledcWrite(PIN_LCD_BL, currentBrt); }
+  },
+  {
+    "sleep", []() { return(255); }, []() { return((int)currentSleep); },
+    [](int v) { currentSleep = v; }
+  },
+  {
+    "theme", []() { return(getTotalThemes() - 1); }, []() { return((int)themeIdx); },
+    [](int v) { themeIdx = v; }
+  },
+  {
+    "utcOffset", []() { return(getTotalUTCOffsets() - 1); }, []() { return((int)utcOffsetIdx); },
+    [](int v) { utcOffsetIdx = v; clockRefreshTime(); }
+  },
+  {
+    "fmRegion", []() { return(getTotalFmRegions() - 1); }, []() { return((int)FmRegionIdx); },
+    [](int v) { FmRegionIdx = v; if(currentMode==FM) rx.setFMDeEmphasis(fmRegions[FmRegionIdx].value); }
+  },
+  {
+    "usbMode", []() { return(getTotalUSBModes() - 1); }, []() { return((int)usbModeIdx); },
+    [](int v) { usbModeIdx = v; }
+  },
+  {
+    "zoomMenu", []() { return(1); }, []() { return((int)zoomMenu); },
+    [](int v) { zoomMenu = v; }
+  },
+  {
+    "reverseScroll", []() { return(1); }, []() { return((int)(scrollDirection < 0)); },
+    [](int v) { scrollDirection = v ? -1 : 1; }
+  },
+  {
+    "propRefresh", []() { return(255); }, []() { return((int)propRefresh); },
+    [](int v) { propRefresh = v; }
+  },
+  {
+    "latitude", []() { return(9000); }, []() { return((int)locationLat); },
+    [](int v) { locationLat = v; }, []() { return(-9000); }, true
+  },
+  {
+    "longitude", []() { return(18000); }, []() { return((int)locationLon); },
+    [](int v) { locationLon = v; }, []() { return(-18000); }, true
+  },
+};
+
+static bool apiSettingValid(const ApiSetting *setting, int32_t value)
+{
+  if(setting->optional && value==ASTRO_NO_LOCATION) return(true);
+  return(value >= (setting->minimum ? setting->minimum() : 0) && value <= setting->maximum());
+}
+
+//
+// Minimal JSON reader for the request bodies
+//
+
+typedef struct
+{
+  const char *p;
+  const char *error;  // First error, NULL if none
+} JsonReader;
+
+static bool jsonFail(JsonReader *r, const char *error)
+{
+  if(!r->error) r->error = error;
+  return(false);
+}
+
+static bool jsonChar(JsonReader *r, char c)
+{
+  while(isspace(*r->p)) r->p++;
+  if(*r->p != c) return(false);
+  r->p++;
+  return(true);
+}
+
+static bool jsonWord(JsonReader *r, const char *word)
+{
+  size_t len = strlen(word);
+
+  while(isspace(*r->p)) r->p++;
+  if(strncmp(r->p, word, len)) return(false);
+  r->p += len;
+  return(true);
+}
+
+//
+// Read a string, truncated to the buffer size (no buffer to skip it)
+//
+static bool jsonString(JsonReader *r, char *out, size_t size)
+{
+  size_t n = 0;
+
+  if(!jsonChar(r, '"')) return(jsonFail(r, "Expected a string"));
+
+  for(char c ; (c = *r->p) != '"' ; r->p++)
+  {
+    if((uint8_t)c < ' ') return(jsonFail(r, "Invalid string"));
+
+    if(c == '\\')
+    {
+      switch(c = *++r->p)
+      {
+        case '"': case '\\': case '/': break;
+        case 'b': c = '\b'; break;
+        case 'f': c = '\f'; break;
+        case 'n': c = '\n'; break;
+        case 'r': c = '\r'; break;
+        case 't': c = '\t'; break;
+        case 'u':
+          {
+            // Only ASCII characters are kept
+            unsigned int code = 0;
+            for(int i=1 ; i<=4 ; i++)
+            {
+              if(!isxdigit(r->p[i])) return(jsonFail(r, "Invalid string"));
+              code = code * 16 + (isdigit(r->p[i]) ? r->p[i] - '0' : tolower(r->p[i]) - 'a' + 10);
+            }
+            c = code < 0x80 ? code : '?';
+            r->p += 4;
+          }
+          break;
+        default:
+          return(jsonFail(r, "Invalid string"));
+      }
+    }
+
+    if(out && n < size - 1) out[n++] = c;
+  }
+
+  r->p++;
+  if(out) out[n] = '\0';
+  return(true);
+}
+
+//
+// Read an integer, true and false are taken as 1 and 0
+//
+static bool jsonInt(JsonReader *r, int32_t *value)
+{
+  if(jsonWord(r, "true"))  { *value = 1; return(true); }
+  if(jsonWord(r, "false")) { *value = 0; return(true); }
+
+  char *end;
+  double v = strtod(r->p, &end);
+
+  // strtod() also takes hex numbers, "inf" and "nan", JSON does not
+  if(end == r->p || strspn(r->p, "0123456789+-.eE") < (size_t)(end - r->p))
+    return(jsonFail(r, "Expected an integer"));
+  if(v < INT32_MIN || v > INT32_MAX || v != floor(v))
+    return(jsonFail(r, "Expected an integer"));
+
+  r->p = end;
+  *value = v;
+  return(true);
+}
+
+static bool jsonField(JsonReader *r, char *key, size_t size, bool *first);
+static bool jsonElement(JsonReader *r, bool *first);
+
+//
+// Skip a value of any type
+//
+static bool jsonSkip(JsonReader *r, int depth = 0)
+{
+  bool first = true;
+  char *end;
+
+  if(depth > 8) return(jsonFail(r, "Nested too deep"));
+  while(isspace(*r->p)) r->p++;
+
+  switch(*r->p)
+  {
+    case '"':
+      return(jsonString(r, NULL, 0));
+    case '[':
+      while(jsonElement(r, &first))
+        if(!jsonSkip(r, depth + 1)) return(false);
+      return(!r->error);
+    case '{':
+      while(jsonField(r, NULL, 0, &first))
+        if(!jsonSkip(r, depth + 1)) return(false);
+      return(!r->error);
+  }
+
+  if(jsonWord(r, "true") || jsonWord(r, "false") || jsonWord(r, "null")) return(true);
+
+  strtod(r->p, &end);
+  if(end == r->p) return(jsonFail(r, "Invalid value"));
+  r->p = end;
+  return(true);
+}
+
+//
+// Go to the next object field, returns false at the end of the object
+// or on error. Set *first to true before the first call.
+//
+static bool jsonField(JsonReader *r, char *key, size_t size, bool *first)
+{
+  if(*first)
+  {
+    *first = false;
+    if(!jsonChar(r, '{')) return(jsonFail(r, "Expected an object"));
+    if(jsonChar(r, '}')) return(false);
+  }
+  else
+  {
+    if(jsonChar(r, '}')) return(false);
+    if(!jsonChar(r, ',')) return(jsonFail(r, "Expected ',' or '}'"));
+  }
+
+  if(!jsonString(r, key, size)) return(false);
+  return(jsonChar(r, ':') || jsonFail(r, "Expected ':'"));
+}
+
+//
+// Go to the next array element, returns false at the end of the array
+// or on error. Set *first to true before the first call.
+//
+static bool jsonElement(JsonReader *r, bool *first)
+{
+  if(*first)
+  {
+    *first = false;
+    if(!jsonChar(r, '[')) return(jsonFail(r, "Expected an array"));
+    return(!jsonChar(r, ']'));
+  }
+
+  if(jsonChar(r, ']')) return(false);
+  return(jsonChar(r, ',') || jsonFail(r, "Expected ',' or ']'"));
+}
+
+//
+// Check that nothing follows the document
+//
+static bool jsonEnd(JsonReader *r)
+{
+  if(r->error) return(false);
+  while(isspace(*r->p)) r->p++;
+  return(!*r->p || jsonFail(r, "Unexpected data after the document"));
+}
+
+//
+// Print a string with JSON escapes
+//
+void jsonPrintString(Print *out, const char *s)
+{
+  out->print('"');
+
+  for( ; *s ; s++)
+  {
+    if(*s == '"' || *s == '\\') out->printf("\\%c", *s);
+    else if((uint8_t)*s < ' ') out->printf("\\u%04x", *s);
+    else out->print(*s);
+  }
+
+  out->print('"');
+}
+
+//
+// Document item being sent, one item is usually an object with a few
+// short strings. Of a longer item, the buffer keeps the part starting
+// at skip, total counts all of it.
+//
+class JsonItem : public Print
+{
+  public:
+    char buf[384];
+    size_t length = 0;
+    size_t pos = 0;
+    size_t skip = 0;
+    size_t total = 0;
+
+    size_t write(uint8_t c) override
+    {
+      if(total++ >= skip && length < sizeof(buf)) buf[length++] = c;
+      return(1);
+    }
+};
+
+//
+// Send a document in chunks, generating items as the connection takes
+// them, so that only one item is kept in memory
+//
+void apiSendChunked(AsyncWebServerRequest *request, ApiItemWriter writer, const char *type)
+{
+  struct ChunkState
+  {
+    JsonItem item;
+    int index = -1;
+    bool done = false;
+  };
+
+  std::shared_ptr<ChunkState> state = std::make_shared<ChunkState>();
+
+  AsyncWebServerResponse *response = request->beginChunkedResponse(type,
+    [state, writer](uint8_t *buffer, size_t maxLen, size_t index) -> size_t
+    {
+      JsonItem *item = &state->item;
+      size_t n = 0;
+
+      while(n < maxLen)
+      {
+        if(item->pos < item->length)
+        {
+          size_t len = min(maxLen - n, item->length - item->pos);
+          memcpy(buffer + n, item->buf + item->pos, len);
+          item->pos += len;
+          n += len;
+        }
+        else if(state->done)
+          break;
+        else
+        {
+          // The rest of an item longer than the buffer is written
+          // again, past the part sent already
+          if(item->total > item->skip + item->length)
+            item->skip += item->length;
+          else
+          {
+            item->skip = 0;
+            state->index++;
+          }
+
+          item->length = item->pos = item->total = 0;
+          state->done = !writer(item, state->index);
+        }
+      }
+
+      return(n);
+    });
+
+  response->addHeader("Cache-Control", "no-store");
+  request->send(response);
+}
+
+static void apiSendError(AsyncWebServerRequest *request, int code, const char *error)
+{
+  JsonItem out;
+
+  out.print("{\"error\":");
+  jsonPrintString(&out, error);
+  out.print('}');
+  out.buf[min(out.length, sizeof(out.buf) - 1)] = '\0';
+
+  request->send(code, "application/json", out.buf);
+}
+
+//
+// Check login, same as for the configuration page
+//
+static bool apiAuthenticate(AsyncWebServerRequest *request)
+{
+  if(loginUsername == "" || loginPassword == "") return(true);
+  if(request->authenticate(loginUsername.c_str(), loginPassword.c_str())) return(true);
+
+  request->requestAuthentication();
+  return(false);
+}
+
+//
+// Collect the request body, it is freed together with the request
+//
+static void apiOnBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)
+{
+  if(!index)
+  {
+    free(request->_tempObject);
+    request->_tempObject = total <= API_MAX_BODY ? calloc(total + 1, 1) : NULL;
+  }
+
+  if(request->_tempObject && index + len <= total)
+    memcpy((char *)request->_tempObject + index, data, len);
+}
+
+static bool apiGetBody(AsyncWebServerRequest *request, JsonReader *r)
+{
+  r->p = (const char *)request->_tempObject;
+  r->error = NULL;
+
+  if(r->p) return(true);
+
+  apiSendError(request, 400, "Missing or too large body");
+  return(false);
+}
+
+//
+// Pass commands to the main loop, all of them or none
+//
+static bool apiEnqueue(const ApiCommand *cmds, int count, uint32_t *ticket = NULL)
+{
+  return(apiRing.push(cmds, count, ticket));
+}
+
+static void apiQueueCommands(AsyncWebServerRequest *request, const ApiCommand *cmds, int count)
+{
+  if(!apiEnqueue(cmds, count))
+    return(apiSendError(request, 503, "Busy, try again"));
+
+  // Applied by the main loop later
+  request->send(202, "application/json", "{\"queued\":true}");
+}
+
+static int apiFindMode(const char *name)
+{
+  for(int i=0 ; i<getTotalModes() ; i++)
+    if(!strcasecmp(bandModeDesc[i], name)) return(i);
+
+  return(-1);
+}
+
+//
+// Find band by name. Some names are used by several bands, so prefer
+// the one that contains the memory.
+//
+static int apiFindBand(const char *name, const Memory *mem)
+{
+  int found = -1;
+
+  for(int i=0 ; i<getTotalBands() ; i++)
+  {
+    if(strcmp(bands[i].bandName, name)) continue;
+    if(!mem || isMemoryInBand(&bands[i], mem)) return(i);
+    if(found < 0) found = i;
+  }
+
+  return(found);
+}
+
+//
+// Status document
+//
+static bool apiStatusItem(Print *out, int index)
+{
+  const char *clock;
+
+  switch(index)
+  {
+    case 0:
+      out->printf(
+        "{\"band\":\"%s\",\"bandIndex\":%d,\"mode\":\"%s\",\"frequency\":%lu,"
+        "\"rssi\":%u,\"snr\":%u,\"volume\":%u,\"squelch\":%u,"
+        "\"step\":\"%s\",\"bandwidth\":\"%s\",\"battery\":%.2f,",
+        getCurrentBand()->bandName, bandIdx, bandModeDesc[currentMode],
+        (unsigned long)getCurrentFrequencyHz(), rssi, snr, volume, currentSquelch,
+        getCurrentStep()->desc, getCurrentBandwidth()->desc, batteryVoltage()
+      );
+      return(true);
+
+    case 1:
+      out->print("\"station\":");
+      jsonPrintString(out, getStationName());
+      out->print(",\"clock\":");
+      clock = clockGet();
+      if(clock) jsonPrintString(out, clock); else out->print("null");
+      out->printf(",\"firmware\":\"%s\",\"mac\":\"%s\"}", getVersion(true), getMACAddress());
+      return(true);
+  }
+
+  return(false);
+}
+
+//
+// Band table document
+//
+static bool apiBandItem(Print *out, int index)
+{
+  int i = index - 1;
+
+  if(!index)
+    out->print('[');
+  else if(i < getTotalBands())
+  {
+    const Band *band = &bands[i];
+    out->printf(
+      "%s{\"index\":%d,\"name\":\"%s\",\"mode\":\"%s\",\"minimum\":%lu,\"maximum\":%lu,\"frequency\":%lu}",
+      i ? "," : "", i, band->bandName, bandModeDesc[band->bandMode],
+      (unsigned long)freqToHz(band->minimumFreq, band->bandMode),
+      (unsigned long)freqToHz(band->maximumFreq, band->bandMode),
+      (unsigned long)freqToHz(band->currentFreq, band->bandMode)
+    );
+  }
+  else if(i == getTotalBands())
+    out->print(']');
+  else
+    return(false);
+
+  return(true);
+}
+
+//
+// Memories document, empty slots are left out
+//
+static bool apiMemoryItem(Print *out, int index)
+{
+  int i = index - 1;
+
+  if(!index)
+    out->print('[');
+  else if(i < getTotalMemories())
+  {
+    const Memory *mem = &memories[i];
+    if(!mem->freq) return(true);
+
+    // Comma unless this is the first used slot
+    bool first = true;
+    for(int j=0 ; j<i && first ; j++) first = !memories[j].freq;
+
+    char name[sizeof(mem->name) + 1];
+    memcpy(name, mem->name, sizeof(mem->name));
+    name[sizeof(mem->name)] = '\0';
+
+    out->printf("%s{\"slot\":%d,\"band\":\"%s\",\"frequency\":%lu,\"mode\":\"%s\",\"name\":",
+      first ? "" : ",", i + 1,
+      mem->band < getTotalBands() ? bands[mem->band].bandName : "",
+      (unsigned long)mem->freq,
+      mem->mode < getTotalModes() ? bandModeDesc[mem->mode] : ""
+    );
+    jsonPrintString(out, name);
+    out->print('}');
+  }
+  else if(i == getTotalMemories())
+    out->print(']');
+  else
+    return(false);
+
+  return(true);
+}
+
+//
+// Settings document
+//
+static bool apiSettingItem(Print *out, int index)
+{
+  int i = index - 1;
+
+  if(!index)
+    out->print('{');
+  else if(i < (int)ITEM_COUNT(apiSettings))
+    out->printf("%s\"%s\":%d", i ? "," : "", apiSettings[i].name, apiSettings[i].get());
+  else if(i == ITEM_COUNT(apiSettings))
+    out->print('}');
+  else
+    return(false);
+
+  return(true);
+}
+
+//
+// Parse a status change object into up to API_STATUS_CMDS commands,
+// returns the number of commands or -1 on error
+//
+#define API_STATUS_CMDS 3
+
+static int apiParseStatus(JsonReader *r, ApiCommand *cmds)
+{
+  ApiCommand tune = { API_CMD_TUNE, -1, -1, 0 };
+  char key[16], text[16];
+  bool first = true;
+  int32_t value;
+  int count = 0;
+
+  while(jsonField(r, key, sizeof(key), &first))
+  {
+    if(!strcmp(key, "band"))
+    {
+      // Band name or index
+      while(isspace(*r->p)) r->p++;
+      if(*r->p == '"')
+      {
+        if(jsonString(r, text, sizeof(text)) && (tune.index = apiFindBand(text, NULL)) < 0)
+          jsonFail(r, "No such band");
+      }
+      else if(jsonInt(r, &value))
+      {
+        tune.index = value;
+        if(value < 0 || value >= getTotalBands()) jsonFail(r, "No such band");
+      }
+    }
+    else if(!strcmp(key, "mode"))
+    {
+      if(jsonString(r, text, sizeof(text)) && (tune.mode = apiFindMode(text)) < 0)
+        jsonFail(r, "No such mode");
+    }
+    else if(!strcmp(key, "frequency"))
+    {
+      if(jsonInt(r, &tune.value) && tune.value <= 0)
+        jsonFail(r, "Invalid frequency");
+    }
+    else if(!strcmp(key, "volume") || !strcmp(key, "squelch"))
+    {
+      bool vol = key[0] == 'v';
+
+      // Room is left for the tuning command
+      if(count >= API_STATUS_CMDS - 1)
+        jsonFail(r, "Duplicate fields");
+      else if(jsonInt(r, &value) && (value < 0 || value > (vol ? 63 : 127)))
+        jsonFail(r, vol ? "Invalid volume" : "Invalid squelch");
+      else
+        cmds[count++] = { (uint8_t)(vol ? API_CMD_VOLUME : API_CMD_SQUELCH), -1, -1, value };
+    }
+    else
+      // Read only or unknown fields
+      jsonSkip(r);
+
+    if(r->error) break;
+  }
+
+  if(!jsonEnd(r)) return(-1);
+
+  if(tune.index >= 0 || tune.mode >= 0 || tune.value) cmds[count++] = tune;
+  return(count);
+}
+
+//
+// PUT /api/v1/status
+//
+static void apiPutStatus(AsyncWebServerRequest *request)
+{
+  ApiCommand cmds[API_STATUS_CMDS];
+  JsonReader r;
+
+  if(!apiAuthenticate(request) || !apiGetBody(request, &r)) return;
+
+  int count = apiParseStatus(&r, cmds);
+  if(count < 0) return(apiSendError(request, 400, r.error));
+  apiQueueCommands(request, cmds, count);
+}
+
+//
+// Parse a memory slot object
+//
+static bool apiParseMemory(JsonReader *r, ApiCommand *cmd)
+{
+  char key[16], band[16] = "", mode[8] = "";
+  bool first = true;
+  int32_t value;
+
+  cmd->type  = API_CMD_MEMORY;
+  cmd->index = -1;
+  memset(&cmd->memory, 0, sizeof(cmd->memory));
+
+  while(jsonField(r, key, sizeof(key), &first))
+  {
+    if(!strcmp(key, "slot"))
+    {
+      if(jsonInt(r, &value) && (value < 1 || value > getTotalMemories()))
+        return(jsonFail(r, "Invalid memory slot number"));
+      cmd->index = value - 1;
+    }
+    else if(!strcmp(key, "band"))
+      jsonString(r, band, sizeof(band));
+    else if(!strcmp(key, "mode"))
+      jsonString(r, mode, sizeof(mode));
+    else if(!strcmp(key, "frequency"))
+    {
+      if(jsonInt(r, &value) && value < 0)
+        return(jsonFail(r, "Invalid frequency"));
+      cmd->memory.freq = value;
+    }
+    else if(!strcmp(key, "name"))
+    {
+      char name[sizeof(cmd->memory.name) + 1];
+      if(jsonString(r, name, sizeof(name)))
+        strncpy(cmd->memory.name, name, sizeof(cmd->memory.name));
+    }
+    else
+      jsonSkip(r);
+
+    if(r->error) return(false);
+  }
+
+  if(r->error) return(false);
+  if(cmd->index < 0) return(jsonFail(r, "Missing memory slot number"));
+
+  // Zero frequency clears the slot
+  if(!cmd->memory.freq)
+  {
+    memset(&cmd->memory, 0, sizeof(cmd->memory));
+    return(true);
+  }
+
+  int m = apiFindMode(mode);
+  if(m < 0) return(jsonFail(r, "No such mode"));
+  cmd->memory.mode = m;
+
+  int b = apiFindBand(band, &cmd->memory);
+  if(b < 0) return(jsonFail(r, "No such band"));
+  cmd->memory.band = b;
+
+  if(!isMemoryInBand(&bands[b], &cmd->memory))
+    return(jsonFail(r, "Invalid frequency or mode"));
+
+  return(true);
+}
+
+//
+// PUT /api/v1/memories, an array of memory slots
+//
+static void apiPutMemories(AsyncWebServerRequest *request)
+{
+  JsonReader r;
+  bool first = true;
+  int count = 0;
+
+  if(!apiAuthenticate(request) || !apiGetBody(request, &r)) return;
+
+  // Temporary, only until the commands are queued
+  std::unique_ptr<ApiCommand[]> cmds(new ApiCommand[getTotalMemories()]);
+
+  while(jsonElement(&r, &first))
+  {
+    if(count >= getTotalMemories())
+    {
+      r.error = "Too many memory slots";
+      break;
+    }
+    if(!apiParseMemory(&r, &cmds[count++])) break;
+  }
+
+  if(!jsonEnd(&r)) return(apiSendError(request, 400, r.error));
+  apiQueueCommands(request, cmds.get(), count);
+}
+
+//
+// PUT /api/v1/settings
+//
+static void apiPutSettings(AsyncWebServerRequest *request)
+{
+  ApiCommand cmds[ITEM_COUNT(apiSettings)];
+  JsonReader r;
+  char key[24];
+  bool first = true;
+  int count = 0;
+
+  if(!apiAuthenticate(request) || !apiGetBody(request, &r)) return;
+
+  while(jsonField(&r, key, sizeof(key), &first))
+  {
+    unsigned int i;
+    int32_t value;
+
+    for(i=0 ; i<ITEM_COUNT(apiSettings) && strcmp(key, apiSettings[i].name) ; i++);
+
+    if(i >= ITEM_COUNT(apiSettings))
+      r.error = "No such setting";
+    else if(count >= (int)ITEM_COUNT(apiSettings))
+      r.error = "Duplicate fields";
+    else if(jsonInt(&r, &value))
+    {
+      if(!apiSettingValid(&apiSettings[i], value))
+        r.error = "Invalid value";
+      cmds[count++] = { API_CMD_SETTING, -1, (int16_t)i, value };
+    }
+
+    if(r.error) break;
+  }
+
+  if(!jsonEnd(&r)) return(apiSendError(request, 400, r.error));
+  apiQueueCommands(request, cmds, count);
+}
+
+//
+// Queue changes from the /api/control form (-1 or 0 to keep)
+//
+bool apiQueueControl(int32_t band, uint32_t freq, int32_t vol, uint32_t *ticket)
+{
+  ApiCommand cmds[2];
+  int count = 0;
+
+  if(band >= 0 || freq)
+    cmds[count++] = { API_CMD_TUNE, -1, (int16_t)(band < getTotalBands() ? band : -1), (int32_t)freq };
+  if(vol >= 0)
+    cmds[count++] = { API_CMD_VOLUME, -1, -1, constrain(vol, 0, 63) };
+
+  return(apiEnqueue(cmds, count, ticket));
+}
+
+//
+// Queue a change of a setting by its name, checking the value
+//
+bool apiQueueSetting(const char *name, int32_t value, uint32_t *ticket)
+{
+  for(unsigned int i=0 ; i<ITEM_COUNT(apiSettings) ; i++)
+  {
+    if(strcmp(name, apiSettings[i].name)) continue;
+    if(!apiSettingValid(&apiSettings[i], value)) return(false);
+
+    ApiCommand cmd = { API_CMD_SETTING, -1, (int16_t)i, value };
+    return(apiEnqueue(&cmd, 1, ticket));
+  }
+
+  return(false);
+}
+
+//
+// Queue a status change object, as for PUT /api/v1/status. Returns
+// NULL or the error.
+//
+const char *apiQueueStatus(const char *text)
+{
+  ApiCommand cmds[API_STATUS_CMDS];
+  JsonReader r = { text, NULL };
+  int count = apiParseStatus(&r, cmds);
+
+  if(count < 0) return(r.error);
+  return(apiEnqueue(cmds, count) ? NULL : "Busy, try again");
+}
+
+//
+// WebSocket clients allowed to make changes, by id (0 - free)
+//
+static uint32_t apiSocketAuth[API_WS_CLIENTS] = { 0 };
+static volatile bool apiSocketSync = false;
+
+static uint32_t *apiSocketSlot(uint32_t id)
+{
+  for(int i=0 ; i<API_WS_CLIENTS ; i++)
+    if(apiSocketAuth[i] == id) return(&apiSocketAuth[i]);
+
+  return(NULL);
+}
+
+//
+// Web server task: WebSocket events. Text messages are status change
+// objects, the same as for PUT /api/v1/status.
+//
+static void apiOnSocketEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len)
+{
+  AwsFrameInfo *info = (AwsFrameInfo *)arg;
+  char text[API_WS_MAX_MESSAGE];
+  const char *error;
+
+  switch(type)
+  {
+    case WS_EVT_CONNECT:
+      if(server->count() > API_WS_CLIENTS)
+      {
+        client->close();
+        break;
+      }
+      // Changes need the same login as PUT requests
+      if(loginUsername == "" || loginPassword == "" ||
+         ((AsyncWebServerRequest *)arg)->authenticate(loginUsername.c_str(), loginPassword.c_str()))
+      {
+        uint32_t *slot = apiSocketSlot(0);
+        if(slot) *slot = client->id();
+      }
+      // New client needs the full state
+      apiSocketSync = true;
+      break;
+
+    case WS_EVT_DISCONNECT:
+      {
+        uint32_t *slot = apiSocketSlot(client->id());
+        if(slot) *slot = 0;
+      }
+      break;
+
+    case WS_EVT_DATA:
+      // Only complete single frame text messages
+      if(!info->final || info->index || info->len != len || info->opcode != WS_TEXT)
+        break;
+      if(len >= sizeof(text))
+      {
+        client->text("{\"error\":\"Message too large\"}");
+        break;
+      }
+      if(!apiSocketSlot(client->id()))
+      {
+        client->text("{\"error\":\"Login required\"}");
+        break;
+      }
+
+      memcpy(text, data, len);
+      text[len] = '\0';
+
+      if((error = apiQueueStatus(text)))
+      {
+        JsonItem out;
+        out.print("{\"error\":");
+        jsonPrintString(&out, error);
+        out.print('}');
+        client->text((const uint8_t *)out.buf, out.length);
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+// Live state fields sent over WebSocket, numbers compared as they are
+// and band and mode sent by name
+static const char *apiSocketKeys[] = { "band", "mode", "frequency", "rssi", "snr", "volume" };
+
+static int32_t apiSocketValue(int field)
+{
+  switch(field)
+  {
+    case 0: return(bandIdx);
+    case 1: return(currentMode);
+    case 2: return(getCurrentFrequencyHz());
+    case 3: return(rssi);
+    case 4: return(snr);
+    case 5: return(volume);
+  }
+
+  return(0);
+}
+
+//
+// Send the live state fields that changed to the WebSocket clients,
+// at most every API_WS_INTERVAL. Called by the main loop, which tells
+// when something may have changed.
+//
+void apiSocketTick(bool changed)
+{
+  static int32_t last[ITEM_COUNT(apiSocketKeys)];
+  static char lastStation[50] = "";
+  static uint32_t lastTime = 0;
+  static bool pending = false;
+
+  uint32_t now = millis();
+
+  pending |= changed;
+
+  if(now - lastTime < API_WS_INTERVAL) return;
+  if(!apiSocket.count() || (!pending && !apiSocketSync)) return;
+
+  // Drop clients that went away without closing
+  apiSocket.cleanupClients(API_WS_CLIENTS);
+
+  bool full = apiSocketSync;
+  const char *sep = "{";
+  JsonItem out;
+
+  apiSocketSync = false;
+  pending = false;
+  lastTime = now;
+
+  for(unsigned int i=0 ; i<ITEM_COUNT(apiSocketKeys) ; i++)
+  {
+    int32_t value = apiSocketValue(i);
+    if(!full && value == last[i]) continue;
+
+    out.printf("%s\"%s\":", sep, apiSocketKeys[i]);
+    switch(i)
+    {
+      case 0:  jsonPrintString(&out, getCurrentBand()->bandName); break;
+      case 1:  jsonPrintString(&out, bandModeDesc[currentMode]); break;
+      default: out.printf("%ld", (long)value); break;
+    }
+    last[i] = value;
+    sep = ",";
+  }
+
+  const char *station = getStationName();
+  if(full || strncmp(station, lastStation, sizeof(lastStation) - 1))
+  {
+    out.printf("%s\"station\":", sep);
+    jsonPrintString(&out, station);
+    strncpy(lastStation, station, sizeof(lastStation) - 1);
+    sep = ",";
+  }
+
+  // Nothing changed
+  if(*sep == '{') return;
+
+  out.print('}');
+  apiSocket.textAll((const uint8_t *)out.buf, out.length);
+}
+
+//
+// Disconnect the WebSocket clients
+//
+void apiStop()
+{
+  apiSocket.closeAll();
+}
+
+//
+// Register the API handlers with the web server
+//
+void apiInit(AsyncWebServer *server)
+{
+  static bool registered = false;
+
+  // Handlers stay registered with the server
+  if(registered) return;
+  registered = true;
+
+  apiSocket.onEvent(apiOnSocketEvent);
+  server->addHandler(&apiSocket);
+
+  server->on("/api/v1/status", HTTP_GET, [] (AsyncWebServerRequest *request) {
+    apiSendChunked(request, apiStatusItem);
+  });
+  server->on("/api/v1/status", HTTP_PUT, apiPutStatus, NULL, apiOnBody);
+
+  server->on("/api/v1/bands", HTTP_GET, [] (AsyncWebServerRequest *request) {
+    apiSendChunked(request, apiBandItem);
+  });
+
+  server->on("/api/v1/memories", HTTP_GET, [] (AsyncWebServerRequest *request) {
+    apiSendChunked(request, apiMemoryItem);
+  });
+  server->on("/api/v1/memories", HTTP_PUT, apiPutMemories, NULL, apiOnBody);
+
+  server->on("/api/v1/settings", HTTP_GET, [] (AsyncWebServerRequest *request) {
+    apiSendChunked(request, apiSettingItem);
+  });
+  server->on("/api/v1/settings", HTTP_PUT, apiPutSettings, NULL, apiOnBody);
+}
+
+//
+// Apply a change queued by the web server
+//
+static int apiExecute(const ApiCommand *cmd)
+{
+  switch(cmd->type)
+  {
+    case API_CMD_TUNE:
+      if(cmd->index >= 0 && cmd->index != bandIdx) selectBand(cmd->index, true);
+      if(cmd->mode >= 0) selectMode(cmd->mode);
+      if(cmd->value) tuneToFrequency(cmd->value, cmd->index < 0);
+      break;
+
+    case API_CMD_VOLUME:
+      doVolume(cmd->value - volume);
+      break;
+
+    case API_CMD_SQUELCH:
+      doSquelch(cmd->value - currentSquelch);
+      break;
+
+    case API_CMD_MEMORY:
+      memories[cmd->index] = cmd->memory;
+      break;
+
+    case API_CMD_SETTING:
+      apiSettings[cmd->index].set(cmd->value);
+      break;
+
+    default:
+      return(0);
+  }
+
+  return(REMOTE_CHANGED | REMOTE_PREFS);
+}
+
+//
+// Apply changes queued by the web server. Returns once a change
+// produces remote events, so that they are not merged.
+//
+int apiDoCommand()
+{
+  ApiCommand *cmd;
+  int event = 0;
+
+  // Commands are done (see CommandRing::finished()) once removed from
+  // the ring
+  while(!event && (cmd = apiRing.front()))
+  {
+    event = apiExecute(cmd);
+    apiRing.pop();
+  }
+
+  if(event) metricCommands.add();
+
+  return(event);
+}
@@ -0,0 +1,43 @@
+#ifndef API_H
+#define API_H
+
+#include <Arduino.h>
+
+//
+// JSON REST API served by the web server under /api/v1. Documents are
+// generated in chunks while they are sent, changes are checked by the
+// web server task, then passed to the main loop through a lock-free
+// command ring (see Ring.h).
+//
+//   GET     /api/v1/status    - receiver status
+//   PUT     /api/v1/status    - change band, mode, frequency, volume, squelch
+//   GET     /api/v1/bands     - band table
+//   GET/PUT /api/v1/memories  - memory slots (frequency 0 clears a slot)
+//   GET/PUT /api/v1/settings  - settings
+//   WS      /api/v1/ws        - live state changes, status change messages
+//
+
+#define API_QUEUE          128   // Command ring length (power of two), fits all memories
+#define API_MAX_BODY     16384   // Largest request body (bytes), fits all memories
+#define API_WS_CLIENTS       4   // Most WebSocket clients
+#define API_WS_INTERVAL    100   // Shortest time between WebSocket updates (ms)
+#define API_WS_MAX_MESSAGE 256   // Largest WebSocket message (bytes)
+
+class AsyncWebServer;
+class AsyncWebServerRequest;
+
+// Write document item with the given index, false past the last item
+typedef bool (*ApiItemWriter)(Print *out, int index);
+
+void apiInit(AsyncWebServer *server);
+bool apiQueueControl(int32_t band, uint32_t freq, int32_t volume, uint32_t *ticket = NULL);
+bool apiQueueSetting(const char *name, int32_t value, uint32_t *ticket = NULL);
+const char *apiQueueStatus(const char *text);
+void apiSendChunked(AsyncWebServerRequest *request, ApiItemWriter writer, const char *type = "application/json");
+int apiDoCommand();
+void apiSocketTick(bool changed);
+void apiStop();
+
+void jsonPrintString(Print *out, const char *s);
+
+#endif // API_H
@@ -0,0 +1,198 @@
+#include "Astro.h"
+#include <math.h>
+#include <time.h>
+
+#define DEG  (float)(180.0 / M_PI)
+#define RAD  (float)(M_PI / 180.0)
+
+// Earliest system time taken as set (2024-01-01), before that the
+// date is not known
+#define ASTRO_VALID_TIME  1704067200
+
+//
+// Solar declination and equation of time for a day and time
+//
+void astroSunAt(AstroSun *sun, uint16_t day, int16_t utc)
+{
+  // Days since 2000-01-01 12:00 UTC
+  float n = (int)day - 10957 + (utc - 720) / 1440.0f;
+
+  // Mean longitude, mean anomaly, ecliptic longitude and obliquity
+  float l = fmodf(280.460f + 0.9856474f * n, 360.0f);
+  float g = fmodf(357.528f + 0.9856003f * n, 360.0f) * RAD;
+  float lambda = (l + 1.915f * sinf(g) + 0.020f * sinf(2.0f * g)) * RAD;
+  float e = (23.439f - 0.0000004f * n) * RAD;
+
+  // Right ascension and declination
+  float ra = atan2f(cosf(e) * sinf(lambda), cosf(lambda)) * DEG;
+  float decl = asinf(sinf(e) * sinf(lambda));
+
+  sun->day     = day;
+  sun->utc     = utc;
+  sun->decl    = decl * DEG;
+  sun->sinDecl = sinf(decl);
+  sun->cosDecl = cosf(decl);
+  sun->eqTime  = 4.0f * remainderf(l - ra, 360.0f);
+}
+
+//
+// Sun for this minute, if the system time has been set (NTP)
+//
+bool astroSunForNow(AstroSun *sun)
+{
+  time_t now = time(NULL);
+
+  if(now < ASTRO_VALID_TIME) return(false);
+
+  uint16_t day = now / 86400;
+  int16_t utc = now % 86400 / 60;
+
+  if(sun->day != day || sun->utc != utc) astroSunAt(sun, day, utc);
+  return(true);
+}
+
+void astroPlace(AstroPlace *place, const char *name, float lat, float lon)
+{
+  place->name   = name;
+  place->lat    = lat;
+  place->lon    = lon;
+  place->sinLat = sinf(lat * RAD);
+  place->cosLat = cosf(lat * RAD);
+}
+
+//
+// Sun elevation at a place and time (minutes UTC)
+//
+float astroElevation(const AstroSun *sun, const AstroPlace *place, uint16_t utc)
+{
+  // Hour angle, from the true solar time
+  float ha = ((utc + sun->eqTime + 4.0f * place->lon) / 4.0f - 180.0f) * RAD;
+  float s  = place->sinLat * sun->sinDecl + place->cosLat * sun->cosDecl * cosf(ha);
+
+  return(asinf(fmaxf(-1.0f, fminf(1.0f, s))) * DEG);
+}
+
+uint8_t astroState(float elevation)
+{
+  return(
+    elevation >= ASTRO_RISE_SET ? ASTRO_DAY
+  : elevation >= ASTRO_TWILIGHT ? ASTRO_GREYLINE
+  : ASTRO_NIGHT
+  );
+}
+
+//
+// Time (minutes UTC, unwrapped) the sun crosses the given elevation,
+// rising or setting, or INT16_MIN if it stays above or below it
+//
+static int16_t astroCrossingAt(const AstroSun *sun, const AstroPlace *place, float elevation, bool rising)
+{
+  float d = place->cosLat * sun->cosDecl;
+  float c = d ? (sinf(elevation * RAD) - place->sinLat * sun->sinDecl) / d : 2.0f;
+
+  if(c < -1.0f || c > 1.0f) return(INT16_MIN);
+
+  float ha = acosf(c) * DEG;
+  return((int16_t)lroundf(720.0f - 4.0f * (place->lon + (rising ? ha : -ha)) - sun->eqTime));
+}
+
+//
+// Time (minutes UTC) the sun crosses the given elevation on the day,
+// rising or setting, or -1 if it stays above or below it all day
+//
+int16_t astroCrossing(const AstroSun *sun, const AstroPlace *place, float elevation, bool rising)
+{
+  AstroSun then;
+  int t = astroCrossingAt(sun, place, elevation, rising);
+
+  // Once more with the sun at that time, it moves ~0.4 deg a day
+  if(t != INT16_MIN)
+  {
+    astroSunAt(&then, sun->day, t);
+    t = astroCrossingAt(&then, place, elevation, rising);
+  }
+
+  return(t == INT16_MIN ? -1 : (int16_t)(((t % 1440) + 1440) % 1440));
+}
+
+void astroTimes(const AstroSun *sun, const AstroPlace *place, AstroTimes *times)
+{
+  times->dawn    = astroCrossing(sun, place, ASTRO_TWILIGHT, true);
+  times->sunrise = astroCrossing(sun, place, ASTRO_RISE_SET, true);
+  times->sunset  = astroCrossing(sun, place, ASTRO_RISE_SET, false);
+  times->dusk    = astroCrossing(sun, place, ASTRO_TWILIGHT, false);
+}
+
+//
+// Parse a location given as a Maidenhead locator ("JN47", "JN47pm")
+// or as latitude and longitude in degrees ("47.5,8.6"). Results are
+// in hundredths of a degree, locators give the square center.
+//
+bool astroParseLocation(const char *text, int16_t *lat, int16_t *lon)
+{
+  char l[7] = "";
+  float la, lo;
+  int n;
+
+  // Degrees
+  if(sscanf(text, " %f , %f %n", &la, &lo, &n) == 2 && !text[n])
+  {
+    if(la < -90.0f || la > 90.0f || lo < -180.0f || lo > 180.0f) return(false);
+    *lat = (int16_t)lroundf(la * 100.0f);
+    *lon = (int16_t)lroundf(lo * 100.0f);
+    return(true);
+  }
+
+  // Locator
+  if(sscanf(text, " %6s %n", l, &n) != 1 || text[n] || (strlen(l) != 4 && strlen(l) != 6))
+    return(false);
+
+  for(int i=0 ; l[i] ; i++) l[i] = i<2 || i>3 ? toupper(l[i]) : l[i];
+
+  if(l[0]<'A' || l[0]>'R' || l[1]<'A' || l[1]>'R' || !isdigit(l[2]) || !isdigit(l[3]))
+    return(false);
+
+  lo = (l[0] - 'A') * 20.0f + (l[2] - '0') * 2.0f - 180.0f;
+  la = (l[1] - 'A') * 10.0f + (l[3] - '0') * 1.0f - 90.0f;
+
+  if(!l[4])
+  {
+    lo += 1.0f;
+    la += 0.5f;
+  }
+  else
+  {
+    if(l[4]<'A' || l[4]>'X' || l[5]<'A' || l[5]>'X') return(false);
+    lo += (l[4] - 'A') * (2.0f / 24.0f) + 1.0f / 24.0f;
+    la += (l[5] - 'A') * (1.0f / 24.0f) + 0.5f / 24.0f;
+  }
+
+  *lat = (int16_t)lroundf(la * 100.0f);
+  *lon = (int16_t)lroundf(lo * 100.0f);
+  return(true);
+}
+
+//
+// Six character Maidenhead locator for a location (hundredths of a
+// degree), empty if the location is not set
+//
+void astroLocator(int16_t lat, int16_t lon, char *locator)
+{
+  if(lat==ASTRO_NO_LOCATION || lon==ASTRO_NO_LOCATION)
+  {
+    locator[0] = '\0';
+    return;
+  }
+
+  // In 1/24 of the subsquare size, kept inside the grid
+  int x = constrain((lon + 18000) * 12 / 100, 0, 18 * 240 - 1);
+  int y = constrain((lat + 9000) * 24 / 100, 0, 18 * 240 - 1);
+
+  locator[0] = 'A' + x / 240;
+  locator[1] = 'A' + y / 240;
+  locator[2] = '0' + x % 240 / 24;
+  locator[3] = '0' + y % 240 / 24;
+  locator[4] = 'a' + x % 24;
+  locator[5] = 'a' + y % 24;
+  locator[6] = '\0';
+}
@@ -0,0 +1,64 @@
+#ifndef ASTRO_H
+#define ASTRO_H
+
+#include <Arduino.h>
+
+//
+// Sun position for the offline propagation screen. Uses the low
+// precision formulas of the Astronomical Almanac (0.01 deg for years
+// 1950-2050), good to a minute for sunrise and sunset away from the
+// polar regions. Times are minutes since 00:00 UTC, angles are degrees.
+//
+
+#define ASTRO_RISE_SET    -0.833f  // Sun elevation at sunrise and sunset
+#define ASTRO_TWILIGHT    -6.0f    // Sun elevation at the end of the greyline
+
+#define ASTRO_NIGHT       0
+#define ASTRO_GREYLINE    1
+#define ASTRO_DAY         2
+
+#define ASTRO_NO_LOCATION INT16_MIN  // Location setting not set
+
+// Sun at a given time, same for all locations
+typedef struct
+{
+  uint16_t day;      // Days since 1970-01-01
+  int16_t utc;       // Minutes UTC (may be outside of the day)
+  float sinDecl;     // Sine of the solar declination
+  float cosDecl;     // Cosine of the solar declination
+  float decl;        // Solar declination
+  float eqTime;      // Equation of time (minutes)
+} AstroSun;
+
+// A place on Earth, with its latitude terms computed once
+typedef struct
+{
+  const char *name;
+  float lat;
+  float lon;
+  float sinLat;
+  float cosLat;
+} AstroPlace;
+
+// Sunrise, sunset and greyline for a place and day
+typedef struct
+{
+  int16_t dawn;      // Greyline start (-1 - none)
+  int16_t sunrise;   // (-1 - none)
+  int16_t sunset;    // (-1 - none)
+  int16_t dusk;      // Greyline end (-1 - none)
+} AstroTimes;
+
+void astroSunAt(AstroSun *sun, uint16_t day, int16_t utc);
+bool astroSunForNow(AstroSun *sun);
+void astroPlace(AstroPlace *place, const char *name, float lat, float lon);
+
+float astroElevation(const AstroSun *sun, const AstroPlace *place, uint16_t utc);
+uint8_t astroState(float elevation);
+int16_t astroCrossing(const AstroSun *sun, const AstroPlace *place, float elevation, bool rising);
+void astroTimes(const AstroSun *sun, const AstroPlace *place, AstroTimes *times);
+
+bool astroParseLocation(const char *text, int16_t *lat, int16_t *lon);
+void astroLocator(int16_t lat, int16_t lon, char *locator);
+
+#endif // ASTRO_H
@@ -1,6 +1,7 @@
 #include "Common.h"
 #include "Themes.h"
 #include "Utils.h"
+#include "Metrics.h"
 
 #define VBAT_MON  4                 // GPIO04 -- Battery Monitor PIN
 
@@ -10,13 +11,17 @@
 #define BATT_SOC_LEVEL2      3.780  // Battery SOC voltage for 50%
 #define BATT_SOC_LEVEL3      3.880  // Battery SOC voltage for 75%
 #define BATT_SOC_HYST_2      0.020  // Battery SOC hyteresis voltage divided by 2
+#define BATT_CACHE_TIME       1000  // Lifetime of a cached measurement (ms)
 
 // State machine used for battery state of charge (SOC) detection with
 // hysteresis (Default = Illegal state)
 static uint8_t batteryState = 255;
 
-// Current battery voltage
+// Current battery voltage and the time it was measured
 static float batteryVolts = 4.0;
+static uint32_t batteryTime = 0;
+
+static Metric metricBattery("atsmini_battery_volts", "Battery voltage", METRIC_GAUGE);
 
 //
 // Measure and return battery voltage
@@ -30,6 +35,8 @@ float batteryMonitor()
 
   // Calculate average voltage with correction factor
   batteryVolts = ((float)j / BATT_ADC_READS) * BATT_ADC_FACTOR / 1000;
+  batteryTime  = millis();
+  metricBattery.set(batteryVolts);
 
   // State machine
   // SOC (%)      batteryState
@@ -62,6 +69,16 @@ float batteryMonitor()
   return(batteryVolts);
 }
 
+//
+// Return battery voltage, measuring it again only if the last
+// measurement is older than BATT_CACHE_TIME
+//
+float batteryVoltage()
+{
+  if(!batteryTime || millis() - batteryTime >= BATT_CACHE_TIME) batteryMonitor();
+  return(batteryVolts);
+}
+
 //
 // Show last measured battery voltage and status at given screen
 // coordinates. Return true if voltage was drawn.
@@ -0,0 +1,406 @@
+#include "Common.h"
+#include "Utils.h"
+#include "Menu.h"
+#include "Binary.h"
+
+//
+// Response being built
+//
+typedef struct
+{
+  uint8_t data[BIN_MAX_RESPONSE];
+  uint16_t length;
+  int event;
+} BinaryResponse;
+
+static BinaryResponse resp;
+
+// Encoded response, with COBS overhead and the terminating zero
+static uint8_t respFrame[BIN_MAX_RESPONSE + BIN_MAX_RESPONSE / 254 + 2];
+
+//
+// CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF)
+//
+uint16_t binaryCrc16(const uint8_t *data, size_t length, uint16_t crc)
+{
+  while(length--)
+  {
+    crc ^= (uint16_t)*data++ << 8;
+    for(int i=0 ; i<8 ; i++)
+      crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+
+  return(crc);
+}
+
+//
+// COBS encode given data, returns encoded length (without the
+// terminating zero)
+//
+size_t cobsEncode(const uint8_t *src, size_t length, uint8_t *dst)
+{
+  size_t code = 0;
+  size_t out  = 1;
+
+  for(size_t i=0 ; i<length ; i++)
+  {
+    if(src[i])
+      dst[out++] = src[i];
+
+    // Close the block on a zero or when it reaches 254 bytes
+    if(!src[i] || out - code == 0xFF)
+    {
+      dst[code] = out - code;
+      code = out++;
+    }
+  }
+
+  dst[code] = out - code;
+  return(out);
+}
+
+//
+// COBS decode given data in place, returns decoded length or -1
+//
+int cobsDecode(uint8_t *buf, size_t length)
+{
+  size_t in  = 0;
+  size_t out = 0;
+
+  while(in < length)
+  {
+    uint8_t code = buf[in++];
+
+    if(!code || in + code - 1 > length) return(-1);
+
+    for(int i=1 ; i<code ; i++) buf[out++] = buf[in++];
+
+    // Blocks shorter than 254 bytes imply a zero, except the last one
+    if(code < 0xFF && in < length) buf[out++] = 0;
+  }
+
+  return(out);
+}
+
+static inline uint16_t getU16(const uint8_t *p)
+{
+  return(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t getU32(const uint8_t *p)
+{
+  return(p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24));
+}
+
+static void putU8(uint8_t value)
+{
+  // Leave room for the header and CRC
+  if(resp.length < sizeof(resp.data) - 6) resp.data[resp.length++] = value;
+}
+
+static void putU16(uint16_t value)
+{
+  putU8(value);
+  putU8(value >> 8);
+}
+
+static void putU32(uint32_t value)
+{
+  putU16(value);
+  putU16(value >> 16);
+}
+
+static void putString(const char *str)
+{
+  size_t length = strlen(str);
+  putU8(length);
+  while(length--) putU8(*str++);
+}
+
+static void putStatus(uint8_t op, uint8_t status)
+{
+  putU8(op);
+  putU8(status);
+  putU8(BIN_T_NONE);
+}
+
+static void putMemory(uint8_t op, uint8_t slot)
+{
+  const Memory *mem = &memories[slot - 1];
+  putU8(op);
+  putU8(BIN_OK);
+  putU8(BIN_T_MEMORY);
+  putU8(slot);
+  putU8(mem->band);
+  putU8(mem->mode);
+  putU32(mem->freq);
+}
+
+static void putValue(uint8_t op, uint8_t type, uint32_t value)
+{
+  putU8(op);
+  putU8(BIN_OK);
+  putU8(type);
+  switch(type)
+  {
+    case BIN_T_U8:  putU8(value);  break;
+    case BIN_T_U16: putU16(value); break;
+    case BIN_T_U32: putU32(value); break;
+  }
+}
+
+//
+// Set memory slot contents (zero frequency clears the slot)
+//
+static bool setMemory(uint8_t slot, uint8_t band, uint8_t mode, uint32_t freq)
+{
+  Memory mem = { freq, band, mode };
+
+  if(band >= getTotalBands() || mode >= getTotalModes()) return(false);
+  if(freq && !isMemoryInBand(&bands[band], &mem)) return(false);
+
+  memories[slot - 1] = mem;
+  return(true);
+}
+
+//
+// Get number of argument bytes for given operation, -1 if unknown
+//
+static int binaryArgLength(uint8_t op)
+{
+  bool set = op & BIN_SET;
+
+  switch(op & ~BIN_SET)
+  {
+    case BIN_OP_FREQ:      return(set ? 4 : 0);
+    case BIN_OP_MODE:
+    case BIN_OP_BAND:
+    case BIN_OP_BANDWIDTH:
+    case BIN_OP_AGC:
+    case BIN_OP_VOLUME:    return(set ? 1 : 0);
+    case BIN_OP_MEMORY:    return(set ? 7 : 1);
+    case BIN_OP_BANDNAME:  return(1);
+    case BIN_OP_RSSI:
+    case BIN_OP_SNR:
+    case BIN_OP_VERSION:   return(0);
+  }
+
+  return(-1);
+}
+
+//
+// Execute a single operation and add its result to the response
+//
+static void binaryDoOp(uint8_t op, const uint8_t *args)
+{
+  bool set = op & BIN_SET;
+  uint8_t arg = args[0];
+  uint16_t start = resp.length;
+
+  switch(op & ~BIN_SET)
+  {
+    case BIN_OP_FREQ:
+      if(set && !tuneToFrequency(getU32(args), false))
+        putStatus(op, BIN_ERR_RANGE);
+      else
+        putValue(op, BIN_T_U32, getCurrentFrequencyHz());
+      break;
+
+    case BIN_OP_MODE:
+      if(set && !selectMode(arg))
+        putStatus(op, BIN_ERR_RANGE);
+      else
+        putValue(op, BIN_T_U8, currentMode);
+      break;
+
+    case BIN_OP_BAND:
+      if(set && arg >= getTotalBands())
+        putStatus(op, BIN_ERR_RANGE);
+      else
+      {
+        if(set && arg != bandIdx) doBand(arg - bandIdx);
+        putValue(op, BIN_T_U8, bandIdx);
+      }
+      break;
+
+    case BIN_OP_BANDWIDTH:
+      if(set && arg > getLastBandwidth(currentMode))
+        putStatus(op, BIN_ERR_RANGE);
+      else
+      {
+        if(set) doBandwidth(arg - getCurrentBand()->bandwidthIdx);
+        putValue(op, BIN_T_U8, getCurrentBand()->bandwidthIdx);
+      }
+      break;
+
+    case BIN_OP_AGC:
+      if(set && arg > getLastAgc())
+        putStatus(op, BIN_ERR_RANGE);
+      else
+      {
+        if(set) doAgc(arg - agcIdx);
+        putValue(op, BIN_T_U8, agcIdx);
+      }
+      break;
+
+    case BIN_OP_VOLUME:
+      if(set && arg > 63)
+        putStatus(op, BIN_ERR_RANGE);
+      else
+      {
+        if(set) doVolume(arg - volume);
+        putValue(op, BIN_T_U8, volume);
+      }
+      break;
+
+    case BIN_OP_MEMORY:
+      if(arg < 1 || arg > getTotalMemories())
+        putStatus(op, BIN_ERR_RANGE);
+      else if(set && !setMemory(arg, args[1], args[2], getU32(args + 3)))
+        putStatus(op, BIN_ERR_RANGE);
+      else
+        putMemory(op, arg);
+      break;
+
+    case BIN_OP_BANDNAME:
+      if(set)
+        putStatus(op, BIN_ERR_READONLY);
+      else if(arg >= getTotalBands())
+        putStatus(op, BIN_ERR_RANGE);
+      else
+      {
+        putU8(op);
+        putU8(BIN_OK);
+        putU8(BIN_T_STR);
+        putString(bands[arg].bandName);
+      }
+      break;
+
+    case BIN_OP_RSSI:
+      if(set) putStatus(op, BIN_ERR_READONLY); else putValue(op, BIN_T_U8, rssi);
+      break;
+
+    case BIN_OP_SNR:
+      if(set) putStatus(op, BIN_ERR_READONLY); else putValue(op, BIN_T_U8, snr);
+      break;
+
+    case BIN_OP_VERSION:
+      if(set) putStatus(op, BIN_ERR_READONLY); else putValue(op, BIN_T_U16, VER_APP);
+      break;
+  }
+
+  // Changing settings requires a redraw and saving preferences
+  if(set && resp.data[start + 1] == BIN_OK) resp.event |= REMOTE_CHANGED | REMOTE_PREFS;
+}
+
+//
+// Send response frame
+//
+static void binarySend(Stream* stream, uint16_t id)
+{
+  uint16_t length = resp.length;
+  uint8_t hdr[4] = { (uint8_t)id, (uint8_t)(id >> 8), (uint8_t)length, (uint8_t)(length >> 8) };
+  uint16_t crc = binaryCrc16(resp.data, length, binaryCrc16(hdr, 4));
+
+  // Make room for the header in front of the body
+  memmove(resp.data + 4, resp.data, length);
+  memcpy(resp.data, hdr, 4);
+  resp.data[length + 4] = crc;
+  resp.data[length + 5] = crc >> 8;
+
+  size_t size = cobsEncode(resp.data, length + 6, respFrame);
+  respFrame[size++] = 0;
+  stream->write(respFrame, size);
+}
+
+//
+// Process a complete encoded frame
+//
+static int binaryProcessFrame(Stream* stream, uint8_t *buf, size_t size)
+{
+  int length = cobsDecode(buf, size);
+  uint16_t id = length >= 2 ? getU16(buf) : 0;
+
+  resp.length = 0;
+  resp.event  = 0;
+
+  if(length < 6 || getU16(buf + 2) != length - 6)
+    putStatus(BIN_OP_FRAME, BIN_ERR_LENGTH);
+  else if(binaryCrc16(buf, length - 2) != getU16(buf + length - 2))
+    putStatus(BIN_OP_FRAME, BIN_ERR_CRC);
+  else
+  {
+    const uint8_t *p   = buf + 4;
+    const uint8_t *end = buf + length - 2;
+    int ops = 0;
+
+    while(p < end)
+    {
+      if(++ops > BIN_MAX_OPS)
+      {
+        putStatus(BIN_OP_FRAME, BIN_ERR_LIMIT);
+        break;
+      }
+
+      uint8_t op = *p++;
+      int length = binaryArgLength(op);
+
+      // Can not skip unknown or truncated operations, stop here
+      if(length < 0)
+      {
+        putStatus(op, BIN_ERR_OP);
+        break;
+      }
+      if(length > end - p)
+      {
+        putStatus(op, BIN_ERR_ARGS);
+        break;
+      }
+
+      binaryDoOp(op, p);
+      p += length;
+    }
+  }
+
+  binarySend(stream, id);
+  return(resp.event);
+}
+
+//
+// Receive binary frames and execute them, does not block
+//
+int binaryDoCommand(Stream* stream, BinaryState* state)
+{
+  int event = 0;
+
+  while(stream->available())
+  {
+    int c = stream->read();
+    if(c < 0) break;
+
+    if(c)
+    {
+      // Collect frame data until the terminating zero
+      if(state->length < sizeof(state->buf))
+        state->buf[state->length++] = c;
+      else
+        state->overflow = true;
+    }
+    else if(state->overflow)
+    {
+      // Frame too large, report and drop it
+      resp.length = 0;
+      putStatus(BIN_OP_FRAME, BIN_ERR_SIZE);
+      binarySend(stream, 0);
+      state->length   = 0;
+      state->overflow = false;
+    }
+    else if(state->length)
+    {
+      event |= binaryProcessFrame(stream, state->buf, state->length);
+      state->length = 0;
+    }
+  }
+
+  return(event);
+}
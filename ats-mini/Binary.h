@@ -0,0 +1,70 @@
+#ifndef BINARY_H
+#define BINARY_H
+
+#include <Arduino.h>
+
+//
+// Binary remote protocol. Each frame is COBS encoded and terminated
+// with a zero byte. A decoded frame is:
+//
+//   id (u16) | length (u16) | body (length bytes) | crc (u16)
+//
+// All numbers are little endian. The CRC is CRC-16/CCITT-FALSE over
+// the id, length and body. A request body is a batch of operations,
+// each one an opcode optionally ORed with BIN_SET and followed by its
+// arguments. The response carries the same id and, for each operation,
+// the opcode, a status and a typed value.
+//
+
+#define BIN_MAX_FRAME     256 // Largest decoded request frame (bytes)
+#define BIN_MAX_OPS        48 // Largest number of operations per request
+#define BIN_MAX_RESPONSE 1024 // Largest decoded response frame (bytes)
+
+// Operations (get: no arguments unless noted, set: BIN_SET | op)
+#define BIN_OP_FRAME     0x00 // Frame error report (response only)
+#define BIN_OP_FREQ      0x01 // Frequency, set: u32 Hz
+#define BIN_OP_MODE      0x02 // Mode (FM/LSB/USB/AM), set: u8
+#define BIN_OP_BAND      0x03 // Band index, set: u8
+#define BIN_OP_BANDWIDTH 0x04 // Bandwidth index, set: u8
+#define BIN_OP_AGC       0x05 // AGC/attenuator index, set: u8
+#define BIN_OP_VOLUME    0x06 // Volume (0..63), set: u8
+#define BIN_OP_MEMORY    0x07 // Memory slot, get: u8 slot, set: u8 slot, u8 band, u8 mode, u32 Hz
+#define BIN_OP_RSSI      0x08 // RSSI (dBuV), get only
+#define BIN_OP_SNR       0x09 // SNR (dB), get only
+#define BIN_OP_BANDNAME  0x0A // Band name, get: u8 band
+#define BIN_OP_VERSION   0x0B // Firmware version, get only
+#define BIN_SET          0x80
+
+// Response status
+#define BIN_OK           0
+#define BIN_ERR_OP       1 // Unknown operation, rest of the batch skipped
+#define BIN_ERR_ARGS     2 // Truncated arguments, rest of the batch skipped
+#define BIN_ERR_RANGE    3 // Value out of range
+#define BIN_ERR_READONLY 4 // Value can not be set
+#define BIN_ERR_CRC      5 // Frame CRC mismatch (BIN_OP_FRAME)
+#define BIN_ERR_LENGTH   6 // Frame length mismatch (BIN_OP_FRAME)
+#define BIN_ERR_SIZE     7 // Frame too large (BIN_OP_FRAME)
+#define BIN_ERR_LIMIT    8 // Too many operations (BIN_OP_FRAME)
+
+// Response value types
+#define BIN_T_NONE       0 // No value
+#define BIN_T_U8         1 // u8
+#define BIN_T_U16        2 // u16
+#define BIN_T_U32        3 // u32
+#define BIN_T_STR        4 // u8 length, characters
+#define BIN_T_MEMORY     5 // u8 slot, u8 band, u8 mode, u32 Hz (0 = empty)
+
+typedef struct
+{
+  // Encoded frame being received, with COBS overhead
+  uint8_t buf[BIN_MAX_FRAME + BIN_MAX_FRAME / 254 + 2];
+  uint16_t length;
+  bool overflow;
+} BinaryState;
+
+uint16_t binaryCrc16(const uint8_t *data, size_t length, uint16_t crc = 0xFFFF);
+size_t cobsEncode(const uint8_t *src, size_t length, uint8_t *dst);
+int cobsDecode(uint8_t *buf, size_t length);
+int binaryDoCommand(Stream* stream, BinaryState* state);
+
+#endif // BINARY_H
@@ -0,0 +1,191 @@
+#include "Common.h"
+#include "Themes.h"
+#include "Chrome.h"
+
+//
+// Side bar boxes (anti-aliased frames, headers, static labels) do not
+// change between frames. They are rendered once into a cached sprite
+// and copied to the screen, until the theme or the box changes. The
+// rounded corners blend into whatever is behind the box, so they are
+// not copied but drawn in place every time.
+//
+// With PALETTE_SPRITE, copying has to map every run of pixels through
+// the palette, which costs more than drawing the box, so boxes are
+// always drawn directly.
+//
+
+//
+// Draw side bar box directly into the screen sprite
+//
+static void drawChromeDirect(uint8_t kind, const char *title, bool cursor, int x, int y, int sx)
+{
+  if(kind == CHROME_MENU)
+  {
+    spr.fillSmoothRoundRect(1+x, 1+y, 76+sx, 110, 4, TH.menu_border);
+    spr.fillSmoothRoundRect(2+x, 2+y, 74+sx, 108, 4, TH.menu_bg);
+
+    spr.setTextDatum(MC_DATUM);
+    spr.setTextColor(TH.menu_hdr);
+    spr.drawString(title, 40+x+(sx/2), 12+y, 2);
+    spr.drawLine(1+x, 23+y, 76+x+sx, 23+y, TH.menu_border);
+
+    if(cursor)
+      spr.fillRoundRect(6+x, 24+y+(2*16), 66+sx, 16, 2, TH.menu_hl_bg);
+  }
+  else
+  {
+    spr.fillSmoothRoundRect(1+x, 1+y, 76+sx, 110, 4, TH.box_border);
+    spr.fillSmoothRoundRect(2+x, 2+y, 74+sx, 108, 4, TH.box_bg);
+
+    spr.setTextDatum(ML_DATUM);
+    spr.setTextColor(TH.box_text);
+    spr.drawString("Step:", 6+x, 64+y+(-3*16), 2);
+    spr.drawString("BW:", 6+x, 64+y+(-2*16), 2);
+    spr.drawString("Vol:", 6+x, 64+y+(0*16), 2);
+  }
+}
+
+#ifndef PALETTE_SPRITE
+
+typedef struct
+{
+  const char *title;    // Header (CHROME_MENU only)
+  bool cursor;          // TRUE: highlighted item bar
+  int8_t sx;            // Box width delta
+  uint16_t colors[4];   // Theme colors used
+} ChromeKey;
+
+static TFT_eSprite chromeSpr[2] = { TFT_eSprite(&tft), TFT_eSprite(&tft) };
+static ChromeKey chromeKey[2];
+
+static void renderChrome(uint8_t kind, TFT_eSprite &s, int sx)
+{
+  const ChromeKey &key = chromeKey[kind];
+
+  // Drawn at (-1, -1), so that the frame starts at the sprite origin
+  s.fillSprite(TH.bg);
+
+  if(kind == CHROME_MENU)
+  {
+    s.fillSmoothRoundRect(0, 0, 76+sx, 110, 4, TH.menu_border);
+    s.fillSmoothRoundRect(1, 1, 74+sx, 108, 4, TH.menu_bg);
+
+    s.setTextDatum(MC_DATUM);
+    s.setTextColor(TH.menu_hdr);
+    s.drawString(key.title, 39+(sx/2), 11, 2);
+    s.drawLine(0, 22, 75+sx, 22, TH.menu_border);
+
+    if(key.cursor)
+      s.fillRoundRect(5, 23+(2*16), 66+sx, 16, 2, TH.menu_hl_bg);
+  }
+  else
+  {
+    s.fillSmoothRoundRect(0, 0, 76+sx, 110, 4, TH.box_border);
+    s.fillSmoothRoundRect(1, 1, 74+sx, 108, 4, TH.box_bg);
+
+    s.setTextDatum(ML_DATUM);
+    s.setTextColor(TH.box_text);
+    s.drawString("Step:", 5, 63+(-3*16), 2);
+    s.drawString("BW:", 5, 63+(-2*16), 2);
+    s.drawString("Vol:", 5, 63+(0*16), 2);
+  }
+}
+
+//
+// Copy cached box to the screen sprite at (x, y), except for the
+// corner squares. Returns FALSE if the box does not fit.
+//
+static bool compositeChrome(TFT_eSprite &s, int x, int y)
+{
+  int w = s.width();
+  int h = s.height();
+
+  // Both sprites hold byte-swapped RGB565, copy whole lines
+  if(x < 0 || x+w > spr.width()) return(false);
+
+  for(int j=0 ; j<h ; j++)
+  {
+    int corner = (j < CHROME_CORNER || j >= h - CHROME_CORNER) ? CHROME_CORNER : 0;
+
+    if(y+j < 0 || y+j >= spr.height()) continue;
+
+    uint16_t *src = (uint16_t *)s.getPointer() + j * w + corner;
+    uint16_t *dst = (uint16_t *)spr.getPointer() + (y+j) * spr.width() + x + corner;
+    memcpy(dst, src, (w - 2 * corner) * sizeof(uint16_t));
+  }
+
+  return(true);
+}
+
+//
+// Draw box frame into the screen sprite, clipped to the corner
+// squares, so that the edges blend with the actual background
+//
+static void drawCorners(uint16_t border, uint16_t bg, int x, int y, int w, int h)
+{
+  const int cx[2] = { x, x + w - CHROME_CORNER };
+  const int cy[2] = { y, y + h - CHROME_CORNER };
+
+  for(int j=0 ; j<4 ; j++)
+  {
+    spr.setViewport(cx[j & 1], cy[j >> 1], CHROME_CORNER, CHROME_CORNER, false);
+    spr.fillSmoothRoundRect(x, y, w, h, 4, border);
+    spr.fillSmoothRoundRect(x+1, y+1, w-2, h-2, 4, bg);
+  }
+
+  spr.resetViewport();
+}
+
+#endif // !PALETTE_SPRITE
+
+//
+// Draw side bar box, using the cached copy if possible
+//
+void drawChrome(uint8_t kind, const char *title, bool cursor, int x, int y, int sx)
+{
+#ifdef PALETTE_SPRITE
+  drawChromeDirect(kind, title, cursor, x, y, sx);
+#else
+  ChromeKey key;
+  TFT_eSprite &s = chromeSpr[kind];
+
+  memset(&key, 0, sizeof(key));
+  key.title  = kind == CHROME_MENU ? title : 0;
+  key.cursor = kind == CHROME_MENU && cursor;
+  key.sx     = sx;
+
+  if(kind == CHROME_MENU)
+  {
+    key.colors[0] = TH.menu_border;
+    key.colors[1] = TH.menu_bg;
+    key.colors[2] = TH.menu_hdr;
+    key.colors[3] = TH.menu_hl_bg;
+  }
+  else
+  {
+    key.colors[0] = TH.box_border;
+    key.colors[1] = TH.box_bg;
+    key.colors[2] = TH.box_text;
+  }
+
+  // Re-render if anything has changed
+  if(!s.created() || memcmp(&key, &chromeKey[kind], sizeof(key)))
+  {
+    if(s.created() && s.width() != 76+sx) s.deleteSprite();
+    if(!s.created() && !s.createSprite(76+sx, 110))
+    {
+      // Out of memory, draw directly
+      drawChromeDirect(kind, title, cursor, x, y, sx);
+      return;
+    }
+
+    chromeKey[kind] = key;
+    renderChrome(kind, s, sx);
+  }
+
+  if(!compositeChrome(s, 1+x, 1+y))
+    drawChromeDirect(kind, title, cursor, x, y, sx);
+  else
+    drawCorners(key.colors[0], key.colors[1], 1+x, 1+y, 76+sx, 110);
+#endif
+}
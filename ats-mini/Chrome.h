@@ -0,0 +1,12 @@
+#ifndef CHROME_H
+#define CHROME_H
+
+#include <Arduino.h>
+
+#define CHROME_MENU    0  // Menu box with a header
+#define CHROME_INFO    1  // Information box
+#define CHROME_CORNER  5  // Rounded corner squares, drawn in place
+
+void drawChrome(uint8_t kind, const char *title, bool cursor, int x, int y, int sx);
+
+#endif // CHROME_H
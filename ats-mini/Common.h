@@ -15,6 +15,10 @@
 #include <TFT_eSPI.h>
 #include <SI4735-fixed.h>
 
+#ifdef PALETTE_SPRITE
+#include "Palette.h"
+#endif
+
 #define RECEIVER_DESC  "ESP32-SI4732 Receiver"
 #define RECEIVER_NAME  "ATS-Mini"
 #define FIRMWARE_URL   "https://github.com/esp32-si4732/ats-mini"
@@ -25,9 +29,9 @@
 #define AUTHORS_LINE4  "Marat Fayzullin"
 
 #define VER_APP        233  // Firmware version
-#define VER_SETTINGS   71   // Settings version
-#define VER_MEMORIES   71   // Memories version
-#define VER_BANDS      72   // Bands version
+#define VER_SETTINGS   72   // Settings version
+#define VER_MEMORIES   72   // Memories version
+#define VER_BANDS      73   // Bands version
 
 // Modes
 #define FM            0
@@ -93,6 +97,8 @@
 #define USB_OFF        0 // USB is disabled
 #define USB_ADHOC      1 // Ad hoc serial protocol
 #define USB_RIGCTL     2 // Hamlib RigCtl protocol
+#define USB_BINARY     3 // Binary framed protocol
+#define USB_KENWOOD    4 // Kenwood TS-480 CAT protocol
 
 //
 // Data Types
@@ -145,7 +151,11 @@ typedef struct
 //
 
 extern SI4735_fixed rx;
+#ifdef PALETTE_SPRITE
+extern PaletteSprite spr;
+#else
 extern TFT_eSprite spr;
+#endif
 extern TFT_eSPI tft;
 
 extern bool pushAndRotate;
@@ -166,6 +176,7 @@ extern bool zoomMenu;
 extern int8_t scrollDirection;
 extern uint8_t utcOffsetIdx;
 extern uint8_t uiLayoutIdx;
+extern uint8_t historyZoomIdx;
 
 extern int8_t FmAgcIdx;
 extern int8_t AmAgcIdx;
@@ -201,6 +212,7 @@ bool checkStopSeeking();
 
 // Battery.c
 float batteryMonitor();
+float batteryVoltage();
 bool drawBattery(int x, int y);
 
 // Scan.c
@@ -227,13 +239,22 @@ bool ntpIsAvailable();
 bool ntpSyncTime();
 
 void netRequestConnect();
-void netTickTime();
+bool netTickTime();
+bool netGetStatus(const char **statusLine1, const char **statusLine2);
+
+// Propagation.cpp
+extern uint8_t propRefresh;
+extern int16_t locationLat;
+extern int16_t locationLon;
 void updatePropagationData();
+bool propagationBusy();
+bool propagationTickTime();
 
 // Remote.c
 #define REMOTE_CHANGED   1
 #define REMOTE_CLICK     2
 #define REMOTE_PREFS     4
+#define REMOTE_CLOSE    16
 #define REMOTE_DIRECTION 8
 
 #endif // COMMON_H
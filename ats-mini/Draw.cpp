@@ -5,6 +5,7 @@
 #include "Menu.h"
 //#include "Ble.h"
 #include "Draw.h"
+#include "Profile.h"
 
 //
 // Draw preferences write indicator
@@ -75,6 +76,9 @@ void drawWiFiIndicator(int x, int y)
 //
 bool drawWiFiStatus(const char *statusLine1, const char *statusLine2, int x, int y)
 {
+  // Show connection progress unless given other status
+  if(!statusLine1 && !statusLine2) netGetStatus(&statusLine1, &statusLine2);
+
   if(statusLine1 || statusLine2)
   {
     // Draw two lines of network status
@@ -314,7 +318,7 @@ void drawScale(uint32_t freq)
 //
 // Draw S-meter
 //
-void drawSMeter(int strength, int x, int y)
+void drawSMeter(int strength, int x, int y, int peak)
 {
   spr.drawTriangle(x + 1, y + 1, x + 11, y + 1, x + 6, y + 6, TH.smeter_icon);
   spr.drawLine(x + 6, y + 1, x + 6, y + 14, TH.smeter_icon);
@@ -326,6 +330,10 @@ void drawSMeter(int strength, int x, int y)
     else
       spr.fillRect(15+x + (i*4), 2+y, 2, 12, TH.smeter_bar_plus);
   }
+
+  // Peak hold marker
+  if(peak > strength)
+    spr.fillRect(15+x + ((peak-1)*4), 2+y, 2, 12, TH.smeter_icon);
 }
 
 //
@@ -428,6 +436,42 @@ void drawScanGraphs(uint32_t freq)
 
 #include "Beacons.h"
 
+//
+// Signal meters drawn on the last full screen, so that they can be
+// updated without redrawing everything else
+//
+static void (*meterDraw)() = 0;
+static int16_t meterX, meterY, meterW, meterH;
+
+//
+// Draw signal meters occupying given screen area, remembering them
+// for the subsequent drawMeters() calls
+//
+void drawMeterArea(void (*draw)(), int x, int y, int w, int h)
+{
+  meterDraw = draw;
+  meterX = x;
+  meterY = y;
+  meterW = w;
+  meterH = h;
+  draw();
+}
+
+//
+// Redraw and push signal meters alone. Returns false if the current
+// screen has no separately updatable meters.
+//
+bool drawMeters()
+{
+  if(sleepOn()) return(true);
+  if(!meterDraw) return(false);
+
+  spr.fillRect(meterX, meterY, meterW, meterH, TH.bg);
+  meterDraw();
+  spr.pushSprite(meterX, meterY, meterX, meterY, meterW, meterH);
+  return(true);
+}
+
 //
 // Draw screen according to given command
 //
@@ -435,25 +479,45 @@ void drawScreen(const char *statusLine1, const char *statusLine2)
 {
   if(sleepOn()) return;
 
+  // Layouts register their meters again
+  meterDraw = 0;
+
+  PROFILE_BEGIN(
+    currentCmd==CMD_ABOUT?   PROF_UI_ABOUT :
+    currentCmd==CMD_PROPAG?  PROF_UI_PROPAG :
+    currentCmd==CMD_UTILITY? PROF_UI_UTILITY :
+    uiLayoutIdx==UI_SMETER?  PROF_UI_SMETER :
+    uiLayoutIdx==UI_WATERFALL? PROF_UI_WATERFALL : PROF_UI_DEFAULT
+  );
+
   // Clear screen buffer
   spr.fillSprite(TH.bg);
+  PROFILE_LAP(PROF_CLEAR);
 
   // About screen is a special case
+  // (these screens push the sprite themselves, push time is
+  // counted as widgets)
   if(currentCmd==CMD_ABOUT)
   {
     drawAbout();
+    PROFILE_LAP(PROF_WIDGETS);
+    PROFILE_END();
     return;
   }
   
   if(currentCmd==CMD_PROPAG)
   {
     drawPropagation();
+    PROFILE_LAP(PROF_WIDGETS);
+    PROFILE_END();
     return;
   }
   
   if(currentCmd==CMD_UTILITY)
   {
     drawUtility();
+    PROFILE_LAP(PROF_WIDGETS);
+    PROFILE_END();
     return;
   }
 
@@ -471,4 +535,6 @@ void drawScreen(const char *statusLine1, const char *statusLine2)
   }
 
   spr.pushSprite(0, 0);
+  PROFILE_LAP(PROF_PUSH);
+  PROFILE_END();
 }
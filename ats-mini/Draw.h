@@ -36,6 +36,8 @@ void drawMessage(const char *msg);
 void drawZoomedMenu(const char *text, bool force = false);
 void drawScanGraphs(uint32_t freq);
 void drawScreen(const char *statusLine1 = 0, const char *statusLine2 = 0);
+void drawMeterArea(void (*draw)(), int x, int y, int w, int h);
+bool drawMeters();
 
 void drawWiFiIndicator(int x, int y);
 void drawSaveIndicator(int x, int y);
@@ -44,7 +46,7 @@ void drawBandAndMode(const char *band, const char *mode, int x, int y);
 void drawFrequency(uint32_t freq, int x, int y, int ux, int uy, uint8_t hl);
 void drawLongStationName(const char *name, int x, int y);
 void drawStationName(const char *name, int x, int y);
-void drawSMeter(int strength, int x, int y);
+void drawSMeter(int strength, int x, int y, int peak = 0);
 void drawStereoIndicator(int x, int y, bool stereo = true);
 bool drawWiFiStatus(const char *statusLine1, const char *statusLine2, int x, int y);
 void drawRadioText(int y, int ymax);
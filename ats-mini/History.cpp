@@ -0,0 +1,212 @@
+#include "Common.h"
+#include "History.h"
+
+//
+// Signal history is kept as a cascade of rings. Raw RSSI/SNR samples
+// are collected into one second buckets (level 0), every 10 level 0
+// buckets make one level 1 entry, and every 6 level 1 buckets make
+// one level 2 entry. Sums and sample counts are carried up the
+// cascade, so means at every level are exact.
+//
+
+struct HistoryAcc
+{
+  uint8_t  min;
+  uint8_t  max;
+  uint32_t sum;
+  uint32_t count;
+};
+
+struct HistoryLevel
+{
+  const char *desc;     // Zoom level name
+  HistoryEntry *ring;   // Entries, oldest overwritten first
+  uint16_t length;      // Ring size
+  uint16_t period;      // Seconds per entry
+  uint8_t  ratio;       // Lower level entries per entry (0 = raw samples)
+  uint8_t  parts;       // Lower level entries accumulated so far
+  uint16_t head;        // Next entry to write
+  uint16_t count;       // Valid entries
+  HistoryAcc rssi;      // Current bucket
+  HistoryAcc snr;
+};
+
+static HistoryEntry ring5min[300];
+static HistoryEntry ring1hour[360];
+static HistoryEntry ring24hour[1440];
+
+static HistoryLevel levels[HISTORY_LEVELS] =
+{
+  { "5 min",    ring5min,   ITEM_COUNT(ring5min),   1,  0 },
+  { "1 hour",   ring1hour,  ITEM_COUNT(ring1hour),  10, 10 },
+  { "24 hours", ring24hour, ITEM_COUNT(ring24hour), 60, 6 },
+};
+
+static uint32_t nextTick = 0;
+static bool historyInit = false;
+static bool haveSample = false;
+static uint8_t lastRssi = 0;
+static uint8_t lastSnr  = 0;
+
+static void accReset(HistoryAcc *acc)
+{
+  acc->min   = 0xFF;
+  acc->max   = 0;
+  acc->sum   = 0;
+  acc->count = 0;
+}
+
+static void accAdd(HistoryAcc *acc, uint8_t min, uint8_t max, uint32_t sum, uint32_t count)
+{
+  acc->min    = min < acc->min ? min : acc->min;
+  acc->max    = max > acc->max ? max : acc->max;
+  acc->sum   += sum;
+  acc->count += count;
+}
+
+static HistoryValue accValue(const HistoryAcc *acc)
+{
+  HistoryValue v;
+  v.min  = acc->min;
+  v.max  = acc->max;
+  v.mean = (acc->sum + acc->count / 2) / acc->count;
+  return(v);
+}
+
+//
+// Close current bucket at given level, store it, and pass it up
+// the cascade. Returns bitmask of levels that got a new entry.
+//
+static uint8_t historyCommit(uint8_t level)
+{
+  HistoryLevel *l = &levels[level];
+  uint8_t result = 1 << level;
+
+  l->ring[l->head].rssi = accValue(&l->rssi);
+  l->ring[l->head].snr  = accValue(&l->snr);
+  l->head = (l->head + 1) % l->length;
+  if(l->count < l->length) l->count++;
+
+  if(level + 1 < HISTORY_LEVELS)
+  {
+    HistoryLevel *up = &levels[level + 1];
+    accAdd(&up->rssi, l->rssi.min, l->rssi.max, l->rssi.sum, l->rssi.count);
+    accAdd(&up->snr, l->snr.min, l->snr.max, l->snr.sum, l->snr.count);
+    if(++up->parts >= up->ratio)
+    {
+      result |= historyCommit(level + 1);
+      up->parts = 0;
+    }
+  }
+
+  accReset(&l->rssi);
+  accReset(&l->snr);
+  return(result);
+}
+
+void historyClear()
+{
+  for(int i = 0 ; i < HISTORY_LEVELS ; i++)
+  {
+    levels[i].head  = 0;
+    levels[i].count = 0;
+    levels[i].parts = 0;
+    accReset(&levels[i].rssi);
+    accReset(&levels[i].snr);
+  }
+
+  haveSample  = false;
+  historyInit = true;
+}
+
+//
+// Add raw signal sample, called every time RSSI/SNR are read
+//
+void historyAddSample(uint8_t rssi, uint8_t snr)
+{
+  if(!historyInit) historyClear();
+
+  accAdd(&levels[0].rssi, rssi, rssi, rssi, 1);
+  accAdd(&levels[0].snr, snr, snr, snr, 1);
+  lastRssi   = rssi;
+  lastSnr    = snr;
+  haveSample = true;
+}
+
+//
+// Tick history time, closing level 0 buckets at a fixed rate.
+// Returns true if the currently shown history level has changed.
+//
+bool historyTickTime()
+{
+  uint32_t now = millis();
+  uint8_t updated = 0;
+
+  if((int32_t)(now - nextTick) < 0) return(false);
+
+  // Resynchronize if we fell far behind (i.e. sleep or long operation)
+  nextTick = (now - nextTick) > 5 * HISTORY_SAMPLE_TIME ?
+    now + HISTORY_SAMPLE_TIME : nextTick + HISTORY_SAMPLE_TIME;
+
+  // Nothing to record yet
+  if(!haveSample) return(false);
+
+  // No fresh samples (i.e. during seek): repeat the last one
+  if(!levels[0].rssi.count) historyAddSample(lastRssi, lastSnr);
+
+  updated = historyCommit(HISTORY_5MIN);
+
+  return(uiLayoutIdx == UI_WATERFALL && (updated & (1 << historyZoomIdx)));
+}
+
+const char *historyDesc(uint8_t level)
+{
+  return(level < HISTORY_LEVELS ? levels[level].desc : "");
+}
+
+uint16_t historyPeriod(uint8_t level)
+{
+  return(level < HISTORY_LEVELS ? levels[level].period : 0);
+}
+
+uint16_t historyLength(uint8_t level)
+{
+  return(level < HISTORY_LEVELS ? levels[level].length : 0);
+}
+
+uint16_t historyCount(uint8_t level)
+{
+  return(level < HISTORY_LEVELS ? levels[level].count : 0);
+}
+
+//
+// Get history entry by age (0 = most recent)
+//
+bool historyGet(uint8_t level, uint16_t age, HistoryEntry *entry)
+{
+  if(level >= HISTORY_LEVELS || age >= levels[level].count) return(false);
+
+  const HistoryLevel *l = &levels[level];
+  *entry = l->ring[(l->head + l->length - 1 - age) % l->length];
+  return(true);
+}
+
+//
+// Print history level as CSV, oldest entry first
+//
+void historyPrint(Print *out, uint8_t level)
+{
+  HistoryEntry e;
+
+  out->print("age_s,rssi_min,rssi_mean,rssi_max,snr_min,snr_mean,snr_max\r\n");
+
+  for(int age = historyCount(level) - 1 ; age >= 0 ; age--)
+  {
+    if(!historyGet(level, age, &e)) continue;
+    out->printf("%lu,%u,%u,%u,%u,%u,%u\r\n",
+      (unsigned long)age * historyPeriod(level),
+      e.rssi.min, e.rssi.mean, e.rssi.max,
+      e.snr.min, e.snr.mean, e.snr.max
+    );
+  }
+}
@@ -0,0 +1,38 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <Arduino.h>
+
+// History zoom levels
+#define HISTORY_5MIN   0  // 1 second per entry, 5 minutes
+#define HISTORY_1HOUR  1  // 10 seconds per entry, 1 hour
+#define HISTORY_24HOUR 2  // 1 minute per entry, 24 hours
+#define HISTORY_LEVELS 3
+
+#define HISTORY_SAMPLE_TIME 1000 // Level 0 entry period (ms)
+
+struct HistoryValue
+{
+  uint8_t min;          // Lowest sample
+  uint8_t max;          // Highest sample
+  uint8_t mean;         // Average of all samples
+};
+
+struct HistoryEntry
+{
+  HistoryValue rssi;    // RSSI (dBuV)
+  HistoryValue snr;     // SNR (dB)
+};
+
+void historyAddSample(uint8_t rssi, uint8_t snr);
+bool historyTickTime();
+void historyClear();
+
+const char *historyDesc(uint8_t level);
+uint16_t historyPeriod(uint8_t level);
+uint16_t historyLength(uint8_t level);
+uint16_t historyCount(uint8_t level);
+bool historyGet(uint8_t level, uint16_t age, HistoryEntry *entry);
+void historyPrint(Print *out, uint8_t level);
+
+#endif // HISTORY_H
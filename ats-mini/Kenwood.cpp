@@ -0,0 +1,285 @@
+#include "Common.h"
+#include "Utils.h"
+#include "Menu.h"
+#include "Kenwood.h"
+
+// Kenwood mode numbers, indexed by FM/LSB/USB/AM
+static const char catModes[] = { '4', '1', '2', '5' };
+
+#define CAT_ERROR -1
+
+// Command handler, returns remote events or CAT_ERROR
+typedef int (*CatHandler)(Stream* stream, KenwoodState* state, const char *args);
+
+typedef struct
+{
+  char name[3];
+  CatHandler handler;
+} CatCommand;
+
+//
+// Parse exactly the given number of decimal digits
+//
+static bool catNumber(const char *args, int digits, uint32_t *value)
+{
+  if((int)strlen(args) != digits) return(false);
+
+  for(*value=0 ; *args ; args++)
+  {
+    if(!isdigit(*args)) return(false);
+    *value = *value * 10 + *args - '0';
+  }
+
+  return(true);
+}
+
+//
+// Get Kenwood mode number for the current mode
+//
+static char catMode()
+{
+  return(currentMode < sizeof(catModes) ? catModes[currentMode] : '5');
+}
+
+//
+// Get S-meter reading, 0 to 15 for S0 to S9, up to 30 for S9+60dB
+//
+static int catSMeter()
+{
+  int s = getStrength(rssi);
+  int value = s <= 10 ? (s - 1) * 15 / 9 : 15 + (s - 10) * 5 / 2;
+  return(value > 30 ? 30 : value);
+}
+
+//
+// Send the IF (information) answer
+//
+static void catSendInfo(Stream* stream)
+{
+  // Frequency, 5 spaces, RIT/XIT offset, RIT, XIT, memory bank and
+  // channel, TX, mode, VFO, scan, split, tone, tone number and shift
+  stream->printf("IF%011lu     +0000000000%c0000000;", (unsigned long)getCurrentFrequencyHz(), catMode());
+}
+
+static int catFA(Stream* stream, KenwoodState* state, const char *args)
+{
+  uint32_t freq;
+
+  if(!*args)
+  {
+    stream->printf("FA%011lu;", (unsigned long)getCurrentFrequencyHz());
+    return(0);
+  }
+
+  if(!catNumber(args, 11, &freq) || !tuneToFrequency(freq, true)) return(CAT_ERROR);
+  return(REMOTE_CHANGED | REMOTE_PREFS);
+}
+
+static int catFB(Stream* stream, KenwoodState* state, const char *args)
+{
+  // There is only one VFO
+  if(!*args) stream->printf("FB%011lu;", (unsigned long)getCurrentFrequencyHz());
+  return(0);
+}
+
+static int catMD(Stream* stream, KenwoodState* state, const char *args)
+{
+  if(!*args)
+  {
+    stream->printf("MD%c;", catMode());
+    return(0);
+  }
+
+  // One digit, catModes has no terminator to match
+  const char *mode = args[0] && !args[1] ? (const char *)memchr(catModes, args[0], sizeof(catModes)) : NULL;
+  if(!mode || !selectMode(mode - catModes)) return(CAT_ERROR);
+  return(REMOTE_CHANGED | REMOTE_PREFS);
+}
+
+static int catIF(Stream* stream, KenwoodState* state, const char *args)
+{
+  if(*args) return(CAT_ERROR);
+  catSendInfo(stream);
+  return(0);
+}
+
+static int catAI(Stream* stream, KenwoodState* state, const char *args)
+{
+  if(!*args)
+  {
+    stream->printf("AI%u;", state->autoInfo);
+    return(0);
+  }
+
+  if(args[1] || args[0] < '0' || args[0] > '3') return(CAT_ERROR);
+  state->autoInfo = args[0] - '0';
+  state->lastFreq = getCurrentFrequencyHz();
+  state->lastMode = currentMode;
+  return(0);
+}
+
+static int catSM(Stream* stream, KenwoodState* state, const char *args)
+{
+  if(strcmp(args, "0")) return(CAT_ERROR);
+  stream->printf("SM0%04d;", catSMeter());
+  return(0);
+}
+
+static int catAG(Stream* stream, KenwoodState* state, const char *args)
+{
+  uint32_t value;
+
+  if(!strcmp(args, "0"))
+  {
+    stream->printf("AG0%03d;", (volume * 255 + 31) / 63);
+    return(0);
+  }
+
+  if(args[0] != '0' || !catNumber(args + 1, 3, &value) || value > 255) return(CAT_ERROR);
+  doVolume((value * 63 + 127) / 255 - volume);
+  return(REMOTE_CHANGED | REMOTE_PREFS);
+}
+
+static int catSQ(Stream* stream, KenwoodState* state, const char *args)
+{
+  uint32_t value;
+
+  if(!strcmp(args, "0"))
+  {
+    stream->printf("SQ0%03d;", (currentSquelch * 255 + 63) / 127);
+    return(0);
+  }
+
+  if(args[0] != '0' || !catNumber(args + 1, 3, &value) || value > 255) return(CAT_ERROR);
+  doSquelch((value * 127 + 127) / 255 - currentSquelch);
+  return(REMOTE_CHANGED | REMOTE_PREFS);
+}
+
+static int catID(Stream* stream, KenwoodState* state, const char *args)
+{
+  if(*args) return(CAT_ERROR);
+  stream->print("ID020;");
+  return(0);
+}
+
+static int catPS(Stream* stream, KenwoodState* state, const char *args)
+{
+  if(!*args) stream->print("PS1;");
+  return(0);
+}
+
+static int catFR(Stream* stream, KenwoodState* state, const char *args)
+{
+  // Receive and transmit VFO, only VFO A
+  if(!*args) stream->print("FR0;");
+  return(!*args || !strcmp(args, "0") ? 0 : CAT_ERROR);
+}
+
+static int catFT(Stream* stream, KenwoodState* state, const char *args)
+{
+  if(!*args) stream->print("FT0;");
+  return(!*args || !strcmp(args, "0") ? 0 : CAT_ERROR);
+}
+
+static int catRX(Stream* stream, KenwoodState* state, const char *args)
+{
+  return(0);
+}
+
+static int catTX(Stream* stream, KenwoodState* state, const char *args)
+{
+  // Receive only
+  return(CAT_ERROR);
+}
+
+static int catUP(Stream* stream, KenwoodState* state, const char *args)
+{
+  return(1 << REMOTE_DIRECTION);
+}
+
+static int catDN(Stream* stream, KenwoodState* state, const char *args)
+{
+  return(-(1 << REMOTE_DIRECTION));
+}
+
+static const CatCommand catCommands[] =
+{
+  { "FA", catFA }, { "FB", catFB }, { "MD", catMD }, { "IF", catIF },
+  { "AI", catAI }, { "SM", catSM }, { "AG", catAG }, { "SQ", catSQ },
+  { "ID", catID }, { "PS", catPS }, { "FR", catFR }, { "FT", catFT },
+  { "RX", catRX }, { "TX", catTX }, { "UP", catUP }, { "DN", catDN },
+};
+
+//
+// Execute a complete command (without the terminating ';')
+//
+static int catExecute(Stream* stream, KenwoodState* state, char *cmd)
+{
+  if(strlen(cmd) >= 2)
+  {
+    cmd[0] = toupper(cmd[0]);
+    cmd[1] = toupper(cmd[1]);
+
+    for(unsigned int i=0 ; i<ITEM_COUNT(catCommands) ; i++)
+    {
+      if(cmd[0] != catCommands[i].name[0] || cmd[1] != catCommands[i].name[1]) continue;
+
+      int event = catCommands[i].handler(stream, state, cmd + 2);
+      if(event != CAT_ERROR) return(event);
+      break;
+    }
+  }
+
+  stream->print("?;");
+  return(0);
+}
+
+//
+// Receive CAT commands and execute them, does not block. Returns once
+// a command produces remote events, so that they are not merged.
+//
+int kenwoodDoCommand(Stream* stream, KenwoodState* state)
+{
+  int event = 0;
+
+  while(!event && stream->available())
+  {
+    int c = stream->read();
+    if(c < 0) break;
+
+    if(c == ';')
+    {
+      state->buf[state->length] = '\0';
+      if(state->overflow)
+        stream->print("?;");
+      else if(state->length)
+        event = catExecute(stream, state, state->buf);
+      state->length   = 0;
+      state->overflow = false;
+    }
+    else if(!isspace(c))
+    {
+      if(state->length < sizeof(state->buf) - 1)
+        state->buf[state->length++] = c;
+      else
+        state->overflow = true;
+    }
+  }
+
+  return(event);
+}
+
+//
+// Send auto information when the frequency or the mode changes
+//
+void kenwoodTickTime(Stream* stream, KenwoodState* state)
+{
+  if(!state->autoInfo) return;
+
+  uint32_t freq = getCurrentFrequencyHz();
+  if(freq == state->lastFreq && currentMode == state->lastMode) return;
+
+  state->lastFreq = freq;
+  state->lastMode = currentMode;
+  catSendInfo(stream);
+}
@@ -0,0 +1,30 @@
+#ifndef KENWOOD_H
+#define KENWOOD_H
+
+#include <Arduino.h>
+
+//
+// Kenwood TS-480 compatible CAT protocol. Commands are two letters
+// followed by optional parameters and terminated with ';'. A command
+// without parameters reads the value, with parameters it sets the value
+// without a reply. Errors are answered with "?;". With auto information
+// enabled (AI2;) the receiver sends an IF answer whenever the frequency
+// or the mode changes, including from the front panel.
+//
+
+#define CAT_MAX_COMMAND 32  // Longest command with parameters
+
+typedef struct
+{
+  char buf[CAT_MAX_COMMAND];  // Command being received
+  uint8_t length;
+  bool overflow;
+  uint8_t autoInfo;           // AI setting, 0 if off
+  uint32_t lastFreq;          // Last frequency sent as auto information
+  uint8_t lastMode;           // Last mode sent as auto information
+} KenwoodState;
+
+int kenwoodDoCommand(Stream* stream, KenwoodState* state);
+void kenwoodTickTime(Stream* stream, KenwoodState* state);
+
+#endif // KENWOOD_H
@@ -3,6 +3,19 @@
 #include "Utils.h"
 #include "Menu.h"
 #include "Draw.h"
+#include "Profile.h"
+#include "Meter.h"
+
+//
+// Draw S-meter with peak hold and stereo indicator
+//
+static void drawDefaultMeters()
+{
+  drawSMeter(getStrength(rssi), METER_OFFSET_X, METER_OFFSET_Y, getStrength(meterPeak(&rssiMeter)));
+
+  // Indicate FM pilot detection (stereo indicator)
+  drawStereoIndicator(METER_OFFSET_X, METER_OFFSET_Y, (currentMode==FM) && rx.getCurrentPilot());
+}
 
 void drawLayoutDefault(const char *statusLine1, const char *statusLine2)
 {
@@ -49,15 +62,16 @@ void drawLayoutDefault(const char *statusLine1, const char *statusLine2)
   else if(*getStationName())
     drawStationName(getStationName(), RDS_OFFSET_X, RDS_OFFSET_Y);
 
+  PROFILE_LAP(PROF_WIDGETS);
+
   // Draw left-side menu/info bar
   // @@@ FIXME: Frequency display (above) intersects the side bar!
   drawSideBar(currentCmd, MENU_OFFSET_X, MENU_OFFSET_Y, MENU_DELTA_X);
+  PROFILE_LAP(PROF_SIDEBAR);
 
-  // Draw S-meter
-  drawSMeter(getStrength(rssi), METER_OFFSET_X, METER_OFFSET_Y);
-
-  // Indicate FM pilot detection (stereo indicator)
-  drawStereoIndicator(METER_OFFSET_X, METER_OFFSET_Y, (currentMode==FM) && rx.getCurrentPilot());
+  // Draw S-meter and stereo indicator
+  drawMeterArea(drawDefaultMeters, METER_OFFSET_X, METER_OFFSET_Y, 15 + 17 * 4, 16);
+  PROFILE_LAP(PROF_WIDGETS);
 
   if(currentCmd == CMD_SCAN)
   {
@@ -71,4 +85,6 @@ void drawLayoutDefault(const char *statusLine1, const char *statusLine2)
     else
       drawScale(isSSB()? (currentFrequency + currentBFO/1000) : currentFrequency);
   }
+
+  PROFILE_LAP(PROF_GRAPHS);
 }
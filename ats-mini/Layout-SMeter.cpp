@@ -2,6 +2,8 @@
 #include "Themes.h"
 #include "Menu.h"
 #include "Draw.h"
+#include "Profile.h"
+#include "Meter.h"
 
 static int getInterpolatedStrength(int rssi)
 {
@@ -84,7 +86,7 @@ static void drawAltStereoIndicator(int x, int y, bool stereo = true)
   // Add an "else" statement here to draw a mono indicator
 }
 
-static void drawLargeSMeter(int rssi, int strength, int x, int y)
+static void drawLargeSMeter(int rssi, int strength, int peak, int x, int y)
 {
   // S-Meter legend
   spr.setTextDatum(TC_DATUM);
@@ -126,6 +128,8 @@ static void drawLargeSMeter(int rssi, int strength, int x, int y)
       spr.fillRect(x+(i*5), 11+y, 3, 10, TH.smeter_bar);
     else if (i<strength)
       spr.fillRect(x+(i*5), 11+y, 3, 10, TH.smeter_bar_plus);
+    else if (i == peak - 1)
+      spr.fillRect(x+(i*5), 11+y, 3, 10, TH.smeter_icon);
     else
       spr.fillRect(x+(i*5), 11+y, 3, 10, TH.smeter_bar_empty);
 }
@@ -147,6 +151,20 @@ static void drawLargeSNMeter(int snr, int x, int y)
       spr.fillRect(x+(i*5), y - 1, 3, 10, TH.smeter_bar_empty);
 }
 
+//
+// Draw large S-meter with peak hold and SN-meter
+//
+static void drawLargeMeters()
+{
+  // Draw SN-meter
+  drawLargeSNMeter(snr, ALT_METER_OFFSET_X, ALT_METER_OFFSET_Y);
+  // Draw S-meter
+  drawLargeSMeter(
+    rssi, getInterpolatedStrength(rssi), getInterpolatedStrength(meterPeak(&rssiMeter)),
+    ALT_METER_OFFSET_X, ALT_METER_OFFSET_Y
+  );
+}
+
 //
 // Draw alternative screen layout with the large S-meter.
 //
@@ -195,15 +213,20 @@ void drawLayoutSmeter(const char *statusLine1, const char *statusLine2)
   else if(*getStationName())
     drawStationName(getStationName(), RDS_OFFSET_X, RDS_OFFSET_Y);
 
+  PROFILE_LAP(PROF_WIDGETS);
+
   // Draw band scale
   drawSmallScale(isSSB()? (currentFrequency + currentBFO/1000) : currentFrequency, 120);
+  PROFILE_LAP(PROF_GRAPHS);
 
   // Draw left-side menu/info bar
   // @@@ FIXME: Frequency display (above) intersects the side bar!
   drawSideBar(currentCmd, ALT_MENU_OFFSET_X, ALT_MENU_OFFSET_Y, MENU_DELTA_X);
+  PROFILE_LAP(PROF_SIDEBAR);
 
   // Indicate FM pilot detection (stereo indicator)
   drawAltStereoIndicator(ALT_STEREO_OFFSET_X, ALT_STEREO_OFFSET_Y, (currentMode==FM) && rx.getCurrentPilot());
+  PROFILE_LAP(PROF_WIDGETS);
 
   if(currentCmd == CMD_SCAN)
   {
@@ -215,11 +238,8 @@ void drawLayoutSmeter(const char *statusLine1, const char *statusLine2)
     if(*getRadioText() || *getProgramInfo())
       drawRadioText(STATUS_OFFSET_Y, STATUS_OFFSET_Y + 25);
     else
-    {
-      // Draw SN-meter
-      drawLargeSNMeter(snr, ALT_METER_OFFSET_X, ALT_METER_OFFSET_Y);
-      // Draw S-meter
-      drawLargeSMeter(rssi, getInterpolatedStrength(rssi), ALT_METER_OFFSET_X, ALT_METER_OFFSET_Y);
-    }
+      drawMeterArea(drawLargeMeters, 16, ALT_METER_OFFSET_Y - 10, 320 - 16, 170 - ALT_METER_OFFSET_Y + 10);
   }
+
+  PROFILE_LAP(PROF_GRAPHS);
 }
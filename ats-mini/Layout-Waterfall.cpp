@@ -2,25 +2,16 @@
 #include "Themes.h"
 #include "Menu.h"
 #include "Draw.h"
+#include "History.h"
+#include "Profile.h"
 
-// History buffers
-#define HISTORY_LEN 320
-static uint8_t rssiHistory[HISTORY_LEN];
-static uint8_t snrHistory[HISTORY_LEN];
-static uint16_t historyHead = 0;
-static bool historyInit = false;
-
-static void updateHistory()
+//
+// Scale a signal value to the graph height
+//
+static int graphScale(int value, int range, int height)
 {
-  if (!historyInit) {
-    memset(rssiHistory, 0, sizeof(rssiHistory));
-    memset(snrHistory, 0, sizeof(snrHistory));
-    historyInit = true;
-  }
-  
-  rssiHistory[historyHead] = rssi;
-  snrHistory[historyHead] = snr;
-  historyHead = (historyHead + 1) % HISTORY_LEN;
+  int h = value * height / range;
+  return(h > height ? height : h);
 }
 
 //
@@ -82,15 +73,16 @@ void drawLayoutWaterfall(const char *statusLine1, const char *statusLine2)
   // I cannot call it. I will skip it or copy it.
   // Copying it is safer to avoid modifying Draw.h too much.
   
+  PROFILE_LAP(PROF_WIDGETS);
+
   // Draw left-side menu/info bar
   drawSideBar(currentCmd, ALT_MENU_OFFSET_X, ALT_MENU_OFFSET_Y, MENU_DELTA_X);
+  PROFILE_LAP(PROF_SIDEBAR);
 
   // ---------------------------------------------------------
   // Bottom Section: Signal History Graph
   // ---------------------------------------------------------
 
-  updateHistory();
-
   int graphX = 80; // Start after the menu
   int graphY = 120;
   int graphW = 240; // 320 - 80
@@ -109,40 +101,52 @@ void drawLayoutWaterfall(const char *statusLine1, const char *statusLine2)
   spr.drawString("S", graphX - 2, graphY + 10, 2);
   spr.drawString("N", graphX - 2, graphY + graphH - 10, 2);
 
-  // Draw RSSI History (Top half of graph, or full graph?)
-  // Let's draw RSSI as a filled area or line.
-  
-  int startIdx = (historyHead - graphW + HISTORY_LEN) % HISTORY_LEN;
-  
-  for (int i = 0; i < graphW - 1; i++) {
-      int idx = (startIdx + i) % HISTORY_LEN;
-      int idxNext = (startIdx + i + 1) % HISTORY_LEN;
-      
-      // RSSI (0-100 typical)
-      int val1 = rssiHistory[idx];
-      int val2 = rssiHistory[idxNext];
-      
-      // Scale to graph height
-      int h1 = (val1 * (graphH - 2)) / 100; 
-      int h2 = (val2 * (graphH - 2)) / 100;
-      
-      if(h1 > graphH-2) h1 = graphH-2;
-      if(h2 > graphH-2) h2 = graphH-2;
-
-      // Draw Line
-      spr.drawLine(graphX + i + 1, graphY + graphH - 1 - h1, graphX + i + 2, graphY + graphH - 1 - h2, TH.smeter_bar);
-      
-      // Optional: Draw SNR as a different color line?
-      // SNR (0-30 typical)
-      int s1 = snrHistory[idx];
-      int s2 = snrHistory[idxNext];
-      int sh1 = (s1 * (graphH - 2)) / 40; // Scale 0-40 SNR to height
-      int sh2 = (s2 * (graphH - 2)) / 40;
-      
-       if(sh1 > graphH-2) sh1 = graphH-2;
-       if(sh2 > graphH-2) sh2 = graphH-2;
-       
-      spr.drawLine(graphX + i + 1, graphY + graphH - 1 - sh1, graphX + i + 2, graphY + graphH - 1 - sh2, TH.scan_snr);
+  // Draw history zoom level
+  spr.setTextDatum(TL_DATUM);
+  spr.drawString(historyDesc(historyZoomIdx), graphX + 3, graphY + 2, 1);
+
+  // Each column covers an equal slice of the selected history level,
+  // the most recent entries are on the right
+  int w = graphW - 2;
+  int h = graphH - 2;
+  int len = historyLength(historyZoomIdx);
+  int prevRssi = -1, prevSnr = -1;
+
+  for(int i = 0; i < w; i++) {
+      int ageFirst = (w - 1 - i) * len / w;
+      int ageLast  = (w - i) * len / w - 1;
+      int rssiMin = 255, rssiMax = 0, rssiSum = 0;
+      int snrSum = 0, n = 0;
+      HistoryEntry e;
+
+      for(int age = ageFirst; age <= ageLast && historyGet(historyZoomIdx, age, &e); age++) {
+          rssiMin = min(rssiMin, (int)e.rssi.min);
+          rssiMax = max(rssiMax, (int)e.rssi.max);
+          rssiSum += e.rssi.mean;
+          snrSum  += e.snr.mean;
+          n++;
+      }
+
+      // No data recorded this far back yet
+      if(!n) continue;
+
+      int x = graphX + 1 + i;
+      int y0 = graphY + graphH - 1;
+
+      // RSSI range (0-100 typical) as a vertical bar
+      int hMin = graphScale(rssiMin, 100, h);
+      int hMax = graphScale(rssiMax, 100, h);
+      if(hMax > hMin) spr.drawFastVLine(x, y0 - hMax, hMax - hMin, TH.smeter_bar_empty);
+
+      // RSSI and SNR (0-40 typical) averages as lines
+      int hRssi = graphScale(rssiSum / n, 100, h);
+      int hSnr  = graphScale(snrSum / n, 40, h);
+
+      spr.drawLine(prevRssi < 0 ? x : x - 1, y0 - (prevRssi < 0 ? hRssi : prevRssi), x, y0 - hRssi, TH.smeter_bar);
+      spr.drawLine(prevSnr < 0 ? x : x - 1, y0 - (prevSnr < 0 ? hSnr : prevSnr), x, y0 - hSnr, TH.scan_snr);
+
+      prevRssi = hRssi;
+      prevSnr  = hSnr;
   }
 
   // Draw current numeric values overlay
@@ -152,4 +156,6 @@ void drawLayoutWaterfall(const char *statusLine1, const char *statusLine2)
   spr.setTextDatum(BR_DATUM);
   spr.setTextColor(TH.scan_snr);
   spr.drawNumber(snr, graphX + graphW - 2, graphY + graphH - 2, 2);
+
+  PROFILE_LAP(PROF_GRAPHS);
 }
@@ -6,7 +6,9 @@
 #include "EIBI.h"
 //#include "Ble.h"
 #include "Menu.h"
+#include "Chrome.h"
 #include "Beacons.h"
+#include "History.h"
 
 //
 // Bands Menu
@@ -127,15 +129,16 @@ static const char *menu[] =
 #define MENU_FM_REGION    4
 #define MENU_THEME        5
 #define MENU_UI           6
-#define MENU_ZOOM         7
-#define MENU_SCROLL       8
-#define MENU_SLEEP        9
-#define MENU_SLEEPMODE    10
-#define MENU_LOADEIBI     11
-#define MENU_USBMODE      12
-#define MENU_BLEMODE      13
-#define MENU_WIFIMODE     14
-#define MENU_ABOUT        15
+#define MENU_HISTORY      7
+#define MENU_ZOOM         8
+#define MENU_SCROLL       9
+#define MENU_SLEEP        10
+#define MENU_SLEEPMODE    11
+#define MENU_LOADEIBI     12
+#define MENU_USBMODE      13
+#define MENU_BLEMODE      14
+#define MENU_WIFIMODE     15
+#define MENU_ABOUT        16
 
 
 int8_t settingsIdx = MENU_BRIGHTNESS;
@@ -149,6 +152,7 @@ static const char *settings[] =
   "FM Region",
   "Theme",
   "UI Layout",
+  "History",
   "Zoom Menu",
   "Scroll Dir.",
   "Sleep",
@@ -277,13 +281,18 @@ uint8_t uiLayoutIdx = 0;
 static const char *uiLayoutDesc[] =
 { "Default", "S-Meter", "S-History" };
 
+//
+// Signal History Zoom Menu
+//
+uint8_t historyZoomIdx = HISTORY_5MIN;
+
 //
 // USB Port Mode Menu
 //
 
 uint8_t usbModeIdx = USB_OFF;
 static const char *usbModeDesc[] =
-{ "Off", "Ad hoc", "RigCtl" };
+{ "Off", "Ad hoc", "RigCtl", "Binary", "Kenwood" };
 
 int getTotalUSBModes() { return(ITEM_COUNT(usbModeDesc)); }
 
@@ -442,7 +451,7 @@ static const Bandwidth *bandwidths[4] =
 
 static const uint8_t defaultBwIdx[4] = { 0, 4, 4, 4 };
 
-static int getLastBandwidth(int mode)
+int getLastBandwidth(int mode)
 {
   switch(mode)
   {
@@ -571,6 +580,11 @@ static void doUILayout(int16_t enc)
   uiLayoutIdx = uiLayoutIdx > LAST_ITEM(uiLayoutDesc) ? UI_DEFAULT : wrap_range(uiLayoutIdx, enc, 0, LAST_ITEM(uiLayoutDesc));
 }
 
+static void doHistoryZoom(int16_t enc)
+{
+  historyZoomIdx = historyZoomIdx >= HISTORY_LEVELS ? HISTORY_5MIN : wrap_range(historyZoomIdx, enc, 0, HISTORY_LEVELS - 1);
+}
+
 void doAvc(int16_t enc)
 {
   // Only allow for AM and SSB modes
@@ -757,6 +771,41 @@ bool tuneToMemory(const Memory *memory)
   return(true);
 }
 
+//
+// Tune to given frequency (Hz), switching to another band if the
+// current one does not have it and anyBand is set
+//
+bool tuneToFrequency(uint32_t freq, bool anyBand)
+{
+  Memory mem = { freq, (uint8_t)bandIdx, currentMode };
+
+  // Band limits are 16-bit, in kHz (10kHz for FM)
+  if((currentMode==FM ? freq / 10000 : freq / 1000) <= 0xFFFF && isMemoryInBand(getCurrentBand(), &mem))
+  {
+    if(!updateFrequency(freqFromHz(freq, currentMode), false)) return(false);
+    if(isSSB()) updateBFO(bfoFromHz(freq), false);
+
+    // Clear current station name and information
+    clearStationInfo();
+    // Check for named frequencies
+    identifyFrequency(currentFrequency + currentBFO / 1000);
+    return(true);
+  }
+
+  if(!anyBand) return(false);
+
+  // Keep current modulation unless switching between FM and other bands
+  for(int i=0 ; i<getTotalBands() ; i++)
+  {
+    mem.band = i;
+    mem.mode = (bands[i].bandMode==FM) == (currentMode==FM) ? currentMode : bands[i].bandMode;
+    if((mem.mode==FM ? freq / 10000 : freq / 1000) > 0xFFFF) continue;
+    if(tuneToMemory(&mem)) return(true);
+  }
+
+  return(false);
+}
+
 static void doMemory(int16_t enc)
 {
   memoryIdx = wrap_range(memoryIdx, enc, 0, LAST_ITEM(memories));
@@ -795,14 +844,19 @@ void doStep(int16_t enc)
     rx.setSeekAmSpacing(steps[currentMode][idx].spacing);
 }
 
+int getLastAgc()
+{
+  return(currentMode==FM? 27 : isSSB()? 1 : 37);
+}
+
 void doAgc(int16_t enc)
 {
   if(currentMode==FM)
-    agcIdx = FmAgcIdx = wrap_range(FmAgcIdx, enc, 0, 27);
+    agcIdx = FmAgcIdx = wrap_range(FmAgcIdx, enc, 0, getLastAgc());
   else if(isSSB())
-    agcIdx = SsbAgcIdx = wrap_range(SsbAgcIdx, enc, 0, 1);
+    agcIdx = SsbAgcIdx = wrap_range(SsbAgcIdx, enc, 0, getLastAgc());
   else
-    agcIdx = AmAgcIdx = wrap_range(AmAgcIdx, enc, 0, 37);
+    agcIdx = AmAgcIdx = wrap_range(AmAgcIdx, enc, 0, getLastAgc());
 
   // Process agcIdx to generate disableAgc and agcIdx
   // agcIdx     0 1 2 3 4 5 6  ..... n    (n:    FM = 27, AM = 37, SSB = 1)
@@ -820,15 +874,34 @@ void doAgc(int16_t enc)
 void doMode(int16_t enc)
 {
   // This is our current mode for the current band
-  currentMode = bands[bandIdx].bandMode;
+  uint8_t mode = currentMode = bands[bandIdx].bandMode;
 
   // Cannot change away from FM mode
-  if(currentMode==FM) return;
+  if(mode==FM) return;
 
   // Change AM/LSB/USB modes, do not allow FM mode
   do
-    currentMode = wrap_range(currentMode, enc, 0, LAST_ITEM(bandModeDesc));
-  while(currentMode==FM);
+    mode = wrap_range(mode, enc, 0, LAST_ITEM(bandModeDesc));
+  while(mode==FM);
+
+  selectMode(mode);
+}
+
+//
+// Switch current band to the given mode, keeping the frequency
+//
+bool selectMode(uint8_t mode)
+{
+  // Must be a valid mode
+  if(mode>LAST_ITEM(bandModeDesc)) return(false);
+
+  // FM bands only do FM, other bands can not do FM
+  if((mode==FM) != (bands[bandIdx].bandMode==FM)) return(false);
+
+  // Nothing to do if the mode does not change
+  if(mode==currentMode) return(true);
+
+  currentMode = mode;
 
   // Save current band settings
   bands[bandIdx].currentFreq = currentFrequency + currentBFO / 1000;
@@ -838,6 +911,7 @@ void doMode(int16_t enc)
 
   // Enable the new band
   selectBand(bandIdx);
+  return(true);
 }
 
 void doSquelch(int16_t enc)
@@ -1031,6 +1105,7 @@ static void clickSettings(int cmd, bool shortPress)
       break;
     case MENU_THEME:      currentCmd = CMD_THEME;      break;
     case MENU_UI:         currentCmd = CMD_UI;         break;
+    case MENU_HISTORY:    currentCmd = CMD_HISTORY;    break;
     case MENU_RDS:        currentCmd = CMD_RDS;        break;
     case MENU_ZOOM:       currentCmd = CMD_ZOOM;       break;
     case MENU_SCROLL:     currentCmd = CMD_SCROLL;     break;
@@ -1075,6 +1150,7 @@ bool doSideBar(uint16_t cmd, int16_t enc, int16_t enca)
     case CMD_CAL:        doCal(enca);break;
     case CMD_THEME:      doTheme(scrollDirection * enc);break;
     case CMD_UI:         doUILayout(scrollDirection * enc);break;
+    case CMD_HISTORY:    doHistoryZoom(scrollDirection * enc);break;
     case CMD_RDS:        doRDSMode(scrollDirection * enc);break;
     case CMD_MEMORY:     doMemory(scrollDirection * enca);break;
     case CMD_SLEEP:      doSleep(enca);break;
@@ -1162,35 +1238,16 @@ void selectBand(uint8_t idx, bool drawLoadingSSB)
 
 static void drawCommon(const char *title, int x, int y, int sx, bool cursor = false)
 {
-  spr.setTextDatum(MC_DATUM);
-
-  spr.setTextColor(TH.menu_hdr);
-  spr.fillSmoothRoundRect(1+x, 1+y, 76+sx, 110, 4, TH.menu_border);
-  spr.fillSmoothRoundRect(2+x, 2+y, 74+sx, 108, 4, TH.menu_bg);
-
-  spr.drawString(title, 40+x+(sx/2), 12+y, 2);
-  spr.drawLine(1+x, 23+y, 76+sx, 23+y, TH.menu_border);
+  drawChrome(CHROME_MENU, title, cursor, x, y, sx);
 
+  spr.setTextDatum(MC_DATUM);
   spr.setTextFont(0);
   spr.setTextColor(TH.menu_item);
-  if(cursor)
-    spr.fillRoundRect(6+x, 24+y+(2*16), 66+sx, 16, 2, TH.menu_hl_bg);
 }
 
 static void drawMenu(int x, int y, int sx)
 {
-  spr.setTextDatum(MC_DATUM);
-
-  spr.fillSmoothRoundRect(1+x, 1+y, 76+sx, 110, 4, TH.menu_border);
-  spr.fillSmoothRoundRect(2+x, 2+y, 74+sx, 108, 4, TH.menu_bg);
-  spr.setTextColor(TH.menu_hdr);
-
-  spr.drawString("Menu", 40+x+(sx/2), 12+y, 2);
-  spr.drawLine(1+x, 23+y, 76+sx, 23+y, TH.menu_border);
-
-  spr.setTextFont(0);
-  spr.setTextColor(TH.menu_item);
-  spr.fillRoundRect(6+x, 24+y+(2*16), 66+sx, 16, 2, TH.menu_hl_bg);
+  drawCommon("Menu", x, y, sx, true);
 
   int count = ITEM_COUNT(menu);
   for(int i=-2 ; i<3 ; i++)
@@ -1208,17 +1265,7 @@ static void drawMenu(int x, int y, int sx)
 
 static void drawSettings(int x, int y, int sx)
 {
-  spr.setTextDatum(MC_DATUM);
-
-  spr.fillSmoothRoundRect(1+x, 1+y, 76+sx, 110, 4, TH.menu_border);
-  spr.fillSmoothRoundRect(2+x, 2+y, 74+sx, 108, 4, TH.menu_bg);
-  spr.setTextColor(TH.menu_hdr);
-  spr.drawString("Settings", 40+x+(sx/2), 12+y, 2);
-  spr.drawLine(1+x, 23+y, 76+sx, 23+y, TH.menu_border);
-
-  spr.setTextFont(0);
-  spr.setTextColor(TH.menu_item);
-  spr.fillRoundRect(6+x, 24+y+(2*16), 66+sx, 16, 2, TH.menu_hl_bg);
+  drawCommon("Settings", x, y, sx, true);
 
   int count = ITEM_COUNT(settings);
   for(int i=-2 ; i<3 ; i++)
@@ -1481,6 +1528,30 @@ static void drawUILayout(int x, int y, int sx)
   }
 }
 
+static void drawHistoryZoom(int x, int y, int sx)
+{
+  drawCommon(settings[MENU_HISTORY], x, y, sx, true);
+
+  int count = HISTORY_LEVELS;
+  for(int i=-2 ; i<3 ; i++)
+  {
+    if(i==0) {
+      drawZoomedMenu(historyDesc(abs((historyZoomIdx+count+i)%count)));
+      spr.setTextColor(TH.menu_hl_text, TH.menu_hl_bg);
+    } else {
+      spr.setTextColor(TH.menu_item);
+    }
+
+    // Prevent repeats for short menus
+    if (count < 5 && ((historyZoomIdx+i) < 0 || (historyZoomIdx+i) >= count)) {
+      continue;
+    }
+
+    spr.setTextDatum(MC_DATUM);
+    spr.drawString(historyDesc(abs((historyZoomIdx+count+i)%count)), 40+x+(sx/2), 64+y+(i*16), 2);
+  }
+}
+
 static void drawRDSMode(int x, int y, int sx)
 {
   drawCommon(settings[MENU_RDS], x, y, sx, true);
@@ -1738,16 +1809,12 @@ static void drawInfo(int x, int y, int sx)
 {
   char text[16];
 
-  // Info box
+  // Info box with static labels
+  drawChrome(CHROME_INFO, 0, false, x, y, sx);
   spr.setTextDatum(ML_DATUM);
   spr.setTextColor(TH.box_text);
-  spr.fillSmoothRoundRect(1+x, 1+y, 76+sx, 110, 4, TH.box_border);
-  spr.fillSmoothRoundRect(2+x, 2+y, 74+sx, 108, 4, TH.box_bg);
 
-  spr.drawString("Step:", 6+x, 64+y+(-3*16), 2);
   spr.drawString(getCurrentStep()->desc, 48+x, 64+y+(-3*16), 2);
-
-  spr.drawString("BW:", 6+x, 64+y+(-2*16), 2);
   spr.drawString(getCurrentBandwidth()->desc, 48+x, 64+y+(-2*16), 2);
 
   if(!agcNdx && !agcIdx)
@@ -1762,7 +1829,6 @@ static void drawInfo(int x, int y, int sx)
     spr.drawString(text, 48+x, 64+y+(-1*16), 2);
   }
 
-  spr.drawString("Vol:", 6+x, 64+y+(0*16), 2);
   if(muteOn(MUTE_MAIN) || muteOn(MUTE_SQUELCH))
   {
     spr.setTextColor(TH.box_off_text, TH.box_off_bg);
@@ -1825,6 +1891,7 @@ void drawSideBar(uint16_t cmd, int x, int y, int sx)
     case CMD_BANDWIDTH:  drawBandwidth(x, y, sx);  break;
     case CMD_THEME:      drawTheme(x, y, sx);      break;
     case CMD_UI:         drawUILayout(x, y, sx);   break;
+    case CMD_HISTORY:    drawHistoryZoom(x, y, sx); break;
     case CMD_VOLUME:     drawVolume(x, y, sx);     break;
     case CMD_AGC:        drawAgc(x, y, sx);        break;
     case CMD_SOFTMUTE:   drawSoftMuteMaxAtt(x, y, sx);break;
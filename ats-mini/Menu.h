@@ -47,7 +47,8 @@
 #define CMD_USBMODE    0x2D00 // |
 #define CMD_BLEMODE    0x2E00 // |
 #define CMD_WIFIMODE   0x2F00 // |
-#define CMD_ABOUT      0x3000 //-+
+#define CMD_HISTORY    0x3000 // |
+#define CMD_ABOUT      0x3100 //-+
 
 // UI Layouts
 #define UI_DEFAULT  0
@@ -117,11 +118,14 @@ uint8_t getFreqInputPos();
 int getFreqInputStep();
 const Step *getCurrentStep();
 const Bandwidth *getCurrentBandwidth();
+int getLastBandwidth(int mode);
+int getLastAgc();
 uint8_t getRDSMode();
 
 int getCurrentUTCOffset();
 int getTotalUTCOffsets();
 int getTotalFmRegions();
+int getTotalUSBModes();
 int getTotalBleModes();
 
 void doSoftMute(int16_t enc);
@@ -130,10 +134,14 @@ void doAvc(int16_t enc);
 void doFmRegion(int16_t enc);
 void doBandwidth(int16_t enc);
 void doVolume(int16_t enc);
+void doSquelch(int16_t enc);
 void doBrt(int16_t enc);
 void doCal(int16_t enc);
 void doStep(int16_t enc);
 void doMode(int16_t enc);
+bool selectMode(uint8_t mode);
+bool tuneToMemory(const Memory *memory);
+bool tuneToFrequency(uint32_t freq, bool anyBand);
 void doBand(int16_t enc);
 
 #endif // MENU_H
@@ -0,0 +1,71 @@
+#include "Common.h"
+#include "Meter.h"
+
+//
+// Signal meters are smoothed with a fast attack / slow decay
+// exponential filter. The peak follows raw samples, is held for
+// METER_PEAK_HOLD, then falls at METER_PEAK_DECAY units per second.
+//
+
+MeterFilter rssiMeter;
+MeterFilter snrMeter;
+
+void meterReset(MeterFilter *f)
+{
+  f->value    = 0;
+  f->peak     = 0;
+  f->peakTime = 0;
+  f->lastTime = 0;
+  f->valid    = false;
+}
+
+void meterUpdate(MeterFilter *f, uint8_t sample, uint32_t now)
+{
+  uint16_t target = sample << 8;
+
+  // First sample initializes the filter
+  if(!f->valid)
+  {
+    f->value    = target;
+    f->peak     = target;
+    f->peakTime = now;
+    f->lastTime = now;
+    f->valid    = true;
+    return;
+  }
+
+  // After a long gap (sleep, slow redraw) the filter has settled
+  // anyway, keep the fixed point math below in range
+  uint32_t dt = min(now - f->lastTime, (uint32_t)METER_MAX_GAP);
+  f->lastTime = now;
+
+  // Filter coefficient for the elapsed time (0..256)
+  uint32_t tau = target > f->value ? METER_ATTACK_TIME : METER_DECAY_TIME;
+  int32_t alpha = (dt * 256) / (tau + dt);
+  f->value += ((int32_t)target - (int32_t)f->value) * alpha / 256;
+
+  if(target >= f->peak)
+  {
+    // New peak
+    f->peak     = target;
+    f->peakTime = now;
+  }
+  else if(now - f->peakTime > METER_PEAK_HOLD)
+  {
+    // Peak hold expired, let the peak fall down to the smoothed value
+    uint32_t fall = METER_PEAK_DECAY * 256 * dt / 1000;
+    f->peak = f->peak > f->value + fall ? f->peak - fall : f->value;
+  }
+
+  if(f->peak < f->value) f->peak = f->value;
+}
+
+uint8_t meterValue(const MeterFilter *f)
+{
+  return((f->value + 128) >> 8);
+}
+
+uint8_t meterPeak(const MeterFilter *f)
+{
+  return((f->peak + 128) >> 8);
+}
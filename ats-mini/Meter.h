@@ -0,0 +1,33 @@
+#ifndef METER_H
+#define METER_H
+
+#include <Arduino.h>
+
+#ifndef METER_SAMPLE_TIME
+#define METER_SAMPLE_TIME   50  // RSSI/SNR sampling period (ms)
+#endif
+#define METER_ATTACK_TIME   40  // Rising signal time constant (ms)
+#define METER_DECAY_TIME   400  // Falling signal time constant (ms)
+#define METER_PEAK_HOLD   1500  // Peak hold time (ms)
+#define METER_PEAK_DECAY    20  // Peak fall rate after hold (units/s)
+#define METER_REDRAW_TIME 1200  // Full screen meter refresh period (ms)
+#define METER_MAX_GAP    10000  // Longer gaps between samples count as this (ms)
+
+typedef struct
+{
+  uint16_t value;       // Smoothed value (8.8 fixed point)
+  uint16_t peak;        // Peak value (8.8 fixed point)
+  uint32_t peakTime;    // Time the peak was last raised
+  uint32_t lastTime;    // Time of the last sample
+  bool     valid;       // FALSE: no samples yet
+} MeterFilter;
+
+extern MeterFilter rssiMeter;
+extern MeterFilter snrMeter;
+
+void meterReset(MeterFilter *f);
+void meterUpdate(MeterFilter *f, uint8_t sample, uint32_t now);
+uint8_t meterValue(const MeterFilter *f);
+uint8_t meterPeak(const MeterFilter *f);
+
+#endif // METER_H
@@ -0,0 +1,127 @@
+#include "Common.h"
+#include "Api.h"
+#include "Metrics.h"
+#include <WiFi.h>
+#include <ESPAsyncWebServer.h>
+#include <esp_timer.h>
+
+Metric *Metric::head = NULL;
+
+//
+// Register a metric, after the last one of its family if any
+//
+Metric::Metric(const char *name, const char *help, uint8_t type, const char *labels, float (*get)())
+  : name(name), help(help), labels(labels), type(type), next(NULL), get(get), count(0), value(NAN)
+{
+  Metric **p, **after = NULL;
+
+  for(p=&head ; *p ; p=&(*p)->next)
+    if(!strcmp((*p)->name, name)) after = &(*p)->next;
+
+  if(!after) after = p;
+  next = *after;
+  *after = this;
+}
+
+//
+// Current gauge value (NAN - none)
+//
+float Metric::read() const
+{
+  return(get ? get() : value.load(std::memory_order_relaxed));
+}
+
+uint32_t Metric::total() const
+{
+  return(count.load(std::memory_order_relaxed));
+}
+
+//
+// Receiver metrics
+//
+static Metric metricUptime("atsmini_uptime_seconds", "Time since boot", METRIC_GAUGE, NULL,
+  []() -> float { return(esp_timer_get_time() / 1000000.0f); });
+static Metric metricHeap("atsmini_heap_free_bytes", "Free heap memory", METRIC_GAUGE, NULL,
+  []() -> float { return(ESP.getFreeHeap()); });
+static Metric metricHeapMin("atsmini_heap_min_free_bytes", "Least free heap memory since boot", METRIC_GAUGE, NULL,
+  []() -> float { return(ESP.getMinFreeHeap()); });
+static Metric metricPsram("atsmini_psram_free_bytes", "Free PSRAM", METRIC_GAUGE, NULL,
+  []() -> float { return(psramFound() ? ESP.getFreePsram() : NAN); });
+static Metric metricRssi("atsmini_wifi_rssi_dbm", "Wi-Fi signal strength", METRIC_GAUGE, NULL,
+  []() -> float { return(WiFi.status() == WL_CONNECTED ? WiFi.RSSI() : NAN); });
+static Metric metricLoops("atsmini_loop_iterations_total", "Main loop iterations", METRIC_COUNTER);
+static Metric metricLoopMax("atsmini_loop_time_max_seconds", "Longest main loop iteration in the last 10 seconds", METRIC_GAUGE);
+
+//
+// Write metric with the given index, with the family description
+// before the first one of each family. False past the last metric.
+//
+bool metricsWrite(Print *out, int index)
+{
+  const Metric *prev = NULL, *m = Metric::first();
+  char buf[192], value[16];
+  float v;
+
+  for( ; m && index>0 ; index--) { prev = m; m = m->next; }
+  if(!m) return(false);
+
+  if(!prev || strcmp(prev->name, m->name))
+  {
+    snprintf(buf, sizeof(buf), "# HELP %s %s\n# TYPE %s %s\n",
+      m->name, m->help, m->name, m->type == METRIC_COUNTER ? "counter" : "gauge");
+    out->write((const uint8_t *)buf, strlen(buf));
+  }
+
+  // Gauges may have no value for now, infinities are spelled +Inf
+  // and -Inf
+  if(m->type == METRIC_COUNTER)
+    snprintf(value, sizeof(value), "%lu", (unsigned long)m->total());
+  else if(isinf(v = m->read()))
+    strcpy(value, v > 0 ? "+Inf" : "-Inf");
+  else if(!isnan(v))
+    snprintf(value, sizeof(value), "%.7g", v);
+  else
+    value[0] = '\0';
+
+  if(value[0])
+    snprintf(buf, sizeof(buf), "%s%s%s%s %s\n", m->name,
+      m->labels ? "{" : "", m->labels ? m->labels : "", m->labels ? "}" : "",
+      value);
+  else
+    buf[0] = '\0';
+
+  out->write((const uint8_t *)buf, strlen(buf));
+  return(true);
+}
+
+//
+// Register /metrics with the web server
+//
+void metricsInit(AsyncWebServer *server)
+{
+  server->on("/metrics", HTTP_GET, [] (AsyncWebServerRequest *request) {
+    apiSendChunked(request, metricsWrite, "text/plain; version=0.0.4");
+  });
+}
+
+//
+// Called at the start of every main loop iteration
+//
+void metricsTickTime()
+{
+  static uint32_t lastTime = 0;
+  static uint32_t windowTime = 0;
+  static uint32_t windowMax = 0;
+  uint32_t now = micros();
+
+  if(lastTime) windowMax = max(windowMax, now - lastTime);
+  lastTime = now;
+  metricLoops.add();
+
+  if(millis() - windowTime >= METRICS_WINDOW)
+  {
+    metricLoopMax.set(windowMax / 1000000.0f);
+    windowTime = millis();
+    windowMax = 0;
+  }
+}
@@ -0,0 +1,59 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include <atomic>
+
+//
+// Counters and gauges served at /metrics in the Prometheus text format.
+// A module declares its metrics as static objects, which register
+// themselves when constructed, and updates them with add() or set().
+// Nothing is allocated, updates are safe from any task. Metrics of the
+// same family (name) tell themselves apart with labels, for example
+// "source=\"tcp\"". Names follow the Prometheus conventions: base units
+// (seconds, bytes, volts) and a "_total" suffix for counters.
+//
+
+#define METRIC_COUNTER   0
+#define METRIC_GAUGE     1
+
+#define METRICS_WINDOW   10000  // Loop time statistics period (ms)
+
+class Print;
+class AsyncWebServer;
+
+class Metric
+{
+  public:
+    // The help text and labels have to stay valid, get() reads a gauge
+    // when it is served (NAN - no value now)
+    Metric(const char *name, const char *help, uint8_t type, const char *labels = NULL, float (*get)() = NULL);
+
+    void add(uint32_t n = 1) { count.fetch_add(n, std::memory_order_relaxed); }
+    void set(float v)        { value.store(v, std::memory_order_relaxed); }
+    float read() const;
+    uint32_t total() const;
+
+    const char *name;
+    const char *help;
+    const char *labels;
+    uint8_t type;
+
+    // Next registered metric, families are kept together
+    Metric *next;
+
+    static Metric *first() { return(head); }
+
+  private:
+    static Metric *head;
+
+    float (*get)();
+    std::atomic<uint32_t> count;
+    std::atomic<float> value;
+};
+
+bool metricsWrite(Print *out, int index);
+void metricsInit(AsyncWebServer *server);
+void metricsTickTime();
+
+#endif // METRICS_H
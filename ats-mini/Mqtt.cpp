@@ -0,0 +1,601 @@
+#include "Common.h"
+#include "Storage.h"
+#include "Utils.h"
+#include "Menu.h"
+#include "Api.h"
+#include "Metrics.h"
+#include "Mqtt.h"
+#include <AsyncTCP.h>
+
+// Connection states
+#define MQTT_OFF      0 // No broker or no network
+#define MQTT_IDLE     1 // Waiting to connect
+#define MQTT_CONNECT  2 // TCP connection in progress
+#define MQTT_CONNACK  3 // Waiting for the broker to accept the connection
+#define MQTT_READY    4 // Connected
+
+// Packet types
+#define MQTT_PKT_CONNECT     0x10
+#define MQTT_PKT_CONNACK     0x20
+#define MQTT_PKT_PUBLISH     0x30
+#define MQTT_PKT_PUBACK      0x40
+#define MQTT_PKT_SUBSCRIBE   0x82
+#define MQTT_PKT_SUBACK      0x90
+#define MQTT_PKT_PINGREQ     0xC0
+#define MQTT_PKT_PINGRESP    0xD0
+#define MQTT_PKT_DISCONNECT  0xE0
+
+// Configuration, loaded by the main loop
+static char mqttHost[64] = "";
+static uint16_t mqttPort = MQTT_PORT;
+static char mqttStatusTopic[72] = "";
+static char mqttSetTopic[72] = "";
+static uint16_t mqttInterval = MQTT_INTERVAL;
+static volatile bool mqttReload = true;
+
+static AsyncClient mqttClient;
+static uint8_t mqttState = MQTT_OFF;
+static uint32_t mqttStateTime = 0;
+static uint32_t mqttSendTime = 0;
+
+// Set by the network task
+static volatile bool mqttTcpUp = false;
+static volatile bool mqttTcpDown = false;
+static volatile int16_t mqttConnack = -1;   // Return code (-1 - none yet)
+static volatile uint16_t mqttAckId = 0;     // Last acknowledged message
+
+// Packet ID of the oldest message (0 - not published yet) and whether
+// it was published over this connection
+static uint16_t mqttMessageId = 0;
+static uint16_t mqttNextId = 1;
+static bool mqttWaitAck = false;
+
+// Messages waiting to be published: 16-bit length and JSON text, oldest
+// at the tail
+static uint8_t *mqttBuf = NULL;
+static size_t mqttBufSize = 0;
+static size_t mqttHead = 0;
+static size_t mqttTail = 0;
+static size_t mqttUsed = 0;
+
+// Samples for the next message
+static struct
+{
+  uint32_t time;
+  uint32_t freq;
+  uint8_t rssi;
+  uint8_t snr;
+} mqttSamples[MQTT_BATCH];
+static uint8_t mqttSampleCount = 0;
+static uint32_t mqttSampleTime = 0;
+static time_t mqttBatchClock = 0;
+
+static Metric metricMessages("atsmini_mqtt_messages_total", "MQTT messages acknowledged by the broker", METRIC_COUNTER);
+static Metric metricDropped("atsmini_mqtt_dropped_total", "MQTT messages dropped with a full buffer", METRIC_COUNTER);
+
+//
+// Message being formatted
+//
+class MqttMessage : public Print
+{
+  public:
+    uint8_t buf[MQTT_MESSAGE];
+    size_t length = 0;
+    bool full = false;
+
+    size_t write(uint8_t c) override
+    {
+      if(length >= sizeof(buf)) { full = true; return(0); }
+      buf[length++] = c;
+      return(1);
+    }
+};
+
+static MqttMessage mqttMessage;
+
+static void mqttRingRead(size_t pos, uint8_t *out, size_t size)
+{
+  for(size_t i=0 ; i<size ; i++) out[i] = mqttBuf[(pos + i) % mqttBufSize];
+}
+
+static uint16_t mqttRingFront()
+{
+  uint8_t len[2];
+
+  if(!mqttUsed) return(0);
+  mqttRingRead(mqttTail, len, 2);
+  return(len[0] | (len[1] << 8));
+}
+
+static void mqttRingPop()
+{
+  size_t size = 2 + mqttRingFront();
+
+  mqttTail = (mqttTail + size) % mqttBufSize;
+  mqttUsed -= size;
+
+  // The message being published is always the oldest
+  mqttMessageId = 0;
+  mqttWaitAck = false;
+}
+
+//
+// Add a message, dropping the oldest ones to make room
+//
+static void mqttRingPush(const uint8_t *data, uint16_t size)
+{
+  uint8_t len[2] = { (uint8_t)size, (uint8_t)(size >> 8) };
+
+  if(!mqttBuf || size + 2U > mqttBufSize) return;
+
+  while(mqttBufSize - mqttUsed < size + 2U)
+  {
+    mqttRingPop();
+    metricDropped.add();
+  }
+
+  for(size_t i=0 ; i<2U + size ; i++)
+  {
+    mqttBuf[mqttHead] = i<2 ? len[i] : data[i - 2];
+    mqttHead = (mqttHead + 1) % mqttBufSize;
+  }
+
+  mqttUsed += size + 2;
+}
+
+//
+// Packet encoding, the remaining length takes one to four bytes
+//
+size_t mqttPutLength(uint8_t *p, uint32_t length)
+{
+  size_t n = 0;
+
+  do
+  {
+    p[n] = length & 0x7F;
+    length >>= 7;
+    if(length) p[n] |= 0x80;
+  }
+  while(p[n++] & 0x80);
+
+  return(n);
+}
+
+static size_t mqttPutString(uint8_t *p, const char *s)
+{
+  size_t len = strlen(s);
+
+  p[0] = len >> 8;
+  p[1] = len;
+  memcpy(p + 2, s, len);
+  return(len + 2);
+}
+
+static void mqttSend(const uint8_t *data, size_t size)
+{
+  mqttClient.add((const char *)data, size);
+  mqttClient.send();
+  mqttSendTime = millis();
+}
+
+static void mqttSendConnect()
+{
+  uint8_t pkt[96], body[80];
+  char id[24] = "atsmini-";
+  size_t n = 0, m = 0;
+
+  // Client ID from the MAC address
+  for(const char *p = getMACAddress() ; *p ; p++)
+    if(*p != ':' && strlen(id) < sizeof(id) - 1) strncat(id, p, 1);
+
+  m += mqttPutString(body + m, "MQTT");
+  body[m++] = 4;    // Protocol level (3.1.1)
+  body[m++] = 0x02; // Clean session
+  body[m++] = MQTT_KEEPALIVE >> 8;
+  body[m++] = MQTT_KEEPALIVE & 0xFF;
+  m += mqttPutString(body + m, id);
+
+  pkt[n++] = MQTT_PKT_CONNECT;
+  n += mqttPutLength(pkt + n, m);
+  memcpy(pkt + n, body, m);
+  mqttSend(pkt, n + m);
+}
+
+static void mqttSendSubscribe()
+{
+  uint8_t pkt[96];
+  size_t n = 0;
+
+  pkt[n++] = MQTT_PKT_SUBSCRIBE;
+  n += mqttPutLength(pkt + n, 2 + 2 + strlen(mqttSetTopic) + 1);
+  pkt[n++] = 0;
+  pkt[n++] = 1;  // Packet ID
+  n += mqttPutString(pkt + n, mqttSetTopic);
+  pkt[n++] = 0;  // QoS 0
+  mqttSend(pkt, n);
+}
+
+static void mqttSendPing()
+{
+  uint8_t pkt[2] = { MQTT_PKT_PINGREQ, 0 };
+  mqttSend(pkt, sizeof(pkt));
+}
+
+//
+// Publish the oldest message with QoS 1, once there is room for it. A
+// message published over an earlier connection is sent again as a
+// duplicate.
+//
+static void mqttPublish()
+{
+  uint16_t size = mqttRingFront();
+  size_t topic = strlen(mqttStatusTopic);
+  bool dup = mqttMessageId != 0;
+  uint8_t pkt[96];
+  size_t n = 0;
+
+  if(!size || mqttClient.space() < 5 + 2 + topic + 2 + size) return;
+
+  if(!dup)
+  {
+    mqttMessageId = mqttNextId;
+    mqttNextId = mqttNextId == 0xFFFF ? 1 : mqttNextId + 1;
+  }
+
+  pkt[n++] = MQTT_PKT_PUBLISH | (dup ? 0x08 : 0) | 0x02;
+  n += mqttPutLength(pkt + n, 2 + topic + 2 + size);
+  n += mqttPutString(pkt + n, mqttStatusTopic);
+  pkt[n++] = mqttMessageId >> 8;
+  pkt[n++] = mqttMessageId & 0xFF;
+  mqttClient.add((const char *)pkt, n);
+
+  // Payload, in two pieces if it wraps around the buffer end
+  size_t pos = (mqttTail + 2) % mqttBufSize;
+  size_t first = min((size_t)size, mqttBufSize - pos);
+  mqttClient.add((const char *)mqttBuf + pos, first);
+  if(first < size) mqttClient.add((const char *)mqttBuf, size - first);
+
+  mqttClient.send();
+  mqttSendTime = millis();
+  mqttWaitAck = true;
+}
+
+//
+// Network task: handle a received packet
+//
+static void mqttOnPacket(uint8_t type, const uint8_t *data, size_t size)
+{
+  switch(type & 0xF0)
+  {
+    case MQTT_PKT_CONNACK:
+      if(size >= 2) mqttConnack = data[1];
+      break;
+
+    case MQTT_PKT_PUBACK:
+      if(size >= 2) mqttAckId = (data[0] << 8) | data[1];
+      break;
+
+    case MQTT_PKT_PUBLISH:
+      {
+        size_t len = size >= 2 ? (data[0] << 8) | data[1] : size;
+        size_t skip = 2 + len + ((type & 0x06) ? 2 : 0);
+        char text[MQTT_RX_SIZE + 1];
+
+        if(size < 2 || skip > size) break;
+        if(len != strlen(mqttSetTopic) || memcmp(data + 2, mqttSetTopic, len)) break;
+
+        // Status change, ignored if malformed
+        memcpy(text, data + skip, size - skip);
+        text[size - skip] = '\0';
+        apiQueueStatus(text);
+      }
+      break;
+
+    default:
+      // SUBACK, PINGRESP
+      break;
+  }
+}
+
+//
+// Network task: split received data into packets, packets too large
+// for the buffer are skipped
+//
+static uint8_t mqttRx[MQTT_RX_SIZE];
+static size_t mqttRxLength = 0;
+static uint32_t mqttRxSkip = 0;
+
+static void mqttOnData(void *arg, AsyncClient *client, void *data, size_t length)
+{
+  const uint8_t *p = (const uint8_t *)data;
+
+  while(length)
+  {
+    if(mqttRxSkip)
+    {
+      size_t n = min((size_t)mqttRxSkip, length);
+      mqttRxSkip -= n;
+      p += n;
+      length -= n;
+      continue;
+    }
+
+    mqttRx[mqttRxLength++] = *p++;
+    length--;
+
+    // Fixed header: type and up to four bytes of remaining length
+    uint32_t size = 0;
+    size_t n;
+    for(n=1 ; n<mqttRxLength && n<=4 ; n++)
+    {
+      size |= (mqttRx[n] & 0x7F) << (7 * (n - 1));
+      if(!(mqttRx[n] & 0x80)) break;
+    }
+
+    if(n >= mqttRxLength) continue;
+
+    if(n > 4)
+    {
+      // Not MQTT
+      mqttRxLength = 0;
+      client->close(true);
+      return;
+    }
+
+    if(n + 1 + size > sizeof(mqttRx))
+    {
+      mqttRxSkip = size;
+      mqttRxLength = 0;
+      continue;
+    }
+
+    if(mqttRxLength == n + 1 + size)
+    {
+      mqttOnPacket(mqttRx[0], mqttRx + n + 1, size);
+      mqttRxLength = 0;
+    }
+  }
+}
+
+static void mqttOnConnect(void *arg, AsyncClient *client)
+{
+  mqttRxLength = 0;
+  mqttRxSkip = 0;
+  mqttTcpUp = true;
+}
+
+static void mqttOnDisconnect(void *arg, AsyncClient *client)
+{
+  mqttTcpDown = true;
+}
+
+//
+// Read the broker ("host" or "host:port"), topic and interval. Uses
+// its own handle, the web server may have the global prefs open.
+//
+static void mqttLoad()
+{
+  // Keep the messages, but talk to the new broker
+  if(mqttState > MQTT_IDLE) mqttClient.close(true);
+  mqttState = MQTT_OFF;
+
+  Preferences netPrefs;
+  netPrefs.begin("network", true, STORAGE_PARTITION);
+  String broker = netPrefs.getString("mqttbroker", "");
+  String topic  = netPrefs.getString("mqtttopic", "atsmini");
+  mqttInterval  = netPrefs.getUShort("mqttinterval", MQTT_INTERVAL);
+  netPrefs.end();
+
+  int colon = broker.indexOf(':');
+  mqttPort = colon < 0 ? MQTT_PORT : broker.substring(colon + 1).toInt();
+  if(colon >= 0) broker = broker.substring(0, colon);
+  if(!mqttPort) mqttPort = MQTT_PORT;
+  if(!mqttInterval) mqttInterval = MQTT_INTERVAL;
+
+  snprintf(mqttHost, sizeof(mqttHost), "%s", broker.c_str());
+  snprintf(mqttStatusTopic, sizeof(mqttStatusTopic), "%.63s/status", topic.c_str());
+  snprintf(mqttSetTopic, sizeof(mqttSetTopic), "%.63s/set", topic.c_str());
+
+  if(mqttHost[0] && !mqttBuf)
+  {
+    mqttBuf = (uint8_t *)ps_malloc(MQTT_BUFFER);
+    mqttBufSize = MQTT_BUFFER;
+    if(!mqttBuf)
+    {
+      mqttBuf = (uint8_t *)malloc(MQTT_BUFFER_SMALL);
+      mqttBufSize = mqttBuf ? MQTT_BUFFER_SMALL : 0;
+    }
+  }
+
+  static bool callbacks = false;
+  if(!callbacks)
+  {
+    mqttClient.onConnect(mqttOnConnect);
+    mqttClient.onDisconnect(mqttOnDisconnect);
+    mqttClient.onData(mqttOnData);
+    callbacks = true;
+  }
+}
+
+//
+// Called by the web server task once the MQTT settings are saved
+//
+void mqttRequestReload()
+{
+  mqttReload = true;
+}
+
+//
+// Turn the samples into a message once the interval is over
+//
+static void mqttBatch()
+{
+  MqttMessage *out = &mqttMessage;
+  uint32_t start = mqttSamples[0].time;
+
+  if(!mqttSampleCount || millis() - start < mqttInterval * 1000UL) return;
+
+  out->length = 0;
+  out->full = false;
+
+  if(mqttBatchClock)
+    out->printf("{\"time\":%lu,", (unsigned long)mqttBatchClock);
+  else
+    out->print("{\"time\":null,");
+
+  out->printf("\"uptime\":%lu,\"band\":", (unsigned long)(start / 1000));
+  jsonPrintString(out, getCurrentBand()->bandName);
+  out->print(",\"mode\":");
+  jsonPrintString(out, bandModeDesc[currentMode]);
+  out->print(",\"station\":");
+  jsonPrintString(out, getStationName());
+  out->print(",\"text\":");
+  jsonPrintString(out, getRadioText());
+  out->print(",\"samples\":[");
+
+  // Seconds from the first sample, frequency (Hz), RSSI, SNR
+  for(int i=0 ; i<mqttSampleCount ; i++)
+    out->printf("%s[%lu,%lu,%u,%u]", i ? "," : "",
+      (unsigned long)((mqttSamples[i].time - start + 500) / 1000),
+      (unsigned long)mqttSamples[i].freq, mqttSamples[i].rssi, mqttSamples[i].snr);
+
+  out->print("]}");
+
+  if(!out->full) mqttRingPush(out->buf, out->length);
+  mqttSampleCount = 0;
+}
+
+//
+// Take a sample, called whenever RSSI and SNR are measured
+//
+void mqttSample(uint8_t rssi, uint8_t snr)
+{
+  // Long intervals take fewer samples
+  uint32_t period = mqttInterval * 1000UL / MQTT_BATCH;
+  if(period < MQTT_SAMPLE_TIME) period = MQTT_SAMPLE_TIME;
+
+  // Only when staying connected to a network
+  if(!mqttHost[0] || (wifiModeIdx != NET_CONNECT && wifiModeIdx != NET_AP_CONNECT)) return;
+  if(mqttSampleCount && millis() - mqttSampleTime < period) return;
+
+  // Finish the message if this sample belongs to the next one
+  mqttBatch();
+  if(mqttSampleCount >= MQTT_BATCH) return;
+
+  if(!mqttSampleCount) mqttBatchClock = ntpIsAvailable() ? time(NULL) : 0;
+
+  mqttSampleTime = millis();
+  mqttSamples[mqttSampleCount++] = { mqttSampleTime, getCurrentFrequencyHz(), rssi, snr };
+}
+
+static void mqttSetState(uint8_t state)
+{
+  mqttState = state;
+  mqttStateTime = millis();
+}
+
+//
+// Called from netTickTime(): batch samples, keep the connection and
+// publish waiting messages
+//
+void mqttTickTime()
+{
+  bool online = mqttHost[0] && getWiFiStatus() == 2;
+  uint32_t elapsed = millis() - mqttStateTime;
+
+  if(mqttReload)
+  {
+    mqttReload = false;
+    mqttLoad();
+  }
+
+  mqttBatch();
+
+  // Once the broker has a message, send the next one
+  if(mqttWaitAck && mqttAckId == mqttMessageId)
+  {
+    mqttRingPop();
+    metricMessages.add();
+  }
+
+  if(mqttTcpDown)
+  {
+    mqttTcpDown = false;
+    mqttTcpUp = false;
+    if(mqttState > MQTT_IDLE) mqttSetState(MQTT_IDLE);
+  }
+
+  switch(mqttState)
+  {
+    case MQTT_OFF:
+      if(!online) break;
+      // Connect right away
+      mqttSetState(MQTT_IDLE);
+      mqttStateTime -= MQTT_RETRY_TIME;
+      break;
+
+    case MQTT_IDLE:
+      if(!online) { mqttSetState(MQTT_OFF); break; }
+      if(elapsed < MQTT_RETRY_TIME) break;
+
+      mqttConnack = -1;
+      mqttTcpUp = false;
+      mqttSetState(mqttClient.connect(mqttHost, mqttPort) ? MQTT_CONNECT : MQTT_IDLE);
+      break;
+
+    case MQTT_CONNECT:
+      if(mqttTcpUp)
+      {
+        // New session, publish the oldest message again
+        mqttWaitAck = false;
+        mqttSendConnect();
+        mqttSetState(MQTT_CONNACK);
+      }
+      else if(elapsed >= MQTT_WAIT_TIME)
+      {
+        mqttClient.close(true);
+        mqttSetState(MQTT_IDLE);
+      }
+      break;
+
+    case MQTT_CONNACK:
+      if(mqttConnack == 0)
+      {
+        mqttSendSubscribe();
+        mqttSetState(MQTT_READY);
+      }
+      else if(mqttConnack > 0 || elapsed >= MQTT_WAIT_TIME)
+      {
+        mqttClient.close(true);
+        mqttSetState(MQTT_IDLE);
+      }
+      break;
+
+    case MQTT_READY:
+      if(!online)
+      {
+        mqttStop();
+        break;
+      }
+
+      if(!mqttWaitAck) mqttPublish();
+
+      if(millis() - mqttSendTime >= MQTT_KEEPALIVE * 500UL) mqttSendPing();
+      break;
+  }
+}
+
+//
+// Disconnect from the broker, messages are kept
+//
+void mqttStop()
+{
+  if(mqttState == MQTT_READY)
+  {
+    uint8_t pkt[2] = { MQTT_PKT_DISCONNECT, 0 };
+    mqttSend(pkt, sizeof(pkt));
+  }
+
+  if(mqttState > MQTT_IDLE) mqttClient.close(true);
+  mqttSetState(MQTT_OFF);
+}
@@ -0,0 +1,40 @@
+#ifndef MQTT_H
+#define MQTT_H
+
+#include <Arduino.h>
+
+//
+// MQTT telemetry. Once a second the main loop takes a sample of the
+// frequency, RSSI and SNR. The samples are published as one JSON
+// message per interval to <topic>/status, together with the band, mode,
+// station name and radio text. Messages wait in a ring buffer (PSRAM
+// if present) while the broker cannot be reached, and the oldest ones
+// are dropped when it is full. They are sent in order with QoS 1, one
+// at a time, and only removed once the broker acknowledges them.
+// Status change objects (as for PUT /api/v1/status) published to
+// <topic>/set tune the receiver.
+//
+// The connection is made by the network task (AsyncTCP). Received
+// packets are handled there, everything else is done by the main
+// loop, which never waits for the network.
+//
+
+#define MQTT_PORT           1883  // Default broker port
+#define MQTT_KEEPALIVE        60  // Keep alive interval (s)
+#define MQTT_RETRY_TIME    10000  // Time between connection attempts (ms)
+#define MQTT_WAIT_TIME      5000  // Longest wait for a connection (ms)
+#define MQTT_SAMPLE_TIME    1000  // Time between samples (ms)
+#define MQTT_INTERVAL         10  // Default time between messages (s)
+#define MQTT_BATCH            60  // Most samples per message
+#define MQTT_MESSAGE        3072  // Largest message (bytes)
+#define MQTT_BUFFER  (64 * 1024)  // Message buffer with PSRAM (bytes)
+#define MQTT_BUFFER_SMALL   8192  // Message buffer without PSRAM (bytes)
+#define MQTT_RX_SIZE         512  // Largest received packet (bytes)
+
+void mqttRequestReload();
+size_t mqttPutLength(uint8_t *p, uint32_t length);
+void mqttSample(uint8_t rssi, uint8_t snr);
+void mqttTickTime();
+void mqttStop();
+
+#endif // MQTT_H
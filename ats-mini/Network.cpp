@@ -4,18 +4,43 @@
 #include "Utils.h"
 #include "Menu.h"
 #include "Draw.h"
+#include "History.h"
+#include "Profile.h"
+#include "RemoteTcp.h"
+#include "Script.h"
+#include "Api.h"
+#include "Ota.h"
+#include "Metrics.h"
+#include "Mqtt.h"
+#include "Astro.h"
+#include "WebAssets.h"
 
 #include <WiFi.h>
-#include <WiFiMulti.h>
-#include <WiFiUdp.h>
 #include <AsyncTCP.h>
 #include <ESPAsyncWebServer.h>
-#include <NTPClient.h>
 #include <ESPmDNS.h>
+#include <LittleFS.h>
+#include <esp_sntp.h>
 
 #define CONNECT_TIME  3000  // Time of inactivity to start connecting WiFi
+#define SCAN_TIME    10000  // Longest time to look for known networks (ms)
+#define JOIN_TIME    10000  // Longest time to connect to a network (ms)
+#define NTP_TIME      5000  // Longest wait for the NTP time after connecting (ms)
+#define SYNC_TIME    15000  // Longest wait for the downloads in the Sync Only mode (ms)
+#define STATUS_TIME   2000  // Time the connection status stays on screen (ms)
+#define NTP_INTERVAL 300000 // NTP time update period (ms)
 
-WiFiMulti wifiMulti;
+//
+// Network bring-up steps, advanced by netTickTime() so that the main
+// loop keeps running while connecting
+//
+#define NET_STATE_OFF    0 // Nothing to do
+#define NET_STATE_START  1 // Showing access point status before connecting
+#define NET_STATE_SCAN   2 // Looking for known networks
+#define NET_STATE_JOIN   3 // Connecting to a network
+#define NET_STATE_NTP    4 // Connected, waiting for NTP time
+#define NET_STATE_SYNC   5 // Waiting for the downloads before disconnecting
+#define NET_STATE_READY  6 // Done
 
 //
 // Access Point (AP) mode settings
@@ -26,11 +51,28 @@ static const int   apChannel = 10;      // WiFi channel number (1..13)
 static const bool  apHideMe  = false;   // TRUE: disable SSID broadcast
 static const int   apClients = 3;       // Maximum simultaneous connected clients
 
-static uint16_t ajaxInterval = 2500;
-
 static bool itIsTimeToWiFi = false; // TRUE: Need to connect to WiFi
 static uint32_t connectTime = millis();
 
+static uint8_t netState = NET_STATE_OFF;
+static uint8_t netMode = NET_OFF;
+static uint32_t netStateTime = 0;
+
+// Known networks, in the order to try them
+static String netSSID[3];
+static String netPass[3];
+static uint8_t netOrder[3];
+static uint8_t netCount = 0;
+static uint8_t netNext = 0;
+
+// Connection status shown on screen
+static String netStatus1;
+static String netStatus2;
+static uint32_t netStatusTime = 0;
+static bool netVerbose = false;
+
+static volatile bool ntpTimeSet = false;
+
 // Settings
 String loginUsername = "";
 String loginPassword = "";
@@ -38,23 +80,21 @@ String loginPassword = "";
 // AsyncWebServer object on port 80
 AsyncWebServer server(80);
 
-// NTP Client to get time
-WiFiUDP ntpUDP;
-NTPClient ntpClient(ntpUDP, "pool.ntp.org");
-
 static bool wifiInitAP();
-static bool wifiConnect();
+static void wifiConnect();
+static void wifiJoinNext();
+static void netStartServices();
 static void webInit();
 
 static void webSetConfig(AsyncWebServerRequest *request);
 static void webSetControl(AsyncWebServerRequest *request);
+static void webScript(AsyncWebServerRequest *request);
+static void webSendAsset(AsyncWebServerRequest *request, const WebAsset *asset);
 
 static const String webInputField(const String &name, const String &value, bool pass = false);
-static const String webStyleSheet();
 static const String webPage(const String &body);
 static const String webUtcOffsetSelector();
 static const String webThemeSelector();
-static const String webRadioPage();
 static const String webMemoryPage();
 static const String webConfigPage();
 
@@ -67,8 +107,51 @@ void netRequestConnect()
   itIsTimeToWiFi = true;
 }
 
-void netTickTime()
+//
+// Show connection status, it stays on screen for a while
+//
+static void netShowStatus(const String &line1, const String &line2 = "")
+{
+  if(!netVerbose) return;
+
+  netStatus1 = line1;
+  netStatus2 = line2;
+  netStatusTime = millis();
+  drawScreen();
+}
+
+//
+// Returns TRUE and the status lines if the connection status should
+// be on screen
+//
+bool netGetStatus(const char **statusLine1, const char **statusLine2)
+{
+  bool connecting = netState==NET_STATE_SCAN || netState==NET_STATE_JOIN;
+
+  if(!netVerbose || (!connecting && (millis() - netStatusTime >= STATUS_TIME)))
+    return(false);
+
+  *statusLine1 = netStatus1.c_str();
+  *statusLine2 = netStatus2 != "" ? netStatus2.c_str() : NULL;
+  return(true);
+}
+
+static void netSetState(uint8_t state)
+{
+  netState = state;
+  netStateTime = millis();
+}
+
+//
+// Advance network bring-up, returns TRUE if the screen needs redrawing
+//
+bool netTickTime()
 {
+  static bool statusShown = false;
+  uint32_t elapsed = millis() - netStateTime;
+  int32_t rssi[3];
+  int n;
+
   // Connect to WiFi if requested
   if(itIsTimeToWiFi && ((millis() - connectTime) > CONNECT_TIME))
   {
@@ -76,6 +159,90 @@ void netTickTime()
     connectTime = millis();
     itIsTimeToWiFi = false;
   }
+
+  switch(netState)
+  {
+    case NET_STATE_START:
+      // Let user see the access point status first
+      if(netMode==NET_AP_CONNECT && netVerbose && elapsed < STATUS_TIME) break;
+      wifiConnect();
+      break;
+
+    case NET_STATE_SCAN:
+      n = WiFi.scanComplete();
+      if(n==WIFI_SCAN_RUNNING && elapsed < SCAN_TIME) break;
+
+      // Try the strongest known network first, then the ones not
+      // found (they may be hidden)
+      netCount = 0;
+      for(int k=0 ; k<3 ; k++)
+      {
+        if(netSSID[k] == "") continue;
+
+        rssi[k] = INT32_MIN;
+        for(int j=0 ; j<n ; j++)
+          if(WiFi.SSID(j) == netSSID[k] && WiFi.RSSI(j) > rssi[k]) rssi[k] = WiFi.RSSI(j);
+
+        int i = netCount++;
+        for( ; i>0 && rssi[netOrder[i-1]] < rssi[k] ; i--) netOrder[i] = netOrder[i-1];
+        netOrder[i] = k;
+      }
+
+      WiFi.scanDelete();
+      netNext = 0;
+      wifiJoinNext();
+      break;
+
+    case NET_STATE_JOIN:
+      if(WiFi.status()==WL_CONNECTED)
+      {
+        // WiFi connection succeeded
+        netShowStatus(
+          "Connected to WiFi network (" + WiFi.SSID() + ")",
+          "IP : " + WiFi.localIP().toString() + " or atsmini.local"
+        );
+
+        if(netMode==NET_CONNECT) netStartServices();
+
+        // Get NTP time from the network, updated every 5 minutes
+        clockReset();
+        sntp_set_time_sync_notification_cb([](struct timeval *tv) { ntpTimeSet = true; });
+        sntp_set_sync_interval(NTP_INTERVAL);
+        configTime(0, 0, "pool.ntp.org");
+        netSetState(NET_STATE_NTP);
+      }
+      else if(elapsed >= JOIN_TIME)
+        wifiJoinNext();
+      break;
+
+    case NET_STATE_NTP:
+      if(!ntpIsAvailable() && elapsed < NTP_TIME) break;
+      ntpSyncTime();
+
+      // Fetch Solar/DX data once, in the background
+      updatePropagationData();
+      netSetState(netMode==NET_SYNC ? NET_STATE_SYNC : NET_STATE_READY);
+      break;
+
+    case NET_STATE_SYNC:
+      if(propagationBusy() && elapsed < SYNC_TIME) break;
+
+      // Only connected to sync, drop network connection
+      WiFi.disconnect(true);
+      WiFi.mode(WIFI_MODE_NULL);
+      netSetState(NET_STATE_OFF);
+      break;
+  }
+
+  // Publish telemetry, keep the broker connection
+  mqttTickTime();
+
+  // Redraw when the status appears or goes away
+  const char *line1, *line2;
+  bool shown = netGetStatus(&line1, &line2);
+  bool changed = shown != statusShown;
+  statusShown = shown;
+  return(changed);
 }
 
 //
@@ -114,7 +281,16 @@ void netStop()
 {
   wifi_mode_t mode = WiFi.getMode();
 
+  netSetState(NET_STATE_OFF);
+  netVerbose = false;
+
+  mqttStop();
+  remoteTcpStop();
+  apiStop();
   MDNS.end();
+  esp_sntp_stop();
+  ntpTimeSet = false;
+  WiFi.scanDelete();
 
   // If network connection up, shut it down
   if((mode==WIFI_STA) || (mode==WIFI_AP_STA))
@@ -128,14 +304,35 @@ void netStop()
 }
 
 //
-// Initialize WiFi network and services
+// Initialize WiFi network and services. The connection is made
+// later by netTickTime().
 //
-void netInit(uint8_t netMode, bool showStatus)
+void netInit(uint8_t mode, bool showStatus)
 {
   // Always disable WiFi first
   netStop();
+  netMode = mode;
+  netVerbose = showStatus;
 
-  switch(netMode)
+  // Get the preferences
+  prefs.begin("network", true, STORAGE_PARTITION);
+  loginUsername = prefs.getString("loginusername", "");
+  loginPassword = prefs.getString("loginpassword", "");
+
+  for(int j=0 ; j<3 ; j++)
+  {
+    char nameSSID[16], namePASS[16];
+    sprintf(nameSSID, "wifissid%d", j+1);
+    sprintf(namePASS, "wifipass%d", j+1);
+
+    netSSID[j] = prefs.getString(nameSSID, "");
+    netPass[j] = prefs.getString(namePASS, "");
+  }
+
+  // Done with preferences
+  prefs.end();
+
+  switch(mode)
   {
     case NET_OFF:
       // Do not initialize WiFi if disabled
@@ -143,14 +340,10 @@ void netInit(uint8_t netMode, bool showStatus)
     case NET_AP_ONLY:
       // Start WiFi access point if requested
       WiFi.mode(WIFI_AP);
-      // Let user see connection status if successful
-      if(wifiInitAP() && showStatus) delay(2000);
       break;
     case NET_AP_CONNECT:
       // Start WiFi access point if requested
       WiFi.mode(WIFI_AP_STA);
-      // Let user see connection status if successful
-      if(wifiInitAP() && showStatus) delay(2000);
       break;
     default:
       // No access point
@@ -158,40 +351,33 @@ void netInit(uint8_t netMode, bool showStatus)
       break;
   }
 
-  // Initialize WiFi and try connecting to a network
-  if(netMode>NET_AP_ONLY && wifiConnect())
+  // Services are available through the access point right away,
+  // let user see its status before connecting to a network
+  if(mode==NET_AP_ONLY || mode==NET_AP_CONNECT)
   {
-    // Let user see connection status if successful
-    if(netMode!=NET_SYNC && showStatus) delay(2000);
-
-    // NTP time updates will happen every 5 minutes
-    ntpClient.setUpdateInterval(5*60*1000);
-
-    // Get NTP time from the network
-    clockReset();
-    for(int j=0 ; j<10 ; j++)
-      if(ntpSyncTime()) break; else delay(500);
-      
-    // Fetch Solar/DX Data once
-    updatePropagationData();
+    wifiInitAP();
+    netStartServices();
   }
 
-  // If only connected to sync...
-  if(netMode==NET_SYNC)
-  {
-    // Drop network connection
-    WiFi.disconnect(true);
-    WiFi.mode(WIFI_MODE_NULL);
-  }
-  else
-  {
-    // Initialize web server for remote configuration
-    webInit();
+  netSetState(mode>NET_AP_ONLY ? NET_STATE_START : NET_STATE_READY);
+}
 
-    // Initialize mDNS
-    MDNS.begin("atsmini"); // Set the hostname to "atsmini.local"
-    MDNS.addService("http", "tcp", 80);
-  }
+//
+// Start web server, remote control servers and mDNS
+//
+static void netStartServices()
+{
+  // Initialize web server for remote configuration
+  webInit();
+
+  // Initialize remote control servers
+  remoteTcpInit();
+
+  // Initialize mDNS
+  MDNS.begin("atsmini"); // Set the hostname to "atsmini.local"
+  MDNS.addService("http", "tcp", 80);
+  MDNS.addService("rigctld", "tcp", REMOTE_TCP_RIGCTL_PORT);
+  MDNS.addService("atsmini", "tcp", REMOTE_TCP_ADHOC_PORT);
 }
 
 //
@@ -199,24 +385,21 @@ void netInit(uint8_t netMode, bool showStatus)
 //
 bool ntpIsAvailable()
 {
-  return(ntpClient.isTimeSet());
+  return(ntpTimeSet);
 }
 
 //
-// Update NTP time and synchronize clock with NTP time
+// Synchronize clock with NTP time (kept by the system in the background)
 //
 bool ntpSyncTime()
 {
-  if(WiFi.status()==WL_CONNECTED)
+  if(WiFi.status()==WL_CONNECTED && ntpTimeSet)
   {
-    ntpClient.update();
-
-    if(ntpClient.isTimeSet())
-      return(clockSet(
-        ntpClient.getHours(),
-        ntpClient.getMinutes(),
-        ntpClient.getSeconds()
-      ));
+    time_t now = time(NULL);
+    struct tm utc;
+
+    gmtime_r(&now, &utc);
+    return(clockSet(utc.tm_hour, utc.tm_min, utc.tm_sec));
   }
   return(false);
 }
@@ -235,67 +418,50 @@ static bool wifiInitAP()
   WiFi.softAP(apSSID, apPWD, apChannel, apHideMe, apClients);
   WiFi.softAPConfig(ip, gateway, subnet);
 
-  drawScreen(
-    ("Use Access Point " + String(apSSID)).c_str(),
-    ("IP : " + WiFi.softAPIP().toString() + " or atsmini.local").c_str()
+  netShowStatus(
+    "Use Access Point " + String(apSSID),
+    "IP : " + WiFi.softAPIP().toString() + " or atsmini.local"
   );
 
-  ajaxInterval = 2500;
   return(true);
 }
 
 //
-// Connect to a WiFi network
+// Start looking for known WiFi networks
 //
-static bool wifiConnect()
+static void wifiConnect()
 {
-  String status = "Connecting to WiFi network...";
-
-  // Clean credentials
-  wifiMulti.APlistClean();
-
-  // Get the preferences
-  prefs.begin("network", true, STORAGE_PARTITION);
-  loginUsername = prefs.getString("loginusername", "");
-  loginPassword = prefs.getString("loginpassword", "");
+  netShowStatus("Connecting to WiFi network...");
+  WiFi.scanNetworks(true);
+  netSetState(NET_STATE_SCAN);
+}
 
-  // Try connecting to known WiFi networks
-  for(int j=0 ; (j<3) ; j++)
+//
+// Connect to the next known network, or give up
+//
+static void wifiJoinNext()
+{
+  if(netNext < netCount)
   {
-    char nameSSID[16], namePASS[16];
-    sprintf(nameSSID, "wifissid%d", j+1);
-    sprintf(namePASS, "wifipass%d", j+1);
-
-    String ssid = prefs.getString(nameSSID, "");
-    String password = prefs.getString(namePASS, "");
-
-    if(ssid != "")
-      wifiMulti.addAP(ssid.c_str(), password.c_str());
+    uint8_t j = netOrder[netNext++];
+    WiFi.begin(netSSID[j].c_str(), netPass[j].c_str());
+    netSetState(NET_STATE_JOIN);
+    return;
   }
 
-  // Done with preferences
-  prefs.end();
-
-  drawScreen(status.c_str());
+  // WiFi connection failed
+  WiFi.disconnect();
+  netShowStatus("Connecting to WiFi network...", "No WiFi connection");
 
-  // If failed connecting to WiFi network...
-  if (wifiMulti.run() != WL_CONNECTED)
+  if(netMode==NET_SYNC)
   {
-    // WiFi connection failed
-    drawScreen(status.c_str(), "No WiFi connection");
-    // Done
-    return(false);
+    WiFi.mode(WIFI_MODE_NULL);
+    netSetState(NET_STATE_OFF);
   }
   else
   {
-    // WiFi connection succeeded
-    drawScreen(
-      ("Connected to WiFi network (" + WiFi.SSID() + ")").c_str(),
-      ("IP : " + WiFi.localIP().toString() + " or atsmini.local").c_str()
-    );
-    // Done
-    ajaxInterval = 1000;
-    return(true);
+    if(netMode==NET_CONNECT) netStartServices();
+    netSetState(NET_STATE_READY);
   }
 }
 
@@ -304,9 +470,14 @@ static bool wifiConnect()
 //
 static void webInit()
 {
-  server.on("/", HTTP_ANY, [] (AsyncWebServerRequest *request) {
-    request->send(200, "text/html", webRadioPage());
-  });
+  // Static pages, stylesheet and scripts
+  for(unsigned int i=0 ; i<ITEM_COUNT(webAssets) ; i++)
+  {
+    const WebAsset *asset = &webAssets[i];
+    server.on(asset->path, HTTP_GET, [asset] (AsyncWebServerRequest *request) {
+      webSendAsset(request, asset);
+    });
+  }
 
   server.on("/memory", HTTP_ANY, [] (AsyncWebServerRequest *request) {
     request->send(200, "text/html", webMemoryPage());
@@ -329,40 +500,145 @@ static void webInit()
   // API Control
   server.on("/api/control", HTTP_ANY, webSetControl);
 
+  // JSON REST API
+  apiInit(&server);
+
+  // Firmware update
+  otaInit(&server);
+  metricsInit(&server);
+
+  // Script download, upload and control
+  server.on("/script", HTTP_ANY, webScript);
+  server.on("/script/log", HTTP_ANY, [] (AsyncWebServerRequest *request) {
+    if(!LittleFS.exists(SCRIPT_LOG_PATH))
+      return request->send(404, "text/plain", "No log");
+    request->send(LittleFS, SCRIPT_LOG_PATH, "text/plain");
+  });
+
+  // Signal history export (CSV)
+  server.on("/history", HTTP_ANY, [] (AsyncWebServerRequest *request) {
+    uint8_t level = request->hasParam("level") ? request->getParam("level")->value().toInt() : historyZoomIdx;
+    if(level >= HISTORY_LEVELS)
+      return request->send(400, "text/plain", "Invalid level");
+    AsyncResponseStream *response = request->beginResponseStream("text/csv");
+    historyPrint(response, level);
+    request->send(response);
+  });
+
+#ifdef RENDER_STATS
+  // Screen rendering statistics (CSV)
+  server.on("/api/stats", HTTP_ANY, [] (AsyncWebServerRequest *request) {
+    AsyncResponseStream *response = request->beginResponseStream("text/csv");
+    profilePrint(response);
+    request->send(response);
+  });
+#endif
+
   // Start web server
   server.begin();
 }
 
-void webSetControl(AsyncWebServerRequest *request)
+//
+// Find static web file by its URL path
+//
+static const WebAsset *webFindAsset(const char *path)
 {
-  if(request->hasParam("freq"))
+  for(unsigned int i=0 ; i<ITEM_COUNT(webAssets) ; i++)
+    if(!strcmp(webAssets[i].path, path)) return(&webAssets[i]);
+
+  return(NULL);
+}
+
+//
+// Send static web file as it is stored (gzip compressed), or just
+// confirm that the browser has the current version
+//
+static void webSendAsset(AsyncWebServerRequest *request, const WebAsset *asset)
+{
+  String etag = String("\"") + asset->etag + "\"";
+  AsyncWebServerResponse *response;
+
+  if(request->hasHeader("If-None-Match") && request->header("If-None-Match") == etag)
+    response = request->beginResponse(304);
+  else
   {
-    String freq = request->getParam("freq")->value();
-    if (currentMode == FM)
-        updateFrequency(freq.toFloat() * 100);
-    else
-        updateFrequency(freq.toInt());
+    response = request->beginResponse(200, asset->type, asset->data, asset->size);
+    response->addHeader("Content-Encoding", "gzip");
   }
 
-  if(request->hasParam("vol"))
+  // Files referenced with their hash never change, pages are checked
+  // with the ETag every time
+  response->addHeader("ETag", etag);
+  response->addHeader("Cache-Control", asset->immutable ? "public, max-age=31536000, immutable" : "no-cache, max-age=0");
+  request->send(response);
+}
+
+//
+// Download the script (GET), upload it as the "script" form field
+// (POST), or start and stop it ("run" parameter, 1 or 0)
+//
+void webScript(AsyncWebServerRequest *request)
+{
+  bool upload = request->hasParam("script", true);
+  bool run = request->hasParam("run");
+
+  if(!upload && !run)
   {
-    String vol = request->getParam("vol")->value();
-    volume = constrain(vol.toInt(), 0, 63);
-    rx.setVolume(volume);
+    if(!LittleFS.exists(SCRIPT_PATH))
+      return request->send(404, "text/plain", "No script");
+    return request->send(LittleFS, SCRIPT_PATH, "text/plain");
   }
-  
-  if(request->hasParam("band"))
+
+  if(loginUsername != "" && loginPassword != "")
+    if(!request->authenticate(loginUsername.c_str(), loginPassword.c_str()))
+      return request->requestAuthentication();
+
+  AsyncResponseStream *response = request->beginResponseStream("text/plain");
+
+  if(upload && !scriptSave(request->getParam("script", true)->value().c_str(), response))
+    response->setCode(400);
+  else if(run)
+  {
+    // Executed by the main loop
+    bool on = request->getParam("run")->value() != "0";
+    scriptRequestRun(on);
+    response->print(on ? "Starting script\r\n" : "Stopping script\r\n");
+  }
+
+  request->send(response);
+}
+
+void webSetControl(AsyncWebServerRequest *request)
+{
+  int32_t band = -1, vol = -1;
+  uint32_t freq = 0;
+
+  if(request->hasParam("freq"))
   {
-    String val = request->getParam("band")->value();
-    selectBand(val.toInt());
+    // MHz in FM mode, kHz otherwise
+    String val = request->getParam("freq")->value();
+    freq = currentMode == FM ? val.toFloat() * 1000000 : val.toInt() * 1000;
   }
 
+  if(request->hasParam("vol"))
+    vol = request->getParam("vol")->value().toInt();
+
+  if(request->hasParam("band"))
+    band = request->getParam("band")->value().toInt();
+
+  // Applied by the main loop shortly, the web server task must not
+  // wait for it
+  if(!apiQueueControl(band, freq, vol))
+    return request->send(503, "text/plain", "Busy, try again");
+
   request->redirect("/");
 }
 
 void webSetConfig(AsyncWebServerRequest *request)
 {
   uint32_t prefsSave = 0;
+  bool mqttChanged = false;
+  bool queued = true;
 
   // Start modifying preferences
   prefs.begin("network", false, STORAGE_PARTITION);
@@ -396,12 +672,20 @@ void webSetConfig(AsyncWebServerRequest *request)
     }
   }
 
+  // Save MQTT broker, topic and interval
+  if(request->hasParam("mqttbroker", true) && request->hasParam("mqtttopic", true) && request->hasParam("mqttinterval", true))
+  {
+    prefs.putString("mqttbroker", request->getParam("mqttbroker", true)->value());
+    prefs.putString("mqtttopic", request->getParam("mqtttopic", true)->value());
+    prefs.putUShort("mqttinterval", constrain(request->getParam("mqttinterval", true)->value().toInt(), 1, 3600));
+    mqttChanged = true;
+  }
+
   // Save time zone
   if(request->hasParam("utcoffset", true))
   {
     String utcOffset = request->getParam("utcoffset", true)->value();
-    utcOffsetIdx = utcOffset.toInt();
-    clockRefreshTime();
+    queued &= apiQueueSetting("utcOffset", utcOffset.toInt());
     prefsSave |= SAVE_SETTINGS;
   }
 
@@ -409,23 +693,55 @@ void webSetConfig(AsyncWebServerRequest *request)
   if(request->hasParam("theme", true))
   {
     String theme = request->getParam("theme", true)->value();
-    themeIdx = theme.toInt();
+    queued &= apiQueueSetting("theme", theme.toInt());
     prefsSave |= SAVE_SETTINGS;
   }
 
+  // Save Solar/DX data refresh period
+  if(request->hasParam("proprefresh", true))
+  {
+    String propRefresh = request->getParam("proprefresh", true)->value();
+    queued &= apiQueueSetting("propRefresh", propRefresh.toInt());
+    prefsSave |= SAVE_SETTINGS;
+  }
+
+  // Save receiver location, given as a locator or as degrees, or
+  // clear it when the field is empty
+  if(request->hasParam("location", true))
+  {
+    String location = request->getParam("location", true)->value();
+    int16_t lat = ASTRO_NO_LOCATION, lon = ASTRO_NO_LOCATION;
+
+    location.trim();
+    if(!location.length() || astroParseLocation(location.c_str(), &lat, &lon))
+    {
+      queued &= apiQueueSetting("latitude", lat);
+      queued &= apiQueueSetting("longitude", lon);
+      prefsSave |= SAVE_SETTINGS;
+    }
+  }
+
   // Save scroll direction and menu zoom
-  scrollDirection = request->hasParam("scroll", true)? -1 : 1;
-  zoomMenu        = request->hasParam("zoom", true);
+  queued &= apiQueueSetting("reverseScroll", request->hasParam("scroll", true));
+  queued &= apiQueueSetting("zoomMenu", request->hasParam("zoom", true));
   prefsSave |= SAVE_SETTINGS;
 
   // Done with the preferences
   prefs.end();
 
-  // Save preferences immediately
+  // Reconnect MQTT once its settings are written
+  if(mqttChanged) mqttRequestReload();
+
+  // Settings are changed by the main loop, which saves them
+  // immediately
   prefsRequestSave(prefsSave, true);
 
-  // Show config page again
-  request->redirect("/config");
+  // Show config page again, unless the command queue was full or a
+  // value was not taken
+  if(queued)
+    request->redirect("/config");
+  else
+    request->send(503, "text/plain", "Some settings were not changed, try again");
 
   // If we are currently in AP mode, and infrastructure mode requested,
   // and there is at least one SSID / PASS pair, request network connection
@@ -446,57 +762,6 @@ static const String webInputField(const String &name, const String &value, bool
   );
 }
 
-static const String webStyleSheet()
-{
-  return
-"BODY"
-"{"
-  "margin: 0;"
-  "padding: 0;"
-"}"
-"H1"
-"{"
-  "text-align: center;"
-"}"
-"TABLE"
-"{"
-  "width: 100%;"
-  "max-width: 768px;"
-  "border: 0px;"
-  "margin-left: auto;"
-  "margin-right: auto;"
-"}"
-"TH, TD"
-"{"
-  "padding: 0.5em;"
-"}"
-"TH.HEADING"
-"{"
-  "background-color: #80A0FF;"
-  "column-span: all;"
-  "text-align: center;"
-"}"
-"TD.LABEL"
-"{"
-  "text-align: right;"
-"}"
-"INPUT[type=text], INPUT[type=password], SELECT"
-"{"
-  "width: 95%;"
-  "padding: 0.5em;"
-"}"
-"INPUT[type=submit]"
-"{"
-  "width: 50%;"
-  "padding: 0.5em 0;"
-"}"
-".CENTER"
-"{"
-  "text-align: center;"
-"}"
-;
-}
-
 static const String webPage(const String &body)
 {
   return
@@ -506,9 +771,9 @@ static const String webPage(const String &body)
   "<META CHARSET='UTF-8'>"
   "<META NAME='viewport' CONTENT='width=device-width, initial-scale=1.0'>"
   "<TITLE>ATS-Mini Config</TITLE>"
-  "<STYLE>" + webStyleSheet() + "</STYLE>"
+  "<LINK REL='stylesheet' HREF='/style.css?v=" + String(webFindAsset("/style.css")->etag) + "'>"
 "</HEAD>"
-"<BODY STYLE='font-family: sans-serif;'>" + body + "</BODY>"
+"<BODY>" + body + "</BODY>"
 "</HTML>"
 ;
 }
@@ -552,87 +817,6 @@ static const String webThemeSelector()
   return(result);
 }
 
-static const String webRadioPage()
-{
-  String ip = "";
-  String ssid = "";
-  String freq = currentMode == FM?
-    String(currentFrequency / 100.0) + "MHz "
-  : String(currentFrequency + currentBFO / 1000.0) + "kHz ";
-
-  if(WiFi.status()==WL_CONNECTED)
-  {
-    ip = WiFi.localIP().toString();
-    ssid = WiFi.SSID();
-  }
-  else
-  {
-    ip = WiFi.softAPIP().toString();
-    ssid = String(apSSID);
-  }
-
-  return webPage(
-"<H1>ATS-Mini Pocket Receiver</H1>"
-"<P ALIGN='CENTER'>"
-  "<A HREF='/memory'>Memory</A>&nbsp;|&nbsp;<A HREF='/config'>Config</A>"
-"</P>"
-"<TABLE COLUMNS=2>"
-"<TR>"
-  "<TD CLASS='LABEL'>IP Address</TD>"
-  "<TD><A HREF='http://" + ip + "'>" + ip + "</A> (" + ssid + ")</TD>"
-"</TR>"
-"<TR>"
-  "<TD CLASS='LABEL'>MAC Address</TD>"
-  "<TD>" + String(getMACAddress()) + "</TD>"
-"</TR>"
-"<TR>"
-  "<TD CLASS='LABEL'>Firmware</TD>"
-  "<TD>" + String(getVersion(true)) + "</TD>"
-"</TR>"
-"<TR>"
-  "<TD CLASS='LABEL'>Band</TD>"
-  "<TD>" + String(getCurrentBand()->bandName) + "</TD>"
-"</TR>"
-"<TR>"
-  "<TD CLASS='LABEL'>Frequency</TD>"
-  "<TD>" + freq + String(bandModeDesc[currentMode]) + "</TD>"
-"</TR>"
-"<TR>"
-  "<TD CLASS='LABEL'>Signal Strength</TD>"
-  "<TD>" + String(rssi) + "dBuV</TD>"
-"</TR>"
-"<TR>"
-  "<TD CLASS='LABEL'>Signal to Noise</TD>"
-  "<TD>" + String(snr) + "dB</TD>"
-"</TR>"
-"<TR>"
-  "<TD CLASS='LABEL'>Battery Voltage</TD>"
-  "<TD>" + String(batteryMonitor()) + "V</TD>"
-"</TR>"
-"</TABLE>"
-"<H2 ALIGN='CENTER'>Remote Control</H2>"
-"<FORM ACTION='/api/control' METHOD='GET'>"
-"<TABLE COLUMNS=2>"
-"<TR>"
-  "<TD CLASS='LABEL'>Frequency " + String(currentMode==FM ? "(MHz)" : "(kHz)") + "</TD>"
-  "<TD><INPUT TYPE='TEXT' NAME='freq' VALUE='" + String(currentMode==FM ? (float)currentFrequency/100.0 : currentFrequency) + "'></TD>"
-"</TR>"
-"<TR>"
-  "<TD CLASS='LABEL'>Volume (0-63)</TD>"
-  "<TD><INPUT TYPE='TEXT' NAME='vol' VALUE='" + String(volume) + "'></TD>"
-"</TR>"
-"<TR>"
-  "<TD CLASS='LABEL'>Band Index</TD>"
-  "<TD><INPUT TYPE='TEXT' NAME='band' VALUE='" + String(bandIdx) + "'></TD>"
-"</TR>"
-"<TR><TH COLSPAN=2 CLASS='HEADING'>"
-    "<INPUT TYPE='SUBMIT' VALUE='Update'>"
-"</TH></TR>"
-"</TABLE>"
-"</FORM>"
-);
-}
-
 static const String webMemoryPage()
 {
   String items = "";
@@ -672,8 +856,18 @@ const String webConfigPage()
   String pass2 = prefs.getString("wifipass2", "");
   String ssid3 = prefs.getString("wifissid3", "");
   String pass3 = prefs.getString("wifipass3", "");
+  String mqttBroker = prefs.getString("mqttbroker", "");
+  String mqttTopic = prefs.getString("mqtttopic", "atsmini");
+  uint16_t mqttInterval = prefs.getUShort("mqttinterval", MQTT_INTERVAL);
   prefs.end();
 
+  // Stored degrees, so that saving the form keeps them as they are
+  char location[16] = "";
+  char locator[7];
+  astroLocator(locationLat, locationLon, locator);
+  if(locator[0])
+    sprintf(location, "%.2f,%.2f", locationLat / 100.0f, locationLon / 100.0f);
+
   return webPage(
 "<H1>ATS-Mini Config</H1>"
 "<P ALIGN='CENTER'>"
@@ -718,6 +912,19 @@ const String webConfigPage()
     "<TD CLASS='LABEL'>Password</TD>"
     "<TD>" + webInputField("password", loginPassword, true) + "</TD>"
   "</TR>"
+  "<TR><TH COLSPAN=2 CLASS='HEADING'>MQTT Telemetry</TH></TR>"
+  "<TR>"
+    "<TD CLASS='LABEL'>Broker (host[:port], empty = off)</TD>"
+    "<TD>" + webInputField("mqttbroker", mqttBroker) + "</TD>"
+  "</TR>"
+  "<TR>"
+    "<TD CLASS='LABEL'>Topic</TD>"
+    "<TD>" + webInputField("mqtttopic", mqttTopic) + "</TD>"
+  "</TR>"
+  "<TR>"
+    "<TD CLASS='LABEL'>Interval (s)</TD>"
+    "<TD>" + webInputField("mqttinterval", String(mqttInterval)) + "</TD>"
+  "</TR>"
   "<TR><TH COLSPAN=2 CLASS='HEADING'>Settings</TH></TR>"
   "<TR>"
     "<TD CLASS='LABEL'>Time Zone</TD>"
@@ -741,10 +948,34 @@ const String webConfigPage()
     "<TD><INPUT TYPE='CHECKBOX' NAME='zoom' VALUE='on'" +
     (zoomMenu? " CHECKED ":"") + "></TD>"
   "</TR>"
+  "<TR>"
+    "<TD CLASS='LABEL'>Location (locator or lat,lon)</TD>"
+    "<TD>" + webInputField("location", location) + " " + locator + "</TD>"
+  "</TR>"
+  "<TR>"
+    "<TD CLASS='LABEL'>Solar/DX Refresh (min, 0 = on connect)</TD>"
+    "<TD>" + webInputField("proprefresh", String(propRefresh)) + "</TD>"
+  "</TR>"
   "<TR><TH COLSPAN=2 CLASS='HEADING'>"
     "<INPUT TYPE='SUBMIT' VALUE='Save'>"
   "</TH></TR>"
   "</TABLE>"
 "</FORM>"
+"<FORM ACTION='/update' METHOD='POST' ENCTYPE='multipart/form-data'>"
+  "<TABLE COLUMNS=2>"
+  "<TR><TH COLSPAN=2 CLASS='HEADING'>Firmware Update (" + String(getVersion(true)) + ")</TH></TR>"
+  "<TR>"
+    "<TD CLASS='LABEL'>SHA-256</TD>"
+    "<TD>" + webInputField("sha256", "") + "</TD>"
+  "</TR>"
+  "<TR>"
+    "<TD CLASS='LABEL'>Firmware File</TD>"
+    "<TD><INPUT TYPE='FILE' NAME='firmware' ACCEPT='.bin'></TD>"
+  "</TR>"
+  "<TR><TH COLSPAN=2 CLASS='HEADING'>"
+    "<INPUT TYPE='SUBMIT' VALUE='Update'>"
+  "</TH></TR>"
+  "</TABLE>"
+"</FORM>"
 );
 }
@@ -0,0 +1,247 @@
+#include "Common.h"
+#include "Storage.h"
+#include "Ota.h"
+#include <ESPAsyncWebServer.h>
+#include <Update.h>
+#include <esp_ota_ops.h>
+#include <mbedtls/sha256.h>
+
+extern String loginUsername;
+extern String loginPassword;
+
+// Upload in progress (NULL - none)
+static const OtaWriter *otaWriter = NULL;
+static mbedtls_sha256_context otaHash;
+static size_t otaSize = 0;
+static const char *otaError = NULL;
+
+// Web requests doing the upload and the last one that failed, and
+// the reboot after it
+static AsyncWebServerRequest *otaRequest = NULL;
+static AsyncWebServerRequest *otaFailed = NULL;
+static volatile bool otaReboot = false;
+static uint32_t otaRebootTime = 0;
+
+//
+// Start writing a new image
+//
+bool otaBegin(const OtaWriter *writer)
+{
+  if(otaWriter)
+  {
+    otaError = "Another update is in progress";
+    return(false);
+  }
+
+  if(!writer->begin())
+  {
+    otaError = "Cannot start the update";
+    return(false);
+  }
+
+  mbedtls_sha256_init(&otaHash);
+  mbedtls_sha256_starts(&otaHash, 0);
+  otaWriter = writer;
+  otaSize = 0;
+  otaError = NULL;
+  return(true);
+}
+
+//
+// Write the next piece of the image, the update is aborted on errors
+//
+bool otaWrite(const uint8_t *data, size_t size)
+{
+  if(!otaWriter) return(false);
+
+  if(!otaSize && size && data[0] != OTA_IMAGE_MAGIC)
+    otaError = "Not a firmware image";
+  else if(!otaWriter->write(data, size))
+    otaError = "Write failed, image too large?";
+  else
+  {
+    mbedtls_sha256_update(&otaHash, data, size);
+    otaSize += size;
+    return(true);
+  }
+
+  otaAbort();
+  return(false);
+}
+
+//
+// Check the image against its SHA-256 (hex) and make it bootable
+//
+bool otaEnd(const char *sha256)
+{
+  uint8_t hash[32];
+  bool match = strlen(sha256) == 2 * sizeof(hash);
+
+  if(!otaWriter) return(false);
+
+  mbedtls_sha256_finish(&otaHash, hash);
+
+  for(unsigned int i=0 ; match && i<sizeof(hash) ; i++)
+  {
+    char hex[3];
+    sprintf(hex, "%02x", hash[i]);
+    match = tolower(sha256[2 * i]) == hex[0] && tolower(sha256[2 * i + 1]) == hex[1];
+  }
+
+  if(!otaSize)
+    otaError = "Empty image";
+  else if(!match)
+    otaError = "SHA-256 does not match the image";
+  else if(!otaWriter->end())
+    otaError = "Invalid firmware image";
+  else
+  {
+    mbedtls_sha256_free(&otaHash);
+    otaWriter = NULL;
+    return(true);
+  }
+
+  otaAbort();
+  return(false);
+}
+
+//
+// Drop the image written so far, the current one stays bootable
+//
+void otaAbort()
+{
+  if(!otaWriter) return;
+
+  otaWriter->abort();
+  mbedtls_sha256_free(&otaHash);
+  otaWriter = NULL;
+}
+
+const char *otaGetError()
+{
+  return(otaError ? otaError : "");
+}
+
+//
+// Write into the inactive OTA partition with the Update library
+//
+static const OtaWriter otaFlash =
+{
+  []() { return(Update.begin(UPDATE_SIZE_UNKNOWN, U_FLASH)); },
+  [](const uint8_t *data, size_t size) { return(Update.write((uint8_t *)data, size) == size); },
+  []() { return(Update.end(true)); },
+  []() { Update.abort(); },
+};
+
+// Partition written by the uploads
+static const OtaWriter *otaTarget = &otaFlash;
+
+//
+// Updates need the web login, and it has to be set
+//
+static bool otaAllowed(AsyncWebServerRequest *request)
+{
+  return(
+    loginUsername != "" && loginPassword != "" &&
+    request->authenticate(loginUsername.c_str(), loginPassword.c_str())
+  );
+}
+
+//
+// Web server task: write the uploaded image as it arrives
+//
+static void otaOnUpload(AsyncWebServerRequest *request, const String &filename, size_t index, uint8_t *data, size_t len, bool final)
+{
+  if(!index)
+  {
+    if(!otaAllowed(request)) return;
+    if(!otaBegin(otaTarget)) { otaFailed = request; return; }
+
+    // Drop the image if the client goes away
+    otaRequest = request;
+    request->onDisconnect([request]() {
+      if(otaRequest == request) { otaAbort(); otaRequest = NULL; }
+    });
+  }
+
+  if(otaRequest == request && len && !otaWrite(data, len))
+  {
+    otaFailed = request;
+    otaRequest = NULL;
+  }
+}
+
+//
+// Web server task: the whole request is received, check the image
+//
+static void otaOnRequest(AsyncWebServerRequest *request)
+{
+  if(loginUsername == "" || loginPassword == "")
+    return request->send(403, "text/plain", "Set the web login and password first\r\n");
+  if(!otaAllowed(request))
+    return request->requestAuthentication();
+  if(otaRequest != request)
+    return request->send(400, "text/plain", otaFailed == request ? String(otaGetError()) + "\r\n" : "No firmware image\r\n");
+
+  otaRequest = NULL;
+
+  String sha256 =
+    request->hasParam("sha256", true) ? request->getParam("sha256", true)->value()
+  : request->hasParam("sha256") ? request->getParam("sha256")->value()
+  : "";
+
+  if(!otaEnd(sha256.c_str()))
+    return request->send(400, "text/plain", String(otaGetError()) + "\r\n");
+
+  // Reboot once the reply is sent
+  request->send(200, "text/plain", "Firmware updated, rebooting\r\n");
+  otaRebootTime = millis();
+  otaReboot = true;
+}
+
+//
+// Register the update handler with the web server, uploads go to the
+// given writer or to the inactive OTA partition (NULL)
+//
+void otaInit(AsyncWebServer *server, const OtaWriter *writer)
+{
+  otaTarget = writer ? writer : &otaFlash;
+  server->on("/update", HTTP_POST, otaOnRequest, otaOnUpload);
+}
+
+//
+// Reboot into a new image, keep a new image once it runs
+//
+void otaTickTime()
+{
+  static bool confirmed = false;
+
+  if(otaReboot && millis() - otaRebootTime >= OTA_REBOOT_TIME)
+  {
+    // Write pending preferences first
+    prefsRequestSave(0, true);
+    prefsTickTime();
+    ESP.restart();
+  }
+
+  // If the new image resets before this, the bootloader boots the
+  // previous one instead
+  if(!confirmed && millis() >= OTA_CONFIRM_TIME)
+  {
+    esp_ota_img_states_t state;
+
+    if(esp_ota_get_state_partition(esp_ota_get_running_partition(), &state) == ESP_OK && state == ESP_OTA_IMG_PENDING_VERIFY)
+      esp_ota_mark_app_valid_cancel_rollback();
+
+    confirmed = true;
+  }
+}
+
+//
+// Called by the Arduino core at startup: do not keep a new image right
+// away, otaTickTime() does it once the image has been running for a while
+//
+extern "C" bool verifyRollbackLater()
+{
+  return(true);
+}
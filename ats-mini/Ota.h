@@ -0,0 +1,42 @@
+#ifndef OTA_H
+#define OTA_H
+
+#include <Arduino.h>
+
+//
+// Firmware update over Wi-Fi. The image is uploaded to /update as a
+// form file, together with its SHA-256 ("sha256" form field or query
+// parameter). It is written chunk by chunk into the inactive OTA
+// partition while the hash is computed, and only made bootable if the
+// hash matches. The receiver then reboots into the new image, which has
+// to keep running for OTA_CONFIRM_TIME, otherwise the bootloader falls
+// back to the previous image on the next reset.
+//
+
+#define OTA_CONFIRM_TIME  30000  // Running time before a new image is kept (ms)
+#define OTA_REBOOT_TIME    1000  // Delay before rebooting into a new image (ms)
+#define OTA_IMAGE_MAGIC    0xE9  // First byte of an ESP32 application image
+
+//
+// Writes the image into a partition (replaceable for testing)
+//
+typedef struct
+{
+  bool (*begin)();
+  bool (*write)(const uint8_t *data, size_t size);
+  bool (*end)();    // Check the image and make it bootable
+  void (*abort)();
+} OtaWriter;
+
+class AsyncWebServer;
+
+bool otaBegin(const OtaWriter *writer);
+bool otaWrite(const uint8_t *data, size_t size);
+bool otaEnd(const char *sha256);
+void otaAbort();
+const char *otaGetError();
+
+void otaInit(AsyncWebServer *server, const OtaWriter *writer = NULL);
+void otaTickTime();
+
+#endif // OTA_H
@@ -0,0 +1,241 @@
+#include "Common.h"
+#include "Themes.h"
+
+#ifdef PALETTE_SPRITE
+
+#include <stddef.h>
+#include "Palette.h"
+
+// RGB332 value TFT_eSprite stores for a given RGB565 color
+static inline uint8_t rgb332(uint16_t c)
+{
+  return(((c & 0xE000) >> 8) | ((c & 0x0700) >> 6) | ((c & 0x0018) >> 3));
+}
+
+// RGB565 color that TFT_eSprite converts to exactly the given byte
+static inline uint16_t indexTo565(uint8_t b)
+{
+  return(((b & 0xE0) << 8) | ((b & 0x1C) << 6) | ((b & 0x03) << 3));
+}
+
+// Stock RGB332 to RGB565 expansion, used for unassigned slots
+static inline uint16_t expand332(uint8_t b)
+{
+  return(
+    ((b & 0xE0) << 8) | ((b & 0xC0) << 5) |
+    ((b & 0x1C) << 6) | ((b & 0x1C) << 3) |
+    ((b & 0x03) << 3) | ((b & 0x03) << 1) | ((b & 0x03) >> 1)
+  );
+}
+
+static inline uint16_t hashOf(uint16_t c)
+{
+  return(((c * 0x9E37u) >> 7) & (PALETTE_HASH - 1));
+}
+
+PaletteSprite::PaletteSprite(TFT_eSPI *tft) : TFT_eSprite(tft)
+{
+  resetPalette();
+}
+
+//
+// Start a new palette and seed it with all colors of the current theme
+//
+void PaletteSprite::resetPalette()
+{
+  for(int i = 0 ; i < PALETTE_SIZE ; i++)
+  {
+    palette[i] = expand332(i);
+    swapped[i] = (palette[i] >> 8) | (palette[i] << 8);
+    taken[i]   = false;
+  }
+
+  memset(hashUsed, 0, sizeof(hashUsed));
+  used        = 0;
+  hashCount   = 0;
+  nextFree    = 0;
+  lastColor   = 0;
+  lastEncoded = indexTo565(addColor(0));
+
+  // ColorTheme is packed: a name pointer followed by RGB565 colors
+  const uint8_t *p = (const uint8_t *)&TH + offsetof(ColorTheme, bg);
+  for(size_t j = offsetof(ColorTheme, bg) ; j < sizeof(ColorTheme) ; j += sizeof(uint16_t), p += sizeof(uint16_t))
+  {
+    uint16_t c;
+    memcpy(&c, p, sizeof(c));
+    addColor(c);
+  }
+}
+
+//
+// Return palette index for a color, adding it to the palette if needed
+//
+uint8_t PaletteSprite::addColor(uint16_t color)
+{
+  uint16_t h = hashOf(color);
+
+  // Look the color up
+  for(uint16_t n = 0 ; n < PALETTE_HASH && hashUsed[h] ; n++, h = (h + 1) & (PALETTE_HASH - 1))
+    if(hashKey[h] == color) return(hashIdx[h]);
+
+  uint8_t idx;
+
+  if(used >= PALETTE_SIZE)
+  {
+    // Palette full, use the closest color
+    idx = findNearest(color);
+  }
+  else
+  {
+    // Prefer the slot stock RGB332 would use, so that any drawing
+    // that bypasses the palette still looks right
+    idx = rgb332(color);
+    if(taken[idx])
+    {
+      while(taken[nextFree]) nextFree++;
+      idx = nextFree;
+    }
+
+    taken[idx]   = true;
+    palette[idx] = color;
+    swapped[idx] = (color >> 8) | (color << 8);
+    used++;
+  }
+
+  // Remember the mapping, leaving some slack in the hash table
+  if(hashCount < PALETTE_HASH * 3 / 4)
+  {
+    hashUsed[h] = true;
+    hashKey[h]  = color;
+    hashIdx[h]  = idx;
+    hashCount++;
+  }
+
+  return(idx);
+}
+
+//
+// Find the palette color closest to the given one
+//
+uint8_t PaletteSprite::findNearest(uint16_t color)
+{
+  int r = color >> 11, g = (color >> 5) & 0x3F, b = color & 0x1F;
+  uint32_t best = UINT32_MAX;
+  uint8_t idx = 0;
+
+  for(int i = 0 ; i < PALETTE_SIZE ; i++)
+  {
+    int dr = r - (palette[i] >> 11);
+    int dg = g - ((palette[i] >> 5) & 0x3F);
+    int db = b - (palette[i] & 0x1F);
+    uint32_t d = 4 * dr * dr + dg * dg + 4 * db * db;
+    if(d < best) { best = d; idx = i; if(!d) break; }
+  }
+
+  return(idx);
+}
+
+//
+// Convert a color to the value TFT_eSprite turns into its palette index
+//
+inline uint32_t PaletteSprite::encode(uint32_t color)
+{
+  uint16_t c = color;
+
+  if(c != lastColor)
+  {
+    lastColor   = c;
+    lastEncoded = indexTo565(addColor(c));
+  }
+
+  return(lastEncoded);
+}
+
+void PaletteSprite::fillSprite(uint32_t color)
+{
+  resetPalette();
+  TFT_eSprite::fillSprite(encode(color));
+}
+
+void PaletteSprite::drawPixel(int32_t x, int32_t y, uint32_t color)
+{
+  TFT_eSprite::drawPixel(x, y, encode(color));
+}
+
+void PaletteSprite::drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color)
+{
+  TFT_eSprite::drawFastVLine(x, y, h, encode(color));
+}
+
+void PaletteSprite::drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color)
+{
+  TFT_eSprite::drawFastHLine(x, y, w, encode(color));
+}
+
+void PaletteSprite::fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color)
+{
+  TFT_eSprite::fillRect(x, y, w, h, encode(color));
+}
+
+//
+// Return the true RGB565 color, so that anti-aliasing blends correctly
+//
+uint16_t PaletteSprite::readPixel(int32_t x, int32_t y)
+{
+  if(!_created || x < 0 || y < 0 || x >= _iwidth || y >= _iheight)
+    return(0xFFFF);
+
+  return(palette[_img8[x + y * _iwidth]]);
+}
+
+//
+// Expand palette indices to RGB565 a few lines at a time and push
+// them to the display
+//
+void PaletteSprite::pushSprite(int32_t x, int32_t y)
+{
+  pushSprite(x, y, 0, 0, _iwidth, _iheight);
+}
+
+//
+// Same for a part of the sprite, pushed to (tx, ty)
+//
+bool PaletteSprite::pushSprite(int32_t tx, int32_t ty, int32_t sx, int32_t sy, int32_t sw, int32_t sh)
+{
+  static uint16_t buf[320 * PALETTE_LINES];
+
+  if(!_created) return(false);
+
+  // Clip to the sprite
+  if(sx < 0) { tx -= sx; sw += sx; sx = 0; }
+  if(sy < 0) { ty -= sy; sh += sy; sy = 0; }
+  if(sx + sw > _iwidth)  sw = _iwidth - sx;
+  if(sy + sh > _iheight) sh = _iheight - sy;
+  if(sw <= 0 || sh <= 0 || sw > (int32_t)ITEM_COUNT(buf)) return(false);
+
+  int32_t lines = ITEM_COUNT(buf) / sw;
+  bool oldSwapBytes = _tft->getSwapBytes();
+
+  _tft->setSwapBytes(false);
+  _tft->startWrite();
+
+  for(int32_t row = 0 ; row < sh ; row += lines)
+  {
+    int32_t n = min(lines, sh - row);
+    uint16_t *dst = buf;
+
+    for(int32_t j = 0 ; j < n ; j++)
+    {
+      const uint8_t *src = _img8 + (sy + row + j) * _iwidth + sx;
+      for(int32_t i = 0 ; i < sw ; i++) *dst++ = swapped[src[i]];
+    }
+
+    _tft->pushImage(tx, ty + row, sw, n, buf);
+  }
+
+  _tft->endWrite();
+  _tft->setSwapBytes(oldSwapBytes);
+  return(true);
+}
+
+#endif // PALETTE_SPRITE
@@ -0,0 +1,56 @@
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include <TFT_eSPI.h>
+
+#define PALETTE_SIZE   256  // Colors in the palette (8-bit index)
+#define PALETTE_HASH   512  // Color -> index lookup slots (power of two)
+#define PALETTE_LINES   10  // Lines expanded to RGB565 per push
+
+//
+// 8-bit sprite whose pixels are indices into a palette built from
+// the active color theme. Colors that are not in the theme (such as
+// anti-aliasing blends) are added on the fly until the palette is
+// full, after which the nearest palette color is used. The palette
+// is rebuilt by fillSprite(), so switching themes swaps the palette.
+//
+class PaletteSprite : public TFT_eSprite
+{
+  public:
+    explicit PaletteSprite(TFT_eSPI *tft);
+
+    using TFT_eSprite::drawPixel;
+    using TFT_eSprite::pushSprite;
+
+    void fillSprite(uint32_t color);
+    void pushSprite(int32_t x, int32_t y);
+    bool pushSprite(int32_t tx, int32_t ty, int32_t sx, int32_t sy, int32_t sw, int32_t sh);
+
+    void drawPixel(int32_t x, int32_t y, uint32_t color) override;
+    void drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color) override;
+    void drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color) override;
+    void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) override;
+    uint16_t readPixel(int32_t x, int32_t y) override;
+
+    uint16_t paletteUsed() { return(used); }
+
+  private:
+    uint16_t palette[PALETTE_SIZE];   // RGB565 colors
+    uint16_t swapped[PALETTE_SIZE];   // Same, byte-swapped for pushing
+    bool     taken[PALETTE_SIZE];     // Slot holds a real color
+    uint16_t hashKey[PALETTE_HASH];
+    uint8_t  hashIdx[PALETTE_HASH];
+    bool     hashUsed[PALETTE_HASH];
+    uint16_t used;
+    uint16_t hashCount;
+    uint16_t lastColor;
+    uint32_t lastEncoded;
+    uint8_t  nextFree;
+
+    void resetPalette();
+    uint8_t addColor(uint16_t color);
+    uint8_t findNearest(uint16_t color);
+    uint32_t encode(uint32_t color);
+};
+
+#endif // PALETTE_H
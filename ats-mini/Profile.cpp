@@ -0,0 +1,144 @@
+#include "Common.h"
+#include "Profile.h"
+
+#ifdef RENDER_STATS
+
+static const char *screenNames[PROF_UI_COUNT] =
+{ "Default", "S-Meter", "S-History", "About", "Propag.", "Utility" };
+
+static const char *stageNames[PROF_STAGE_COUNT] =
+{ "clear", "widgets", "sidebar", "graphs", "push", "frame" };
+
+static ProfileStat stats[PROF_UI_COUNT][PROF_STAGE_COUNT];
+
+// Current frame
+static uint32_t frameCycles[PROF_STAGE_COUNT];
+static uint32_t frameStart;
+static uint32_t lapStart;
+static uint8_t  frameStages;
+static uint8_t  frameScreen;
+static bool     inFrame = false;
+
+//
+// Histogram bucket for given time: bucket N holds times below 2^N us,
+// the last bucket holds everything longer
+//
+uint8_t profileBucket(uint32_t us)
+{
+  uint8_t b = 0;
+  while(b < PROF_BUCKETS - 1 && us >= (1UL << b)) b++;
+  return(b);
+}
+
+//
+// Add time sample to the statistics, rolling the min/avg/max window
+//
+void profileStatAdd(ProfileStat *stat, uint32_t us)
+{
+  if(!stat->count || us < stat->min) stat->min = us;
+  if(!stat->count || us > stat->max) stat->max = us;
+  stat->sum += us;
+  stat->hist[profileBucket(us)]++;
+
+  if(++stat->count >= PROF_WINDOW)
+  {
+    stat->lastMin   = stat->min;
+    stat->lastMax   = stat->max;
+    stat->lastAvg   = stat->sum / stat->count;
+    stat->lastValid = true;
+    stat->count     = 0;
+    stat->sum       = 0;
+  }
+}
+
+//
+// Get min/avg/max for the last complete window, or for the current
+// one if no window has been completed yet
+//
+bool profileStatGet(const ProfileStat *stat, uint32_t *min, uint32_t *avg, uint32_t *max)
+{
+  if(stat->lastValid)
+  {
+    *min = stat->lastMin;
+    *avg = stat->lastAvg;
+    *max = stat->lastMax;
+  }
+  else if(stat->count)
+  {
+    *min = stat->min;
+    *avg = stat->sum / stat->count;
+    *max = stat->max;
+  }
+  else return(false);
+
+  return(true);
+}
+
+void profileBegin(uint8_t screen)
+{
+  // Ignore nested frames (i.e. drawScreen() called while drawing)
+  if(inFrame || screen >= PROF_UI_COUNT) return;
+
+  memset(frameCycles, 0, sizeof(frameCycles));
+  frameStages = 0;
+  frameScreen = screen;
+  frameStart  = lapStart = ESP.getCycleCount();
+  inFrame     = true;
+}
+
+//
+// Attribute time since the previous lap to the given stage. A stage
+// can be timed several times per frame, the times are added up.
+//
+void profileLap(uint8_t stage)
+{
+  if(!inFrame || stage >= PROF_FRAME) return;
+
+  uint32_t now = ESP.getCycleCount();
+  frameCycles[stage] += now - lapStart;
+  frameStages |= 1 << stage;
+  lapStart = now;
+}
+
+void profileEnd()
+{
+  if(!inFrame) return;
+
+  uint32_t mhz = ESP.getCpuFreqMHz();
+  ProfileStat *s = stats[frameScreen];
+
+  frameCycles[PROF_FRAME] = ESP.getCycleCount() - frameStart;
+  frameStages |= 1 << PROF_FRAME;
+
+  for(int i = 0 ; i < PROF_STAGE_COUNT ; i++)
+    if(frameStages & (1 << i)) profileStatAdd(&s[i], frameCycles[i] / mhz);
+
+  inFrame = false;
+}
+
+//
+// Print rendering statistics as CSV
+//
+void profilePrint(Print *out)
+{
+  uint32_t min, avg, max;
+
+  out->print("screen,stage,min_us,avg_us,max_us");
+  for(int b = 0 ; b < PROF_BUCKETS ; b++)
+    out->printf(b < PROF_BUCKETS - 1 ? ",lt%lu" : ",ge%lu", b < PROF_BUCKETS - 1 ? 1UL << b : 1UL << (b - 1));
+  out->print("\r\n");
+
+  for(int i = 0 ; i < PROF_UI_COUNT ; i++)
+    for(int j = 0 ; j < PROF_STAGE_COUNT ; j++)
+    {
+      if(!profileStatGet(&stats[i][j], &min, &avg, &max)) continue;
+
+      out->printf("%s,%s,%lu,%lu,%lu", screenNames[i], stageNames[j],
+        (unsigned long)min, (unsigned long)avg, (unsigned long)max);
+      for(int b = 0 ; b < PROF_BUCKETS ; b++)
+        out->printf(",%lu", (unsigned long)stats[i][j].hist[b]);
+      out->print("\r\n");
+    }
+}
+
+#endif // RENDER_STATS
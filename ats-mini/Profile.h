@@ -0,0 +1,63 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <Arduino.h>
+
+// Screens being profiled
+#define PROF_UI_DEFAULT    0
+#define PROF_UI_SMETER     1
+#define PROF_UI_WATERFALL  2
+#define PROF_UI_ABOUT      3
+#define PROF_UI_PROPAG     4
+#define PROF_UI_UTILITY    5
+#define PROF_UI_COUNT      6
+
+// Rendering stages
+#define PROF_CLEAR         0 // Clearing the sprite
+#define PROF_WIDGETS       1 // Frequency, band, icons, meters
+#define PROF_SIDEBAR       2 // Left side menu / info bar
+#define PROF_GRAPHS        3 // Scale, graphs, status text
+#define PROF_PUSH          4 // Pushing the sprite to the display
+#define PROF_FRAME         5 // Whole frame
+#define PROF_STAGE_COUNT   6
+
+#define PROF_WINDOW       64 // Frames per rolling min/avg/max window
+#define PROF_BUCKETS      16 // Histogram buckets, bucket N holds times < 2^N us
+
+struct ProfileStat
+{
+  uint32_t count;       // Samples in the current window
+  uint32_t min;         // Current window, microseconds
+  uint32_t max;
+  uint32_t sum;
+  uint32_t lastMin;     // Last complete window, microseconds
+  uint32_t lastMax;
+  uint32_t lastAvg;
+  bool     lastValid;   // TRUE: last window is available
+  uint32_t hist[PROF_BUCKETS]; // Times since boot
+};
+
+#ifdef RENDER_STATS
+
+void profileStatAdd(ProfileStat *stat, uint32_t us);
+bool profileStatGet(const ProfileStat *stat, uint32_t *min, uint32_t *avg, uint32_t *max);
+uint8_t profileBucket(uint32_t us);
+
+void profileBegin(uint8_t screen);
+void profileLap(uint8_t stage);
+void profileEnd();
+void profilePrint(Print *out);
+
+#define PROFILE_BEGIN(screen) profileBegin(screen)
+#define PROFILE_LAP(stage)    profileLap(stage)
+#define PROFILE_END()         profileEnd()
+
+#else
+
+#define PROFILE_BEGIN(screen) do {} while(0)
+#define PROFILE_LAP(stage)    do {} while(0)
+#define PROFILE_END()         do {} while(0)
+
+#endif // RENDER_STATS
+
+#endif // PROFILE_H
@@ -0,0 +1,177 @@
+#include "Common.h"
+#include "Propagation.h"
+
+const char *propBands[PROP_BANDS] = { "10m", "20m", "40m", "80m" };
+
+// Parser states
+enum {
+    PARSE_VALUE,    // Expecting a value
+    PARSE_KEY,      // Expecting a key or the end of an object
+    PARSE_COLON,    // Expecting ':' after a key
+    PARSE_NEXT,     // Expecting ',' or the end of an object or array
+    PARSE_STRING,   // Inside a string
+    PARSE_ESCAPE,   // After '\' inside a string
+    PARSE_LITERAL,  // Inside a number, true, false or null
+    PARSE_DONE,     // After the top level value
+    PARSE_ERROR
+};
+
+void PropParser::reset() {
+    state = PARSE_VALUE;
+    depth = 0;
+    arrays = 0;
+    first = false;
+    len = 0;
+    isKey = false;
+    key[0] = 0;
+    band = -1;
+    haveSfi = false;
+    haveKp = false;
+    data = { false, 0, 0, { "--", "--", "--", "--" } };
+}
+
+bool PropParser::open(bool array) {
+    if (depth >= 32) return false;
+    arrays = array ? arrays | (1UL << depth) : arrays & ~(1UL << depth);
+    depth++;
+    first = true;
+    state = array ? PARSE_VALUE : PARSE_KEY;
+    key[0] = 0;
+    return true;
+}
+
+bool PropParser::close(bool array) {
+    if (!depth || !(arrays & (1UL << (depth - 1))) != !array) return false;
+    depth--;
+    state = depth ? PARSE_NEXT : PARSE_DONE;
+    key[0] = 0;
+    return true;
+}
+
+// A string or literal value (in text) for the current key
+void PropParser::value(bool string) {
+    char *end;
+
+    if (string) {
+        for (int i = 0; i < PROP_BANDS; i++)
+            if (!strcmp(text, propBands[i])) band = i;
+
+        // First rating after the band name
+        if (!strcmp(key, "rating") && band >= 0) {
+            strncpy(data.rating[band], text, sizeof(data.rating[band]) - 1);
+            data.rating[band][sizeof(data.rating[band]) - 1] = 0;
+            band = -1;
+            return;
+        }
+    }
+
+    // Numbers, possibly quoted
+    float v = strtof(text, &end);
+    if (end == text || *end) return;
+
+    if (!haveSfi && !strcmp(key, "sfi")) { data.sfi = v; haveSfi = true; }
+    if (!haveKp && !strcmp(key, "kp")) { data.kp = v; haveKp = true; }
+}
+
+bool PropParser::put(char c) {
+    bool space = c == ' ' || c == '\t' || c == '\r' || c == '\n';
+
+    switch (state) {
+    case PARSE_STRING:
+        if ((uint8_t)c < ' ') return false;
+        if (c == '\\') { state = PARSE_ESCAPE; return true; }
+        if (c != '"') {
+            // Long strings are cut, none of the ones we need is long
+            if (len < sizeof(text) - 1) text[len++] = c;
+            return true;
+        }
+        text[len] = 0;
+        if (isKey) {
+            strcpy(key, len < sizeof(key) ? text : "");
+            for (int i = 0; i < PROP_BANDS; i++)
+                if (!strcmp(key, propBands[i])) band = i;
+            state = PARSE_COLON;
+        } else {
+            value(true);
+            key[0] = 0;
+            state = depth ? PARSE_NEXT : PARSE_DONE;
+        }
+        return true;
+
+    case PARSE_ESCAPE:
+        if (len < sizeof(text) - 1) text[len++] = c;
+        state = PARSE_STRING;
+        return true;
+
+    case PARSE_LITERAL:
+        if (isalnum(c) || c == '+' || c == '-' || c == '.') {
+            if (len >= sizeof(text) - 1) return false;
+            text[len++] = c;
+            return true;
+        }
+        text[len] = 0;
+        if (isalpha(text[0]) && strcmp(text, "true") && strcmp(text, "false") && strcmp(text, "null"))
+            return false;
+        value(false);
+        key[0] = 0;
+        state = depth ? PARSE_NEXT : PARSE_DONE;
+        // This character ends the literal and goes on as usual
+        return put(c);
+
+    default:
+        break;
+    }
+
+    if (space) return true;
+
+    // Only empty objects and arrays end right after the start
+    bool empty = first;
+    first = false;
+
+    switch (state) {
+    case PARSE_VALUE:
+        if (c == '{') return open(false);
+        if (c == '[') return open(true);
+        if (c == ']' && empty) return close(true);
+        if (c == '"') { state = PARSE_STRING; isKey = false; len = 0; return true; }
+        if (c == '-' || isalnum(c)) { state = PARSE_LITERAL; len = 0; return put(c); }
+        return false;
+
+    case PARSE_KEY:
+        if (c == '}' && empty) return close(false);
+        if (c == '"') { state = PARSE_STRING; isKey = true; len = 0; return true; }
+        return false;
+
+    case PARSE_COLON:
+        if (c != ':') return false;
+        state = PARSE_VALUE;
+        return true;
+
+    case PARSE_NEXT:
+        if (c == '}') return close(false);
+        if (c == ']') return close(true);
+        if (c != ',') return false;
+        state = arrays & (1UL << (depth - 1)) ? PARSE_VALUE : PARSE_KEY;
+        return true;
+
+    default:
+        // Nothing allowed after the top level value
+        return false;
+    }
+}
+
+bool PropParser::feed(const char *data, size_t size) {
+    for (size_t i = 0; i < size && state != PARSE_ERROR; i++)
+        if (!put(data[i])) state = PARSE_ERROR;
+
+    return state != PARSE_ERROR;
+}
+
+bool PropParser::finish(PropData *result) {
+    // A top level number is only complete at the end
+    if (state == PARSE_LITERAL && !depth && !put(' ')) state = PARSE_ERROR;
+
+    data.valid = state == PARSE_DONE && (haveSfi || haveKp);
+    *result = data;
+    return data.valid;
+}
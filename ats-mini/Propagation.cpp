@@ -3,115 +3,255 @@
 #include "Draw.h"
 #include "Themes.h"
 #include "Menu.h"
+#include "Propagation.h"
+#include "Astro.h"
 #include <WiFi.h>
 #include <HTTPClient.h>
 #include <WiFiClientSecure.h>
+#include <LittleFS.h>
+
+#define PROP_TASK_STACK   10240
+#define PROP_CACHE_MAGIC  0x50524F31   // "PRO1"
+
+// Data refresh period (minutes, 0 - only when connecting)
+uint8_t propRefresh = 60;
+
+// Receiver location (hundredths of a degree)
+int16_t locationLat = ASTRO_NO_LOCATION;
+int16_t locationLon = ASTRO_NO_LOCATION;
 
 // Data Cache
-struct PropData {
-    bool valid;
-    float sfi;
-    float kp;
-    char rating10m[16];
-    char rating20m[16];
-    char rating40m[16];
-    char rating80m[16];
-};
+static PropData propData = { false, 0, 0, { "--", "--", "--", "--" } };
+static bool propLive = false;      // Fetched since boot, not from the file
+static bool propLoaded = false;    // File has been read
 
-static PropData propData = { false, 0, 0, "--", "--", "--", "--" };
+// Fetched by a background task, taken over by the main loop
+static PropData propFetched;
+static volatile bool propFetchBusy = false;
+static volatile bool propFetchDone = false;
+static volatile bool propFetchFailed = false;
+static bool propFetchOnce = false;
+static uint32_t propFetchTime = 0;
+
+// Read the payload as it arrives, without keeping it
+static bool propagationRead(HTTPClient &https, PropParser &parser) {
+    WiFiClient *stream = https.getStreamPtr();
+    int size = https.getSize(); // -1 if unknown
+    uint32_t lastData = millis();
+    char buf[128];
+
+    for (int total = 0; size < 0 || total < size; ) {
+        int n = stream->available();
+        if (n > 0) {
+            n = stream->read((uint8_t *)buf, min(n, (int)sizeof(buf)));
+            if (n > 0) {
+                if (!parser.feed(buf, n)) return false;
+                total += n;
+                lastData = millis();
+                continue;
+            }
+        }
+
+        // Without a size, the data ends with the connection
+        if (!stream->connected()) return size < 0;
+        if (millis() - lastData >= PROP_READ_TIME) return false;
+        delay(10);
+    }
 
-// Helper to parse JSON value manually (lightweight)
-// Returns true if found
-bool extractJsonString(String& json, const char* key, char* buffer, int bufLen) {
-    int keyPos = json.indexOf(key);
-    if (keyPos == -1) return false;
-    
-    // Find colon
-    int colonPos = json.indexOf(':', keyPos);
-    if (colonPos == -1) return false;
-    
-    // Find start quote
-    int quoteStart = json.indexOf('"', colonPos);
-    if (quoteStart == -1) return false;
-    
-    // Find end quote
-    int quoteEnd = json.indexOf('"', quoteStart + 1);
-    if (quoteEnd == -1) return false;
-    
-    String val = json.substring(quoteStart + 1, quoteEnd);
-    strncpy(buffer, val.c_str(), bufLen);
-    buffer[bufLen-1] = 0; // Ensure null term
     return true;
 }
 
-// Helper for float values (e.g. "sfi": 155.0)
-float extractJsonFloat(String& json, const char* key) {
-    int keyPos = json.indexOf(key);
-    if (keyPos == -1) return 0.0;
-    
-    int colonPos = json.indexOf(':', keyPos);
-    if (colonPos == -1) return 0.0;
-    
-    // Find start of number (skip spaces)
-    int valStart = colonPos + 1;
-    while (valStart < json.length() && (json[valStart] == ' ' || json[valStart] == '\t')) valStart++;
-    
-    // Find end of number (comma, brace, or space)
-    int valEnd = valStart;
-    while (valEnd < json.length() && (isdigit(json[valEnd]) || json[valEnd] == '.' || json[valEnd] == '-')) valEnd++;
-    
-    String val = json.substring(valStart, valEnd);
-    return val.toFloat();
+// Keep the last good data for the next boot
+static void propagationSave(const PropData &data) {
+    uint32_t magic = PROP_CACHE_MAGIC;
+    fs::File file = LittleFS.open(PROP_CACHE_PATH, "wb");
+
+    if (file) {
+        file.write((uint8_t *)&magic, sizeof(magic));
+        file.write((uint8_t *)&data, sizeof(data));
+        file.close();
+    }
 }
 
-// Called explicitly from Network.cpp after WiFi connect
-void updatePropagationData() {
-    if (getWiFiStatus() != 2) return; // Need Internet
-    if (propData.valid) return; // Already have data, one-shot
-    
+static void propagationLoad() {
+    uint32_t magic = 0;
+    PropData data;
+    fs::File file = LittleFS.open(PROP_CACHE_PATH, "rb");
+
+    if (!file) return;
+
+    if (file.read((uint8_t *)&magic, sizeof(magic)) == sizeof(magic) && magic == PROP_CACHE_MAGIC &&
+        file.read((uint8_t *)&data, sizeof(data)) == sizeof(data) && data.valid) {
+        for (int i = 0; i < PROP_BANDS; i++) data.rating[i][sizeof(data.rating[i]) - 1] = 0;
+        propData = data;
+    }
+
+    file.close();
+}
+
+// Background task: fetch Solar/DX data over HTTPS, this takes seconds
+static void propagationFetch(void *arg) {
+    PropData data = { false };
+    PropParser parser;
+
     WiFiClientSecure *client = new WiFiClientSecure;
     if(client) {
         client->setInsecure(); // Skip certificate check
         HTTPClient https;
-        
-        // Use wspr.hb9vqq.ch API with shorter timeout
-        https.setTimeout(3000); 
-        
+
+        // Use wspr.hb9vqq.ch API with shorter timeout, no chunked
+        // transfer encoding so that the stream is the plain payload
+        https.setTimeout(3000);
+        https.useHTTP10(true);
+
         if (https.begin(*client, "https://wspr.hb9vqq.ch/api/dx.json")) {
-            int httpCode = https.GET();
-            if (httpCode == HTTP_CODE_OK) {
-                String payload = https.getString();
-                
-                propData.sfi = extractJsonFloat(payload, "\"sfi\"");
-                propData.kp  = extractJsonFloat(payload, "\"kp\"");
-                
-                auto getRating = [&](const char* band) {
-                    int bandPos = payload.indexOf(band);
-                    if (bandPos == -1) return String("--");
-                    int ratePos = payload.indexOf("\"rating\"", bandPos);
-                    if (ratePos == -1) return String("--");
-                    int q1 = payload.indexOf('"', ratePos + 8);
-                    int q2 = payload.indexOf('"', q1 + 1);
-                    if (q1 != -1 && q2 != -1) return payload.substring(q1+1, q2);
-                    return String("--");
-                };
-                
-                strncpy(propData.rating10m, getRating("\"10m\"").c_str(), 15);
-                strncpy(propData.rating20m, getRating("\"20m\"").c_str(), 15);
-                strncpy(propData.rating40m, getRating("\"40m\"").c_str(), 15);
-                strncpy(propData.rating80m, getRating("\"80m\"").c_str(), 15);
-                
-                propData.valid = true;
-            }
+            if (https.GET() == HTTP_CODE_OK && propagationRead(https, parser))
+                parser.finish(&data);
             https.end();
         }
         delete client;
     }
+
+    // Hand the data over to the main loop
+    if (data.valid) {
+        propagationSave(data);
+        propFetched = data;
+        propFetchDone = true;
+    }
+    propFetchFailed = !data.valid;
+    propFetchBusy = false;
+    vTaskDelete(NULL);
+}
+
+// TRUE if it is time to fetch the data again
+static bool propagationExpired() {
+    if (!propFetchOnce) return true;
+    if (propFetchFailed) return millis() - propFetchTime >= PROP_RETRY_TIME;
+    return propRefresh && millis() - propFetchTime >= propRefresh * 60000UL;
+}
+
+// Called from Network.cpp after WiFi connect, starts fetching in the
+// background (if the data is old) so that the radio keeps running
+void updatePropagationData() {
+    if (propFetchBusy || !propagationExpired()) return;
+    if (getWiFiStatus() != 2) return; // Need Internet
+
+    propFetchOnce = true;
+    propFetchTime = millis();
+    propFetchFailed = false;
+    propFetchBusy = true;
+    if (xTaskCreate(propagationFetch, "propagation", PROP_TASK_STACK, NULL, 1, NULL) != pdPASS) {
+        propFetchFailed = true;
+        propFetchBusy = false;
+    }
+}
+
+// TRUE while the data is being fetched
+bool propagationBusy() {
+    return propFetchBusy;
+}
+
+// Called from the main loop: show the last good data after boot and
+// keep it fresh. Returns TRUE if there is new data to draw.
+bool propagationTickTime() {
+    if (!propLoaded) {
+        propLoaded = true;
+        propagationLoad();
+    }
+
+    updatePropagationData();
+
+    if (!propFetchDone) return false;
+
+    // Take over freshly fetched data
+    propData = propFetched;
+    propLive = true;
+    propFetchDone = false;
+    return true;
 }
 
-// Removed periodic tick, now called manually
+// DX target regions, shown as day, greyline or night
+static AstroPlace propRegions[] = {
+    { "EU",   50,   10 }, { "NAe",  40,  -75 }, { "NAw",  40, -120 }, { "SA",  -15,  -55 },
+    { "AF",    0,   20 }, { "AS",   30,  100 }, { "JA",   36,  138 }, { "OC",  -30,  145 },
+};
+static bool propRegionsReady = false;
+
+static const char *propPhases[] = { "Night Time", "Greyline", "Daytime" };
+static const char *propBestBands[] = { "40m - 160m", "20m - 40m", "10m - 20m" };
+
+static uint16_t propStateColor(uint8_t state) {
+    return state == ASTRO_DAY ? TH.text_warn : state == ASTRO_GREYLINE ? TH.scale_line : TH.menu_param;
+}
+
+// Local "HH:MM" for minutes UTC
+static const char *propLocalTime(char *buf, int16_t utc) {
+    int t = (utc + getCurrentUTCOffset() * 15 + 2 * 1440) % 1440;
+    sprintf(buf, "%02d:%02d", t / 60, t % 60);
+    return buf;
+}
+
+// Without live data: conditions from the sun position at the receiver
+// location and at the DX regions
+static void drawPropagationSun(const AstroSun *sun) {
+    char buf[48], t1[6], t2[6], t3[6], t4[6];
+
+    if (!propRegionsReady) {
+        for (unsigned int i = 0; i < ITEM_COUNT(propRegions); i++) {
+            AstroPlace *r = &propRegions[i];
+            astroPlace(r, r->name, r->lat, r->lon);
+        }
+        propRegionsReady = true;
+    }
+
+    spr.setTextDatum(TC_DATUM);
+
+    if (locationLat == ASTRO_NO_LOCATION || locationLon == ASTRO_NO_LOCATION) {
+        spr.setTextColor(TH.menu_item);
+        spr.drawString("Location not set", 160, 52, 4);
+        spr.drawString("Set it on the Wi-Fi settings page", 160, 86, 2);
+    } else {
+        AstroPlace home;
+        AstroTimes times;
+
+        astroPlace(&home, "", locationLat / 100.0f, locationLon / 100.0f);
+        astroTimes(sun, &home, &times);
+        float elevation = astroElevation(sun, &home, sun->utc);
+        uint8_t state = astroState(elevation);
+
+        spr.setTextColor(propStateColor(state));
+        spr.drawString(propPhases[state], 160, 50, 4);
+
+        spr.setTextColor(TH.menu_item);
+        if (times.sunrise < 0)
+            sprintf(buf, "Sun %s all day", elevation > 0 ? "up" : "down");
+        else
+            sprintf(buf, "Sunrise %s   Sunset %s", propLocalTime(t1, times.sunrise), propLocalTime(t2, times.sunset));
+        spr.drawString(buf, 160, 78, 2);
+
+        if (times.dawn >= 0 && times.sunrise >= 0) {
+            sprintf(buf, "Greyline %s-%s, %s-%s",
+                propLocalTime(t1, times.dawn), propLocalTime(t2, times.sunrise),
+                propLocalTime(t3, times.sunset), propLocalTime(t4, times.dusk));
+            spr.drawString(buf, 160, 94, 2);
+        }
+
+        spr.setTextColor(TH.band_text);
+        sprintf(buf, "Best Bands: %s", propBestBands[state]);
+        spr.drawString(buf, 160, 112, 2);
+    }
+
+    // Day and night around the world
+    for (unsigned int i = 0; i < ITEM_COUNT(propRegions); i++) {
+        const AstroPlace *r = &propRegions[i];
+        spr.setTextColor(propStateColor(astroState(astroElevation(sun, r, sun->utc))));
+        spr.drawString(r->name, 30 + 37 * i, 134, 2);
+    }
+}
 
 void drawPropagation() {
+    static AstroSun sun;
+
     // Background
     spr.fillSprite(TH.bg);
     
@@ -121,7 +261,7 @@ void drawPropagation() {
     spr.fillSmoothRoundRect(10, 10, 300, 150, 4, TH.menu_border);
     spr.fillSmoothRoundRect(12, 12, 296, 146, 4, TH.menu_bg);
     
-    spr.drawString(propData.valid ? "Solar & DX (Live)" : "Propagation Forecast", 160, 20, 4);
+    spr.drawString(!propData.valid ? "Propagation Forecast" : propLive ? "Solar & DX (Live)" : "Solar & DX (Cached)", 160, 20, 4);
     spr.drawLine(10, 45, 310, 45, TH.menu_border);
     
     // Get Time for Local display
@@ -136,6 +276,13 @@ void drawPropagation() {
         localHour = t / 60;
     }
 
+    // Without live data, from the sun position if the date is known
+    if (!propData.valid && astroSunForNow(&sun)) {
+        drawPropagationSun(&sun);
+        spr.pushSprite(0, 0);
+        return;
+    }
+
     if (!propData.valid) {
         // Fallback: Show Estimated Data based on Time
         const char* phase = "Unknown";
@@ -198,10 +345,8 @@ void drawPropagation() {
     int y = 115;
     spr.setTextDatum(TL_DATUM);
     spr.setTextColor(TH.band_text);
-    spr.drawString("10m:", 30, y, 2);
-    spr.drawString("20m:", 100, y, 2);
-    spr.drawString("40m:", 170, y, 2);
-    spr.drawString("80m:", 240, y, 2);
+    for (int i = 0; i < PROP_BANDS; i++)
+        spr.drawString(String(propBands[i]) + ":", 30 + 70 * i, y, 2);
     
     auto getColor = [](const char* r) {
         if (strcmp(r, "Good") == 0) return TH.batt_full;
@@ -209,14 +354,10 @@ void drawPropagation() {
         return TH.text_warn;
     };
     
-    spr.setTextColor(getColor(propData.rating10m));
-    spr.drawString(propData.rating10m, 30, y+15, 2);
-    spr.setTextColor(getColor(propData.rating20m));
-    spr.drawString(propData.rating20m, 100, y+15, 2);
-    spr.setTextColor(getColor(propData.rating40m));
-    spr.drawString(propData.rating40m, 170, y+15, 2);
-    spr.setTextColor(getColor(propData.rating80m));
-    spr.drawString(propData.rating80m, 240, y+15, 2);
+    for (int i = 0; i < PROP_BANDS; i++) {
+        spr.setTextColor(getColor(propData.rating[i]));
+        spr.drawString(propData.rating[i], 30 + 70 * i, y+15, 2);
+    }
 
     spr.pushSprite(0, 0);
 }
@@ -0,0 +1,57 @@
+#ifndef PROPAGATION_H
+#define PROPAGATION_H
+
+#include <Arduino.h>
+
+#define PROP_BANDS        4                    // 10m, 20m, 40m, 80m
+#define PROP_CACHE_PATH   "/propagation.bin"   // Last good data
+#define PROP_RETRY_TIME   (5 * 60 * 1000)      // Retry after a failed fetch (ms)
+#define PROP_READ_TIME    3000                 // Longest wait for more data (ms)
+
+// Band names, as in the Solar/DX data
+extern const char *propBands[PROP_BANDS];
+
+// Solar/DX data
+struct PropData {
+    bool valid;
+    float sfi;
+    float kp;
+    char rating[PROP_BANDS][16];
+};
+
+//
+// Streaming JSON scanner for the Solar/DX data. It is fed the payload
+// in pieces as it arrives and only keeps the current token. SFI and Kp
+// come from the first "sfi" and "kp" fields, a band rating from the
+// first "rating" field following the band name ("10m", ...), be it a
+// key or a value.
+//
+class PropParser {
+public:
+    PropParser() { reset(); }
+
+    void reset();
+    bool feed(const char *data, size_t size); // FALSE: malformed JSON
+    bool finish(PropData *data);              // FALSE: incomplete or no data
+
+private:
+    bool put(char c);
+    bool open(bool array);
+    bool close(bool array);
+    void value(bool string);
+
+    uint8_t state;
+    uint8_t depth;
+    uint32_t arrays;      // Bit per nesting level, set for arrays
+    bool first;           // Right after '{' or '['
+    char text[24];        // Current string or literal
+    uint8_t len;
+    bool isKey;
+    char key[16];         // Key of the current value
+    int8_t band;          // Band named last (-1 - none)
+    bool haveSfi;
+    bool haveKp;
+    PropData data;
+};
+
+#endif // PROPAGATION_H
@@ -4,6 +4,13 @@
 #include "Menu.h"
 #include "Draw.h"
 #include "Remote.h"
+#include "History.h"
+#include "Profile.h"
+#include "Binary.h"
+#include "RigCtl.h"
+#include "Kenwood.h"
+#include "Script.h"
+#include "Metrics.h"
 
 
 static uint8_t char2nibble(char key)
@@ -56,69 +63,93 @@ static void remoteCaptureScreen(Stream* stream)
   }
 }
 
-char remoteReadChar(Stream* stream)
+//
+// PackBits compress a row of 16-bit pixels: a header byte N of 0..127
+// is followed by N+1 literal pixels, a header byte N of -1..-127 is
+// followed by one pixel repeated 1-N times. Returns the output size.
+//
+static size_t packBitsRow(const uint16_t *row, int width, uint8_t *out)
 {
-  char key;
+  size_t size = 0;
 
-  while (!stream->available());
-  key = stream->read();
-  stream->print(key);
-  return key;
-}
+  for(int i=0 ; i<width ; )
+  {
+    int run = 1;
+    while(i + run < width && run < 128 && row[i + run] == row[i]) run++;
 
-long int remoteReadInteger(Stream* stream)
-{
-  long int result = 0;
-  while (true) {
-    char ch = stream->peek();
-    if (ch == 0xFF) {
-      continue;
-    } else if ((ch >= '0') && (ch <= '9')) {
-      ch = remoteReadChar(stream);
-      // Can overflow, but it's ok
-      result = result * 10 + (ch - '0');
-    } else {
-      return result;
+    if(run > 1)
+    {
+      out[size++] = (uint8_t)(1 - run);
+      memcpy(out + size, &row[i], 2);
+      size += 2;
+      i += run;
     }
-  }
-}
-
-void remoteReadString(Stream* stream, char *bufStr, uint8_t bufLen)
-{
-  uint8_t length = 0;
-  while (true) {
-    char ch = stream->peek();
-    if (ch == 0xFF) {
-      continue;
-    } else if (ch == ',' || ch < ' ') {
-      bufStr[length] = '\0';
-      return;
-    } else {
-      ch = remoteReadChar(stream);
-      bufStr[length] = ch;
-      if (++length >= bufLen - 1) {
-        bufStr[length] = '\0';
-        return;
-      }
+    else
+    {
+      // Collect literals until the next run of two or more pixels
+      int count = 1;
+      while(i + count < width && count < 128 &&
+           (i + count + 1 >= width || row[i + count] != row[i + count + 1]))
+        count++;
+
+      out[size++] = count - 1;
+      memcpy(out + size, &row[i], count * 2);
+      size += count * 2;
+      i += count;
     }
   }
+
+  return(size);
 }
 
-static bool expectNewline(Stream* stream)
+//
+// Capture current screen image to the remote in binary form:
+//
+//   "ATSS" | width (u16) | height (u16) | format (u8) | 16 (u8)
+//
+// followed by one chunk per row, top to bottom: length (u16) and the
+// row data. Pixels are RGB565 with the high byte first, rows are raw
+// (format 0) or PackBits compressed (format 1). Numbers are little
+// endian.
+//
+static void remoteCaptureScreenBinary(Stream* stream, bool packBits)
 {
-  char ch;
-  while ((ch = stream->peek()) == 0xFF);
-  if (ch == '\r') {
-    stream->read();
-    return true;
+  uint16_t width  = spr.width();
+  uint16_t height = spr.height();
+  uint16_t row[width];
+  uint8_t chunk[2 + width * 2 + (width + 127) / 128];
+
+  uint8_t header[10] =
+  {
+    'A', 'T', 'S', 'S',
+    (uint8_t)width, (uint8_t)(width >> 8),
+    (uint8_t)height, (uint8_t)(height >> 8),
+    packBits, 16
+  };
+
+  stream->println("");
+  stream->write(header, sizeof(header));
+
+  for(int y=0 ; y<height ; y++)
+  {
+#ifdef PALETTE_SPRITE
+    for(int x=0 ; x<width ; x++) row[x] = htons(spr.readPixel(x, y));
+#else
+    // Framebuffer already holds byte-swapped (high byte first) pixels
+    memcpy(row, (uint16_t *)spr.getPointer() + y * width, width * 2);
+#endif
+
+    size_t size = packBits ? packBitsRow(row, width, chunk + 2) : width * 2;
+    if(!packBits) memcpy(chunk + 2, row, size);
+
+    chunk[0] = size;
+    chunk[1] = size >> 8;
+    stream->write(chunk, size + 2);
   }
-  return false;
 }
 
 static bool remoteShowError(Stream* stream, const char *message)
 {
-  // Consume the remaining input
-  while (stream->available()) remoteReadChar(stream);
   stream->printf("\r\nError: %s\r\n", message);
   return false;
 }
@@ -132,22 +163,22 @@ static void remoteGetMemories(Stream* stream)
   }
 }
 
-static bool remoteSetMemory(Stream* stream)
+static bool remoteSetMemory(Stream* stream, char *line)
 {
-  stream->print('#');
   Memory mem;
   uint32_t freq = 0;
+  char *p = line;
 
-  long int slot = remoteReadInteger(stream);
-  if (remoteReadChar(stream) != ',')
+  long int slot = strtol(p, &p, 10);
+  if (*p++ != ',')
     return remoteShowError(stream, "Expected ','");
   if (slot < 1 || slot > getTotalMemories())
     return remoteShowError(stream, "Invalid memory slot number");
 
-  char band[8];
-  remoteReadString(stream, band, 8);
-  if (remoteReadChar(stream) != ',')
+  char *band = p;
+  if (!(p = strchr(p, ',')))
     return remoteShowError(stream, "Expected ','");
+  *p++ = '\0';
   mem.band = 0xFF;
   for (int i = 0; i < getTotalBands(); i++) {
     if (strcmp(bands[i].bandName, band) == 0) {
@@ -158,15 +189,11 @@ static bool remoteSetMemory(Stream* stream)
   if (mem.band == 0xFF)
     return remoteShowError(stream, "No such band");
 
-  freq = remoteReadInteger(stream);
-  if (remoteReadChar(stream) != ',')
+  freq = strtoul(p, &p, 10);
+  if (*p++ != ',')
     return remoteShowError(stream, "Expected ','");
 
-  char mode[4];
-  remoteReadString(stream, mode, 4);
-  if (!expectNewline(stream))
-    return remoteShowError(stream, "Expected newline");
-  stream->println();
+  char *mode = p;
   mem.mode = 15;
   for (int i = 0; i < getTotalModes(); i++) {
     if (strcmp(bandModeDesc[i], mode) == 0) {
@@ -205,34 +232,39 @@ static bool remoteSetMemory(Stream* stream)
 }
 
 //
-// Set current color theme from the remote
+// Number of characters in a complete color theme string (x0001x0002...)
 //
-static void remoteSetColorTheme(Stream* stream)
+static int remoteColorThemeLength()
 {
-  stream->print("Enter a string of hex colors (x0001x0002...): ");
+  return((sizeof(ColorTheme) - offsetof(ColorTheme, bg)) / sizeof(uint16_t) * 5);
+}
 
+//
+// Set current color theme from the remote, given a string of hex
+// colors (x0001x0002...). Colors are applied up to the first one
+// that is malformed.
+//
+static void remoteSetColorTheme(Stream* stream, const char *hex)
+{
   uint8_t *p = (uint8_t *)&(TH.bg);
+  bool ok = (int)strlen(hex) == remoteColorThemeLength();
 
-  for(int i=0 ; ; i+=sizeof(uint16_t))
+  for(int i=0 ; *hex ; i+=sizeof(uint16_t), hex+=5)
   {
-    if(i >= sizeof(ColorTheme)-offsetof(ColorTheme, bg))
+    if(hex[0]!='x' || !isxdigit(hex[1]) || !isxdigit(hex[2]) || !isxdigit(hex[3]) || !isxdigit(hex[4]))
     {
-      stream->println(" Ok");
+      ok = false;
       break;
     }
 
-    if(remoteReadChar(stream) != 'x')
-    {
-      stream->println(" Err");
-      break;
-    }
-
-    p[i + 1]  = char2nibble(remoteReadChar(stream)) * 16;
-    p[i + 1] |= char2nibble(remoteReadChar(stream));
-    p[i]      = char2nibble(remoteReadChar(stream)) * 16;
-    p[i]     |= char2nibble(remoteReadChar(stream));
+    p[i + 1]  = char2nibble(hex[1]) * 16;
+    p[i + 1] |= char2nibble(hex[2]);
+    p[i]      = char2nibble(hex[3]) * 16;
+    p[i]     |= char2nibble(hex[4]);
   }
 
+  stream->println(ok ? " Ok" : " Err");
+
   // Redraw screen
   drawScreen();
 }
@@ -259,16 +291,14 @@ static void remoteGetColorTheme(Stream* stream)
 void remotePrintStatus(Stream* stream, RemoteState* state)
 {
   // Prepare information ready to be sent
-  float remoteVoltage = batteryMonitor();
+  float remoteVoltage = batteryVoltage();
 
   // S-Meter conditional on compile option
   rx.getCurrentReceivedSignalQuality();
   uint8_t remoteRssi = rx.getCurrentRSSI();
   uint8_t remoteSnr = rx.getCurrentSNR();
 
-  // Use rx.getFrequency to force read of capacitor value from SI4732/5
-  rx.getFrequency();
-  uint16_t tuningCapacitor = rx.getAntennaTuningCapacitor();
+  uint16_t tuningCapacitor = getTuningCapacitor();
 
   // Remote serial
   stream->printf("%u,%u,%d,%d,%s,%s,%s,%s,%hu,%hu,%hu,%hu,%hu,%.2f,%hu\r\n",
@@ -304,15 +334,209 @@ void remoteTickTime(Stream* stream, RemoteState* state)
     // Show status
     remotePrintStatus(stream, state);
   }
+
+  telemetryTick(stream, &state->telemetry);
+}
+
+//
+// Stop periodic output before sending something else
+//
+static void remoteStopLog(RemoteState* state)
+{
+  state->remoteLogOn = false;
+  telemetryStop(&state->telemetry);
+}
+
+//
+// Script commands: status, run, stop, print, log or upload
+//
+static void remoteScript(Stream* stream, RemoteState* state, const char *args)
+{
+  if(args[0] && args[1])
+  {
+    remoteShowError(stream, "Invalid script command");
+    return;
+  }
+
+  switch(args[0])
+  {
+    case '\0':
+      scriptStatus(stream);
+      break;
+    case 'r':
+      scriptStart(stream);
+      break;
+    case 's':
+      scriptStop();
+      scriptStatus(stream);
+      break;
+    case 'p':
+      remoteStopLog(state);
+      scriptPrint(stream);
+      break;
+    case 'l':
+      remoteStopLog(state);
+      scriptPrintLog(stream);
+      break;
+    case 'u':
+      remoteStopLog(state);
+      state->scriptUpload = scriptUploadStart(state, stream);
+      break;
+    default:
+      remoteShowError(stream, "Invalid script command");
+      break;
+  }
+}
+
+//
+// Execute a complete multi-character command
+//
+static int remoteExecute(Stream* stream, RemoteState* state)
+{
+  char *args = state->cmd + 1;
+  int event = 0;
+
+  switch(state->cmd[0])
+  {
+    case 'c':
+      remoteStopLog(state);
+      if(args[0] != '0' && args[0] != '1')
+        remoteShowError(stream, "Invalid screenshot format");
+      else
+        remoteCaptureScreenBinary(stream, args[0] == '1');
+      break;
+    case 'H':
+      {
+        uint8_t level = args[0] - '0';
+        remoteStopLog(state);
+        if(level >= HISTORY_LEVELS)
+          remoteShowError(stream, "Invalid history level");
+        else
+        {
+          stream->println("");
+          historyPrint(stream, level);
+        }
+      }
+      break;
+    case '#':
+      if (remoteSetMemory(stream, args))
+        event |= REMOTE_PREFS;
+      break;
+    case 'u':
+      if(!telemetrySubscribe(&state->telemetry, args))
+        remoteShowError(stream, "Invalid subscription");
+      break;
+    case 'x':
+      remoteScript(stream, state, args);
+      break;
+    case '^':
+      remoteSetColorTheme(stream, args);
+      break;
+  }
+
+  return(event | REMOTE_CHANGED);
+}
+
+//
+// Add character to the multi-character command being received,
+// execute the command once it is complete
+//
+static int remoteAddChar(Stream* stream, RemoteState* state, char key)
+{
+  bool newline = key == '\r' || key == '\n';
+  bool complete = false;
+
+  // Echo everything except the line ending
+  if(!newline) stream->print(key);
+
+  if(state->cmdLength >= sizeof(state->cmd) - 1)
+  {
+    state->cmdLength = 0;
+    remoteShowError(stream, "Command too long");
+    return(0);
+  }
+
+  state->cmd[state->cmdLength++] = newline ? '\0' : key;
+  state->cmd[state->cmdLength] = '\0';
+  state->cmdTime = millis();
+
+  switch(state->cmd[0])
+  {
+    case 'c':
+    case 'H':
+      // Single character argument
+      complete = true;
+      break;
+    case '#':
+    case 'u':
+    case 'x':
+      // Line terminated by a newline
+      if(newline)
+      {
+        stream->println();
+        complete = true;
+      }
+      break;
+    case '^':
+      // Full string of colors, or a newline to cut it short. Bad
+      // characters are collected too, so that hex digits are not
+      // taken for commands.
+      complete = newline || state->cmdLength - 1 == remoteColorThemeLength();
+      break;
+  }
+
+  if(!complete) return(0);
+
+  state->cmdLength = 0;
+  return(remoteExecute(stream, state));
 }
 
 //
-// Recognize and execute given remote command
+// Drop a partially received command if the rest of it does not
+// arrive in time
+//
+static void remoteCheckTimeout(Stream* stream, RemoteState* state, bool quiet)
+{
+  if(state->cmdLength && (millis() - state->cmdTime > REMOTE_TIMEOUT))
+  {
+    state->cmdLength = 0;
+    if(!quiet) remoteShowError(stream, "Timeout");
+  }
+}
+
+//
+// Start receiving a multi-character command
+//
+static void remoteStartCommand(RemoteState* state, char key)
+{
+  state->cmd[0]    = key;
+  state->cmd[1]    = '\0';
+  state->cmdLength = 1;
+  state->cmdTime   = millis();
+}
+
+//
+// Recognize and execute given remote command. Commands with arguments
+// are collected over several calls, so this never waits for input.
 //
 int remoteDoCommand(Stream* stream, RemoteState* state, char key)
 {
   int event = 0;
 
+  // Receiving a script
+  if(state->scriptUpload)
+  {
+    state->scriptUpload = scriptUploadActive(state);
+    if(state->scriptUpload)
+    {
+      scriptUploadChar(state, stream, key);
+      return(0);
+    }
+  }
+
+  // Continue receiving a multi-character command
+  if(state->cmdLength) return(remoteAddChar(stream, state, key));
+
   switch(key)
   {
     case 'R': // Rotate Encoder Clockwise
@@ -397,27 +621,45 @@ int remoteDoCommand(Stream* stream, RemoteState* state, char key)
       event |= REMOTE_PREFS;
       break;
     case 'C':
-      state->remoteLogOn = false;
+      remoteStopLog(state);
       remoteCaptureScreen(stream);
       break;
+    case 'c':
+    case 'H':
+      remoteStartCommand(state, key);
+      return(0);
     case 't':
       state->remoteLogOn = !state->remoteLogOn;
       break;
+#ifdef RENDER_STATS
+    case 'P':
+      remoteStopLog(state);
+      stream->println("");
+      profilePrint(stream);
+      break;
+#endif
 
     case '$':
       remoteGetMemories(stream);
       break;
     case '#':
-      if (remoteSetMemory(stream))
-        event |= REMOTE_PREFS;
-      break;
+      stream->print('#');
+      remoteStartCommand(state, key);
+      return(0);
+    case 'u':
+    case 'x':
+      stream->print(key);
+      remoteStartCommand(state, key);
+      return(0);
 
     case 'T':
       stream->println(switchThemeEditor(!switchThemeEditor()) ? "Theme editor enabled" : "Theme editor disabled");
       break;
     case '^':
-      if(switchThemeEditor()) remoteSetColorTheme(stream);
-      break;
+      if(!switchThemeEditor()) break;
+      stream->print("Enter a string of hex colors (x0001x0002...): ");
+      remoteStartCommand(state, key);
+      return(0);
     case '@':
       if(switchThemeEditor()) remoteGetColorTheme(stream);
       break;
@@ -432,112 +674,87 @@ int remoteDoCommand(Stream* stream, RemoteState* state, char key)
 }
 
 //
-// RigCtl implementation
+// Collect RigCtl command lines, execute them once complete
 //
-static void rigCtlProcess(Stream* stream)
+static int rigCtlDoCommand(Stream* stream, RemoteState* state, char key)
 {
-  if (!stream->available()) return;
-  
-  char cmd = stream->read();
-  
-  switch(cmd)
-  {
-    case 'f': // get_freq
-      stream->printf("%lu\n", (currentMode == FM) ? (uint32_t)(currentFrequency * 10000) : (uint32_t)((currentFrequency * 1000) + currentBFO));
-      break;
-      
-    case 'F': // set_freq
-      {
-        long freq = remoteReadInteger(stream); // in Hz
-        if (currentMode == FM)
-          updateFrequency(freq / 10000);
-        else
-          updateFrequency(freq / 1000);
-        stream->println("RPRT 0");
-      }
-      break;
+  if (key == '\r') return 0;
+
+  if (key != '\n') {
+    // Drop lines that do not fit into the buffer
+    if (state->cmdLength < sizeof(state->cmd) - 1)
+      state->cmd[state->cmdLength++] = key;
+    state->cmdTime = millis();
+    return 0;
+  }
 
-    case 'm': // get_mode
-      {
-        const char* m = "AM";
-        int width = 0; // Hz
-        
-        switch(currentMode) {
-          case FM: m = "FM"; width = 100000; break;
-          case AM: m = "AM"; width = 6000; break;
-          case LSB: m = "LSB"; width = 2700; break;
-          case USB: m = "USB"; width = 2700; break;
-        }
-        stream->printf("%s\n%d\n", m, width);
-      }
-      break;
-      
-    case 'M': // set_mode
-      {
-         char modeName[8];
-         remoteReadString(stream, modeName, 8);
-         // Pass bandwidth param
-         remoteReadInteger(stream); 
-         
-         if (strcmp(modeName, "FM") == 0) currentMode = FM;
-         else if (strcmp(modeName, "AM") == 0) currentMode = AM;
-         else if (strcmp(modeName, "LSB") == 0) currentMode = LSB;
-         else if (strcmp(modeName, "USB") == 0) currentMode = USB;
-         
-         // Force band/mode update
-         selectBand(bandIdx); // Re-select to apply mode? No, this resets frequency.
-         // Just setting currentMode might not be enough if logic depends on band.
-         // But for now let's assume simple mode switch.
-         stream->println("RPRT 0");
-      }
-      break;
+  int event = 0;
+  state->cmd[state->cmdLength] = '\0';
+  if (state->cmdLength && state->cmdLength < sizeof(state->cmd) - 1)
+    event = rigCtlExecute(stream, state->cmd);
+  state->cmdLength = 0;
 
-    case 'v': // get_vfo
-      stream->println("VFOA");
-      break;
+  return event;
+}
 
-    case 'l': // get_level
-      {
-         char lvl[8];
-         remoteReadString(stream, lvl, 8);
-         if (strcmp(lvl, "STRENGTH") == 0) {
-            // Return RSSI
-            stream->printf("%d\n", rssi - 127); // Hamlib expects dBm usually, or relative? RSSI here is dBuV usually.
-         } else {
-             stream->println("0");
-         }
-      }
-      break;
-      
-    case 'q': // quit?
-        // Do nothing
-        break;
+//
+// Feed available input from a remote stream to the command parser.
+// Never waits for input, returns once a command has been executed so
+// that events from different commands are not merged.
+//
+int remoteDoInput(Stream* stream, RemoteState* state, bool rigCtl)
+{
+  // RigCtl clients do not expect error messages
+  remoteCheckTimeout(stream, state, rigCtl);
 
-    default:
-       // Ignore unknown or eat line
-       while(stream->available() && stream->peek() != '\n') stream->read();
-       if(stream->peek() == '\n') stream->read();
-       break;
+  while (stream->available()) {
+    int c = stream->read();
+    if (c < 0) break;
+
+    int event = rigCtl ? rigCtlDoCommand(stream, state, c) : remoteDoCommand(stream, state, c);
+    if (event) return event;
   }
+
+  return 0;
+}
+
+static KenwoodState kenwoodState;
+
+static Metric metricCommands("atsmini_remote_commands_total", "Remote commands that changed the receiver", METRIC_COUNTER, "source=\"serial\"");
+
+static int serialInput(Stream* stream, RemoteState* state, uint8_t usbMode)
+{
+  static BinaryState binaryState;
+
+  if (usbMode == USB_BINARY)
+    return binaryDoCommand(stream, &binaryState);
+
+  if (usbMode == USB_KENWOOD)
+    return kenwoodDoCommand(stream, &kenwoodState);
+
+  return remoteDoInput(stream, state, usbMode == USB_RIGCTL);
 }
 
 int serialDoCommand(Stream* stream, RemoteState* state, uint8_t usbMode)
 {
   if(usbMode == USB_OFF) return 0;
 
-  if (usbMode == USB_RIGCTL) {
-    rigCtlProcess(stream);
-    return 0; // RigCtl handles its own responses
-  }
-
-  if (Serial.available())
-    return remoteDoCommand(stream, state, Serial.read());
-  return 0;
+  int event = serialInput(stream, state, usbMode);
+  if (event) metricCommands.add();
+  return event;
 }
 
 void serialTickTime(Stream* stream, RemoteState* state, uint8_t usbMode)
 {
-  if(usbMode == USB_OFF) return;
+  // Text log would break binary frames
+  if(usbMode == USB_OFF || usbMode == USB_BINARY) return;
+
+  // CAT clients get auto information instead
+  if(usbMode == USB_KENWOOD)
+  {
+    kenwoodTickTime(stream, &kenwoodState);
+    return;
+  }
 
   remoteTickTime(stream, state);
 }
@@ -1,14 +1,25 @@
 #ifndef REMOTE_H
 #define REMOTE_H
 
+#include "Telemetry.h"
+
+#define REMOTE_MAX_COMMAND 256  // Longest command with arguments
+#define REMOTE_TIMEOUT    5000  // Incomplete command timeout (ms)
+
 typedef struct {
   uint32_t remoteTimer = millis();
   uint8_t remoteSeqnum = 0;
   bool remoteLogOn = false;
+  char cmd[REMOTE_MAX_COMMAND];  // Command being received
+  uint16_t cmdLength = 0;
+  uint32_t cmdTime = 0;          // Time the last character was received
+  TelemetryState telemetry;      // Telemetry subscription
+  bool scriptUpload = false;     // Receiving a script
 } RemoteState;
 
 void remoteTickTime(Stream* stream, RemoteState* state);
 int remoteDoCommand(Stream* stream, RemoteState* state, char key);
+int remoteDoInput(Stream* stream, RemoteState* state, bool rigCtl);
 int serialDoCommand(Stream* stream, RemoteState* state, uint8_t usbMode);
 void serialTickTime(Stream* stream, RemoteState* state, uint8_t usbMode);
 
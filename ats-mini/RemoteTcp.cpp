@@ -0,0 +1,383 @@
+#include "Common.h"
+#include "Remote.h"
+#include "RemoteTcp.h"
+#include "Metrics.h"
+#include <AsyncTCP.h>
+#include <atomic>
+
+// Slot states. The network task takes a free slot for a new client
+// and marks it closed when the client disconnects, the main loop
+// activates an open slot and frees a closed one.
+#define TCP_FREE           0
+#define TCP_OPEN           1 // Client connected, not seen by the main loop yet
+#define TCP_ACTIVE         2 // Client served by the main loop
+#define TCP_CLOSED         3 // Client disconnected, waiting to be freed
+
+//
+// Connected client, used as a Stream by the remote command parsers.
+// Received data goes through a single producer (network task), single
+// consumer (main loop) buffer, the replies are buffered by the main
+// loop and sent as the client acknowledges them.
+//
+class TcpClient : public Stream
+{
+  public:
+    AsyncClient *client = NULL;
+    std::atomic<uint8_t> status{TCP_FREE};
+    std::atomic<bool> acked{false}; // Client acknowledged some output
+    bool rigCtl = false;
+    bool closing = false;           // Close once the output is sent
+    RemoteState state;
+
+    //
+    // Network task: take a free slot, returns false if there is no
+    // memory for the buffers
+    //
+    bool open(AsyncClient *newClient, bool rigCtlPort)
+    {
+      buf = (uint8_t *)ps_malloc(REMOTE_TCP_BUFFER + REMOTE_TCP_OUTPUT);
+      if(!buf) return(false);
+
+      client = newClient;
+      rigCtl = rigCtlPort;
+      inHead.store(0, std::memory_order_relaxed);
+      inTail.store(0, std::memory_order_relaxed);
+      inAcked = 0;
+      status.store(TCP_OPEN, std::memory_order_release);
+      return(true);
+    }
+
+    //
+    // Network task: add received data, returns false if it does not fit
+    //
+    bool put(const uint8_t *data, size_t length)
+    {
+      uint32_t head = inHead.load(std::memory_order_relaxed);
+      uint32_t tail = inTail.load(std::memory_order_acquire);
+
+      if(length > REMOTE_TCP_BUFFER - (head - tail)) return(false);
+
+      for(size_t i=0 ; i<length ; i++)
+        buf[(head + i) % REMOTE_TCP_BUFFER] = data[i];
+
+      inHead.store(head + length, std::memory_order_release);
+      return(true);
+    }
+
+    //
+    // Network task: let the client send as much as the main loop read
+    //
+    void ack()
+    {
+      uint32_t n = inTail.load(std::memory_order_acquire) - inAcked;
+      if(n) inAcked += client->ack(n);
+    }
+
+    //
+    // Main loop: start serving an open slot, returns false if the
+    // client is gone already
+    //
+    bool activate()
+    {
+      uint8_t expected = TCP_OPEN;
+
+      state   = RemoteState();
+      out     = buf + REMOTE_TCP_BUFFER;
+      outHead = outTail = 0;
+      closing = overflow = false;
+      return(status.compare_exchange_strong(expected, TCP_ACTIVE, std::memory_order_acquire));
+    }
+
+    //
+    // Main loop: free a closed slot for the network task
+    //
+    void release()
+    {
+      delete client;
+      free(buf);
+      client = NULL;
+      buf = NULL;
+      status.store(TCP_FREE, std::memory_order_release);
+    }
+
+    // Commands wait until the replies to the previous ones are sent
+    int available() override
+    {
+      if(pending()) return(0);
+      return(inHead.load(std::memory_order_acquire) - inTail.load(std::memory_order_relaxed));
+    }
+
+    int peek() override
+    {
+      uint32_t tail = inTail.load(std::memory_order_relaxed);
+      return(available() ? buf[tail % REMOTE_TCP_BUFFER] : -1);
+    }
+
+    int read() override
+    {
+      uint32_t tail = inTail.load(std::memory_order_relaxed);
+      if(!available()) return(-1);
+      uint8_t c = buf[tail % REMOTE_TCP_BUFFER];
+      inTail.store(tail + 1, std::memory_order_release);
+      return(c);
+    }
+
+    size_t write(uint8_t c) override { return(write(&c, 1)); }
+
+    //
+    // Main loop: buffer output, a reply that does not fit closes
+    // the connection
+    //
+    size_t write(const uint8_t *data, size_t size) override
+    {
+      if(overflow || size > REMOTE_TCP_OUTPUT - (outHead - outTail))
+      {
+        overflow = true;
+        return(0);
+      }
+
+      if(outHead == outTail) outTime = millis();
+
+      for(size_t i=0 ; i<size ; i++)
+        out[(outHead + i) % REMOTE_TCP_OUTPUT] = data[i];
+
+      outHead += size;
+      return(size);
+    }
+
+    bool pending() { return(outHead != outTail); }
+
+    //
+    // Main loop: pass as much output as the client takes now to the
+    // TCP stack, the rest waits for acknowledgements
+    //
+    void send()
+    {
+      bool sent = false;
+
+      if(overflow)
+      {
+        abort();
+        return;
+      }
+
+      while(pending())
+      {
+        uint32_t at = outTail % REMOTE_TCP_OUTPUT;
+        size_t size = min((size_t)(outHead - outTail), (size_t)(REMOTE_TCP_OUTPUT - at));
+
+        size = client->add((const char *)out + at, min(size, client->space()));
+        if(!size) break;
+
+        outTail += size;
+        outTime = millis();
+        sent = true;
+      }
+
+      if(sent) client->send();
+      if(closing && !pending()) client->close();
+    }
+
+    //
+    // Main loop: drop the connection and the output now
+    //
+    void abort()
+    {
+      outHead = outTail;
+      overflow = false;
+      closing = true;
+      client->close(true);
+    }
+
+    // Main loop: true if the client has not taken any output for long
+    bool stalled() { return(pending() && millis() - outTime > REMOTE_TCP_TIMEOUT); }
+
+  private:
+    uint8_t *buf = NULL;            // Received data, then output
+    std::atomic<uint32_t> inHead{0};
+    std::atomic<uint32_t> inTail{0};
+    uint32_t inAcked = 0;           // Network task only
+    uint8_t *out = NULL;
+    uint32_t outHead = 0;
+    uint32_t outTail = 0;
+    uint32_t outTime = 0;           // Last time output was taken
+    bool overflow = false;
+};
+
+static AsyncServer rigCtlServer(REMOTE_TCP_RIGCTL_PORT);
+static AsyncServer adHocServer(REMOTE_TCP_ADHOC_PORT);
+static TcpClient tcpClients[REMOTE_TCP_CLIENTS];
+
+static Metric metricCommands("atsmini_remote_commands_total", "Remote commands that changed the receiver", METRIC_COUNTER, "source=\"tcp\"");
+
+//
+// Network task: pass received data to the main loop. The data is
+// acknowledged when the main loop reads it, so it always fits.
+//
+static void remoteTcpOnData(void *arg, AsyncClient *client, void *data, size_t length)
+{
+  TcpClient *c = &tcpClients[(uintptr_t)arg];
+
+  client->ackLater();
+  if(!c->put((const uint8_t *)data, length)) client->close(true);
+  c->ack();
+}
+
+//
+// Network task: acknowledge data read by the main loop in the
+// meantime, reopens the receive window of a client that filled it
+//
+static void remoteTcpOnPoll(void *arg, AsyncClient *client)
+{
+  tcpClients[(uintptr_t)arg].ack();
+}
+
+//
+// Network task: the client took some output, send more
+//
+static void remoteTcpOnAck(void *arg, AsyncClient *client, size_t length, uint32_t time)
+{
+  tcpClients[(uintptr_t)arg].acked.store(true, std::memory_order_release);
+}
+
+//
+// Network task: report disconnected client, the main loop frees it
+//
+static void remoteTcpOnDisconnect(void *arg, AsyncClient *client)
+{
+  tcpClients[(uintptr_t)arg].status.store(TCP_CLOSED, std::memory_order_release);
+}
+
+//
+// Network task: assign a new client to a free slot
+//
+static void remoteTcpOnClient(void *arg, AsyncClient *client)
+{
+  for(int i=0 ; i<REMOTE_TCP_CLIENTS ; i++)
+  {
+    TcpClient *c = &tcpClients[i];
+
+    if(c->status.load(std::memory_order_acquire) != TCP_FREE) continue;
+    if(!c->open(client, (uintptr_t)arg == REMOTE_TCP_RIGCTL_PORT)) break;
+
+    client->setNoDelay(true);
+    client->onData(remoteTcpOnData, (void *)(uintptr_t)i);
+    client->onPoll(remoteTcpOnPoll, (void *)(uintptr_t)i);
+    client->onAck(remoteTcpOnAck, (void *)(uintptr_t)i);
+    client->onDisconnect(remoteTcpOnDisconnect, (void *)(uintptr_t)i);
+    return;
+  }
+
+  // No free slots or no memory
+  client->onDisconnect([](void *arg, AsyncClient *client) { delete client; }, NULL);
+  client->close(true);
+}
+
+//
+// Start TCP servers (call once the network is up)
+//
+void remoteTcpInit()
+{
+  rigCtlServer.onClient(remoteTcpOnClient, (void *)(uintptr_t)REMOTE_TCP_RIGCTL_PORT);
+  adHocServer.onClient(remoteTcpOnClient, (void *)(uintptr_t)REMOTE_TCP_ADHOC_PORT);
+  rigCtlServer.begin();
+  adHocServer.begin();
+}
+
+//
+// Main loop: take new and closed clients from the network task,
+// returns true if the client is served
+//
+static bool remoteTcpCheck(TcpClient *c)
+{
+  switch(c->status.load(std::memory_order_acquire))
+  {
+    case TCP_OPEN:
+      if(c->activate()) return(true);
+      // Disconnected before it was served
+      c->release();
+      return(false);
+
+    case TCP_ACTIVE:
+      return(true);
+
+    case TCP_CLOSED:
+      c->release();
+      return(false);
+  }
+
+  return(false);
+}
+
+//
+// Stop TCP servers and disconnect all clients, the main loop frees
+// them once they are gone
+//
+void remoteTcpStop()
+{
+  rigCtlServer.end();
+  adHocServer.end();
+
+  for(int i=0 ; i<REMOTE_TCP_CLIENTS ; i++)
+  {
+    TcpClient *c = &tcpClients[i];
+    if(remoteTcpCheck(c)) c->abort();
+  }
+}
+
+//
+// Receive and execute commands from the network clients. Returns once
+// a command produces remote events, so that they are not merged.
+//
+int remoteTcpDoCommand()
+{
+  static uint8_t next = 0;
+
+  // Serve clients in turn
+  for(int i=0 ; i<REMOTE_TCP_CLIENTS ; i++)
+  {
+    TcpClient *c = &tcpClients[next];
+    next = (next + 1) % REMOTE_TCP_CLIENTS;
+
+    if(!remoteTcpCheck(c)) continue;
+    if(c->acked.exchange(false, std::memory_order_acquire)) c->send();
+
+    if(c->closing) continue;
+
+    // Also drops incomplete commands after a timeout
+    int event = remoteDoInput(c, &c->state, c->rigCtl);
+
+    if(event & REMOTE_CLOSE) c->closing = true;
+    c->send();
+
+    event &= ~REMOTE_CLOSE;
+    if(event)
+    {
+      metricCommands.add();
+      return(event);
+    }
+  }
+
+  return(0);
+}
+
+//
+// Send periodic status and telemetry to the ad hoc clients, disconnect
+// clients that do not take their output
+//
+void remoteTcpTickTime()
+{
+  for(int i=0 ; i<REMOTE_TCP_CLIENTS ; i++)
+  {
+    TcpClient *c = &tcpClients[i];
+    if(!remoteTcpCheck(c) || c->closing) continue;
+
+    if(c->stalled())
+      c->abort();
+    else if(!c->rigCtl && !c->pending())
+    {
+      remoteTickTime(c, &c->state);
+      c->send();
+    }
+  }
+}
@@ -0,0 +1,35 @@
+#ifndef REMOTE_TCP_H
+#define REMOTE_TCP_H
+
+#include <Arduino.h>
+
+//
+// Remote control over TCP. Hamlib rigctld clients connect to
+// REMOTE_TCP_RIGCTL_PORT, the ad hoc serial commands are served on
+// REMOTE_TCP_ADHOC_PORT. Each connection has its own RemoteState.
+// The network task puts received data into the client buffer, the main
+// loop reads and executes the commands and buffers the replies. Data is
+// acknowledged once the main loop has read it, so a client can not
+// send more than the buffer takes. Replies are sent as the client
+// acknowledges them, a client that stops reading is disconnected.
+//
+
+#define REMOTE_TCP_RIGCTL_PORT 4532  // Hamlib rigctld port
+#define REMOTE_TCP_ADHOC_PORT  4534  // Ad hoc commands port
+#define REMOTE_TCP_CLIENTS        4  // Largest number of connected clients
+#define REMOTE_TCP_OUTPUT (256 * 1024) // Reply buffer per client, holds a screenshot (bytes)
+#define REMOTE_TCP_TIMEOUT     2000  // Send timeout (ms)
+
+// Received data buffer per client, takes a full TCP window
+#ifdef CONFIG_LWIP_TCP_WND_DEFAULT
+#define REMOTE_TCP_BUFFER CONFIG_LWIP_TCP_WND_DEFAULT
+#else
+#define REMOTE_TCP_BUFFER      5760
+#endif
+
+void remoteTcpInit();
+void remoteTcpStop();
+int remoteTcpDoCommand();
+void remoteTcpTickTime();
+
+#endif // REMOTE_TCP_H
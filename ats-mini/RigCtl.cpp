@@ -0,0 +1,367 @@
+#include "Common.h"
+#include "Utils.h"
+#include "Menu.h"
+#include "RigCtl.h"
+#include <stdarg.h>
+
+#define RIGCTL_MAX_ARGS 3
+
+// Hamlib mode, VFO and level bits used by \dump_state
+#define RIG_MODE_AM     0x01
+#define RIG_MODE_USB    0x04
+#define RIG_MODE_LSB    0x08
+#define RIG_MODE_FM     0x20
+#define RIG_MODE_WFM    0x40
+#define RIG_VFO_A       0x01
+#define RIG_ANT_1       0x01
+#define RIG_LEVEL_ATT      (1UL << 1)
+#define RIG_LEVEL_AF       (1UL << 3)
+#define RIG_LEVEL_SQL      (1UL << 5)
+#define RIG_LEVEL_AGC      (1UL << 17)
+#define RIG_LEVEL_RAWSTR   (1UL << 26)
+#define RIG_LEVEL_STRENGTH (1UL << 30)
+
+// Hamlib AGC level values
+#define RIG_AGC_OFF     0
+#define RIG_AGC_AUTO    6
+
+//
+// Response being sent
+//
+typedef struct
+{
+  Stream *stream;
+  bool ext;  // Extended response, with labels
+  char sep;  // Extended response separator
+} RigCtlReply;
+
+//
+// Command table entry
+//
+typedef struct
+{
+  char cmd;          // Short command, 0 if none
+  const char *name;  // Long command (without the backslash)
+  uint8_t args;      // Number of required arguments
+  bool set;          // Replies with RPRT even if successful
+  int (*handler)(RigCtlReply *reply, char **argv);
+} RigCtlCommand;
+
+//
+// Send a (labeled) response value
+//
+static void rigCtlValue(RigCtlReply *reply, const char *label, const char *format, ...)
+{
+  char buf[64];
+  va_list args;
+
+  va_start(args, format);
+  vsnprintf(buf, sizeof(buf), format, args);
+  va_end(args);
+
+  if(reply->ext) reply->stream->printf("%s: ", label);
+  reply->stream->print(buf);
+  reply->stream->print(reply->ext ? reply->sep : '\n');
+}
+
+//
+// Get current filter bandwidth in Hz
+//
+static int rigCtlPassband()
+{
+  // Bandwidths are named "2.2k", except the automatic FM filter
+  int width = atof(getCurrentBandwidth()->desc) * 1000;
+  return(width ? width : currentMode == FM ? 110000 : 0);
+}
+
+static int rigCtlGetFreq(RigCtlReply *reply, char **argv)
+{
+  rigCtlValue(reply, "Frequency", "%lu", (unsigned long)getCurrentFrequencyHz());
+  return(RIG_OK);
+}
+
+static int rigCtlSetFreq(RigCtlReply *reply, char **argv)
+{
+  char *end;
+  double freq = strtod(argv[0], &end);
+
+  if(end == argv[0] || freq < 0 || freq > UINT32_MAX) return(RIG_EINVAL);
+  return(tuneToFrequency(freq, true) ? RIG_OK : RIG_EINVAL);
+}
+
+static int rigCtlGetMode(RigCtlReply *reply, char **argv)
+{
+  rigCtlValue(reply, "Mode", "%s", bandModeDesc[currentMode]);
+  rigCtlValue(reply, "Passband", "%d", rigCtlPassband());
+  return(RIG_OK);
+}
+
+static int rigCtlSetMode(RigCtlReply *reply, char **argv)
+{
+  // Passband is ignored, use the Bandwidth setting instead
+  for(int i=0 ; i<getTotalModes() ; i++)
+    if(!strcmp(argv[0], bandModeDesc[i]))
+      return(selectMode(i) ? RIG_OK : RIG_EINVAL);
+
+  // Broadcast FM is wide FM for Hamlib
+  if(!strcmp(argv[0], "WFM")) return(selectMode(FM) ? RIG_OK : RIG_EINVAL);
+
+  return(RIG_EINVAL);
+}
+
+static int rigCtlGetVfo(RigCtlReply *reply, char **argv)
+{
+  rigCtlValue(reply, "VFO", "VFOA");
+  return(RIG_OK);
+}
+
+static int rigCtlSetVfo(RigCtlReply *reply, char **argv)
+{
+  // There is only one VFO
+  const char *vfo = argv[0];
+  return(!strcmp(vfo, "VFOA") || !strcmp(vfo, "currVFO") || !strcmp(vfo, "Main") ? RIG_OK : RIG_EINVAL);
+}
+
+static int rigCtlGetPtt(RigCtlReply *reply, char **argv)
+{
+  rigCtlValue(reply, "PTT", "0");
+  return(RIG_OK);
+}
+
+static int rigCtlSetPtt(RigCtlReply *reply, char **argv)
+{
+  // Receive only
+  return(atoi(argv[0]) ? RIG_ENAVAIL : RIG_OK);
+}
+
+static int rigCtlGetSplit(RigCtlReply *reply, char **argv)
+{
+  rigCtlValue(reply, "Split", "0");
+  rigCtlValue(reply, "TX VFO", "VFOA");
+  return(RIG_OK);
+}
+
+static int rigCtlSetSplit(RigCtlReply *reply, char **argv)
+{
+  return(atoi(argv[0]) ? RIG_ENAVAIL : RIG_OK);
+}
+
+static int rigCtlGetLevel(RigCtlReply *reply, char **argv)
+{
+  const char *level = argv[0];
+
+  if(!strcmp(level, "?"))
+    rigCtlValue(reply, "Level", "ATT AF SQL AGC RAWSTR STRENGTH");
+  else if(!strcmp(level, "AF"))
+    rigCtlValue(reply, level, "%f", volume / 63.0);
+  else if(!strcmp(level, "SQL"))
+    rigCtlValue(reply, level, "%f", currentSquelch / 127.0);
+  else if(!strcmp(level, "ATT"))
+    rigCtlValue(reply, level, "%d", agcNdx);
+  else if(!strcmp(level, "AGC"))
+    rigCtlValue(reply, level, "%d", agcIdx ? RIG_AGC_OFF : RIG_AGC_AUTO);
+  else if(!strcmp(level, "RAWSTR"))
+    rigCtlValue(reply, level, "%d", rssi);
+  else if(!strcmp(level, "STRENGTH"))
+    // S9 is 34dBuV on HF and 14dBuV on VHF (50 Ohm)
+    rigCtlValue(reply, level, "%d", rssi - (currentMode == FM ? 14 : 34));
+  else
+    return(RIG_EINVAL);
+
+  return(RIG_OK);
+}
+
+static int rigCtlSetLevel(RigCtlReply *reply, char **argv)
+{
+  const char *level = argv[0];
+  char *end;
+  float value = strtof(argv[1], &end);
+
+  if(!strcmp(level, "?"))
+  {
+    rigCtlValue(reply, "Level", "ATT AF SQL AGC");
+    return(RIG_OK);
+  }
+
+  if(end == argv[1]) return(RIG_EINVAL);
+
+  if(!strcmp(level, "AF"))
+  {
+    if(value < 0 || value > 1) return(RIG_EINVAL);
+    doVolume(lroundf(value * 63) - volume);
+  }
+  else if(!strcmp(level, "SQL"))
+  {
+    if(value < 0 || value > 1) return(RIG_EINVAL);
+    doSquelch(lroundf(value * 127) - currentSquelch);
+  }
+  else if(!strcmp(level, "ATT"))
+  {
+    // Attenuation index n is agcIdx n + 1, zero keeps the AGC state
+    int idx = value > 0 ? (int)value + 1 : agcIdx > 1 ? 1 : agcIdx;
+    if(value < 0 || idx > getLastAgc()) return(RIG_EINVAL);
+    doAgc(idx - agcIdx);
+  }
+  else if(!strcmp(level, "AGC"))
+  {
+    // Only on (automatic) and off
+    if(value == RIG_AGC_AUTO) doAgc(-agcIdx);
+    else if(value == RIG_AGC_OFF) { if(!agcIdx) doAgc(1); }
+    else return(RIG_EINVAL);
+  }
+  else
+    // Unknown or read only level
+    return(RIG_EINVAL);
+
+  return(RIG_OK);
+}
+
+static int rigCtlGetInfo(RigCtlReply *reply, char **argv)
+{
+  rigCtlValue(reply, "Info", "%s %s F/W %d.%02d", RECEIVER_NAME, RECEIVER_DESC, VER_APP / 100, VER_APP % 100);
+  return(RIG_OK);
+}
+
+static int rigCtlGetPowerStat(RigCtlReply *reply, char **argv)
+{
+  rigCtlValue(reply, "Power Status", "1");
+  return(RIG_OK);
+}
+
+static int rigCtlChkVfo(RigCtlReply *reply, char **argv)
+{
+  // Commands do not take a VFO argument
+  rigCtlValue(reply, "ChkVFO", "0");
+  return(RIG_OK);
+}
+
+//
+// Describe the receiver to the Hamlib NET rigctl backend
+// (protocol version 1, with the key=value tail)
+//
+static int rigCtlDumpState(RigCtlReply *reply, char **argv)
+{
+  Stream *stream = reply->stream;
+  const int hfModes = RIG_MODE_AM | RIG_MODE_USB | RIG_MODE_LSB;
+  const int fmModes = RIG_MODE_FM | RIG_MODE_WFM;
+  const unsigned long levels = RIG_LEVEL_ATT | RIG_LEVEL_AF | RIG_LEVEL_SQL | RIG_LEVEL_AGC;
+
+  // Protocol version, rig model, ITU region
+  stream->print("1\n2\n1\n");
+
+  // Receive ranges: start, end, modes, low power, high power, VFOs, antennas
+  stream->printf("150000.000000 30000000.000000 0x%x -1 -1 0x%x 0x%x\n", hfModes, RIG_VFO_A, RIG_ANT_1);
+  stream->printf("64000000.000000 108000000.000000 0x%x -1 -1 0x%x 0x%x\n", fmModes, RIG_VFO_A, RIG_ANT_1);
+  stream->print("0 0 0 0 0 0 0\n");
+
+  // No transmit ranges
+  stream->print("0 0 0 0 0 0 0\n");
+
+  // Tuning steps
+  stream->printf("0x%x 10\n0x%x 1000\n0x%x 10000\n0 0\n", RIG_MODE_USB | RIG_MODE_LSB, RIG_MODE_AM, fmModes);
+
+  // Filters (widest, narrowest)
+  stream->printf("0x%x 3000\n0x%x 500\n", RIG_MODE_USB | RIG_MODE_LSB, RIG_MODE_USB | RIG_MODE_LSB);
+  stream->printf("0x%x 6000\n0x%x 1000\n", RIG_MODE_AM, RIG_MODE_AM);
+  stream->printf("0x%x 110000\n0x%x 40000\n0 0\n", fmModes, fmModes);
+
+  // Max RIT, XIT, IF shift, announces, preamps, attenuators
+  stream->print("0\n0\n0\n0\n\n\n");
+
+  // Functions (get, set), levels (get, set), parameters (get, set)
+  stream->printf("0x0\n0x0\n0x%lx\n0x%lx\n0x0\n0x0\n", levels | RIG_LEVEL_RAWSTR | RIG_LEVEL_STRENGTH, levels);
+
+  stream->print("vfo_ops=0x0\nptt_type=0x0\ntargetable_vfo=0x0\n");
+  stream->print("has_set_vfo=1\nhas_get_vfo=1\nhas_set_freq=1\nhas_get_freq=1\n");
+  stream->print("has_set_conf=0\nhas_get_conf=0\nhas_power2mW=0\nhas_mW2power=0\n");
+  stream->print("timeout=1000\nrig_model=2\ndone\n");
+  return(RIG_OK);
+}
+
+//
+// Supported commands, short and long names as in Hamlib rigctld
+//
+static const RigCtlCommand rigCtlCommands[] =
+{
+  { 'F',  "set_freq",      1, true,  rigCtlSetFreq },
+  { 'f',  "get_freq",      0, false, rigCtlGetFreq },
+  { 'M',  "set_mode",      1, true,  rigCtlSetMode },
+  { 'm',  "get_mode",      0, false, rigCtlGetMode },
+  { 'V',  "set_vfo",       1, true,  rigCtlSetVfo },
+  { 'v',  "get_vfo",       0, false, rigCtlGetVfo },
+  { 'T',  "set_ptt",       1, true,  rigCtlSetPtt },
+  { 't',  "get_ptt",       0, false, rigCtlGetPtt },
+  { 'S',  "set_split_vfo", 2, true,  rigCtlSetSplit },
+  { 's',  "get_split_vfo", 0, false, rigCtlGetSplit },
+  { 'L',  "set_level",     2, true,  rigCtlSetLevel },
+  { 'l',  "get_level",     1, false, rigCtlGetLevel },
+  { '_',  "get_info",      0, false, rigCtlGetInfo },
+  { 0,    "get_powerstat", 0, false, rigCtlGetPowerStat },
+  { 0,    "chk_vfo",       0, false, rigCtlChkVfo },
+  { 0,    "dump_state",    0, false, rigCtlDumpState },
+};
+
+static const RigCtlCommand *rigCtlFind(const char *name)
+{
+  for(unsigned int i=0 ; i<ITEM_COUNT(rigCtlCommands) ; i++)
+  {
+    const RigCtlCommand *cmd = &rigCtlCommands[i];
+    if(name[0] == '\\' ? !strcmp(name + 1, cmd->name) : !name[1] && name[0] == cmd->cmd)
+      return(cmd);
+  }
+
+  return(NULL);
+}
+
+//
+// Execute a single command line, returns remote events
+//
+int rigCtlExecute(Stream* stream, char *line)
+{
+  RigCtlReply reply = { stream, false, '\n' };
+  char *argv[RIGCTL_MAX_ARGS + 1] = { 0 };
+  int argc = 0;
+
+  // Extended response prefix
+  if(line[0] && strchr("+;|,", line[0]))
+  {
+    reply.ext = true;
+    reply.sep = line[0] == '+' ? '\n' : line[0];
+    line++;
+  }
+
+  // Short commands may be followed by arguments without a space
+  char *name = strtok(line, " \t");
+  if(!name) return(0);
+  char shortArg[2] = { name[0], '\0' };
+  if(name[0] != '\\' && name[1])
+  {
+    argv[argc++] = name + 1;
+    name = shortArg;
+  }
+
+  while(argc < RIGCTL_MAX_ARGS && (argv[argc] = strtok(NULL, " \t"))) argc++;
+
+  // Quit only makes sense for network connections, there is no response
+  if(!strcmp(name, "q") || !strcmp(name, "Q") || !strcmp(name, "\\quit")) return(REMOTE_CLOSE);
+
+  const RigCtlCommand *cmd = rigCtlFind(name);
+  int result = !cmd ? RIG_ENIMPL : argc < cmd->args ? RIG_EINVAL : RIG_OK;
+
+  if(reply.ext)
+  {
+    // Echo the command and its arguments
+    stream->printf("%s:", cmd ? cmd->name : name);
+    for(int i=0 ; i<argc ; i++) stream->printf(" %s", argv[i]);
+    stream->print(reply.sep);
+  }
+
+  if(result == RIG_OK) result = cmd->handler(&reply, argv);
+
+  // Successful get commands only send the values, unless extended
+  if(reply.ext || result != RIG_OK || cmd->set)
+    stream->printf("RPRT %d\n", result);
+
+  // Changing settings requires a redraw and saving preferences
+  return(cmd && cmd->set && result == RIG_OK ? REMOTE_CHANGED | REMOTE_PREFS : 0);
+}
@@ -0,0 +1,24 @@
+#ifndef RIGCTL_H
+#define RIGCTL_H
+
+#include <Arduino.h>
+
+//
+// Hamlib rigctld (NET rigctl, model 2) protocol. Commands are text
+// lines, either a short single character command ("f") or a long
+// command ("\get_freq"), followed by space separated arguments. A
+// leading '+' asks for an extended response with labels, one per line,
+// while ';', '|' or ',' put the labeled response on one line, separated
+// with that character.
+//
+
+// Hamlib error codes, sent as "RPRT <code>"
+#define RIG_OK        0
+#define RIG_EINVAL   -1  // Invalid parameter
+#define RIG_ENIMPL   -4  // Function not implemented
+#define RIG_EPROTO   -8  // Protocol error
+#define RIG_ENAVAIL -11  // Function not available
+
+int rigCtlExecute(Stream* stream, char *line);
+
+#endif // RIGCTL_H
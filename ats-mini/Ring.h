@@ -0,0 +1,152 @@
+#ifndef RING_H
+#define RING_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <atomic>
+
+//
+// Lock-free command ring. Any number of tasks (web server, network)
+// post commands, a single consumer (the main loop) takes them out in
+// order at a point where it is safe to touch the radio.
+//
+// Every cell has a sequence number telling who owns it: a producer
+// claiming position P waits for the sequence to be P, publishes the
+// command by setting it to P+1, and the consumer frees the cell for
+// the next round by setting it to P+SIZE. Posting never blocks.
+//
+// push() can return a ticket that tells the producer when its
+// commands have been executed, see finished() and wait(). A waiting
+// producer sleeps until the consumer notifies it.
+//
+template <typename T, uint32_t SIZE>
+class CommandRing
+{
+  static_assert(SIZE && !(SIZE & (SIZE - 1)), "Ring size must be a power of two");
+
+  public:
+    CommandRing()
+    {
+      for(uint32_t i=0 ; i<SIZE ; i++)
+        cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    //
+    // Producer: post count commands, all of them or none. Returns
+    // false if there is no room.
+    //
+    bool push(const T *items, uint32_t count = 1, uint32_t *ticket = NULL)
+    {
+      uint32_t pos = head.load(std::memory_order_relaxed);
+
+      if(count > SIZE) return(false);
+
+      // Nothing to post, the ticket covers what is posted already
+      if(!count)
+      {
+        if(ticket) *ticket = pos;
+        return(true);
+      }
+
+      for(;;)
+      {
+        // The consumer frees cells in order, so if the last cell
+        // needed is free, all of them are
+        uint32_t last = pos + count - 1;
+        int32_t diff = (int32_t)(cells[last & (SIZE - 1)].seq.load(std::memory_order_acquire) - last);
+
+        if(diff < 0) return(false);
+        if(diff > 0)
+          pos = head.load(std::memory_order_relaxed);
+        else if(head.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed))
+          break;
+      }
+
+      for(uint32_t i=0 ; i<count ; i++)
+      {
+        Cell *c = &cells[(pos + i) & (SIZE - 1)];
+        c->item = items[i];
+        c->seq.store(pos + i + 1, std::memory_order_release);
+      }
+
+      if(ticket) *ticket = pos + count;
+      return(true);
+    }
+
+    //
+    // Consumer: next command, or NULL if there is none (yet). The
+    // command stays in the ring until pop().
+    //
+    T *front()
+    {
+      uint32_t pos = tail.load(std::memory_order_relaxed);
+      Cell *c = &cells[pos & (SIZE - 1)];
+
+      if(c->seq.load(std::memory_order_acquire) != pos + 1) return(NULL);
+      return(&c->item);
+    }
+
+    //
+    // Consumer: done with the command returned by front()
+    //
+    void pop()
+    {
+      uint32_t pos = tail.load(std::memory_order_relaxed);
+
+      cells[pos & (SIZE - 1)].seq.store(pos + SIZE, std::memory_order_release);
+      tail.store(pos + 1, std::memory_order_seq_cst);
+
+      // Wake up the producer waiting for this command
+      TaskHandle_t task = waiter.load(std::memory_order_seq_cst);
+      if(task && waitTicket.load(std::memory_order_relaxed) == pos + 1)
+        xTaskNotifyGive(task);
+    }
+
+    //
+    // Producer: true once all commands up to the ticket are done
+    //
+    bool finished(uint32_t ticket)
+    {
+      return((int32_t)(tail.load(std::memory_order_seq_cst) - ticket) >= 0);
+    }
+
+    //
+    // Producer: wait for the ticket, at most timeout ms. Must not be
+    // called by the consumer, only one task can wait at a time.
+    //
+    bool wait(uint32_t ticket, uint32_t timeout)
+    {
+      TickType_t start = xTaskGetTickCount();
+
+      // Register before checking the ticket: either the check sees
+      // the commands done, or pop() sees the waiter and notifies it
+      waitTicket.store(ticket, std::memory_order_relaxed);
+      waiter.store(xTaskGetCurrentTaskHandle(), std::memory_order_seq_cst);
+
+      while(!finished(ticket))
+      {
+        TickType_t passed = xTaskGetTickCount() - start;
+        if(passed >= pdMS_TO_TICKS(timeout)) break;
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeout) - passed);
+      }
+
+      waiter.store(NULL, std::memory_order_relaxed);
+      return(finished(ticket));
+    }
+
+  private:
+    struct Cell
+    {
+      std::atomic<uint32_t> seq;
+      T item;
+    };
+
+    Cell cells[SIZE];
+    std::atomic<uint32_t> head{0};  // Next position for the producers
+    std::atomic<uint32_t> tail{0};  // Next position for the consumer
+    std::atomic<TaskHandle_t> waiter{NULL};  // Producer waiting for a ticket
+    std::atomic<uint32_t> waitTicket{0};
+};
+
+#endif // RING_H
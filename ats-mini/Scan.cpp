@@ -1,6 +1,7 @@
 #include "Common.h"
 #include "Utils.h"
 #include "Menu.h"
+#include "Metrics.h"
 
 // Tuning delays after rx.setFrequency()
 #define TUNE_DELAY_DEFAULT 30
@@ -31,6 +32,9 @@ static uint8_t  scanMaxRSSI;
 static uint8_t  scanMinSNR;
 static uint8_t  scanMaxSNR;
 
+static Metric metricScans("atsmini_scans_total", "Band scans", METRIC_COUNTER);
+static Metric metricScanPoints("atsmini_scan_points_total", "Frequencies measured by band scans", METRIC_COUNTER);
+
 static inline uint8_t min(uint8_t a, uint8_t b) { return(a<b? a:b); }
 static inline uint8_t max(uint8_t a, uint8_t b) { return(a>b? a:b); }
 
@@ -110,6 +114,7 @@ static bool scanTickTime()
   rx.getCurrentReceivedSignalQuality();
   scanData[scanCount].rssi = rx.getCurrentRSSI();
   scanData[scanCount].snr  = rx.getCurrentSNR();
+  metricScanPoints.add();
 
   // Measure range of values
   scanMinRSSI = min(scanData[scanCount].rssi, scanMinRSSI);
@@ -147,6 +152,7 @@ void scanRun(uint16_t centerFreq, uint16_t step)
   // Save current frequency
   uint16_t curFreq = rx.getFrequency();
   // Scan the whole range
+  metricScans.add();
   for(scanInit(centerFreq, step) ; scanTickTime(););
   // Restore current frequency
   rx.setFrequency(curFreq);
@@ -0,0 +1,618 @@
+#include "Common.h"
+#include "Utils.h"
+#include "Remote.h"
+#include "RigCtl.h"
+#include "Script.h"
+#include <LittleFS.h>
+
+#define OP_WAIT    0
+#define OP_AT      1
+#define OP_REPEAT  2
+#define OP_END     3
+#define OP_RIG     4
+#define OP_KEY     5
+#define OP_PRINT   6
+#define OP_STOP    7
+
+// Statement keywords, indexed by OP_*
+static const char *scriptOps[] = { "wait", "at", "repeat", "end", "rig", "key", "print", "stop" };
+
+typedef struct
+{
+  uint8_t op;
+  uint16_t line;    // Source line number
+  uint32_t value;   // Wait (ms), time of day (s), repeat count or loop start
+  const char *text; // Command or text argument
+} ScriptStatement;
+
+//
+// Script output, written to the log file up to SCRIPT_MAX_LOG bytes
+//
+class ScriptLog : public Stream
+{
+  public:
+    fs::File file;
+    bool dirty = false;
+
+    int available() override { return(0); }
+    int read() override { return(-1); }
+    int peek() override { return(-1); }
+
+    size_t write(uint8_t c) override { return(write(&c, 1)); }
+
+    size_t write(const uint8_t *data, size_t size) override
+    {
+      if(!file || file.size() + size > SCRIPT_MAX_LOG) return(0);
+      dirty = true;
+      return(file.write(data, size));
+    }
+};
+
+// Running script
+static char scriptText[SCRIPT_MAX_SIZE + 1];
+static ScriptStatement scriptCode[SCRIPT_MAX_LINES];
+static uint16_t scriptLength = 0;
+static uint16_t scriptPC = 0;
+static bool scriptOn = false;
+static bool scriptInStep = false;
+static bool scriptWaiting = false;
+static uint32_t scriptWaitStart;
+static uint32_t scriptWaitTime;
+static uint32_t scriptAtTime;
+static uint32_t scriptStartTime;
+static uint32_t scriptFlushTime;
+static uint32_t scriptLoops[SCRIPT_MAX_DEPTH];
+static uint8_t scriptDepth = 0;
+static RemoteState scriptRemote;
+static ScriptLog scriptLog;
+
+// Script being uploaded
+static char uploadText[SCRIPT_MAX_SIZE + 1];
+static uint16_t uploadLength;
+static uint16_t uploadLine;  // Characters in the current line
+static char uploadFirst;     // First character of the current line
+static bool uploadOverflow;
+static bool uploadStarted;   // Skip the rest of the "xu" command line ending
+static const void *uploadOwner = NULL;
+static uint32_t uploadTime;
+
+// Requests from the web server
+static volatile uint8_t scriptRequest = 0;
+
+static bool scriptError(Print* out, uint16_t line, const char *message)
+{
+  if(out)
+  {
+    if(line) out->printf("\r\nError: Line %u: %s\r\n", line, message);
+    else out->printf("\r\nError: %s\r\n", message);
+  }
+  return(false);
+}
+
+static bool isLineEnd(char c)
+{
+  return(!c || c == '\n' || c == '\r');
+}
+
+static const char *skipSpaces(const char *p)
+{
+  while(*p == ' ' || *p == '\t') p++;
+  return(p);
+}
+
+//
+// Parse wait time with an optional unit (ms, s, m, h)
+//
+static bool scriptParseTime(const char *p, uint32_t *ms)
+{
+  if(!isdigit(*p)) return(false);
+
+  char *end;
+  uint32_t value = strtoul(p, &end, 10);
+  uint32_t unit  = 1000;
+
+  if(!strncmp(end, "ms", 2))  { unit = 1; end += 2; }
+  else if(*end == 's')        { end++; }
+  else if(*end == 'm')        { unit = 60000; end++; }
+  else if(*end == 'h')        { unit = 3600000; end++; }
+
+  // Longest wait is a bit over 49 days
+  if(value > 0xFFFFFFFF / unit) return(false);
+
+  *ms = value * unit;
+  return(isLineEnd(*skipSpaces(end)));
+}
+
+//
+// Parse time of day (HH:MM or HH:MM:SS) to seconds
+//
+static bool scriptParseClock(const char *p, uint32_t *seconds)
+{
+  uint32_t v[3] = { 0, 0, 0 };
+  int n;
+
+  for(n=0 ; n<3 ; n++)
+  {
+    if(!isdigit(p[0]) || !isdigit(p[1])) return(false);
+    v[n] = (p[0] - '0') * 10 + p[1] - '0';
+    p += 2;
+    if(*p != ':') break;
+    p++;
+  }
+
+  if(n < 1 || n > 2 || v[0] > 23 || v[1] > 59 || v[2] > 59) return(false);
+
+  *seconds = v[0] * 3600 + v[1] * 60 + v[2];
+  return(isLineEnd(*skipSpaces(p)));
+}
+
+//
+// Compile script text into statements, or only check it when code is
+// NULL. Does not modify the text, the arguments run to the line ends.
+//
+static bool scriptCompile(const char *text, ScriptStatement *code, uint16_t *length, Print* out)
+{
+  uint16_t stack[SCRIPT_MAX_DEPTH];
+  uint8_t depth = 0;
+  uint16_t count = 0;
+  uint16_t line = 0;
+
+  for(const char *p = text ; *p ; )
+  {
+    const char *start = skipSpaces(p);
+    ScriptStatement st = { 0, ++line, 0, NULL };
+
+    // Find the next line
+    for(p = start ; *p && *p != '\n' ; p++);
+    if(*p) p++;
+
+    // Skip empty lines and comments
+    if(isLineEnd(*start) || *start == '#') continue;
+
+    // Find the keyword
+    size_t len;
+    for(len = 0 ; isalpha(start[len]) ; len++);
+    for(st.op = 0 ; st.op < ITEM_COUNT(scriptOps) ; st.op++)
+      if(len == strlen(scriptOps[st.op]) && !strncasecmp(start, scriptOps[st.op], len)) break;
+
+    const char *args = skipSpaces(start + len);
+    bool noArgs = isLineEnd(*args);
+
+    if(st.op >= ITEM_COUNT(scriptOps) || (args == start + len && !noArgs))
+      return(scriptError(out, line, "Unknown statement"));
+    if(count >= SCRIPT_MAX_LINES)
+      return(scriptError(out, line, "Too many statements"));
+
+    switch(st.op)
+    {
+      case OP_WAIT:
+        if(!scriptParseTime(args, &st.value))
+          return(scriptError(out, line, "Invalid time"));
+        break;
+
+      case OP_AT:
+        if(!scriptParseClock(args, &st.value))
+          return(scriptError(out, line, "Invalid time of day"));
+        break;
+
+      case OP_REPEAT:
+        if(!noArgs)
+        {
+          char *end;
+          st.value = strtoul(args, &end, 10);
+          if(end == args || !st.value || !isLineEnd(*skipSpaces(end)))
+            return(scriptError(out, line, "Invalid repeat count"));
+        }
+        if(depth >= SCRIPT_MAX_DEPTH)
+          return(scriptError(out, line, "Loops nested too deep"));
+        stack[depth++] = count;
+        break;
+
+      case OP_END:
+        if(!depth)
+          return(scriptError(out, line, "End without repeat"));
+        st.value = stack[--depth];
+        // Fall through
+      case OP_STOP:
+        if(!noArgs)
+          return(scriptError(out, line, "Unexpected argument"));
+        break;
+
+      case OP_RIG:
+      case OP_KEY:
+        if(noArgs)
+          return(scriptError(out, line, "Missing command"));
+        st.text = args;
+        break;
+
+      case OP_PRINT:
+        st.text = args;
+        break;
+    }
+
+    if(code) code[count] = st;
+    count++;
+  }
+
+  if(depth)
+    return(scriptError(out, line, "Repeat without end"));
+
+  if(length) *length = count;
+  return(true);
+}
+
+//
+// Check and store a new script
+//
+bool scriptSave(const char *text, Print* out)
+{
+  size_t length = strlen(text);
+  uint16_t count;
+
+  if(length > SCRIPT_MAX_SIZE)
+    return(scriptError(out, 0, "Script too large"));
+  if(!scriptCompile(text, NULL, &count, out))
+    return(false);
+
+  fs::File file = LittleFS.open(SCRIPT_PATH, "wb");
+  if(!file)
+    return(scriptError(out, 0, "Failed opening local storage"));
+
+  bool ok = file.write((const uint8_t *)text, length) == length;
+  file.close();
+
+  if(!ok)
+  {
+    LittleFS.remove(SCRIPT_PATH);
+    return(scriptError(out, 0, "Failed writing local storage"));
+  }
+
+  if(out) out->printf("\r\nScript saved, %u statements\r\n", count);
+  return(true);
+}
+
+//
+// Load the stored script and start executing it
+//
+bool scriptStart(Print* out)
+{
+  // Scripts can not control themselves
+  if(scriptInStep)
+    return(scriptError(out, 0, "Not allowed in a script"));
+
+  scriptStop();
+
+  fs::File file = LittleFS.open(SCRIPT_PATH, "rb");
+  if(!file)
+    return(scriptError(out, 0, "No script"));
+
+  size_t length = file.read((uint8_t *)scriptText, SCRIPT_MAX_SIZE);
+  file.close();
+  scriptText[length] = '\0';
+
+  if(!scriptCompile(scriptText, scriptCode, &scriptLength, out))
+    return(false);
+
+  // Terminate the arguments at the line ends
+  for(char *p = scriptText ; *p ; p++)
+    if(*p == '\n' || *p == '\r') *p = '\0';
+
+  scriptLog.file  = LittleFS.open(SCRIPT_LOG_PATH, "wb");
+  scriptLog.dirty = false;
+  scriptRemote    = RemoteState();
+  scriptPC        = 0;
+  scriptDepth     = 0;
+  scriptWaiting   = false;
+  scriptAtTime    = 0;
+  scriptStartTime = scriptFlushTime = millis();
+  scriptOn        = true;
+
+  if(out) out->printf("\r\nScript started, %u statements\r\n", scriptLength);
+  return(true);
+}
+
+//
+// Stop executing the script and close the log
+//
+void scriptStop()
+{
+  if(!scriptOn || scriptInStep) return;
+
+  scriptOn = false;
+  if(scriptPC < scriptLength)
+    scriptLog.printf("Script stopped at line %u\r\n", scriptCode[scriptPC].line);
+  else
+    scriptLog.print("Script finished\r\n");
+  scriptLog.file.close();
+}
+
+bool scriptRunning()
+{
+  return(scriptOn);
+}
+
+void scriptStatus(Print* out)
+{
+  if(!scriptOn)
+    out->print("\r\nScript stopped\r\n");
+  else if(scriptWaiting)
+    out->printf("\r\nScript waiting at line %u, %lu s left\r\n",
+      scriptCode[scriptPC].line,
+      (unsigned long)(scriptWaitTime - (millis() - scriptWaitStart)) / 1000);
+  else
+    out->printf("\r\nScript running at line %u\r\n", scriptCode[scriptPC].line);
+}
+
+static void scriptPrintFile(Print* out, const char *path)
+{
+  fs::File file = LittleFS.open(path, "rb");
+  uint8_t buf[64];
+  size_t n;
+
+  out->print("\r\n");
+  if(file)
+  {
+    while((n = file.read(buf, sizeof(buf))) > 0) out->write(buf, n);
+    file.close();
+  }
+  out->print("\r\n.\r\n");
+}
+
+//
+// Print the stored script and the log, terminated with a "." line
+//
+void scriptPrint(Print* out)
+{
+  scriptPrintFile(out, SCRIPT_PATH);
+}
+
+void scriptPrintLog(Print* out)
+{
+  if(scriptLog.file) scriptLog.file.flush();
+  scriptPrintFile(out, SCRIPT_LOG_PATH);
+}
+
+//
+// Print a line to the log, prefixed with UTC time or with the time
+// since the script started
+//
+static void scriptLogLine(const char *text)
+{
+  uint8_t h, m, s;
+
+  if(clockGetHMS(&h, &m, &s))
+    scriptLog.printf("%02u:%02u:%02u %s\r\n", h, m, s, text);
+  else
+    scriptLog.printf("+%lus %s\r\n", (unsigned long)(millis() - scriptStartTime) / 1000, text);
+}
+
+//
+// Wait till the given time has passed, returns true when done
+//
+static bool scriptWait(uint32_t ms)
+{
+  if(!scriptWaiting)
+  {
+    scriptWaiting   = true;
+    scriptWaitStart = millis();
+    scriptWaitTime  = ms;
+  }
+
+  if(millis() - scriptWaitStart < scriptWaitTime) return(false);
+
+  scriptWaiting = false;
+  return(true);
+}
+
+//
+// Get seconds left till the given time of day, false if the clock
+// has not been set yet
+//
+static bool scriptTimeLeft(uint32_t time, uint32_t *left)
+{
+  uint8_t h, m, s;
+
+  if(!clockGetHMS(&h, &m, &s)) return(false);
+
+  *left = (time + 86400 - (h * 3600 + m * 60 + s)) % 86400;
+
+  // Do not trigger twice in the same second
+  if(!*left && scriptAtTime && millis() - scriptAtTime < 2000) *left = 86400;
+  return(true);
+}
+
+//
+// Execute the current statement. Returns remote events, sets *wait
+// when the statement has to be executed again later.
+//
+static int scriptStep(bool *wait)
+{
+  const ScriptStatement *st = &scriptCode[scriptPC];
+  int event = 0;
+
+  *wait = false;
+
+  switch(st->op)
+  {
+    case OP_WAIT:
+      *wait = !scriptWait(st->value);
+      break;
+
+    case OP_AT:
+      {
+        uint32_t left = 0;
+
+        // Wait for the clock to be set
+        if(!scriptWaiting && !scriptTimeLeft(st->value, &left))
+        {
+          *wait = true;
+          break;
+        }
+
+        *wait = !scriptWait(left * 1000);
+        if(!*wait) scriptAtTime = millis();
+      }
+      break;
+
+    case OP_REPEAT:
+      scriptLoops[scriptDepth++] = st->value;
+      break;
+
+    case OP_END:
+      // Zero count repeats forever
+      if(!scriptLoops[scriptDepth - 1] || --scriptLoops[scriptDepth - 1])
+      {
+        scriptPC = st->value + 1;
+        return(0);
+      }
+      scriptDepth--;
+      break;
+
+    case OP_RIG:
+      {
+        char line[REMOTE_MAX_COMMAND];
+        strncpy(line, st->text, sizeof(line) - 1);
+        line[sizeof(line) - 1] = '\0';
+        event = rigCtlExecute(&scriptLog, line) & ~REMOTE_CLOSE;
+      }
+      break;
+
+    case OP_KEY:
+      for(const char *p = st->text ; *p ; p++)
+        event |= remoteDoCommand(&scriptLog, &scriptRemote, *p);
+      // Complete a command with arguments
+      if(scriptRemote.cmdLength)
+        event |= remoteDoCommand(&scriptLog, &scriptRemote, '\n');
+      break;
+
+    case OP_PRINT:
+      scriptLogLine(st->text);
+      break;
+
+    case OP_STOP:
+      scriptPC = scriptLength;
+      return(0);
+  }
+
+  if(!*wait) scriptPC++;
+  return(event);
+}
+
+//
+// Execute the script, does not block. Returns once a statement
+// produces remote events, so that they are not merged.
+//
+int scriptTickTime()
+{
+  int event = 0;
+
+  // Serve requests from the web server
+  switch(scriptRequest)
+  {
+    case 1: scriptStart(NULL); break;
+    case 2: scriptStop(); break;
+  }
+  scriptRequest = 0;
+
+  // Drop an abandoned upload
+  if(uploadOwner && millis() - uploadTime > SCRIPT_UPLOAD_TIMEOUT)
+    uploadOwner = NULL;
+
+  if(!scriptOn) return(0);
+
+  for(int i=0 ; !event && i<SCRIPT_MAX_STEPS && scriptPC<scriptLength ; i++)
+  {
+    bool wait;
+    scriptInStep = true;
+    event = scriptStep(&wait);
+    scriptInStep = false;
+    if(wait) break;
+  }
+
+  // Periodic status log and telemetry enabled with "key"
+  remoteTickTime(&scriptLog, &scriptRemote);
+
+  if(scriptPC >= scriptLength)
+    scriptStop();
+  else if(scriptLog.dirty && millis() - scriptFlushTime >= 1000)
+  {
+    // Keep the log on flash in case of power loss
+    scriptLog.file.flush();
+    scriptLog.dirty = false;
+    scriptFlushTime = millis();
+  }
+
+  return(event);
+}
+
+//
+// Ask the main loop to start or stop the script (web server)
+//
+void scriptRequestRun(bool run)
+{
+  scriptRequest = run ? 1 : 2;
+}
+
+//
+// Start receiving a script, terminated with a "." line
+//
+bool scriptUploadStart(const void *owner, Print* out)
+{
+  if(scriptInStep)
+    return(scriptError(out, 0, "Not allowed in a script"));
+  if(uploadOwner && uploadOwner != owner && millis() - uploadTime < SCRIPT_UPLOAD_TIMEOUT)
+    return(scriptError(out, 0, "Upload in progress"));
+
+  uploadOwner    = owner;
+  uploadTime     = millis();
+  uploadLength   = 0;
+  uploadLine     = 0;
+  uploadOverflow = false;
+  uploadStarted  = true;
+
+  out->print("\r\nSend the script, end with a \".\" line\r\n");
+  return(true);
+}
+
+bool scriptUploadActive(const void *owner)
+{
+  return(uploadOwner && uploadOwner == owner);
+}
+
+void scriptUploadChar(const void *owner, Print* out, char c)
+{
+  if(!scriptUploadActive(owner) || c == '\r') return;
+
+  uploadTime = millis();
+
+  if(uploadStarted)
+  {
+    uploadStarted = false;
+    if(c == '\n') return;
+  }
+
+  if(c != '\n')
+  {
+    if(!uploadLine++) uploadFirst = c;
+  }
+  else if(uploadLine == 1 && uploadFirst == '.')
+  {
+    // Done, drop the terminating "." line
+    uploadOwner = NULL;
+    if(uploadOverflow)
+      scriptError(out, 0, "Script too large");
+    else
+    {
+      uploadText[uploadLength - 1] = '\0';
+      scriptSave(uploadText, out);
+    }
+    return;
+  }
+  else
+    uploadLine = 0;
+
+  if(uploadLength < SCRIPT_MAX_SIZE)
+    uploadText[uploadLength++] = c;
+  else
+    uploadOverflow = true;
+}
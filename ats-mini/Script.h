@@ -0,0 +1,48 @@
+#ifndef SCRIPT_H
+#define SCRIPT_H
+
+#include <Arduino.h>
+
+//
+// Scripts of remote commands with waits, loops and clock triggers,
+// stored on LittleFS and executed by the main loop without blocking.
+// One statement per line:
+//
+//   # comment
+//   at 12:00        - wait until the given UTC time (HH:MM[:SS])
+//   wait 10m        - wait given time (ms, s, m or h, seconds by default)
+//   repeat 3        - repeat statements until "end" (forever without count)
+//   end
+//   rig F 5000000   - execute a RigCtl command
+//   key Vt          - execute ad hoc serial commands
+//   print text      - print text to the log, with the time
+//   stop            - stop the script
+//
+// The output of the commands goes to the script log file.
+//
+
+#define SCRIPT_PATH       "/script.txt"
+#define SCRIPT_LOG_PATH   "/script.log"
+#define SCRIPT_MAX_SIZE   4096   // Largest script (bytes)
+#define SCRIPT_MAX_LINES  256    // Largest number of statements
+#define SCRIPT_MAX_DEPTH  4      // Deepest nesting of repeat loops
+#define SCRIPT_MAX_LOG    65536  // Largest log file (bytes)
+#define SCRIPT_MAX_STEPS  16     // Statements executed per main loop pass
+#define SCRIPT_UPLOAD_TIMEOUT 30000 // Abandoned upload timeout (ms)
+
+bool scriptSave(const char *text, Print* out);
+bool scriptStart(Print* out);
+void scriptStop();
+void scriptRequestRun(bool run);
+bool scriptRunning();
+void scriptStatus(Print* out);
+void scriptPrint(Print* out);
+void scriptPrintLog(Print* out);
+int scriptTickTime();
+
+// Receiving a script over a remote connection, one character at a time
+bool scriptUploadStart(const void *owner, Print* out);
+bool scriptUploadActive(const void *owner);
+void scriptUploadChar(const void *owner, Print* out, char c);
+
+#endif // SCRIPT_H
@@ -3,6 +3,7 @@
 #include "Utils.h"
 #include "Menu.h"
 #include "EIBI.h"
+#include "Metrics.h"
 
 // CB frequency range
 #define MIN_CB_FREQUENCY 26060
@@ -223,6 +224,8 @@ static bool showRdsTime(const char *rdsTime)
   return(false);
 }
 
+static Metric metricRds("atsmini_rds_groups_total", "RDS groups received, sampled at each RDS check", METRIC_COUNTER);
+
 bool checkRds()
 {
   bool needRedraw = false;
@@ -232,6 +235,7 @@ bool checkRds()
 
   if(rx.getRdsReceived() && rx.getRdsSync() && rx.getRdsSyncFound())
   {
+    metricRds.add();
     needRedraw |= (mode & RDS_PS) && showStationName(rx.getRdsStationName());
     needRedraw |= (mode & RDS_RT) && showRadioText(rx.getRdsVersionCode()? rx.getRdsText2B() : rx.getRdsText2A());
     needRedraw |= (mode & RDS_PI) && showRdsPiCode(rx.getRdsPI());
@@ -2,12 +2,17 @@
 #include "Storage.h"
 #include "Themes.h"
 #include "Menu.h"
+#include "Metrics.h"
 #include <LittleFS.h>
 #include "nvs_flash.h"
+#include "esp_rom_crc.h"
 
 // Time of inactivity to start writing preferences
 #define STORE_TIME    10000
 
+// Each namespace keeps its record under this key
+#define RECORD_KEY    "Record"
+
 // Preferences saved here
 Preferences prefs;
 
@@ -15,6 +20,195 @@ static uint32_t itIsTimeToSave = 0;       // Preferences to save, or 0 for none
 static bool savingPrefsFlag    = false;   // TRUE: Saving preferences
 static uint32_t storeTime      = millis();
 
+static Metric metricSaves("atsmini_prefs_saves_total", "Preferences writes", METRIC_COUNTER);
+
+//
+// Settings, bands and memories are each stored as a single record: a
+// header followed by the packed data. A record of an older version is
+// brought up to date by the migration steps below, so that upgrades
+// keep user data. Records are only ever added to at the end, what is
+// missing from a shorter record keeps its default value.
+//
+typedef struct
+{
+  uint16_t version;       // VER_SETTINGS, VER_BANDS or VER_MEMORIES
+  uint16_t size;          // Data size
+  uint32_t crc;           // CRC32 of the data
+} RecordHeader;
+
+// Converts the data of one version to the next one, in place
+typedef struct
+{
+  uint16_t from;          // Version converted from
+  uint16_t to;            // Version converted to
+  bool (*migrate)(uint8_t *data, uint16_t *size, uint16_t capacity);
+} Migration;
+
+typedef struct __attribute__((packed))
+{
+  uint16_t app;           // Application version
+  uint8_t volume;         // Current volume
+  uint8_t band;           // Current band
+  uint8_t wifiMode;       // WiFi connection mode
+  uint16_t brightness;    // Brightness
+  int8_t fmAgc;           // FM AGC/ATTN
+  int8_t amAgc;           // AM AGC/ATTN
+  int8_t ssbAgc;          // SSB AGC/ATTN
+  int8_t amAvc;           // AM AVC
+  int8_t ssbAvc;          // SSB AVC
+  int8_t amSoftMute;      // AM soft mute
+  int8_t ssbSoftMute;     // SSB soft mute
+  uint16_t sleep;         // Sleep delay
+  uint8_t theme;          // Color theme
+  uint8_t rdsMode;        // RDS mode
+  uint8_t sleepMode;      // Sleep mode
+  uint8_t zoomMenu;       // TRUE: Zoom menu
+  uint8_t scrollDir;      // TRUE: Reverse scroll
+  uint8_t utcOffset;      // UTC Offset
+  uint8_t squelch;        // Squelch
+  uint8_t fmRegion;       // FM region
+  uint8_t uiLayout;       // UI Layout
+  uint8_t histZoom;       // Signal history zoom
+  uint8_t bleMode;        // Bluetooth mode
+  uint8_t usbMode;        // USB mode
+  uint8_t propRefresh;    // Solar/DX data refresh
+  int16_t latitude;       // Receiver location
+  int16_t longitude;
+} SavedSettings;
+
+typedef struct __attribute__((packed))
+{
+  uint8_t bandMode;       // Band mode (FM, AM, LSB, or USB)
+  uint16_t currentFreq;   // Current frequency
+  int8_t currentStepIdx;  // Current frequency step
+  int8_t bandwidthIdx;    // Index of the table bandwidthFM, bandwidthAM or bandwidthSSB;
+  int16_t usbCal;         // USB calibration value
+  int16_t lsbCal;         // LSB calibration value
+} SavedBand;
+
+//
+// Migrations from the earlier layout, with a key per setting, band and
+// memory slot. They run with the namespace open, and no record in it.
+//
+static bool migrateSettings71(uint8_t *data, uint16_t *size, uint16_t capacity)
+{
+  SavedSettings *s = (SavedSettings *)data;
+
+  if(capacity < sizeof(SavedSettings)) return(false);
+
+  s->app         = prefs.getUShort("App", s->app);
+  s->volume      = prefs.getUChar("Volume", s->volume);
+  s->band        = prefs.getUChar("Band", s->band);
+  s->wifiMode    = prefs.getUChar("WiFiMode", s->wifiMode);
+  s->brightness  = prefs.getUShort("Brightness", s->brightness);
+  s->fmAgc       = prefs.getUChar("FmAGC", s->fmAgc);
+  s->amAgc       = prefs.getUChar("AmAGC", s->amAgc);
+  s->ssbAgc      = prefs.getUChar("SsbAGC", s->ssbAgc);
+  s->amAvc       = prefs.getUChar("AmAVC", s->amAvc);
+  s->ssbAvc      = prefs.getUChar("SsbAVC", s->ssbAvc);
+  s->amSoftMute  = prefs.getUChar("AmSoftMute", s->amSoftMute);
+  s->ssbSoftMute = prefs.getUChar("SsbSoftMute", s->ssbSoftMute);
+  s->sleep       = prefs.getUShort("Sleep", s->sleep);
+  s->theme       = prefs.getUChar("Theme", s->theme);
+  s->rdsMode     = prefs.getUChar("RDSMode", s->rdsMode);
+  s->sleepMode   = prefs.getUChar("SleepMode", s->sleepMode);
+  s->zoomMenu    = prefs.getUChar("ZoomMenu", s->zoomMenu);
+  s->scrollDir   = prefs.getBool("ScrollDir", s->scrollDir);
+  s->utcOffset   = prefs.getUChar("UTCOffset", s->utcOffset);
+  s->squelch     = prefs.getUChar("Squelch", s->squelch);
+  s->fmRegion    = prefs.getUChar("FmRegion", s->fmRegion);
+  s->uiLayout    = prefs.getUChar("UILayout", s->uiLayout);
+  s->histZoom    = prefs.getUChar("HistZoom", s->histZoom);
+  s->bleMode     = prefs.getUChar("BLEMode", s->bleMode);
+  s->usbMode     = prefs.getUChar("USBMode", s->usbMode);
+  s->propRefresh = prefs.getUChar("PropRefresh", s->propRefresh);
+  s->latitude    = prefs.getShort("Latitude", s->latitude);
+  s->longitude   = prefs.getShort("Longitude", s->longitude);
+
+  *size = sizeof(SavedSettings);
+  return(true);
+}
+
+static bool migrateBands72(uint8_t *data, uint16_t *size, uint16_t capacity)
+{
+  // Not packed back then
+  struct
+  {
+    uint8_t bandMode;
+    uint16_t currentFreq;
+    int8_t currentStepIdx;
+    int8_t bandwidthIdx;
+    int16_t usbCal;
+    int16_t lsbCal;
+  } old;
+
+  SavedBand *b = (SavedBand *)data;
+  int count = capacity / sizeof(SavedBand);
+  char name[32];
+
+  // Bands that were not stored keep their defaults
+  for(int i=0 ; i<count ; i++)
+  {
+    sprintf(name, "Band-%d", i);
+    if(prefs.getBytes(name, &old, sizeof(old)) == sizeof(old))
+    {
+      b[i].bandMode       = old.bandMode;
+      b[i].currentFreq    = old.currentFreq;
+      b[i].currentStepIdx = old.currentStepIdx;
+      b[i].bandwidthIdx   = old.bandwidthIdx;
+      b[i].usbCal         = old.usbCal;
+      b[i].lsbCal         = old.lsbCal;
+    }
+  }
+
+  *size = count * sizeof(SavedBand);
+  return(true);
+}
+
+static bool migrateMemories71(uint8_t *data, uint16_t *size, uint16_t capacity)
+{
+  Memory *m = (Memory *)data;
+  int count = capacity / sizeof(Memory);
+  char name[32];
+
+  for(int i=0 ; i<count ; i++)
+  {
+    sprintf(name, "Memory-%d", i);
+    prefs.getBytes(name, &m[i], sizeof(m[i]));
+  }
+
+  *size = count * sizeof(Memory);
+  return(true);
+}
+
+static const Migration settingsMigrations[] =
+{
+  { 71, 72, migrateSettings71 },
+  { 0, 0, 0 }
+};
+
+static const Migration bandsMigrations[] =
+{
+  { 72, 73, migrateBands72 },
+  { 0, 0, 0 }
+};
+
+static const Migration memoriesMigrations[] =
+{
+  { 71, 72, migrateMemories71 },
+  { 0, 0, 0 }
+};
+
+// Shadow copies of the stored records, so that saving only writes
+// what has changed. A record is only compared once it is known to be
+// stored, after it has been loaded or written.
+static SavedSettings savedSettings;
+static SavedBand *savedBands       = NULL;
+static Memory savedMemories[MEMORY_COUNT];
+static bool settingsStored         = false;
+static bool bandsStored            = false;
+static bool memoriesStored         = false;
+
 // To store any change to preferences, we need at least STORE_TIME
 // milliseconds of inactivity.
 void prefsRequestSave(uint32_t what, bool now)
@@ -43,6 +237,16 @@ bool prefsAreWritten()
   return(result);
 }
 
+//
+// Forget what is stored, next save writes everything
+//
+static void prefsForget()
+{
+  settingsStored = false;
+  bandsStored = false;
+  memoriesStored = false;
+}
+
 // Invlaidate all currently saved preferences
 void prefsInvalidate()
 {
@@ -56,264 +260,291 @@ void prefsInvalidate()
     prefs.clear();
     prefs.end();
   }
+
+  prefsForget();
 }
 
-struct SavedBand
+//
+// Write a record unless the stored one is the same. Returns true if
+// the record has been written.
+//
+static bool prefsSaveRecord(const char *space, uint16_t version, const void *data, uint16_t size, void *saved, bool *stored)
 {
-  uint8_t bandMode;       // Band mode (FM, AM, LSB, or USB)
-  uint16_t currentFreq;   // Current frequency
-  int8_t currentStepIdx;  // Current frequency step
-  int8_t bandwidthIdx;    // Index of the table bandwidthFM, bandwidthAM or bandwidthSSB;
-  int16_t usbCal;         // USB calibration value
-  int16_t lsbCal;         // LSB calibration value
-};
+  // Nothing to write if the stored record is the same
+  if(*stored && !memcmp(data, saved, size)) return(false);
 
-void prefsSaveBand(uint8_t idx, bool openPrefs)
-{
-  SavedBand value;
-  char name[32];
+  uint8_t *buf = (uint8_t *)malloc(sizeof(RecordHeader) + size);
+  if(!buf) return(false);
+
+  RecordHeader *hdr = (RecordHeader *)buf;
+  hdr->version = version;
+  hdr->size    = size;
+  hdr->crc     = esp_rom_crc32_le(0, (const uint8_t *)data, size);
+  memcpy(buf + sizeof(RecordHeader), data, size);
 
-  // Will be saving to bands
-  if(openPrefs) prefs.begin("bands", false, STORAGE_PARTITION);
+  prefs.begin(space, false, STORAGE_PARTITION);
 
-  // Compose preference name and value
-  sprintf(name, "Band-%d", idx);
-  value.currentFreq    = bands[idx].currentFreq;     // Frequency
-  value.bandMode       = bands[idx].bandMode;        // Modulation
-  value.currentStepIdx = bands[idx].currentStepIdx;  // Step
-  value.bandwidthIdx   = bands[idx].bandwidthIdx;    // Bandwidth
-  value.usbCal         = bands[idx].usbCal;          // USB Calibration
-  value.lsbCal         = bands[idx].lsbCal;          // LSB Calibration
+  // Not known to be stored: drop whatever else is in the namespace,
+  // such as keys of the earlier layout
+  if(!*stored) prefs.clear();
 
-  // Write a preference
-  prefs.putBytes(name, &value, sizeof(value));
+  bool result = prefs.putBytes(RECORD_KEY, buf, sizeof(RecordHeader) + size) == sizeof(RecordHeader) + size;
+  prefs.end();
+  free(buf);
 
-  // Done with band preferences
-  if(openPrefs) prefs.end();
+  if(result)
+  {
+    memcpy(saved, data, size);
+    *stored = true;
+  }
+
+  return(result);
 }
 
-bool prefsLoadBand(uint8_t idx, bool openPrefs)
+//
+// Read a record into data, which holds the defaults, migrating it from
+// an older version if needed. Returns false if there is no record of a
+// known version, or if it is damaged.
+//
+static bool prefsLoadRecord(const char *space, uint16_t version, const Migration *migrations, void *data, uint16_t size, void *saved, bool *stored)
 {
-  SavedBand value;
-  char name[32];
+  RecordHeader hdr;
+  bool result = false;
+  bool migrated = false;
 
-  // Will be loading from bands
-  if(openPrefs) prefs.begin("bands", true, STORAGE_PARTITION);
+  prefs.begin(space, true, STORAGE_PARTITION);
 
-  // Compose preference name
-  sprintf(name, "Band-%d", idx);
+  size_t length = prefs.getBytesLength(RECORD_KEY);
+  uint16_t capacity = length > sizeof(hdr) + size ? length - sizeof(hdr) : size;
+  uint8_t *buf = (uint8_t *)malloc(sizeof(hdr) + capacity);
+  uint8_t *body = buf + sizeof(hdr);
 
-  // Read preference
-  bool result = !!prefs.getBytes(name, &value, sizeof(value));
-  if(result)
+  if(!buf)
   {
-    bands[idx].currentFreq    = value.currentFreq;    // Frequency
-    bands[idx].bandMode       = value.bandMode;       // Modulation
-    bands[idx].currentStepIdx = value.currentStepIdx; // Step
-    bands[idx].bandwidthIdx   = value.bandwidthIdx;   // Bandwidth
-    bands[idx].usbCal         = value.usbCal;         // USB Calibration
-    bands[idx].lsbCal         = value.lsbCal;         // LSB Calibration
+    prefs.end();
+    return(false);
   }
 
-  // Done with band preferences
-  if(openPrefs) prefs.end();
+  // Whatever the record does not have stays at its default
+  memcpy(body, data, size);
+  if(capacity > size) memset(body + size, 0, capacity - size);
 
-  // Done
-  return(result);
-}
+  if(length >= sizeof(hdr) && prefs.getBytes(RECORD_KEY, buf, length) == length)
+  {
+    memcpy(&hdr, buf, sizeof(hdr));
+    result = hdr.size == length - sizeof(hdr) &&
+             hdr.crc == esp_rom_crc32_le(0, body, hdr.size);
+  }
+  else if(!length)
+  {
+    // No record, maybe the earlier layout
+    hdr.version = prefs.getUChar("Version", 0);
+    hdr.size    = 0;
+    result      = true;
+  }
 
-void prefsSaveMemory(uint8_t idx, bool openPrefs)
-{
-  char name[32];
+  // Bring the record up to date
+  while(result && hdr.version != version)
+  {
+    const Migration *m;
+    for(m=migrations ; m->migrate && m->from!=hdr.version ; m++);
 
-  // Will be saving to memories
-  if(openPrefs) prefs.begin("memories", false, STORAGE_PARTITION);
+    result = m->migrate && m->migrate(body, &hdr.size, capacity);
+    hdr.version = m->to;
+    migrated = true;
+  }
 
-  // Compose preference name
-  sprintf(name, "Memory-%d", idx);
+  prefs.end();
 
-  // Write a preference
-  prefs.putBytes(name, &memories[idx], sizeof(memories[idx]));
+  if(result)
+  {
+    // Larger records come from newer firmware, take what is known
+    memcpy(data, body, hdr.size < size ? hdr.size : size);
+
+    if(migrated)
+    {
+      // Store the migrated record right away
+      *stored = false;
+      prefsSaveRecord(space, version, data, size, saved, stored);
+    }
+    else if(hdr.size == size)
+    {
+      // This is what is stored now
+      memcpy(saved, data, size);
+      *stored = true;
+    }
+  }
 
-  // Done with memory preferences
-  if(openPrefs) prefs.end();
+  free(buf);
+  return(result);
 }
 
-bool prefsLoadMemory(uint8_t idx, bool openPrefs)
+static void prefsComposeSettings(SavedSettings *value)
 {
-  char name[32];
-
-  // Will be loading from memories
-  if(openPrefs) prefs.begin("memories", true, STORAGE_PARTITION);
+  value->app         = VER_APP;
+  value->volume      = volume;
+  value->band        = bandIdx;
+  value->wifiMode    = wifiModeIdx;
+  value->brightness  = currentBrt;
+  value->fmAgc       = FmAgcIdx;
+  value->amAgc       = AmAgcIdx;
+  value->ssbAgc      = SsbAgcIdx;
+  value->amAvc       = AmAvcIdx;
+  value->ssbAvc      = SsbAvcIdx;
+  value->amSoftMute  = AmSoftMuteIdx;
+  value->ssbSoftMute = SsbSoftMuteIdx;
+  value->sleep       = currentSleep;
+  value->theme       = themeIdx;
+  value->rdsMode     = rdsModeIdx;
+  value->sleepMode   = sleepModeIdx;
+  value->zoomMenu    = zoomMenu;
+  value->scrollDir   = scrollDirection<0;
+  value->utcOffset   = utcOffsetIdx;
+  value->squelch     = currentSquelch;
+  value->fmRegion    = FmRegionIdx;
+  value->uiLayout    = uiLayoutIdx;
+  value->histZoom    = historyZoomIdx;
+  value->bleMode     = bleModeIdx;
+  value->usbMode     = usbModeIdx;
+  value->propRefresh = propRefresh;
+  value->latitude    = locationLat;
+  value->longitude   = locationLon;
+}
 
-  // Compose preference name
-  sprintf(name, "Memory-%d", idx);
+static void prefsApplySettings(const SavedSettings *value)
+{
+  volume          = value->volume;
+  bandIdx         = value->band;
+  wifiModeIdx     = value->wifiMode;
+  currentBrt      = value->brightness;
+  FmAgcIdx        = value->fmAgc;
+  AmAgcIdx        = value->amAgc;
+  SsbAgcIdx       = value->ssbAgc;
+  AmAvcIdx        = value->amAvc;
+  SsbAvcIdx       = value->ssbAvc;
+  AmSoftMuteIdx   = value->amSoftMute;
+  SsbSoftMuteIdx  = value->ssbSoftMute;
+  currentSleep    = value->sleep;
+  themeIdx        = value->theme;
+  rdsModeIdx      = value->rdsMode;
+  sleepModeIdx    = value->sleepMode;
+  zoomMenu        = value->zoomMenu;
+  scrollDirection = value->scrollDir? -1:1;
+  utcOffsetIdx    = value->utcOffset;
+  currentSquelch  = value->squelch;
+  FmRegionIdx     = value->fmRegion;
+  uiLayoutIdx     = value->uiLayout;
+  historyZoomIdx  = value->histZoom;
+  bleModeIdx      = value->bleMode;
+  usbModeIdx      = value->usbMode;
+  propRefresh     = value->propRefresh;
+  locationLat     = value->latitude;
+  locationLon     = value->longitude;
+}
 
-  // Write a preference
-  bool result = !!prefs.getBytes(name, &memories[idx], sizeof(memories[idx]));
+static void prefsComposeBand(uint8_t idx, SavedBand *value)
+{
+  value->currentFreq    = bands[idx].currentFreq;     // Frequency
+  value->bandMode       = bands[idx].bandMode;        // Modulation
+  value->currentStepIdx = bands[idx].currentStepIdx;  // Step
+  value->bandwidthIdx   = bands[idx].bandwidthIdx;    // Bandwidth
+  value->usbCal         = bands[idx].usbCal;          // USB Calibration
+  value->lsbCal         = bands[idx].lsbCal;          // LSB Calibration
+}
 
-  // Done with memory preferences
-  if(openPrefs) prefs.end();
+static void prefsApplyBand(uint8_t idx, const SavedBand *value)
+{
+  bands[idx].currentFreq    = value->currentFreq;    // Frequency
+  bands[idx].bandMode       = value->bandMode;       // Modulation
+  bands[idx].currentStepIdx = value->currentStepIdx; // Step
+  bands[idx].bandwidthIdx   = value->bandwidthIdx;   // Bandwidth
+  bands[idx].usbCal         = value->usbCal;         // USB Calibration
+  bands[idx].lsbCal         = value->lsbCal;         // LSB Calibration
+}
 
-  // Done
-  return(result);
+//
+// Band records, the bands table size is only known at runtime
+//
+static SavedBand *prefsAllocBands()
+{
+  if(!savedBands) savedBands = (SavedBand *)calloc(getTotalBands(), sizeof(SavedBand));
+  return(savedBands ? (SavedBand *)malloc(getTotalBands() * sizeof(SavedBand)) : NULL);
 }
 
 void prefsSave(uint32_t items)
 {
+  bool written = false;
+
   if(items & SAVE_SETTINGS)
   {
-    // Will be saving to settings
-    prefs.begin("settings", false, STORAGE_PARTITION);
-
-    // Save main global settings
-    prefs.putUChar("Version",  VER_SETTINGS);      // Settings version
-    prefs.putUShort("App",     VER_APP);           // Application version
-    prefs.putUChar("Volume",   volume);            // Current volume
-    prefs.putUChar("Band",     bandIdx);           // Current band
-    prefs.putUChar("WiFiMode", wifiModeIdx);       // WiFi connection mode
-
-    // Save additional global settings
-    prefs.putUShort("Brightness", currentBrt);     // Brightness
-    prefs.putUChar("FmAGC",       FmAgcIdx);       // FM AGC/ATTN
-    prefs.putUChar("AmAGC",       AmAgcIdx);       // AM AGC/ATTN
-    prefs.putUChar("SsbAGC",      SsbAgcIdx);      // SSB AGC/ATTN
-    prefs.putUChar("AmAVC",       AmAvcIdx);       // AM AVC
-    prefs.putUChar("SsbAVC",      SsbAvcIdx);      // SSB AVC
-    prefs.putUChar("AmSoftMute",  AmSoftMuteIdx);  // AM soft mute
-    prefs.putUChar("SsbSoftMute", SsbSoftMuteIdx); // SSB soft mute
-    prefs.putUShort("Sleep",      currentSleep);   // Sleep delay
-    prefs.putUChar("Theme",       themeIdx);       // Color theme
-    prefs.putUChar("RDSMode",     rdsModeIdx);     // RDS mode
-    prefs.putUChar("SleepMode",   sleepModeIdx);   // Sleep mode
-    prefs.putUChar("ZoomMenu",    zoomMenu);       // TRUE: Zoom menu
-    prefs.putBool("ScrollDir", scrollDirection<0); // TRUE: Reverse scroll
-    prefs.putUChar("UTCOffset",   utcOffsetIdx);   // UTC Offset
-    prefs.putUChar("Squelch",     currentSquelch); // Squelch
-    prefs.putUChar("FmRegion",    FmRegionIdx);    // FM region
-    prefs.putUChar("UILayout",    uiLayoutIdx);    // UI Layout
-    prefs.putUChar("BLEMode",     bleModeIdx);     // Bluetooth mode
-    prefs.putUChar("USBMode",     usbModeIdx);     // USB mode
-
-    // Done with global settings
-    prefs.end();
+    SavedSettings value;
+    prefsComposeSettings(&value);
+    written |= prefsSaveRecord("settings", VER_SETTINGS, &value, sizeof(value), &savedSettings, &settingsStored);
   }
 
-  if(items & SAVE_BANDS)
-  {
-    // Will be saving to bands
-    prefs.begin("bands", false, STORAGE_PARTITION);
-    prefs.putUChar("Version", VER_BANDS);
-    // Save band settings
-    for(int i=0 ; i<getTotalBands() ; i++) prefsSaveBand(i, false);
-    // Done with bands
-    prefs.end();
-  }
-  else if(items & SAVE_CUR_BAND)
+  if(items & (SAVE_BANDS|SAVE_CUR_BAND))
   {
-    // Save current band only
-    prefsSaveBand(bandIdx);
+    // Saving the current band only writes the record if it has changed
+    SavedBand *value = prefsAllocBands();
+    if(value)
+    {
+      for(int i=0 ; i<getTotalBands() ; i++) prefsComposeBand(i, &value[i]);
+      written |= prefsSaveRecord("bands", VER_BANDS, value, getTotalBands() * sizeof(SavedBand), savedBands, &bandsStored);
+      free(value);
+    }
   }
 
   if(items & SAVE_MEMORIES)
   {
-    // Will be saving to memories
-    prefs.begin("memories", false, STORAGE_PARTITION);
-    prefs.putUChar("Version", VER_MEMORIES);
-    // Save current memories
-    for(int i=0 ; i<getTotalMemories() ; i++) prefsSaveMemory(i, false);
-    // Done with memories
-    prefs.end();
+    written |= prefsSaveRecord("memories", VER_MEMORIES, memories, getTotalMemories() * sizeof(Memory), savedMemories, &memoriesStored);
   }
 
   // Preferences have been saved
-  savingPrefsFlag = true;
+  if(written)
+  {
+    savingPrefsFlag = true;
+    metricSaves.add();
+  }
 }
 
 bool prefsLoad(uint32_t items)
 {
+  bool verify = items & SAVE_VERIFY;
+
   if(items & SAVE_SETTINGS)
   {
-    // Will be loading from settings
-    prefs.begin("settings", true, STORAGE_PARTITION);
-
-    // Check currently saved version
-    if((items & SAVE_VERIFY) && (prefs.getUChar("Version", 0) != VER_SETTINGS))
-    {
-      prefs.end();
+    SavedSettings value;
+    prefsComposeSettings(&value);
+    if(prefsLoadRecord("settings", VER_SETTINGS, settingsMigrations, &value, sizeof(value), &savedSettings, &settingsStored))
+      prefsApplySettings(&value);
+    else if(verify)
       return(false);
-    }
-
-    // Load main global settings
-    volume         = prefs.getUChar("Volume", volume);          // Current volume
-    bandIdx        = prefs.getUChar("Band", bandIdx);           // Current band
-    wifiModeIdx    = prefs.getUChar("WiFiMode", wifiModeIdx);   // WiFi connection mode
-    currentBrt     = prefs.getUShort("Brightness", currentBrt); // Brightness
-    FmAgcIdx       = prefs.getUChar("FmAGC", FmAgcIdx);         // FM AGC/ATTN
-    AmAgcIdx       = prefs.getUChar("AmAGC", AmAgcIdx);         // AM AGC/ATTN
-    SsbAgcIdx      = prefs.getUChar("SsbAGC", SsbAgcIdx);       // SSB AGC/ATTN
-    AmAvcIdx       = prefs.getUChar("AmAVC", AmAvcIdx);         // AM AVC
-    SsbAvcIdx      = prefs.getUChar("SsbAVC", SsbAvcIdx);       // SSB AVC
-    AmSoftMuteIdx  = prefs.getUChar("AmSoftMute", AmSoftMuteIdx);   // AM soft mute
-    SsbSoftMuteIdx = prefs.getUChar("SsbSoftMute", SsbSoftMuteIdx); // SSB soft mute
-    currentSleep   = prefs.getUShort("Sleep", currentSleep);    // Sleep delay
-    themeIdx       = prefs.getUChar("Theme", themeIdx);         // Color theme
-    rdsModeIdx     = prefs.getUChar("RDSMode", rdsModeIdx);     // RDS mode
-    sleepModeIdx   = prefs.getUChar("SleepMode", sleepModeIdx); // Sleep mode
-    zoomMenu       = prefs.getUChar("ZoomMenu", zoomMenu);      // TRUE: Zoom menu
-    scrollDirection = prefs.getBool("ScrollDir", scrollDirection<0)? -1:1; // TRUE: Reverse scroll
-    utcOffsetIdx   = prefs.getUChar("UTCOffset", utcOffsetIdx); // UTC Offset
-    currentSquelch = prefs.getUChar("Squelch", currentSquelch); // Squelch
-    FmRegionIdx    = prefs.getUChar("FmRegion", FmRegionIdx);   // FM region
-    uiLayoutIdx    = prefs.getUChar("UILayout", uiLayoutIdx);   // UI Layout
-    bleModeIdx     = prefs.getUChar("BLEMode", bleModeIdx);     // Bluetooth mode
-    usbModeIdx     = prefs.getUChar("USBMode", usbModeIdx);     // USB mode
-
-    // Done with global settings
-    prefs.end();
   }
 
-  if(items & SAVE_BANDS)
+  if(items & (SAVE_BANDS|SAVE_CUR_BAND))
   {
-    // Will be loading from bands
-    prefs.begin("bands", true, STORAGE_PARTITION);
+    SavedBand *value = prefsAllocBands();
+    bool result = false;
 
-    // Check currently saved version
-    if((items & SAVE_VERIFY) && (prefs.getUChar("Version", 0) != VER_BANDS))
+    if(value)
     {
-      prefs.end();
-      return(false);
-    }
+      for(int i=0 ; i<getTotalBands() ; i++) prefsComposeBand(i, &value[i]);
+      result = prefsLoadRecord("bands", VER_BANDS, bandsMigrations, value, getTotalBands() * sizeof(SavedBand), savedBands, &bandsStored);
 
-    // Read band settings
-    for(int i=0 ; i<getTotalBands() ; i++) prefsLoadBand(i, false);
+      // Load current band only, unless all bands are requested
+      for(int i=0 ; result && i<getTotalBands() ; i++)
+        if((items & SAVE_BANDS) || i==bandIdx) prefsApplyBand(i, &value[i]);
 
-    // Done with bands
-    prefs.end();
-  }
-  else if(items & SAVE_CUR_BAND)
-  {
-    // Load current band only
-    prefsLoadBand(bandIdx);
+      free(value);
+    }
+
+    if(!result && verify) return(false);
   }
 
   if(items & SAVE_MEMORIES)
   {
-    // Will be loading from memories
-    prefs.begin("memories", true, STORAGE_PARTITION);
-
-    // Check currently saved version
-    if((items & SAVE_VERIFY) && (prefs.getUChar("Version", 0) != VER_MEMORIES))
-    {
-      prefs.end();
+    if(!prefsLoadRecord("memories", VER_MEMORIES, memoriesMigrations, memories, getTotalMemories() * sizeof(Memory), savedMemories, &memoriesStored) && verify)
       return(false);
-    }
-
-    // Read all memories
-    for(int i=0 ; i<getTotalMemories() ; i++) prefsLoadMemory(i, false);
-
-    // Done with memories
-    prefs.end();
   }
 
   return(true);
@@ -354,6 +585,7 @@ bool diskInit(bool force)
 
 bool nvsErase()
 {
+  prefsForget();
   return(nvs_flash_erase() == ESP_OK &&
          nvs_flash_init() == ESP_OK &&
          nvs_flash_erase_partition(STORAGE_PARTITION) == ESP_OK &&
@@ -0,0 +1,150 @@
+#include "Common.h"
+#include "Utils.h"
+#include "Menu.h"
+#include "Telemetry.h"
+
+// Field letters, indexed by TM_*
+static const char tmKeys[] = "rnfbcvd";
+
+//
+// Get antenna tuning capacitor value. Reading it requires an I2C
+// transaction, so it is only read again after tuning.
+//
+uint16_t getTuningCapacitor()
+{
+  static uint32_t lastTuning = 0xFFFFFFFF;
+  static uint16_t capacitor = 0;
+  uint32_t tuning = currentFrequency | (currentMode << 16) | (bandIdx << 24);
+
+  if(tuning != lastTuning)
+  {
+    // Use rx.getFrequency to force read of capacitor value from SI4732/5
+    rx.getFrequency();
+    capacitor  = rx.getAntennaTuningCapacitor();
+    lastTuning = tuning;
+  }
+
+  return(capacitor);
+}
+
+//
+// Get current value of a numeric field
+//
+static int32_t telemetryValue(uint8_t field)
+{
+  switch(field)
+  {
+    case TM_RSSI:  return(rssi);
+    case TM_SNR:   return(snr);
+    case TM_FREQ:  return(freqToHz(currentFrequency, currentMode));
+    case TM_BFO:   return(currentBFO);
+    case TM_CAP:   return(getTuningCapacitor());
+    case TM_VOLTS: return(lroundf(batteryVoltage() * 1000));
+  }
+
+  return(0);
+}
+
+//
+// Subscribe to the fields given as letters, optionally followed by a
+// comma and the rate in Hz ("rnf,10"). No fields stop the telemetry.
+//
+bool telemetrySubscribe(TelemetryState *state, const char *args)
+{
+  uint8_t fields = 0;
+  long rate = TELEMETRY_DEF_RATE;
+
+  for( ; *args && *args != ',' ; args++)
+  {
+    const char *key = strchr(tmKeys, *args);
+
+    if(*args == '*')
+      fields = (1 << TM_COUNT) - 1;
+    else if(key)
+      fields |= 1 << (key - tmKeys);
+    else
+      return(false);
+  }
+
+  if(*args == ',')
+  {
+    char *end;
+    rate = strtol(args + 1, &end, 10);
+    if(end == args + 1 || *end || rate < 1 || rate > TELEMETRY_MAX_RATE)
+      return(false);
+  }
+
+  state->fields    = fields;
+  state->rate      = rate;
+  state->full      = true;
+  state->frameTime = millis();
+  return(true);
+}
+
+void telemetryStop(TelemetryState *state)
+{
+  state->fields = 0;
+}
+
+//
+// Send a telemetry frame if it is time to, with the fields that
+// changed since the last frame
+//
+void telemetryTick(Stream* stream, TelemetryState *state)
+{
+  if(!state->fields) return;
+
+  uint32_t now = millis();
+  uint32_t period = 1000 / state->rate;
+
+  if(!state->full && now - state->frameTime < period) return;
+
+  // Keep the average rate, unless more than a period behind. A full
+  // frame sent on request starts the periods over.
+  if(!state->full && now - state->frameTime < 2 * period)
+    state->frameTime += period;
+  else
+    state->frameTime = now;
+
+  bool full = state->full || now - state->fullTime >= TELEMETRY_FULL_TIME;
+  char buf[128];
+  int len = sprintf(buf, "%c%u", full ? '=' : '~', state->seq);
+  bool changed = false;
+
+  for(int i=0 ; i<TM_RDS ; i++)
+  {
+    if(!(state->fields & (1 << i))) continue;
+
+    int32_t value = telemetryValue(i);
+    if(full || value != state->last[i])
+    {
+      len += sprintf(buf + len, " %c%ld", tmKeys[i], (long)value);
+      state->last[i] = value;
+      changed = true;
+    }
+  }
+
+  if(state->fields & (1 << TM_RDS))
+  {
+    const char *name = getStationName();
+    if(full || strncmp(name, state->lastRds, sizeof(state->lastRds) - 1))
+    {
+      len += snprintf(buf + len, sizeof(buf) - len, " %c%s", tmKeys[TM_RDS], name);
+      strncpy(state->lastRds, name, sizeof(state->lastRds) - 1);
+      changed = true;
+    }
+  }
+
+  // Nothing to send
+  if(!changed) return;
+
+  if(full)
+  {
+    state->full     = false;
+    state->fullTime = now;
+  }
+
+  state->seq++;
+  stream->print(buf);
+  stream->print("\r\n");
+}
@@ -0,0 +1,51 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <Arduino.h>
+
+//
+// Telemetry subscription. The client picks a set of fields and a rate
+// with the "u" remote command and the receiver sends one text line per
+// period, with only the fields that changed since the last line:
+//
+//   ~<seq> r34 n12 f7074000       delta frame
+//   =<seq> r34 n12 f7074000 b-120 full frame, sent first and then
+//                                 every TELEMETRY_FULL_TIME
+//
+// Each field is a letter followed by its value. The RDS station name
+// (d) is always the last field and runs to the end of the line. The
+// sequence number counts sent frames, so lost lines can be detected.
+//
+
+#define TELEMETRY_MAX_RATE    20  // Largest frame rate (Hz)
+#define TELEMETRY_DEF_RATE     2  // Default frame rate (Hz)
+#define TELEMETRY_FULL_TIME 5000  // Full frame period (ms)
+
+// Telemetry fields, in the order they are sent
+#define TM_RSSI   0  // r: RSSI (dBuV)
+#define TM_SNR    1  // n: SNR (dB)
+#define TM_FREQ   2  // f: frequency (Hz, without BFO)
+#define TM_BFO    3  // b: BFO (Hz)
+#define TM_CAP    4  // c: antenna tuning capacitor
+#define TM_VOLTS  5  // v: battery voltage (mV)
+#define TM_RDS    6  // d: RDS station name
+#define TM_COUNT  7
+
+typedef struct
+{
+  uint8_t fields = 0;          // Subscribed fields mask, 0 if none
+  uint8_t rate = 0;            // Frames per second
+  bool full = false;           // Send full frame next time
+  uint16_t seq = 0;            // Frame sequence number
+  uint32_t frameTime = 0;      // Last frame time
+  uint32_t fullTime = 0;       // Last full frame time
+  int32_t last[TM_COUNT - 1];  // Last sent numeric values
+  char lastRds[50] = "";       // Last sent station name
+} TelemetryState;
+
+bool telemetrySubscribe(TelemetryState *state, const char *args);
+void telemetryStop(TelemetryState *state);
+void telemetryTick(Stream* stream, TelemetryState *state);
+uint16_t getTuningCapacitor();
+
+#endif // TELEMETRY_H
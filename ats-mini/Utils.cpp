@@ -401,6 +401,14 @@ uint32_t freqToHz(uint16_t freq, uint8_t mode)
   return(mode == FM ? freq * 10000 : freq * 1000);
 }
 
+//
+// Get current frequency in Hz, including the BFO
+//
+uint32_t getCurrentFrequencyHz()
+{
+  return(freqToHz(currentFrequency, currentMode) + (isSSB() ? currentBFO : 0));
+}
+
 //
 // Extract BFO from a frequency in Hz
 //
@@ -42,6 +42,7 @@ bool isMemoryInBand(const Band *band, const Memory *memory);
 uint16_t freqFromHz(uint32_t freq, uint8_t mode);
 uint16_t bfoFromHz(uint32_t freq);
 uint32_t freqToHz(uint16_t freq, uint8_t mode);
+uint32_t getCurrentFrequencyHz();
 
 // Check if given frequency belongs to a band
 bool isFreqInBand(const Band *band, uint16_t freq);
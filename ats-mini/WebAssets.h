@@ -0,0 +1,163 @@
+// Generated by tools/ats_webassets.py from the files in web/, do not edit
+#ifndef WEB_ASSETS_H
+#define WEB_ASSETS_H
+
+#include <Arduino.h>
+
+typedef struct
+{
+  const char *path;     // URL path
+  const char *type;     // Content type
+  const char *etag;     // Hash of the contents
+  bool immutable;       // Referenced with the hash, can be cached for long
+  const uint8_t *data;  // Gzip compressed contents
+  size_t size;
+} WebAsset;
+
+// app.js: 2515 bytes, 1032 compressed
+static const uint8_t webAsset_app_js[] PROGMEM =
+{
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xa5, 0x56, 0x4d, 0x8f, 0xdb, 0x36,
+  0x10, 0xbd, 0xfb, 0x57, 0x4c, 0x72, 0x91, 0xd4, 0x35, 0xa8, 0x4d, 0x02, 0xf4, 0x60, 0xc3, 0x28,
+  0x9a, 0x64, 0x17, 0x4d, 0xd1, 0xcd, 0x06, 0xf5, 0x26, 0x39, 0x14, 0x3d, 0xd0, 0xd2, 0xd8, 0x66,
+  0x22, 0x91, 0x2e, 0x49, 0x59, 0x71, 0x36, 0xfe, 0xef, 0x1d, 0x7e, 0xe8, 0xc3, 0xae, 0x5b, 0xa0,
+  0x08, 0xf6, 0xb0, 0x22, 0xf9, 0x86, 0x33, 0x7a, 0xef, 0xcd, 0xc8, 0x79, 0x0e, 0x4b, 0xcb, 0x6d,
+  0x63, 0x60, 0xc7, 0x37, 0x38, 0x03, 0x21, 0x85, 0x15, 0xbc, 0x02, 0x43, 0x9b, 0x08, 0x6b, 0xad,
+  0x6a, 0xb0, 0x5b, 0x84, 0xdf, 0x6f, 0x96, 0x0f, 0xf0, 0xf3, 0xbb, 0x37, 0x53, 0xb7, 0x92, 0x50,
+  0x89, 0x3d, 0x42, 0xb1, 0xe5, 0x72, 0x83, 0x66, 0x92, 0xe7, 0xa0, 0xf6, 0xa8, 0x3d, 0xee, 0x23,
+  0xae, 0x96, 0xaa, 0xf8, 0x8c, 0x96, 0xc1, 0xab, 0x70, 0x0c, 0x5c, 0x23, 0x18, 0x94, 0x16, 0xb8,
+  0x81, 0x77, 0xef, 0x1f, 0x20, 0xe7, 0x3b, 0x91, 0xef, 0x9f, 0xe5, 0xc6, 0xa7, 0x65, 0x93, 0xc9,
+  0x9e, 0xeb, 0x98, 0x6e, 0x01, 0x8f, 0xc7, 0xf9, 0x64, 0xb2, 0x6e, 0x64, 0x61, 0x85, 0x92, 0x60,
+  0xb6, 0xaa, 0x4d, 0x45, 0x49, 0x49, 0xf1, 0x8b, 0xcd, 0x26, 0x8f, 0x13, 0x80, 0x52, 0x15, 0x4d,
+  0x4d, 0xb7, 0xb1, 0x0d, 0xda, 0x9b, 0x0a, 0xdd, 0xe3, 0xcb, 0xc3, 0x9b, 0x92, 0x50, 0x19, 0x73,
+  0xa8, 0x57, 0x4a, 0x5a, 0x97, 0x6c, 0xe1, 0x63, 0xe6, 0x93, 0xe3, 0xe8, 0xba, 0x75, 0x9d, 0x86,
+  0x4b, 0x34, 0xda, 0x46, 0xcb, 0x90, 0x94, 0xd5, 0xaa, 0xa4, 0xcc, 0x0b, 0x48, 0x6e, 0xef, 0x92,
+  0x33, 0xbc, 0xd2, 0x35, 0xb7, 0xb7, 0x1a, 0xff, 0x6a, 0x50, 0x16, 0x87, 0x74, 0xfb, 0xf5, 0x24,
+  0xdc, 0x5d, 0x07, 0x3f, 0x01, 0x6d, 0x43, 0x0e, 0xcf, 0xf0, 0x47, 0x2a, 0x40, 0xdd, 0x8a, 0x2f,
+  0x58, 0xa6, 0xcf, 0x33, 0xb8, 0x82, 0xe4, 0xee, 0x97, 0xaf, 0x09, 0xcc, 0xfa, 0xf3, 0x17, 0xc3,
+  0xf9, 0x0b, 0x7f, 0xfe, 0x99, 0xce, 0x4f, 0x13, 0x36, 0xbb, 0x92, 0x2a, 0x4a, 0x23, 0xb1, 0x21,
+  0x99, 0x63, 0xc7, 0x15, 0x42, 0x6f, 0xf4, 0x6f, 0xef, 0x9e, 0x14, 0xf4, 0xd2, 0x5a, 0x55, 0x49,
+  0x36, 0x8f, 0x01, 0x58, 0x92, 0x8a, 0x72, 0x43, 0x31, 0x2e, 0x94, 0xb9, 0x73, 0x2e, 0xa4, 0x49,
+  0xfb, 0x1b, 0x38, 0x25, 0xdc, 0x63, 0xbc, 0x84, 0xc2, 0x28, 0xee, 0x7e, 0xf5, 0x09, 0x0b, 0x3a,
+  0x31, 0x46, 0x6c, 0x64, 0xea, 0xb9, 0x99, 0x76, 0x1a, 0x07, 0x84, 0x97, 0x23, 0x59, 0x71, 0x59,
+  0x26, 0xd3, 0x48, 0x9e, 0x5b, 0xf8, 0xac, 0xe1, 0x6c, 0xdd, 0x71, 0x45, 0x80, 0x73, 0xf6, 0x42,
+  0x40, 0x8f, 0xf0, 0x14, 0xd0, 0xdf, 0xd5, 0x48, 0x86, 0xd1, 0x4d, 0x9a, 0xca, 0xe8, 0xb3, 0xb8,
+  0x85, 0x83, 0x97, 0x2f, 0x9b, 0x0f, 0xc9, 0x08, 0x64, 0xa4, 0xee, 0x31, 0xf4, 0x1c, 0x20, 0x27,
+  0x00, 0x3a, 0x22, 0x62, 0x07, 0x50, 0x58, 0x8f, 0x10, 0x0d, 0xf9, 0x9d, 0x8e, 0x93, 0xbe, 0x4e,
+  0x48, 0x5d, 0x4d, 0x69, 0x14, 0xb7, 0x13, 0xd1, 0x8b, 0xe5, 0x4b, 0xce, 0x92, 0x40, 0x06, 0xb9,
+  0xfe, 0xb5, 0x02, 0xa9, 0xac, 0x37, 0x7f, 0xab, 0x05, 0xf9, 0xb7, 0xdd, 0x72, 0x0b, 0xc2, 0xc0,
+  0x0a, 0x1d, 0xf9, 0xf6, 0xb0, 0xc3, 0x92, 0x90, 0x62, 0x9d, 0x3e, 0x89, 0x82, 0x64, 0xb4, 0x74,
+  0xa2, 0x42, 0xd0, 0xa5, 0x27, 0x83, 0xed, 0x79, 0xd5, 0x38, 0xff, 0x77, 0x9e, 0x3a, 0x23, 0xeb,
+  0x82, 0xc1, 0x66, 0x97, 0x41, 0x27, 0x2e, 0x9b, 0x0f, 0xa9, 0xf6, 0xaa, 0x22, 0xe5, 0xfb, 0x3c,
+  0x21, 0x34, 0x6c, 0x8e, 0x50, 0x4e, 0xce, 0x33, 0x8c, 0xdb, 0x72, 0x88, 0xe3, 0x89, 0x53, 0xc9,
+  0x51, 0x92, 0xdc, 0x92, 0x0e, 0x1e, 0x6d, 0x0d, 0x85, 0x48, 0x6c, 0x87, 0x11, 0x90, 0x26, 0xad,
+  0x99, 0xe5, 0xb9, 0xa3, 0xb3, 0x52, 0x85, 0x27, 0x9e, 0x6d, 0x95, 0xb1, 0x8e, 0xc5, 0x6e, 0x08,
+  0xb4, 0x26, 0xd2, 0xd9, 0x1a, 0xa6, 0x64, 0x8d, 0xc6, 0xd0, 0x14, 0x72, 0x3c, 0xc4, 0x44, 0x29,
+  0x66, 0xf0, 0xd8, 0xf5, 0xc5, 0xaf, 0xcb, 0xfb, 0xb7, 0x6c, 0xc7, 0xb5, 0xc1, 0x14, 0x19, 0xed,
+  0xf0, 0x2c, 0x9b, 0xc3, 0x71, 0xde, 0x45, 0x17, 0x95, 0x32, 0x27, 0xb1, 0x2e, 0xd4, 0xa0, 0x7d,
+  0x10, 0x35, 0xaa, 0xc6, 0xa6, 0xb1, 0xe6, 0x29, 0x3c, 0xbf, 0xbe, 0xbe, 0x0e, 0x91, 0xe3, 0x57,
+  0x32, 0xcd, 0xaa, 0x16, 0x96, 0x12, 0x9e, 0xb7, 0x1d, 0x32, 0xcb, 0x35, 0xb5, 0x5c, 0xd7, 0x5c,
+  0xa1, 0x27, 0xdc, 0xb0, 0x82, 0x40, 0xe0, 0x0c, 0xae, 0xfe, 0xc9, 0xf1, 0xb1, 0x83, 0x9b, 0x82,
+  0x57, 0x23, 0x69, 0x49, 0x47, 0xd2, 0x8e, 0x84, 0xf2, 0xaf, 0x8d, 0x6c, 0xa7, 0x71, 0x4f, 0x3d,
+  0xf8, 0x1a, 0xd7, 0xbc, 0xa9, 0x88, 0x50, 0xbf, 0x4d, 0x96, 0x39, 0xd7, 0xe3, 0xc9, 0x58, 0x90,
+  0xcc, 0x4b, 0x16, 0x0a, 0xf1, 0x1b, 0x5d, 0xa7, 0x0f, 0x01, 0x2e, 0x3d, 0x56, 0x06, 0xc7, 0xc8,
+  0xc1, 0x2a, 0x0b, 0xb8, 0xe3, 0x76, 0xcb, 0xb4, 0x6a, 0x64, 0x99, 0x5e, 0xf4, 0xe2, 0x0f, 0xa1,
+  0xf0, 0x50, 0xcf, 0x1a, 0x6d, 0xb1, 0x4d, 0x93, 0xd3, 0xd1, 0x4d, 0x6d, 0xf3, 0x08, 0x35, 0xda,
+  0xad, 0x2a, 0xa9, 0x41, 0x68, 0xb4, 0xd3, 0xc6, 0x4a, 0x95, 0x87, 0x19, 0x78, 0xa1, 0x8c, 0xd5,
+  0xe4, 0x78, 0xb1, 0x3e, 0xc4, 0x79, 0x96, 0xc1, 0x31, 0x94, 0xcd, 0xdc, 0x27, 0x24, 0xed, 0x55,
+  0xd2, 0x4e, 0xa6, 0x38, 0x52, 0x35, 0xfb, 0x64, 0x9c, 0x70, 0xf3, 0xff, 0xc2, 0x86, 0xc6, 0x45,
+  0xad, 0x95, 0xeb, 0x7e, 0xcd, 0xfc, 0x13, 0x7c, 0xfb, 0x06, 0x49, 0xe2, 0x03, 0xcf, 0x64, 0x25,
+  0xf1, 0xc6, 0x3e, 0xfd, 0x1f, 0xb3, 0xb4, 0x1f, 0x12, 0xbc, 0x2c, 0x35, 0x59, 0x93, 0xb2, 0x9d,
+  0x18, 0xd9, 0xf7, 0x97, 0x27, 0x8f, 0x00, 0x37, 0x4e, 0xc5, 0xdf, 0x84, 0xa1, 0xaf, 0x0f, 0x6a,
+  0x9a, 0x3c, 0xde, 0x4d, 0x6e, 0xf0, 0xf8, 0x87, 0x8b, 0x34, 0x3a, 0xb1, 0xc8, 0xff, 0xdf, 0x4b,
+  0x8a, 0xbf, 0x26, 0x8b, 0x73, 0x05, 0xc0, 0x2f, 0x19, 0x95, 0x75, 0xc3, 0x29, 0xd9, 0x80, 0x1a,
+  0x10, 0x7e, 0x78, 0x2d, 0x55, 0x8d, 0x1e, 0x0b, 0x92, 0xd7, 0xf1, 0x33, 0xdd, 0x18, 0x2c, 0xc1,
+  0xb6, 0xa2, 0x40, 0xff, 0x9d, 0x87, 0xb5, 0xd0, 0xd4, 0xae, 0x4a, 0xa2, 0x1b, 0x6a, 0x06, 0x2b,
+  0xea, 0x1e, 0x02, 0xac, 0x0e, 0x3e, 0xa4, 0xbf, 0xcc, 0xcd, 0xb7, 0xc1, 0x7c, 0x64, 0x22, 0x7d,
+  0x58, 0x7a, 0xac, 0x22, 0x1e, 0xfe, 0xf0, 0x6e, 0x5a, 0x3c, 0x75, 0x53, 0x60, 0xc5, 0x5c, 0x9c,
+  0x6b, 0xff, 0xa7, 0x7f, 0x26, 0x59, 0xd6, 0x5f, 0x30, 0x1e, 0x3e, 0xc4, 0x64, 0xea, 0xa6, 0xc8,
+  0xfd, 0x2e, 0x54, 0xed, 0x43, 0xa6, 0x31, 0x34, 0x8b, 0x13, 0x0d, 0xbc, 0xca, 0xe1, 0xa9, 0xfb,
+  0x18, 0x5f, 0x74, 0x68, 0x44, 0x7d, 0xbf, 0xf1, 0x46, 0xfc, 0x06, 0x4b, 0xd4, 0xbc, 0x70, 0xe2,
+  0x32, 0xfa, 0xdf, 0x97, 0x12, 0xbf, 0x81, 0x42, 0xd7, 0x2d, 0xb1, 0xe9, 0x8f, 0xbb, 0xc5, 0x19,
+  0x66, 0xc5, 0xad, 0x25, 0x9a, 0x3c, 0x24, 0x3e, 0x9f, 0xfd, 0x78, 0xf8, 0x90, 0xf4, 0x21, 0x71,
+  0xfa, 0x99, 0x7e, 0xa3, 0x1f, 0xbe, 0xdd, 0xdb, 0x79, 0xc7, 0x47, 0xa3, 0xcf, 0x27, 0x7f, 0x03,
+  0x3d, 0x0d, 0xef, 0x1c, 0xd3, 0x09, 0x00, 0x00,
+};
+
+// style.css: 522 bytes, 304 compressed
+static const uint8_t webAsset_style_css[] PROGMEM =
+{
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x7d, 0x91, 0x51, 0x4f, 0x83, 0x30,
+  0x14, 0x85, 0xdf, 0xf9, 0x15, 0x4d, 0xcc, 0xde, 0x28, 0x61, 0x26, 0xe8, 0x84, 0xf8, 0x00, 0xa3,
+  0x93, 0x25, 0x04, 0x8d, 0xe2, 0x83, 0x31, 0x7b, 0x28, 0x50, 0x58, 0x23, 0x14, 0xd2, 0x96, 0x8c,
+  0xc5, 0xec, 0xbf, 0x5b, 0xca, 0xa2, 0x24, 0x4e, 0x1f, 0xef, 0x77, 0xef, 0x3d, 0xe7, 0x9e, 0x36,
+  0x78, 0x0c, 0xdf, 0x8c, 0x4f, 0x03, 0x80, 0x06, 0xf3, 0x8a, 0x32, 0x17, 0xd8, 0x9e, 0x2a, 0x3a,
+  0x5c, 0x14, 0x94, 0x55, 0xe7, 0xaa, 0x6c, 0x99, 0x84, 0x25, 0x6e, 0x68, 0x7d, 0x74, 0x81, 0xc0,
+  0x4c, 0x40, 0x41, 0x38, 0x2d, 0x3d, 0xe3, 0x64, 0x44, 0x4b, 0x13, 0x44, 0xd7, 0x5a, 0x40, 0x92,
+  0x41, 0x42, 0x5c, 0xd3, 0x4a, 0x89, 0xe4, 0x84, 0x49, 0xc2, 0xc7, 0x81, 0xd4, 0x0f, 0x62, 0xa4,
+  0xfb, 0x07, 0x5a, 0xc8, 0xbd, 0x0b, 0x96, 0xb6, 0xbd, 0xf0, 0xb4, 0xdf, 0x00, 0xcf, 0xe8, 0xf6,
+  0x66, 0xd5, 0x0d, 0x23, 0xcb, 0x5a, 0x5e, 0x10, 0xae, 0x5c, 0xa7, 0x72, 0x3a, 0x09, 0xd6, 0xa4,
+  0x94, 0x2e, 0xc0, 0xbd, 0x6c, 0x67, 0x90, 0xd3, 0x6a, 0xff, 0x4d, 0x95, 0x4d, 0x64, 0x82, 0x34,
+  0xd4, 0x3e, 0x3f, 0xb7, 0x5b, 0x0e, 0x69, 0xa6, 0xa6, 0x15, 0x21, 0x3f, 0xdc, 0x26, 0x0f, 0x7a,
+  0x20, 0xc3, 0xf9, 0x47, 0xc5, 0xdb, 0x9e, 0x15, 0x30, 0x6f, 0xeb, 0x56, 0xf9, 0x5d, 0xad, 0x6c,
+  0xdf, 0xde, 0x6c, 0x46, 0x79, 0x45, 0xfa, 0x86, 0x41, 0xd1, 0x61, 0x15, 0x03, 0xd7, 0xb5, 0xf7,
+  0x77, 0xb2, 0xd0, 0x8a, 0xfd, 0x00, 0xc5, 0xbf, 0xc2, 0xeb, 0xd3, 0xc6, 0x89, 0x6d, 0xf2, 0xf4,
+  0x9a, 0xbe, 0xcb, 0x63, 0x47, 0xee, 0xc7, 0xfe, 0xce, 0x04, 0x33, 0xd2, 0x61, 0x21, 0x0e, 0x2a,
+  0xaf, 0xa2, 0x2f, 0x28, 0x46, 0xeb, 0x74, 0xfe, 0x48, 0x77, 0xce, 0xc2, 0xbb, 0x18, 0x65, 0x26,
+  0x20, 0xfa, 0xac, 0xa1, 0x72, 0x37, 0x5f, 0x73, 0xec, 0x0b, 0x6b, 0xe3, 0x1f, 0x9e, 0x0c, 0x6b,
+  0x8d, 0x92, 0x14, 0x3d, 0xff, 0xf3, 0x53, 0x5f, 0xbe, 0xef, 0xec, 0x66, 0x0a, 0x02, 0x00, 0x00,
+};
+
+// index.html: 1514 bytes, 627 compressed
+static const uint8_t webAsset_index_html[] PROGMEM =
+{
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x95, 0x54, 0xd1, 0x6e, 0x9b, 0x30,
+  0x14, 0x7d, 0xef, 0x57, 0x78, 0x2f, 0xf3, 0x26, 0x2d, 0x25, 0x21, 0xdb, 0xda, 0x68, 0x98, 0xc9,
+  0x01, 0xa7, 0x41, 0x03, 0x82, 0xc0, 0x54, 0xeb, 0x23, 0x05, 0x27, 0xf5, 0x96, 0x40, 0x66, 0x9c,
+  0x44, 0x91, 0xf6, 0xf1, 0x33, 0x38, 0x59, 0x45, 0xd7, 0x6a, 0xf4, 0x85, 0x2b, 0x1f, 0x9f, 0x7b,
+  0x7c, 0x7d, 0x7d, 0xb8, 0xd6, 0x1b, 0x77, 0xe1, 0xd0, 0xbb, 0x88, 0x80, 0x39, 0x0d, 0x7c, 0xfb,
+  0xc2, 0x3a, 0x07, 0x82, 0x5d, 0xfb, 0x02, 0x00, 0x2b, 0x20, 0x14, 0x03, 0x67, 0x8e, 0xe3, 0x84,
+  0x50, 0x04, 0x53, 0x3a, 0x1b, 0x5c, 0xc3, 0xc7, 0x8d, 0x10, 0x07, 0x04, 0xc1, 0x3d, 0x67, 0x87,
+  0x6d, 0x25, 0x24, 0x04, 0xce, 0x22, 0xa4, 0x24, 0x54, 0xc4, 0x03, 0x2f, 0xe4, 0x03, 0x2a, 0xd8,
+  0x9e, 0xe7, 0x6c, 0xd0, 0x2e, 0x3e, 0x00, 0x5e, 0x72, 0xc9, 0xb3, 0xf5, 0xa0, 0xce, 0xb3, 0x35,
+  0x43, 0xa3, 0xcb, 0xa1, 0x16, 0xa2, 0x1e, 0xf5, 0x89, 0x8d, 0x69, 0x32, 0x08, 0x14, 0xc3, 0x32,
+  0xf4, 0xba, 0xd9, 0xf1, 0xbd, 0xf0, 0x1b, 0x88, 0x89, 0x8f, 0x60, 0x2d, 0x8f, 0x6b, 0x56, 0x3f,
+  0x30, 0xa6, 0xce, 0x98, 0xc7, 0x64, 0x86, 0xa0, 0xd1, 0x42, 0x97, 0x79, 0x5d, 0x7f, 0xdd, 0xa3,
+  0xc9, 0xd2, 0xcc, 0xc6, 0x57, 0x93, 0xf1, 0x78, 0x78, 0x3d, 0x62, 0xc3, 0x4f, 0x4b, 0x2d, 0x9c,
+  0x38, 0xb1, 0x17, 0x51, 0x90, 0xc4, 0x8e, 0xa2, 0x67, 0xdb, 0xed, 0xe5, 0x8f, 0x86, 0xfb, 0xf1,
+  0xda, 0xbc, 0x62, 0xcb, 0x49, 0xce, 0x46, 0xe6, 0xd8, 0x9c, 0x14, 0x57, 0x10, 0xb8, 0x64, 0x46,
+  0x62, 0xdb, 0x32, 0x34, 0x5f, 0x5d, 0xde, 0xd0, 0xb7, 0xb7, 0xa6, 0x0b, 0xf7, 0xae, 0xe9, 0xc5,
+  0xe8, 0x6f, 0x75, 0x20, 0xaa, 0xf2, 0x9f, 0x4c, 0x82, 0x98, 0xe5, 0x8c, 0xef, 0x99, 0x50, 0xd4,
+  0x91, 0x62, 0x44, 0x00, 0xfb, 0xde, 0x4d, 0x88, 0xa0, 0xa3, 0x2e, 0x4f, 0x62, 0x7d, 0x3c, 0x3e,
+  0x57, 0xba, 0x61, 0x9b, 0x4a, 0x1c, 0xa1, 0x1d, 0xb4, 0xd1, 0x32, 0xb0, 0xfd, 0xb6, 0xbc, 0xaf,
+  0xb7, 0x5f, 0x7e, 0xeb, 0xf0, 0x48, 0xcc, 0xab, 0x72, 0xc9, 0x57, 0xd0, 0x76, 0xda, 0xd8, 0x10,
+  0x55, 0x2d, 0x91, 0xfa, 0x50, 0x3c, 0xf5, 0x89, 0x6a, 0xae, 0x9f, 0x06, 0x61, 0x82, 0xcc, 0x06,
+  0x51, 0x05, 0x53, 0x17, 0x38, 0x3e, 0x4e, 0x12, 0x04, 0x7d, 0x3c, 0x25, 0x3e, 0xb4, 0x71, 0x51,
+  0x08, 0x56, 0xd7, 0xaa, 0x85, 0x6e, 0xbb, 0xeb, 0xb9, 0x08, 0x66, 0x1a, 0x83, 0xb6, 0x46, 0x0d,
+  0x95, 0xf8, 0x42, 0x76, 0x80, 0x1d, 0xf0, 0x9c, 0xc2, 0x26, 0xcb, 0x7b, 0x64, 0xcf, 0xb8, 0xd8,
+  0x1c, 0x32, 0xc1, 0x3a, 0xa9, 0xcb, 0x13, 0xd8, 0x23, 0x7f, 0x9a, 0x95, 0x45, 0x27, 0xf7, 0x5e,
+  0x01, 0x7d, 0xce, 0x15, 0xec, 0xd7, 0x8e, 0x95, 0xf9, 0xb1, 0x7b, 0xf0, 0x19, 0xed, 0xa1, 0x90,
+  0xf0, 0x55, 0x99, 0xad, 0x41, 0x22, 0x05, 0x2b, 0x57, 0xf2, 0xa1, 0xa3, 0x23, 0xea, 0x9a, 0xf7,
+  0x97, 0x90, 0x15, 0x08, 0x2b, 0x5e, 0x77, 0x7b, 0x50, 0x97, 0xa2, 0x8f, 0x82, 0xcc, 0x24, 0xaf,
+  0xca, 0x6e, 0xa6, 0xc6, 0x7a, 0x35, 0x4f, 0x4a, 0x26, 0x8e, 0xe0, 0xb6, 0x5a, 0xcb, 0x6c, 0xc5,
+  0x9e, 0xf4, 0xb1, 0xdd, 0xeb, 0xaa, 0x18, 0xad, 0xa3, 0x1a, 0x6f, 0x9b, 0x76, 0xac, 0x6c, 0x29,
+  0x19, 0x50, 0xa6, 0x93, 0xa2, 0x5a, 0x2b, 0x47, 0x37, 0xfe, 0x9a, 0x2d, 0xe2, 0xa0, 0x4d, 0xcf,
+  0x35, 0x0c, 0x7b, 0xbb, 0xb0, 0xcd, 0xda, 0xa9, 0x5f, 0xfd, 0x99, 0xb7, 0xb1, 0x2d, 0x2f, 0x8c,
+  0x52, 0x0a, 0x9a, 0x81, 0x83, 0x20, 0x25, 0xdf, 0x29, 0x3c, 0x8d, 0x90, 0xd7, 0x3c, 0x98, 0xba,
+  0xe5, 0x6e, 0xc3, 0xc0, 0xbb, 0xe1, 0xe0, 0xf3, 0xf8, 0xfd, 0xff, 0xa5, 0xf7, 0x2d, 0xfd, 0x95,
+  0x16, 0xb4, 0xad, 0x84, 0xf8, 0xc4, 0xa1, 0x27, 0x8d, 0xb3, 0x19, 0x35, 0xf8, 0xaf, 0xd4, 0xbc,
+  0x69, 0x4b, 0x12, 0xe1, 0x10, 0x99, 0x67, 0xd1, 0x66, 0x86, 0x78, 0xe1, 0x0d, 0xec, 0x16, 0x96,
+  0xa4, 0xd3, 0xc0, 0x53, 0xa5, 0xdd, 0x62, 0x3f, 0x55, 0xcb, 0x74, 0x5b, 0x64, 0x52, 0xd7, 0x36,
+  0x7f, 0x5a, 0xdb, 0x53, 0xc1, 0xd3, 0x6c, 0x69, 0xfb, 0xcb, 0x84, 0xa8, 0xc4, 0x0b, 0x4f, 0x6a,
+  0x34, 0x6f, 0xd7, 0xc4, 0xd3, 0xf8, 0x32, 0xf4, 0x48, 0xff, 0x03, 0xe5, 0x55, 0xa0, 0xf1, 0xea,
+  0x05, 0x00, 0x00,
+};
+
+static const WebAsset webAssets[] =
+{
+  { "/app.js", "application/javascript", "4827ef9ce12329d7", true, webAsset_app_js, sizeof(webAsset_app_js) },
+  { "/style.css", "text/css", "9f2a37933081e05f", true, webAsset_style_css, sizeof(webAsset_style_css) },
+  { "/", "text/html", "e9b06d5c499b05e6", false, webAsset_index_html, sizeof(webAsset_index_html) },
+};
+
+#endif // WEB_ASSETS_H
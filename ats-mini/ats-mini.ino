@@ -13,13 +13,20 @@
 #include "Utils.h"
 #include "EIBI.h"
 #include "Remote.h"
+#include "RemoteTcp.h"
+#include "Script.h"
+#include "Api.h"
+#include "Ota.h"
+#include "Metrics.h"
+#include "Mqtt.h"
 //#include "Ble.h"
 
 #include "Beacons.h"
+#include "History.h"
+#include "Meter.h"
 
 // SI473/5 and UI
 #define MIN_ELAPSED_TIME         5  // 300
-#define MIN_ELAPSED_RSSI_TIME  200  // RSSI check uses IN_ELAPSED_RSSI_TIME * 6 = 1.2s
 #define ELAPSED_COMMAND      10000  // time to turn off the last command controlled by encoder. Time to goes back to the VFO control // G8PTN: Increased time and corrected comment
 #define DEFAULT_VOLUME          35  // change it for your favorite sound volume
 #define DEFAULT_SLEEP            0  // Default sleep interval, range = 0 (off) to 255 in steps of 5
@@ -42,6 +49,8 @@ bool seekStop = false;        // G8PTN: Added flag to abort seeking on rotary en
 bool pushAndRotate = false;   // Push and rotate is active, ignore the long press
 
 long elapsedRSSI = millis();
+uint32_t elapsedMeterRedraw = millis();
+bool meterRedraw = false;
 long elapsedButton = millis();
 
 long lastStrengthCheck = millis();
@@ -103,7 +112,11 @@ RemoteState remoteBLEState;
 Rotary encoder  = Rotary(ENCODER_PIN_B, ENCODER_PIN_A);
 ButtonTracker pb1 = ButtonTracker();
 TFT_eSPI tft    = TFT_eSPI();
+#ifdef PALETTE_SPRITE
+PaletteSprite spr = PaletteSprite(&tft);
+#else
 TFT_eSprite spr = TFT_eSprite(&tft);
+#endif
 SI4735_fixed rx;
 //NordicUART BLESerial = NordicUART(RECEIVER_NAME);
 
@@ -164,6 +177,10 @@ void setup()
   }
 
   tft.fillScreen(TH.bg);
+#ifdef PALETTE_SPRITE
+  // 8-bit palette indices instead of 16-bit colors
+  spr.setColorDepth(8);
+#endif
   spr.createSprite(320, 170);
   spr.setTextDatum(MC_DATUM);
   spr.setSwapBytes(true);
@@ -427,6 +444,8 @@ void useBand(const Band *band)
   // Clear signal strength readings
   rssi = 0;
   snr  = 0;
+  meterReset(&rssiMeter);
+  meterReset(&snrMeter);
 }
 
 //
@@ -568,6 +587,8 @@ bool doSeek(int16_t enc, int16_t enca)
       // Clear stale parameters
       clearStationInfo();
       rssi = snr = 0;
+      meterReset(&rssiMeter);
+      meterReset(&snrMeter);
 
       // Flag is set by rotary encoder and cleared on seek/scan entry
       seekStop = false;
@@ -698,13 +719,16 @@ bool clickFreq(bool shortPress)
 
 bool processRssiSnr()
 {
-  static uint32_t updateCounter = 0;
   bool needRedraw = false;
 
   rx.getCurrentReceivedSignalQuality();
   int newRSSI = rx.getCurrentRSSI();
   int newSNR = rx.getCurrentSNR();
 
+  // Feed raw samples to the long-term signal history and telemetry
+  historyAddSample(newRSSI, newSNR);
+  mqttSample(newRSSI, newSNR);
+
   // Apply squelch if the volume is not muted
   if(currentSquelch && currentSquelch <= 127)
   {
@@ -722,22 +746,27 @@ bool processRssiSnr()
     muteOn(MUTE_SQUELCH, false);
   }
 
-  // G8PTN: Based on 1.2s interval, update RSSI & SNR
-  if(!(updateCounter++ & 7))
+  // Smooth RSSI & SNR for display
+  uint32_t now = millis();
+  uint8_t oldPeak = meterPeak(&rssiMeter);
+  meterUpdate(&rssiMeter, newRSSI, now);
+  meterUpdate(&snrMeter, newSNR, now);
+
+  // Show RSSI status only if this condition has changed
+  if(meterValue(&rssiMeter) != rssi)
   {
-    // Show RSSI status only if this condition has changed
-    if(newRSSI != rssi)
-    {
-      rssi = newRSSI;
-      needRedraw = true;
-    }
-    // Show SNR status only if this condition has changed
-    if(newSNR != snr)
-    {
-      snr = newSNR;
-      needRedraw = true;
-    }
+    rssi = meterValue(&rssiMeter);
+    needRedraw = true;
+  }
+  // Show SNR status only if this condition has changed
+  if(meterValue(&snrMeter) != snr)
+  {
+    snr = meterValue(&snrMeter);
+    needRedraw = true;
   }
+  // Show RSSI peak if it has moved
+  needRedraw |= meterPeak(&rssiMeter) != oldPeak;
+
   return needRedraw;
 }
 
@@ -749,6 +778,8 @@ void loop()
   uint32_t currentTime = millis();
   bool needRedraw = false;
 
+  metricsTickTime();
+
   uint32_t encCounts = consumeEncoderCounts();
   int16_t encCount = (int16_t)(encCounts & 0xFFFF);
   int16_t encCountAccel = (int16_t)(encCounts >> 16);
@@ -757,6 +788,7 @@ void loop()
 
   // Periodically print status to remote interfaces
   serialTickTime(&Serial, &remoteSerialState, usbModeIdx);
+  remoteTcpTickTime();
   //remoteBLETickTime(&BLESerial, &remoteBLEState, bleModeIdx);
 
   // if(encCount && getCpuFrequencyMhz()!=240) setCpuFrequencyMhz(240);
@@ -770,6 +802,29 @@ void loop()
   encCountAccel = ser_direction? ser_direction : encCountAccel;
   if(ser_event & REMOTE_PREFS) prefsRequestSave(SAVE_ALL);
 
+  // Receive and execute network command
+  int tcp_event = remoteTcpDoCommand();
+  needRedraw |= !!(tcp_event & REMOTE_CHANGED);
+  pb1st.wasClicked |= !!(tcp_event & REMOTE_CLICK);
+  int tcp_direction = tcp_event >> REMOTE_DIRECTION;
+  encCount = tcp_direction? tcp_direction : encCount;
+  encCountAccel = tcp_direction? tcp_direction : encCountAccel;
+  if(tcp_event & REMOTE_PREFS) prefsRequestSave(SAVE_ALL);
+
+  // Apply changes made through the REST API
+  int api_event = apiDoCommand();
+  needRedraw |= !!(api_event & REMOTE_CHANGED);
+  if(api_event & REMOTE_PREFS) prefsRequestSave(SAVE_ALL);
+
+  // Execute script statements
+  int script_event = scriptTickTime();
+  needRedraw |= !!(script_event & REMOTE_CHANGED);
+  pb1st.wasClicked |= !!(script_event & REMOTE_CLICK);
+  int script_direction = script_event >> REMOTE_DIRECTION;
+  encCount = script_direction? script_direction : encCount;
+  encCountAccel = script_direction? script_direction : encCountAccel;
+  if(script_event & REMOTE_PREFS) prefsRequestSave(SAVE_ALL);
+
   // Receive and execute BLE command
   /*
   int ble_event = bleDoCommand(&BLESerial, &remoteBLEState, bleModeIdx);
@@ -947,9 +1002,9 @@ void loop()
     elapsedSleep = elapsedCommand = currentTime = millis();
   }
 
-  if((currentTime - elapsedRSSI) > MIN_ELAPSED_RSSI_TIME)
+  if((currentTime - elapsedRSSI) > METER_SAMPLE_TIME)
   {
-    needRedraw |= processRssiSnr();
+    meterRedraw |= processRssiSnr();
     elapsedRSSI = currentTime;
   }
 
@@ -979,10 +1034,19 @@ void loop()
   prefsTickTime();
 
   // Tick NETWORK time, connecting to WiFi if requested
-  netTickTime();
+  needRedraw |= netTickTime();
+
+  // Refresh Solar/DX data in the background
+  needRedraw |= propagationTickTime();
+
+  // Reboot after a firmware update, keep a new firmware once it runs
+  otaTickTime();
   
   // Run clock
   needRedraw |= clockTickTime();
+
+  // Record signal history at a fixed rate
+  needRedraw |= historyTickTime();
   
   // Run beacon logic
   beaconRun();
@@ -997,8 +1061,26 @@ void loop()
     background_timer = currentTime;
   }
 
+  // Push live state changes to the WebSocket clients
+  apiSocketTick(needRedraw || meterRedraw);
+
+  // If only the signal has changed, just update the meters. Screens
+  // without separately updatable meters are redrawn periodically.
+  if(!needRedraw && meterRedraw)
+  {
+    if(drawMeters())
+      meterRedraw = false;
+    else
+      needRedraw = (currentTime - elapsedMeterRedraw) > METER_REDRAW_TIME;
+  }
+
   // Redraw screen if necessary
-  if(needRedraw) drawScreen();
+  if(needRedraw)
+  {
+    drawScreen();
+    meterRedraw = false;
+    elapsedMeterRedraw = currentTime;
+  }
 
   // Add a small default delay in the main loop
   delay(5);
@@ -0,0 +1,97 @@
+// Status page: initial state from the REST API, then live changes
+// over the WebSocket. Changes are sent as PUT /api/v1/status.
+
+var state = {};
+
+function show(id, text)
+{
+  document.getElementById(id).textContent = text;
+}
+
+function fm()
+{
+  return state.mode == 'FM';
+}
+
+function formatFrequency(hz)
+{
+  return fm() ? (hz / 1e6).toFixed(2) + 'MHz' : (hz / 1e3).toFixed(3) + 'kHz';
+}
+
+function update(changes)
+{
+  var form = document.getElementById('control');
+  var editing = form.contains(document.activeElement);
+
+  Object.assign(state, changes);
+
+  show('band', state.band);
+  show('frequency', formatFrequency(state.frequency) + ' ' + state.mode);
+  show('rssi', state.rssi + 'dBuV');
+  show('snr', state.snr + 'dB');
+  show('station', state.station);
+  show('unit', 'Frequency (' + (fm() ? 'MHz' : 'kHz') + ')');
+
+  // Do not overwrite what is being typed
+  if(!editing)
+  {
+    form.frequency.value = fm() ? (state.frequency / 1e6).toFixed(2) : (state.frequency / 1e3).toFixed(3);
+    form.volume.value = state.volume;
+    form.band.value = state.band;
+  }
+}
+
+function connect()
+{
+  var ws = new WebSocket('ws://' + location.host + '/api/v1/ws');
+
+  ws.onmessage = function(e) { update(JSON.parse(e.data)); };
+  ws.onclose = function() { setTimeout(connect, 2000); };
+}
+
+function submit(e)
+{
+  var form = e.target;
+  var change = { volume: +form.volume.value };
+  var scale = fm() ? 1e6 : 1e3;
+
+  e.preventDefault();
+
+  if(form.band.value != state.band)
+    change.band = form.band.value;
+  else
+    change.frequency = Math.round(form.frequency.value * scale);
+
+  fetch('/api/v1/status', { method: 'PUT', body: JSON.stringify(change) })
+    .then(function(r) { return r.json(); })
+    .then(function(r) { show('error', r.error || ''); });
+}
+
+function start()
+{
+  var form = document.getElementById('control');
+
+  show('address', location.host);
+  form.addEventListener('submit', submit);
+
+  fetch('/api/v1/bands')
+    .then(function(r) { return r.json(); })
+    .then(function(bands) {
+      bands.forEach(function(b) {
+        // Some band names are used twice, the first one is selected by name
+        if(!form.band.querySelector('[value="' + b.name + '"]'))
+          form.band.add(new Option(b.name, b.name));
+      });
+      return fetch('/api/v1/status');
+    })
+    .then(function(r) { return r.json(); })
+    .then(function(s) {
+      show('mac', s.mac);
+      show('firmware', s.firmware);
+      show('battery', s.battery.toFixed(2) + 'V');
+      update(s);
+      connect();
+    });
+}
+
+start();
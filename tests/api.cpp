@@ -0,0 +1,278 @@
+#include "test.h"
+#include "Common.h"
+#include "Menu.h"
+#include "Api.h"
+#include <ESPAsyncWebServer.h>
+#include <string>
+
+//
+// REST API and WebSocket as the web server task drives them: request
+// bodies that are not JSON or end early, string escapes both ways,
+// document items longer than the chunk buffer, and WebSocket updates
+// fanned out to every client at most once per interval
+//
+
+String loginUsername = "";
+String loginPassword = "";
+extern const char *hostStationName;
+
+static AsyncWebServer server;
+
+static AsyncWebSocket *socket()
+{
+  static bool started = false;
+
+  if(!started) apiInit(&server);
+  started = true;
+  return((AsyncWebSocket *)server.added[0]);
+}
+
+// Apply what was queued, returns the number of changes
+static int apply()
+{
+  int n = 0;
+  while(apiDoCommand()) n++;
+  return(n);
+}
+
+static void reset()
+{
+  socket();
+  apply();
+  selectBand(2, false);
+  volume = 35;
+  hostStationName = "";
+  loginUsername = loginPassword = "";
+  memset(memories, 0, MEMORY_COUNT * sizeof(Memory));
+}
+
+// GET, the chunked response taken in pieces of the given size
+static std::string get(const char *uri, size_t chunkSize = 1436)
+{
+  AsyncWebServerRequest r;
+
+  r.chunkSize = chunkSize;
+  server.handler(uri, HTTP_GET)->request(&r);
+  CHECK_EQ(r.code, 200);
+  return(r.body);
+}
+
+// PUT with the body coming in pieces of the given size
+static std::string put(const char *uri, const std::string &body, int *code, size_t piece = 1436)
+{
+  AsyncWebServerRequest r;
+  AsyncWebServer::Handler *h = server.handler(uri, HTTP_PUT);
+
+  for(size_t i=0 ; i<body.size() || !i ; i+=piece)
+  {
+    std::string part = body.substr(i, piece);
+    h->body(&r, (uint8_t *)part.data(), part.size(), i, body.size());
+  }
+
+  h->request(&r);
+  *code = r.code;
+  return(r.body);
+}
+
+TEST(apiMalformedJson)
+{
+  reset();
+
+  static const struct { const char *body, *error; } bad[] =
+  {
+    { "",                     "Expected an object" },
+    { "[]",                   "Expected an object" },
+    { "{",                    "Expected a string" },
+    { "{\"volume\"",          "Expected ':'" },
+    { "{\"volume\":",         "Expected an integer" },
+    { "{\"volume\":10",       "Expected ',' or '}'" },
+    { "{\"volume\":10,}",     "Expected a string" },
+    { "{\"volume\":10}}",     "Unexpected data after the document" },
+    { "{\"volume\":0x10}",    "Expected an integer" },
+    { "{\"volume\":10.5}",    "Expected an integer" },
+    { "{\"volume\":nan}",     "Expected an integer" },
+    { "{\"volume\":99}",      "Invalid volume" },
+    { "{\"mode\":\"AM",       "Invalid string" },
+    { "{\"mode\":\"AM\\",     "Invalid string" },
+    { "{\"mode\":\"\\u00",    "Invalid string" },
+    { "{\"mode\":\"\\x41\"}", "Invalid string" },
+    { "{\"mode\":\"A\nM\"}",  "Invalid string" },
+    { "{\"band\":\"XX\"}",    "No such band" },
+    { "{\"x\":[1,2",          "Expected ',' or ']'" },
+    { "{\"x\":{\"y\":tru}}",  "Invalid value" },
+    { "{\"x\":[[[[[[[[[[[]]]]]]]]]]]}", "Nested too deep" },
+  };
+
+  for(const auto &b : bad)
+  {
+    int code;
+    std::string reply = put("/api/v1/status", b.body, &code);
+    if(code != 400 || reply != std::string("{\"error\":\"") + b.error + "\"}")
+    {
+      printf("  %s: %d %s\n", b.body, code, reply.c_str());
+      CHECK_EQ(code, 400);
+    }
+  }
+
+  // Nothing got through, and the good one still does
+  CHECK_EQ(apply(), 0);
+  CHECK_EQ(volume, 35);
+
+  int code;
+  put("/api/v1/status", " { \"volume\" : 1e1, \"x\" : [ {}, null, \"]\" ] } ", &code, 3);
+  CHECK_EQ(code, 202);
+  CHECK_EQ(apply(), 1);
+  CHECK_EQ(volume, 10);
+
+  // A body too large is not collected at all
+  std::string big = "{\"volume\":1" + std::string(API_MAX_BODY, ' ') + "}";
+  CHECK(put("/api/v1/status", big, &code) == "{\"error\":\"Missing or too large body\"}");
+  CHECK_EQ(code, 400);
+  CHECK_EQ(apply(), 0);
+}
+
+TEST(apiEscapedStrings)
+{
+  reset();
+  int code;
+
+  // Escapes in names and values, non-ASCII characters are replaced,
+  // names truncated to the memory name size
+  put("/api/v1/memories",
+    "[{\"slot\":1,\"band\":\"M\\u0057\",\"frequency\":810000,\"mode\":\"AM\",\"name\":\"\\\"q\\\\\\/\\u0041\\t\"},"
+    " {\"slot\":2,\"band\":\"MW\",\"frequency\":999000,\"mode\":\"AM\",\"name\":\"caf\\u00e9\"},"
+    " {\"slot\":3,\"band\":\"SW\",\"frequency\":7100000,\"mode\":\"AM\",\"name\":\"0123456789AB\"}]",
+    &code);
+  CHECK_EQ(code, 202);
+  CHECK_EQ(apply(), 3);
+  CHECK(!strcmp(memories[0].name, "\"q\\/A\t"));
+  CHECK(!strcmp(memories[1].name, "caf?"));
+  CHECK(!strncmp(memories[2].name, "0123456789", sizeof(memories[2].name)));
+
+  // Sent back with escapes, control characters as \u
+  std::string doc = get("/api/v1/memories");
+  CHECK(doc.find("\"name\":\"\\\"q\\\\/A\\u0009\"") != std::string::npos);
+  CHECK(doc.find("\"name\":\"caf?\"") != std::string::npos);
+  CHECK(doc.find("\"name\":\"0123456789\"}]") != std::string::npos);
+  CHECK(doc.find("\"band\":\"MW\"") != std::string::npos);
+}
+
+TEST(apiLongItem)
+{
+  reset();
+
+  // Control characters take six bytes each, making the second status
+  // item longer than the 384 byte item buffer
+  std::string station(100, '\x01'), escaped;
+  for(size_t i=0 ; i<station.size() ; i++) escaped += "\\u0001";
+  hostStationName = station.c_str();
+
+  std::string doc = get("/api/v1/status");
+  size_t at = doc.find("\"station\":\"");
+  CHECK(at != std::string::npos);
+  CHECK(doc.compare(at + 11, escaped.size() + 1, escaped + "\"") == 0);
+  CHECK(doc.find("\"mac\":\"02:00:00:00:00:01\"}") == doc.size() - 26);
+  CHECK(doc.find("\"band\"") == doc.rfind("\"band\""));
+  CHECK_EQ(doc[0], '{');
+
+  // Same document whatever the connection takes at once
+  for(size_t chunk : { 1, 7, 383, 384, 385, 5744 })
+    CHECK(get("/api/v1/status", chunk) == doc);
+
+  hostStationName = "";
+  CHECK(get("/api/v1/status").size() == doc.size() - (escaped.size()));
+}
+
+TEST(apiSocketFanOut)
+{
+  reset();
+  AsyncWebSocket *ws = socket();
+  AsyncWebServerRequest r;
+  AsyncWebSocketClient *clients[API_WS_CLIENTS];
+
+  // One client more than allowed is closed right away
+  for(int i=0 ; i<API_WS_CLIENTS ; i++) clients[i] = ws->connect(&r);
+  AsyncWebSocketClient *extra = ws->connect(&r);
+  CHECK(extra->closed);
+  CHECK_EQ(ws->count(), API_WS_CLIENTS);
+
+  // New clients get every field once
+  hostAdvance(API_WS_INTERVAL);
+  apiSocketTick(false);
+  for(auto *c : clients)
+  {
+    CHECK_EQ(c->messages.size(), 1);
+    CHECK(c->messages.size() && c->messages[0].find("\"band\":\"SW\"") != std::string::npos);
+  }
+  CHECK(extra->messages.empty());
+
+  // The signal changes every 10 ms for a second, each client gets
+  // the changes at most once per interval
+  for(int t=0 ; t<1000 ; t+=10)
+  {
+    rssi = t / 10;
+    hostAdvance(10);
+    apiSocketTick(true);
+  }
+  for(auto *c : clients)
+  {
+    CHECK(c->messages.size() >= 1 + 1000 / API_WS_INTERVAL);
+    CHECK(c->messages.size() <= 2 + 1000 / API_WS_INTERVAL);
+    CHECK(c->messages == clients[0]->messages);
+    CHECK(c->messages.back() == "{\"rssi\":99}");
+  }
+
+  // Nothing changed, nothing sent
+  size_t sent = clients[0]->messages.size();
+  for(int t=0 ; t<1000 ; t+=10)
+  {
+    hostAdvance(10);
+    apiSocketTick(false);
+  }
+  CHECK_EQ(clients[0]->messages.size(), sent);
+
+  // A change right after an update waits for the interval
+  rssi = 1;
+  apiSocketTick(true);
+  CHECK_EQ(clients[0]->messages.size(), sent + 1);
+  rssi = 2;
+  hostAdvance(API_WS_INTERVAL - 1);
+  apiSocketTick(true);
+  CHECK_EQ(clients[0]->messages.size(), sent + 1);
+  hostAdvance(1);
+  apiSocketTick(false);
+  CHECK_EQ(clients[0]->messages.size(), sent + 2);
+
+  // A freed place takes a new client
+  ws->disconnect(clients[0]);
+  clients[0] = ws->connect(&r);
+  CHECK(!clients[0]->closed);
+  CHECK_EQ(ws->count(), API_WS_CLIENTS);
+  ws->closeAll();
+}
+
+TEST(apiSocketChanges)
+{
+  reset();
+  AsyncWebSocket *ws = socket();
+  AsyncWebServerRequest guest, admin;
+
+  // Changes need the login, watching does not
+  loginUsername = "admin";
+  loginPassword = "secret";
+  admin.login = "admin:secret";
+  AsyncWebSocketClient *g = ws->connect(&guest);
+  AsyncWebSocketClient *a = ws->connect(&admin);
+
+  ws->receive(g, "{\"volume\":20}");
+  CHECK(g->messages.size() && g->messages.back() == "{\"error\":\"Login required\"}");
+  ws->receive(a, "{\"volume\":20}");
+  ws->receive(a, "{\"volume\":");
+  CHECK(a->messages.size() && a->messages.back() == "{\"error\":\"Expected an integer\"}");
+  ws->receive(a, "{\"mode\":\"" + std::string(API_WS_MAX_MESSAGE, 'x') + "\"}");
+  CHECK(a->messages.back() == "{\"error\":\"Message too large\"}");
+
+  CHECK_EQ(apply(), 1);
+  CHECK_EQ(volume, 20);
+  ws->closeAll();
+}
@@ -0,0 +1,208 @@
+#include "test.h"
+#include "Astro.h"
+#include <math.h>
+#include <string.h>
+
+//
+// Sun position, sunrise/sunset and greyline times against published
+// almanac values and a Meeus (ch. 25) solar position, and the location
+// parser
+//
+
+// Meeus low precision solar elevation, jd in UT
+static double meeusElevation(double jd, double lat, double lon)
+{
+  double t = (jd - 2451545.0) / 36525.0, r = M_PI / 180;
+  double l0 = fmod(280.46646 + 36000.76983 * t + 0.0003032 * t * t, 360);
+  double m = 357.52911 + 35999.05029 * t - 0.0001537 * t * t;
+  double c = (1.914602 - 0.004817 * t) * sin(m * r) + (0.019993 - 0.000101 * t) * sin(2 * m * r) + 0.000289 * sin(3 * m * r);
+  double om = 125.04 - 1934.136 * t;
+  double lam = l0 + c - 0.00569 - 0.00478 * sin(om * r);
+  double eps = 23.4392911 - 0.0130042 * t + 0.00256 * cos(om * r);
+  double ra = atan2(cos(eps * r) * sin(lam * r), cos(lam * r));
+  double dec = asin(sin(eps * r) * sin(lam * r));
+  double gmst = fmod(280.46061837 + 360.98564736629 * (jd - 2451545.0), 360);
+  double ha = gmst * r + lon * r - ra;
+  return(asin(sin(lat * r) * sin(dec) + cos(lat * r) * cos(dec) * cos(ha)) / r);
+}
+
+// Julian date at 0h UT
+static double julian(int y, int m, int d)
+{
+  if(m <= 2) { y--; m += 12; }
+  int a = y / 100, b = 2 - a + a / 4;
+  return(floor(365.25 * (y + 4716)) + floor(30.6001 * (m + 1)) + d + b - 1524.5);
+}
+
+// Days since 1970-01-01
+static uint16_t day(int y, int m, int d)
+{
+  return(julian(y, m, d) - 2440587.5);
+}
+
+// Minutes between two times of the day
+static double apart(double a, double b)
+{
+  return(fabs(remainder(a - b, 1440)));
+}
+
+// Crossing nearest to the estimate, found in 5 second steps
+static double meeusCrossing(int y, int m, int d, double lat, double lon, double h, bool rising, double estimate)
+{
+  double jd0 = julian(y, m, d), best = -1, bestApart = 1e9;
+
+  for(double t = -720 * 60 ; t < 2160 * 60 ; t += 5)
+  {
+    double e1 = meeusElevation(jd0 + t / 86400.0, lat, lon) - h;
+    double e2 = meeusElevation(jd0 + (t + 5) / 86400.0, lat, lon) - h;
+    if((rising && e1 < 0 && e2 >= 0) || (!rising && e1 >= 0 && e2 < 0))
+    {
+      double min = fmod((t + 2.5) / 60.0 + 2880, 1440);
+      if(apart(min, estimate) < bestApart) { bestApart = apart(min, estimate); best = min; }
+    }
+  }
+
+  return(best);
+}
+
+TEST(almanacTimes)
+{
+  // Sunrise and sunset (minutes UTC) from published almanacs
+  static const struct { const char *name; int y, m, d; float lat, lon; int rise, set; } almanac[] =
+  {
+    { "London",   2024, 6,  21, 51.5074f,  -0.1278f,   3*60+43, 20*60+21 },
+    { "London",   2024, 12, 21, 51.5074f,  -0.1278f,   8*60+4,  15*60+53 },
+    { "New York", 2024, 12, 21, 40.7128f,  -74.0060f,  12*60+17, 21*60+32 },
+    { "Sydney",   2024, 12, 21, -33.8688f, 151.2093f,  18*60+41, 9*60+5 },
+  };
+
+  for(const auto &a : almanac)
+  {
+    AstroSun sun;
+    AstroPlace place;
+    AstroTimes times;
+
+    astroSunAt(&sun, day(a.y, a.m, a.d), 720);
+    astroPlace(&place, a.name, a.lat, a.lon);
+    astroTimes(&sun, &place, &times);
+
+    CHECK(apart(times.sunrise, a.rise) <= 2);
+    CHECK(apart(times.sunset, a.set) <= 2);
+  }
+}
+
+TEST(polarDayAndNight)
+{
+  AstroSun sun;
+  AstroPlace place;
+  AstroTimes times;
+
+  astroPlace(&place, "Tromso", 69.65f, 18.96f);
+
+  // Midnight sun, no greyline either
+  astroSunAt(&sun, day(2024, 6, 21), 720);
+  astroTimes(&sun, &place, &times);
+  CHECK_EQ(times.sunrise, -1);
+  CHECK_EQ(times.sunset, -1);
+  CHECK_EQ(astroState(astroElevation(&sun, &place, 22 * 60)), ASTRO_DAY);
+
+  // Polar night, twilight at noon
+  astroSunAt(&sun, day(2024, 12, 21), 720);
+  astroTimes(&sun, &place, &times);
+  CHECK_EQ(times.sunrise, -1);
+  CHECK_EQ(times.sunset, -1);
+  CHECK(times.dawn >= 0 && times.dusk >= 0);
+  CHECK_EQ(astroState(astroElevation(&sun, &place, 0)), ASTRO_NIGHT);
+}
+
+TEST(declination)
+{
+  AstroSun sun;
+
+  astroSunAt(&sun, day(2024, 6, 20), 720);
+  CHECK_NEAR(sun.decl, 23.44, 0.1);
+  astroSunAt(&sun, day(2024, 12, 21), 720);
+  CHECK_NEAR(sun.decl, -23.44, 0.1);
+  astroSunAt(&sun, day(2024, 3, 20), 720);
+  CHECK_NEAR(sun.decl, 0, 0.4);
+}
+
+TEST(meeusGrid)
+{
+  double worstTimes = 0, worstElevation = 0;
+
+  for(int m=1 ; m<=12 ; m++)
+    for(float lat=-60 ; lat<=60 ; lat+=15)
+      for(float lon=-165 ; lon<=180 ; lon+=55)
+      {
+        int y = 2025, d = 1 + m * 7 % 28;
+        AstroSun sun;
+        AstroPlace place;
+        AstroTimes times;
+
+        astroSunAt(&sun, day(y, m, d), 720);
+        astroPlace(&place, "", lat, lon);
+        astroTimes(&sun, &place, &times);
+
+        // Dawn, sunrise, sunset, dusk
+        const int16_t t[4] = { times.dawn, times.sunrise, times.sunset, times.dusk };
+        for(int k=0 ; k<4 ; k++)
+        {
+          if(t[k] < 0) continue;
+          double h = k==0 || k==3 ? ASTRO_TWILIGHT : ASTRO_RISE_SET;
+          worstTimes = fmax(worstTimes, apart(t[k], meeusCrossing(y, m, d, lat, lon, h, k<2, t[k])));
+        }
+
+        for(int utc=0 ; utc<1440 ; utc+=37)
+        {
+          astroSunAt(&sun, day(y, m, d), utc);
+          double e = astroElevation(&sun, &place, utc) - meeusElevation(julian(y, m, d) + utc / 1440.0, lat, lon);
+          worstElevation = fmax(worstElevation, fabs(e));
+        }
+      }
+
+  CHECK_NEAR(worstTimes, 0, 1);
+  CHECK_NEAR(worstElevation, 0, 0.05);
+}
+
+TEST(parseLocation)
+{
+  int16_t lat = 0, lon = 0;
+
+  CHECK(astroParseLocation("JN47pm", &lat, &lon));
+  CHECK_EQ(lat, 4752);
+  CHECK_EQ(lon, 929);
+  CHECK(astroParseLocation("fn20", &lat, &lon));
+  CHECK_EQ(lat, 4050);
+  CHECK_EQ(lon, -7500);
+  CHECK(astroParseLocation(" -33.87 , 151.21 ", &lat, &lon));
+  CHECK_EQ(lat, -3387);
+  CHECK_EQ(lon, 15121);
+
+  // Stored degrees read back as they were written
+  CHECK(astroParseLocation("47.50,8.60", &lat, &lon));
+  CHECK_EQ(lat, 4750);
+  CHECK_EQ(lon, 860);
+
+  static const char *bad[] = { "", "JN4", "JN47p", "ZZ00", "JN47zz", "91,0", "0,181", "1,2,3", "JN47pm x" };
+  for(const char *text : bad)
+  {
+    lat = lon = 1;
+    CHECK(!astroParseLocation(text, &lat, &lon));
+    CHECK(lat == 1 && lon == 1);
+  }
+}
+
+TEST(locator)
+{
+  char locator[7];
+
+  astroLocator(4752, 929, locator);
+  CHECK(!strcmp(locator, "JN47pm"));
+  astroLocator(-3387, 15121, locator);
+  CHECK(!strcmp(locator, "QF56od"));
+  astroLocator(9000, 18000, locator);
+  CHECK(!strcmp(locator, "RR99xx"));
+  astroLocator(ASTRO_NO_LOCATION, 0, locator);
+  CHECK(!strcmp(locator, ""));
+}
@@ -0,0 +1,217 @@
+#include "test.h"
+#include "Common.h"
+#include "Menu.h"
+#include "Binary.h"
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+//
+// COBS framing of the binary protocol: known encodings, round trips
+// over zero runs and block boundaries, damaged input, and frames of
+// the largest size through binaryDoCommand()
+//
+
+typedef std::vector<uint8_t> Bytes;
+
+struct TestStream : public Stream
+{
+  std::string in, out;
+  size_t pos = 0;
+
+  int available() override { return(in.size() - pos); }
+  int read() override { return(pos < in.size() ? (uint8_t)in[pos++] : -1); }
+  int peek() override { return(pos < in.size() ? (uint8_t)in[pos] : -1); }
+  size_t write(uint8_t c) override { out += (char)c; return(1); }
+};
+
+static Bytes encode(const Bytes &data)
+{
+  Bytes out(data.size() + data.size() / 254 + 2);
+  out.resize(cobsEncode(data.data(), data.size(), out.data()));
+  return(out);
+}
+
+static bool roundTrip(const Bytes &data)
+{
+  Bytes enc = encode(data);
+
+  // No zeros inside a frame, overhead of one byte per 254
+  for(uint8_t c : enc) if(!c) return(false);
+  if(enc.size() > data.size() + data.size() / 254 + 2) return(false);
+
+  int length = cobsDecode(enc.data(), enc.size());
+  return(length == (int)data.size() && std::equal(data.begin(), data.end(), enc.begin()));
+}
+
+// Request frame: id, length, body, CRC
+static std::string request(uint16_t id, const Bytes &body)
+{
+  Bytes f = { (uint8_t)id, (uint8_t)(id >> 8), (uint8_t)body.size(), (uint8_t)(body.size() >> 8) };
+  f.insert(f.end(), body.begin(), body.end());
+  uint16_t crc = binaryCrc16(f.data(), f.size());
+  f.push_back(crc);
+  f.push_back(crc >> 8);
+
+  Bytes enc = encode(f);
+  return(std::string(enc.begin(), enc.end()) + '\0');
+}
+
+// Decoded response frame, empty if it is not a valid one
+static Bytes response(const std::string &out)
+{
+  if(out.empty() || out.back() || out.find('\0') != out.size() - 1) return(Bytes());
+
+  Bytes f(out.begin(), out.end() - 1);
+  int length = cobsDecode(f.data(), f.size());
+  if(length < 6) return(Bytes());
+  f.resize(length);
+
+  uint16_t crc = f[length - 2] | (f[length - 1] << 8);
+  if(binaryCrc16(f.data(), length - 2) != crc || (f[2] | (f[3] << 8)) != length - 6) return(Bytes());
+  return(f);
+}
+
+TEST(cobsKnownEncodings)
+{
+  static const struct { Bytes data, enc; } known[] =
+  {
+    { {},                       { 0x01 } },
+    { { 0x00 },                 { 0x01, 0x01 } },
+    { { 0x00, 0x00 },           { 0x01, 0x01, 0x01 } },
+    { { 0x11, 0x22, 0x00, 0x33 }, { 0x03, 0x11, 0x22, 0x02, 0x33 } },
+    { { 0x11, 0x22, 0x33, 0x44 }, { 0x05, 0x11, 0x22, 0x33, 0x44 } },
+    { { 0x11, 0x00, 0x00, 0x00 }, { 0x02, 0x11, 0x01, 0x01, 0x01 } },
+  };
+
+  for(const auto &k : known) CHECK(encode(k.data) == k.enc);
+
+  // A full block of 254 non-zero bytes gets a code of 0xFF, which
+  // does not imply a zero
+  Bytes block(254);
+  for(int j=0 ; j<254 ; j++) block[j] = j + 1;
+  Bytes enc = encode(block);
+  CHECK_EQ(enc[0], 0xFF);
+  CHECK(std::equal(block.begin(), block.end(), enc.begin() + 1));
+  CHECK(roundTrip(block));
+}
+
+TEST(cobsRoundTrip)
+{
+  std::mt19937 rng(31);
+
+  // Zero runs and block boundaries
+  for(size_t n : { 1, 2, 253, 254, 255, 256, 508, 509, BIN_MAX_FRAME, BIN_MAX_RESPONSE })
+  {
+    CHECK(roundTrip(Bytes(n, 0x00)));
+    CHECK(roundTrip(Bytes(n, 0xA5)));
+
+    Bytes b(n, 0x01);
+    b[n - 1] = 0;
+    CHECK(roundTrip(b));
+    b[0] = 0;
+    CHECK(roundTrip(b));
+  }
+
+  // Random data, from mostly zeros to none
+  for(int j=0 ; j<2000 ; j++)
+  {
+    Bytes b(rng() % (BIN_MAX_RESPONSE + 7));
+    unsigned zeros = rng() % 5;
+    for(auto &c : b) c = zeros && !(rng() % (1 << (2 * zeros))) ? 0 : rng() % 255 + 1;
+    if(!roundTrip(b)) { CHECK(roundTrip(b)); break; }
+  }
+}
+
+TEST(cobsDamaged)
+{
+  // Zero code, block running past the end
+  Bytes zero = { 0x03, 0x11, 0x00, 0x33 };
+  Bytes tooLong = { 0x05, 0x11, 0x22 };
+  Bytes lastTooLong = { 0x02, 0x11, 0x04, 0x22 };
+
+  CHECK_EQ(cobsDecode(zero.data(), zero.size()), -1);
+  CHECK_EQ(cobsDecode(tooLong.data(), tooLong.size()), -1);
+  CHECK_EQ(cobsDecode(lastTooLong.data(), lastTooLong.size()), -1);
+}
+
+TEST(binaryLargestFrame)
+{
+  TestStream s;
+  BinaryState state = {};
+  Bytes body;
+
+  // 31 memory writes, clearing slots means runs of zero bytes, and
+  // two reads make the largest request frame
+  for(int slot=1 ; slot<=31 ; slot++)
+  {
+    uint32_t freq = slot & 1 ? 0 : 999000 + slot * 1000;
+    Bytes op = { BIN_SET | BIN_OP_MEMORY, (uint8_t)slot, 1, AM,
+      (uint8_t)freq, (uint8_t)(freq >> 8), (uint8_t)(freq >> 16), (uint8_t)(freq >> 24) };
+    body.insert(body.end(), op.begin(), op.end());
+  }
+  body.push_back(BIN_OP_VOLUME);
+  body.push_back(BIN_OP_RSSI);
+  CHECK_EQ(body.size() + 6, BIN_MAX_FRAME);
+
+  memories[1].freq = 1;
+  s.in = request(0x1234, body);
+  CHECK(binaryDoCommand(&s, &state) & REMOTE_CHANGED);
+
+  Bytes r = response(s.out);
+  CHECK(r.size() > 6);
+  if(r.size() <= 6) return;
+  CHECK_EQ(r[0] | (r[1] << 8), 0x1234);
+
+  // Each memory comes back as op, status, type, slot, band, mode, Hz
+  for(int slot=1 ; slot<=31 ; slot++)
+  {
+    const uint8_t *m = &r[4 + (slot - 1) * 10];
+    uint32_t freq = m[6] | (m[7] << 8) | (m[8] << 16) | ((uint32_t)m[9] << 24);
+    CHECK_EQ(m[1], BIN_OK);
+    CHECK_EQ(m[3], slot);
+    CHECK_EQ(freq, slot & 1 ? 0 : 999000 + slot * 1000);
+  }
+  CHECK_EQ(memories[1].freq, 1001000);
+  CHECK_EQ(r[4 + 31 * 10], BIN_OP_VOLUME);
+  CHECK_EQ(r[4 + 31 * 10 + 1], BIN_OK);
+
+  // One byte more than the buffer holds is reported, and the stream
+  // stays in sync for the next frame
+  s.out.clear();
+  s.in = std::string(sizeof(state.buf) + 1, 'x') + '\0' + request(7, { BIN_OP_VERSION });
+  s.pos = 0;
+  binaryDoCommand(&s, &state);
+
+  size_t end = s.out.find('\0');
+  CHECK(end != std::string::npos);
+  Bytes e = response(s.out.substr(0, end + 1));
+  CHECK(e.size() == 9 && e[4] == BIN_OP_FRAME && e[5] == BIN_ERR_SIZE);
+  Bytes v = response(s.out.substr(end + 1));
+  CHECK(v.size() > 6 && v[0] == 7 && v[4] == BIN_OP_VERSION && v[5] == BIN_OK);
+}
+
+//
+// Encode and decode throughput for response sized frames
+//
+TEST(benchCobs)
+{
+  const int frames = 20000;
+  std::mt19937 rng(1);
+  Bytes data(BIN_MAX_RESPONSE), enc(BIN_MAX_RESPONSE + BIN_MAX_RESPONSE / 254 + 2);
+  for(auto &c : data) c = rng() % 8 ? rng() : 0;
+
+  auto start = std::chrono::steady_clock::now();
+  size_t total = 0;
+  for(int j=0 ; j<frames ; j++)
+  {
+    size_t n = cobsEncode(data.data(), data.size(), enc.data());
+    total += cobsDecode(enc.data(), n);
+  }
+  std::chrono::duration<double, std::micro> t = std::chrono::steady_clock::now() - start;
+
+  CHECK_EQ(total, (size_t)frames * data.size());
+  printf("  %d byte frame: %.2fus encode and decode, %.0f MB/s\n",
+    BIN_MAX_RESPONSE, t.count() / frames, total / t.count());
+}
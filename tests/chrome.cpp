@@ -0,0 +1,161 @@
+#include "test.h"
+#include "Common.h"
+#include "Themes.h"
+#include "Chrome.h"
+#include <chrono>
+
+//
+// Cached side bar boxes must look exactly like boxes drawn directly,
+// whatever is behind them. Built with and without PALETTE_SPRITE.
+//
+
+#ifdef PALETTE_SPRITE
+typedef PaletteSprite Sprite;
+#else
+typedef TFT_eSprite Sprite;
+#endif
+
+TFT_eSPI tft;
+Sprite spr(&tft);
+
+// Boxes as they were drawn before caching
+static void drawDirect(Sprite &s, uint8_t kind, const char *title, bool cursor, int x, int y, int sx)
+{
+  if(kind == CHROME_MENU)
+  {
+    s.fillSmoothRoundRect(1+x, 1+y, 76+sx, 110, 4, TH.menu_border);
+    s.fillSmoothRoundRect(2+x, 2+y, 74+sx, 108, 4, TH.menu_bg);
+    s.setTextDatum(MC_DATUM);
+    s.setTextColor(TH.menu_hdr);
+    s.drawString(title, 40+x+(sx/2), 12+y, 2);
+    s.drawLine(1+x, 23+y, 76+x+sx, 23+y, TH.menu_border);
+    if(cursor)
+      s.fillRoundRect(6+x, 24+y+(2*16), 66+sx, 16, 2, TH.menu_hl_bg);
+  }
+  else
+  {
+    s.fillSmoothRoundRect(1+x, 1+y, 76+sx, 110, 4, TH.box_border);
+    s.fillSmoothRoundRect(2+x, 2+y, 74+sx, 108, 4, TH.box_bg);
+    s.setTextDatum(ML_DATUM);
+    s.setTextColor(TH.box_text);
+    s.drawString("Step:", 6+x, 64+y+(-3*16), 2);
+    s.drawString("BW:", 6+x, 64+y+(-2*16), 2);
+    s.drawString("Vol:", 6+x, 64+y+(0*16), 2);
+  }
+}
+
+// Something other than the theme background behind the box, as with
+// the waterfall or a layout drawn before the side bar
+static void drawBackground(Sprite &s, int variant)
+{
+  static const uint16_t colors[] = { 0x0000, 0xF800, 0x07E0, 0x001F, 0xFFE0, 0x8410, 0xFFFF };
+
+  s.fillSprite(TH.bg);
+  for(int j=0 ; j<170 ; j+=3)
+    s.fillRect(0, j, 320, 3, colors[(j / 3 + variant) % ITEM_COUNT(colors)]);
+}
+
+static int differences(Sprite &a, Sprite &b)
+{
+  int n = 0;
+  for(int y=0 ; y<a.height() ; y++)
+    for(int x=0 ; x<a.width() ; x++)
+      n += a.readPixel(x, y) != b.readPixel(x, y);
+  return(n);
+}
+
+static void compare(uint8_t kind, const char *title, bool cursor, int x, int y, int sx, int variant)
+{
+  Sprite ref(&tft);
+
+#ifdef PALETTE_SPRITE
+  ref.setColorDepth(8);
+#endif
+  ref.createSprite(320, 170);
+
+  drawBackground(spr, variant);
+  drawChrome(kind, title, cursor, x, y, sx);
+  drawBackground(ref, variant);
+  drawDirect(ref, kind, title, cursor, x, y, sx);
+
+  CHECK_EQ(differences(spr, ref), 0);
+}
+
+static void setup()
+{
+#ifdef PALETTE_SPRITE
+  spr.setColorDepth(8);
+#endif
+  if(!spr.created()) spr.createSprite(320, 170);
+}
+
+TEST(chromeMatchesDirect)
+{
+  setup();
+
+  for(themeIdx=0 ; themeIdx<getTotalThemes() ; themeIdx++)
+  {
+    compare(CHROME_MENU, "Menu", true, 0, 18, 0, 0);
+    compare(CHROME_MENU, "Volume", false, 0, 18, 10, 0);
+    compare(CHROME_INFO, 0, false, 0, 18, 0, 0);
+  }
+
+  themeIdx = 0;
+}
+
+TEST(chromeCornersBlendWithBackground)
+{
+  setup();
+
+  // The cache is reused while the background changes underneath
+  for(int variant=0 ; variant<7 ; variant++)
+  {
+    compare(CHROME_MENU, "Menu", true, 0, 18, 0, variant);
+    compare(CHROME_INFO, 0, false, 10, 40, 10, variant);
+  }
+}
+
+TEST(chromeRerendersOnChange)
+{
+  setup();
+
+  // Title, cursor, width and theme changes all show up
+  compare(CHROME_MENU, "Menu", true, 0, 18, 0, 1);
+  compare(CHROME_MENU, "Settings", true, 0, 18, 0, 1);
+  compare(CHROME_MENU, "Settings", false, 0, 18, 0, 1);
+  compare(CHROME_MENU, "Settings", false, 0, 18, 10, 1);
+  themeIdx = 2;
+  compare(CHROME_MENU, "Settings", false, 0, 18, 10, 1);
+  themeIdx = 0;
+}
+
+//
+// Side bar drawing time, cached against direct. The numbers are for
+// the host model of the sprite, use RENDER_STATS for real ones.
+//
+TEST(benchChrome)
+{
+  const int frames = 5000;
+  double us[2];
+
+  setup();
+  drawBackground(spr, 0);
+
+  for(int j=0 ; j<2 ; j++)
+  {
+    auto start = std::chrono::steady_clock::now();
+
+    for(int k=0 ; k<frames ; k++)
+    {
+      if(j)
+        drawChrome(CHROME_MENU, "Menu", true, 0, 18, 0);
+      else
+        drawDirect(spr, CHROME_MENU, "Menu", true, 0, 18, 0);
+    }
+
+    std::chrono::duration<double, std::micro> t = std::chrono::steady_clock::now() - start;
+    us[j] = t.count() / frames;
+  }
+
+  printf("  side bar box: direct %.1fus, cached %.1fus per frame\n", us[0], us[1]);
+}
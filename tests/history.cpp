@@ -0,0 +1,202 @@
+#include "test.h"
+#include "Common.h"
+#include "History.h"
+
+uint8_t uiLayoutIdx = UI_WATERFALL;
+uint8_t historyZoomIdx = HISTORY_5MIN;
+
+//
+// Feed samples every 200ms for the given number of seconds, ticking
+// history as the main loop does. Sample values come from a function
+// of the elapsed milliseconds.
+//
+static uint32_t feed(uint32_t seconds, uint8_t (*rssi)(uint32_t), uint8_t (*snr)(uint32_t))
+{
+  static uint32_t elapsed = 0;
+  uint32_t updates = 0;
+
+  for(uint32_t j=0 ; j<seconds * 5 ; j++, elapsed += 200)
+  {
+    historyAddSample(rssi(elapsed), snr(elapsed));
+    hostAdvance(200);
+    updates += historyTickTime();
+  }
+
+  return(updates);
+}
+
+static uint8_t rampRssi(uint32_t ms) { return((ms / 200) % 50); }
+static uint8_t constSnr(uint32_t ms) { return(12); }
+
+static void restart()
+{
+  // Line up with the tick so that every second gets 5 samples
+  historyClear();
+  while(!historyTickTime()) { historyAddSample(0, 0); hostAdvance(1); }
+  historyClear();
+}
+
+TEST(historyLevel0)
+{
+  HistoryEntry e;
+
+  restart();
+  feed(3, rampRssi, constSnr);
+
+  CHECK_EQ(historyCount(HISTORY_5MIN), 3);
+  CHECK(historyGet(HISTORY_5MIN, 0, &e));
+  CHECK_EQ(e.snr.min, 12);
+  CHECK_EQ(e.snr.max, 12);
+  CHECK_EQ(e.snr.mean, 12);
+  CHECK(e.rssi.max - e.rssi.min == 4);
+  CHECK_EQ(e.rssi.mean, e.rssi.min + 2);
+  CHECK(!historyGet(HISTORY_5MIN, 3, &e));
+}
+
+TEST(historyDecimation)
+{
+  HistoryEntry e, parts[10];
+  uint32_t min = 0xFF, max = 0, sum = 0;
+
+  restart();
+  feed(10, rampRssi, constSnr);
+
+  CHECK_EQ(historyCount(HISTORY_1HOUR), 1);
+  CHECK_EQ(historyCount(HISTORY_24HOUR), 0);
+
+  // A level 1 entry spans the last 10 level 0 entries
+  for(int j=0 ; j<10 ; j++)
+  {
+    CHECK(historyGet(HISTORY_5MIN, j, &parts[j]));
+    min  = std::min(min, (uint32_t)parts[j].rssi.min);
+    max  = std::max(max, (uint32_t)parts[j].rssi.max);
+    sum += parts[j].rssi.mean;
+  }
+
+  CHECK(historyGet(HISTORY_1HOUR, 0, &e));
+  CHECK_EQ(e.rssi.min, min);
+  CHECK_EQ(e.rssi.max, max);
+  CHECK_NEAR(e.rssi.mean, sum / 10.0, 1.0);
+
+  feed(50, rampRssi, constSnr);
+  CHECK_EQ(historyCount(HISTORY_1HOUR), 6);
+  CHECK_EQ(historyCount(HISTORY_24HOUR), 1);
+  CHECK(historyGet(HISTORY_24HOUR, 0, &e));
+  CHECK_EQ(e.rssi.min, 0);
+  CHECK_EQ(e.rssi.max, 49);
+  CHECK_EQ(e.snr.mean, 12);
+}
+
+// Two seconds at 10, then 20 samples of 100 squeezed into one second
+static uint8_t burstRssi(uint32_t ms) { return(ms % 3000 < 2000 ? 10 : 100); }
+
+TEST(historyExactMean)
+{
+  HistoryEntry e;
+
+  // Means are taken over samples, not over lower level means
+  restart();
+  for(int j=0 ; j<10 ; j++)
+  {
+    int n = j % 2 ? 20 : 5;
+    for(int k=0 ; k<n ; k++) historyAddSample(j % 2 ? 100 : 10, 0);
+    hostAdvance(1000);
+    historyTickTime();
+  }
+
+  CHECK(historyGet(HISTORY_1HOUR, 0, &e));
+  CHECK_EQ(e.rssi.min, 10);
+  CHECK_EQ(e.rssi.max, 100);
+  CHECK_EQ(e.rssi.mean, (5 * 5 * 10 + 5 * 20 * 100 + 62) / 125);
+}
+
+TEST(historyRepeatsLastSample)
+{
+  HistoryEntry e;
+
+  restart();
+  feed(1, burstRssi, constSnr);
+
+  // No samples, as during a seek
+  hostAdvance(1000);
+  historyTickTime();
+  hostAdvance(1000);
+  historyTickTime();
+
+  CHECK_EQ(historyCount(HISTORY_5MIN), 3);
+  CHECK(historyGet(HISTORY_5MIN, 0, &e));
+  CHECK_EQ(e.rssi.min, 10);
+  CHECK_EQ(e.rssi.max, 10);
+  CHECK_EQ(e.snr.mean, 12);
+}
+
+TEST(historyResyncAfterStall)
+{
+  restart();
+  feed(2, rampRssi, constSnr);
+
+  // A long blocking operation must not produce a burst of entries
+  hostAdvance(20000);
+  historyAddSample(1, 1);
+  historyTickTime();
+  historyTickTime();
+
+  CHECK_EQ(historyCount(HISTORY_5MIN), 3);
+}
+
+TEST(historyRingWraps)
+{
+  HistoryEntry e;
+
+  restart();
+  feed(310, rampRssi, constSnr);
+  historyAddSample(200, 1);
+  hostAdvance(1000);
+  historyTickTime();
+
+  CHECK_EQ(historyCount(HISTORY_5MIN), historyLength(HISTORY_5MIN));
+  CHECK(historyGet(HISTORY_5MIN, 0, &e));
+  CHECK_EQ(e.rssi.max, 200);
+  CHECK(historyGet(HISTORY_5MIN, 299, &e));
+  CHECK(!historyGet(HISTORY_5MIN, 300, &e));
+}
+
+TEST(historyTickReportsShownLevel)
+{
+  restart();
+  historyZoomIdx = HISTORY_1HOUR;
+  CHECK_EQ(feed(20, rampRssi, constSnr), 2);
+
+  uiLayoutIdx = UI_DEFAULT;
+  CHECK_EQ(feed(20, rampRssi, constSnr), 0);
+
+  uiLayoutIdx = UI_WATERFALL;
+  historyZoomIdx = HISTORY_5MIN;
+}
+
+struct Capture : public Print
+{
+  char text[256];
+  size_t len = 0;
+  size_t write(uint8_t c) override { if(len < sizeof(text) - 1) text[len++] = c; text[len] = 0; return(1); }
+};
+
+TEST(historyPrintCsv)
+{
+  Capture out;
+
+  restart();
+  historyAddSample(30, 5);
+  historyAddSample(40, 7);
+  hostAdvance(1000);
+  historyTickTime();
+  historyAddSample(50, 9);
+  hostAdvance(1000);
+  historyTickTime();
+  historyPrint(&out, HISTORY_5MIN);
+
+  CHECK(!strcmp(out.text,
+    "age_s,rssi_min,rssi_mean,rssi_max,snr_min,snr_mean,snr_max\r\n"
+    "1,30,35,40,5,6,7\r\n"
+    "0,50,50,50,9,9,9\r\n"));
+}
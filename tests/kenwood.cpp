@@ -0,0 +1,214 @@
+#include "test.h"
+#include "Common.h"
+#include "Menu.h"
+#include "Kenwood.h"
+#include "Utils.h"
+#include <string>
+
+//
+// Kenwood CAT protocol driven the way a logging program talks to it:
+// reads and sets, the fixed IF answer layout, auto information and
+// "?;" for anything the receiver does not take
+//
+
+struct TestStream : public Stream
+{
+  std::string in, out;
+  size_t pos = 0;
+
+  int available() override { return(in.size() - pos); }
+  int read() override { return(pos < in.size() ? (uint8_t)in[pos++] : -1); }
+  int peek() override { return(pos < in.size() ? (uint8_t)in[pos] : -1); }
+  size_t write(uint8_t c) override { out += (char)c; return(1); }
+};
+
+static KenwoodState state;
+static int events;
+
+// Send commands, returns what came back once all were taken
+static std::string run(const std::string &commands)
+{
+  TestStream s;
+
+  s.in = commands;
+  events = 0;
+  while(s.available()) events |= kenwoodDoCommand(&s, &state);
+  return(s.out);
+}
+
+static void reset()
+{
+  state = KenwoodState();
+  selectBand(3, false);
+  currentBFO = 0;
+  rssi = 0;
+}
+
+TEST(kenwoodFrequency)
+{
+  reset();
+
+  // Read as 11 digits in Hz, FB is the same single VFO
+  CHECK(run("FA;") == "FA00014074000;");
+  CHECK(run("FB;") == "FB00014074000;");
+  CHECK_EQ(events, 0);
+
+  // Set without a reply, on any band
+  CHECK(run("FA00007100000;") == "");
+  CHECK_EQ(events, REMOTE_CHANGED | REMOTE_PREFS);
+  CHECK_EQ(bandIdx, 2);
+  CHECK(run("FA;") == "FA00007100000;");
+
+  // Lower case and spaces from terminal users are taken
+  CHECK(run("fa 00007200000 ;fa;") == "FA00007200000;");
+
+  // Wrong digit count, not digits, or out of every band
+  CHECK(run("FA7100000;") == "?;");
+  CHECK(run("FA0000710000x;") == "?;");
+  CHECK(run("FA00000000001;") == "?;");
+  CHECK_EQ(events, 0);
+  CHECK_EQ(getCurrentFrequencyHz(), 7200000);
+}
+
+TEST(kenwoodMode)
+{
+  reset();
+
+  CHECK(run("MD;") == "MD2;");
+  CHECK(run("MD1;MD;") == "MD1;");
+  CHECK_EQ(currentMode, LSB);
+  CHECK_EQ(events, REMOTE_CHANGED | REMOTE_PREFS);
+  CHECK(run("MD5;MD;") == "MD5;");
+  CHECK_EQ(currentMode, AM);
+
+  // Modes the receiver does not have, more than one digit, and FM
+  // outside of the FM band
+  CHECK(run("MD3;") == "?;");
+  CHECK(run("MD0;") == "?;");
+  CHECK(run("MD55;") == "?;");
+  CHECK(run("MD4;") == "?;");
+  CHECK_EQ(events, 0);
+  CHECK_EQ(currentMode, AM);
+
+  // A zero byte ends the parameters, leaving a read
+  CHECK(run(std::string("MD\0" "1;", 5)) == "MD5;");
+  CHECK_EQ(currentMode, AM);
+}
+
+TEST(kenwoodMeter)
+{
+  reset();
+
+  // S0, S9 at 15, S9+60dB at 30
+  CHECK(run("SM0;") == "SM00000;");
+  rssi = 54;
+  CHECK(run("SM0;") == "SM00015;");
+  rssi = 127;
+  CHECK(run("SM0;") == "SM00030;");
+
+  // Main receiver only
+  CHECK(run("SM;") == "?;");
+  CHECK(run("SM1;") == "?;");
+}
+
+TEST(kenwoodInfo)
+{
+  reset();
+  std::string info = run("IF;");
+
+  // TS-480 layout: frequency at 2, mode at 29, 38 bytes with the ';'
+  CHECK_EQ(info.size(), 38);
+  CHECK(info.compare(0, 2, "IF") == 0);
+  CHECK(info.compare(2, 11, "00014074000") == 0);
+  CHECK(info.compare(13, 5, "     ") == 0);
+  CHECK(info.compare(18, 5, "+0000") == 0);
+  CHECK_EQ(info[28], '0');
+  CHECK_EQ(info[29], '2');
+  CHECK_EQ(info[37], ';');
+  for(size_t i=18 ; i<info.size() ; i++)
+    if(i != 18 && i != 29 && i != 37) CHECK_EQ(info[i], '0');
+
+  // Same size below 10 MHz and in another mode
+  run("FA00000810000;");
+  info = run("IF;");
+  CHECK_EQ(info.size(), 38);
+  CHECK(info.compare(2, 11, "00000810000") == 0);
+  CHECK_EQ(info[29], '5');
+
+  CHECK(run("IF0;") == "?;");
+}
+
+TEST(kenwoodAutoInfo)
+{
+  reset();
+  TestStream s;
+
+  // Off by default, nothing is pushed
+  CHECK(run("AI;") == "AI0;");
+  currentFrequency = 14075;
+  kenwoodTickTime(&s, &state);
+  CHECK(s.out.empty());
+
+  // Turning it on does not send the current state
+  CHECK(run("AI2;AI;") == "AI2;");
+  kenwoodTickTime(&s, &state);
+  CHECK(s.out.empty());
+
+  // One IF for a front panel change, none while nothing changes
+  currentFrequency = 14076;
+  kenwoodTickTime(&s, &state);
+  kenwoodTickTime(&s, &state);
+  CHECK(s.out == "IF00014076000     +00000000002" "0000000;");
+  s.out.clear();
+
+  selectMode(LSB);
+  kenwoodTickTime(&s, &state);
+  CHECK_EQ(s.out.size(), 38);
+  CHECK_EQ(s.out[29], '1');
+  s.out.clear();
+
+  // And off again
+  CHECK(run("AI0;") == "");
+  currentFrequency = 14077;
+  kenwoodTickTime(&s, &state);
+  CHECK(s.out.empty());
+  CHECK(run("AI4;") == "?;");
+}
+
+TEST(kenwoodErrors)
+{
+  reset();
+  uint32_t freq = getCurrentFrequencyHz();
+
+  // Unknown, too short, and transmit commands
+  CHECK(run("XX;") == "?;");
+  CHECK(run("F;") == "?;");
+  CHECK(run("TX;") == "?;");
+  CHECK(run("RX;") == "");
+  CHECK(run("ID;") == "ID020;");
+  CHECK(run("ID1;") == "?;");
+
+  // Empty commands are ignored
+  CHECK(run(";;") == "");
+
+  // One error for a command too long, the next one is taken
+  std::string longCommand = "FA" + std::string(CAT_MAX_COMMAND, '0') + ";FA;";
+  CHECK(run(longCommand) == "?;FA00014074000;");
+  CHECK_EQ(events, 0);
+  CHECK_EQ(getCurrentFrequencyHz(), freq);
+
+  // A command split over reads is put together
+  TestStream s;
+  s.in = "F";
+  kenwoodDoCommand(&s, &state);
+  s.in = "A;";
+  s.pos = 0;
+  kenwoodDoCommand(&s, &state);
+  CHECK(s.out == "FA00014074000;");
+
+  // Tuning by steps returns the direction, one command at a time
+  s.in = "UP;DN;";
+  s.pos = 0;
+  CHECK_EQ(kenwoodDoCommand(&s, &state), 1 << REMOTE_DIRECTION);
+  CHECK_EQ(kenwoodDoCommand(&s, &state), -(1 << REMOTE_DIRECTION));
+}
@@ -0,0 +1,135 @@
+#include "test.h"
+#include "Common.h"
+#include "Meter.h"
+
+//
+// Run the filter over a trace: 'level' until 'from', 'burst' until
+// 'to', then 'level' again, sampled every METER_SAMPLE_TIME. Values
+// and peaks are recorded per sample.
+//
+struct Trace
+{
+  uint8_t value[200];
+  uint8_t peak[200];
+};
+
+static void runTrace(Trace *t, uint8_t level, uint8_t burst, uint32_t from, uint32_t to)
+{
+  MeterFilter f;
+
+  meterReset(&f);
+  for(int j=0 ; j<200 ; j++)
+  {
+    uint32_t now = j * METER_SAMPLE_TIME;
+    meterUpdate(&f, now >= from && now < to ? burst : level, now);
+    t->value[j] = meterValue(&f);
+    t->peak[j]  = meterPeak(&f);
+  }
+}
+
+static int at(uint32_t ms) { return(ms / METER_SAMPLE_TIME); }
+
+TEST(meterFirstSample)
+{
+  MeterFilter f;
+
+  meterReset(&f);
+  CHECK(!f.valid);
+  meterUpdate(&f, 37, 12345);
+  CHECK_EQ(meterValue(&f), 37);
+  CHECK_EQ(meterPeak(&f), 37);
+}
+
+TEST(meterAttack)
+{
+  Trace t;
+  runTrace(&t, 20, 60, 1000, 3000);
+
+  // Fast attack: well over half way after one sample, settled after
+  // a few time constants
+  CHECK_EQ(t.value[at(950)], 20);
+  CHECK(t.value[at(1000)] > 40);
+  CHECK(t.value[at(1000)] < 60);
+  CHECK(t.value[at(1150)] >= 58);
+  CHECK_EQ(t.value[at(1500)], 60);
+
+  // Monotonic rise
+  for(int j=at(1000) ; j<at(3000) - 1 ; j++) CHECK(t.value[j + 1] >= t.value[j]);
+}
+
+TEST(meterDecay)
+{
+  Trace t;
+  runTrace(&t, 20, 60, 0, 3000);
+
+  // Slow decay: about 1/e of the step left after METER_DECAY_TIME
+  double left = 20 + 40 * exp(-1.0);
+  CHECK_NEAR(t.value[at(3000 + METER_DECAY_TIME) - 1], left, 2.5);
+  CHECK(t.value[at(3050)] > 50);
+  CHECK(t.value[at(5000)] <= 21);
+
+  for(int j=at(3000) ; j<199 ; j++) CHECK(t.value[j + 1] <= t.value[j]);
+}
+
+TEST(meterPeakHold)
+{
+  Trace t;
+
+  // Short burst: smoothed value barely moves, the peak catches it
+  runTrace(&t, 20, 60, 1000, 1050);
+  CHECK(t.value[at(1000)] < 50);
+  CHECK_EQ(t.peak[at(1000)], 60);
+
+  // Held for METER_PEAK_HOLD after the burst
+  for(uint32_t ms=1000 ; ms<=1000 + METER_PEAK_HOLD ; ms+=METER_SAMPLE_TIME)
+    CHECK_EQ(t.peak[at(ms)], 60);
+
+  // Then falls at METER_PEAK_DECAY units per second
+  CHECK_NEAR(t.peak[at(1000 + METER_PEAK_HOLD + 1000)], 60 - METER_PEAK_DECAY, 2);
+
+  // ...down to the smoothed value, and never below it
+  CHECK_EQ(t.peak[at(9000)], t.value[at(9000)]);
+  for(int j=0 ; j<200 ; j++) CHECK(t.peak[j] >= t.value[j]);
+}
+
+TEST(meterIrregularSamples)
+{
+  MeterFilter a, b;
+
+  // Same time constant whether sampled every 50ms or every 200ms
+  meterReset(&a);
+  meterReset(&b);
+  meterUpdate(&a, 60, 0);
+  meterUpdate(&b, 60, 0);
+
+  for(uint32_t ms=50 ; ms<=800 ; ms+=50)
+  {
+    meterUpdate(&a, 20, ms);
+    if(!(ms % 200)) meterUpdate(&b, 20, ms);
+  }
+
+  CHECK_NEAR(meterValue(&a), meterValue(&b), 3);
+}
+
+TEST(meterLongGap)
+{
+  static const uint32_t gaps[] = { 20 * 60 * 1000UL, 5 * 3600 * 1000UL, 0x80000000UL };
+
+  // After sleep the filter and the peak settle on the new level
+  // instead of wrapping around
+  for(uint32_t gap : gaps)
+  {
+    MeterFilter f;
+
+    meterReset(&f);
+    meterUpdate(&f, 60, 0);
+    meterUpdate(&f, 60, 50);
+    meterUpdate(&f, 20, gap);
+    CHECK_NEAR(meterValue(&f), 20, 2);
+    CHECK(meterPeak(&f) >= meterValue(&f));
+    CHECK(meterPeak(&f) <= 22);
+
+    meterUpdate(&f, 55, gap + 1);
+    CHECK(meterValue(&f) >= 20 && meterValue(&f) <= 55);
+  }
+}
@@ -0,0 +1,252 @@
+#include "test.h"
+#include "Common.h"
+#include "Metrics.h"
+#include <ESPAsyncWebServer.h>
+#include <WiFi.h>
+#include <new>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//
+// Metrics registry and the Prometheus text exposition: families kept
+// together in registration order, HELP and TYPE once per family,
+// labels, counter and gauge values, and writing without allocating
+//
+
+String loginUsername = "";
+String loginPassword = "";
+
+// Heap allocations made with new, which takes the memory from malloc()
+static int allocations = 0;
+static void *(*volatile allocate)(size_t) = malloc;
+static void (*volatile release)(void *) = free;
+
+void *operator new(size_t size)
+{
+  allocations++;
+  void *p = allocate(size ? size : 1);
+  if(!p) throw std::bad_alloc();
+  return(p);
+}
+
+void operator delete(void *p) noexcept { release(p); }
+void operator delete(void *p, size_t size) noexcept { release(p); }
+
+// Families registered out of order, and a gauge read when served
+static float levelRead = NAN;
+static Metric metricTcp("test_requests_total", "Requests served", METRIC_COUNTER, "source=\"tcp\"");
+static Metric metricLevel("test_level_volts", "Input level", METRIC_GAUGE);
+static Metric metricWs("test_requests_total", "Requests served", METRIC_COUNTER, "source=\"ws\"");
+static Metric metricRead("test_read_ratio", "Read when served", METRIC_GAUGE, "kind=\"a\",unit=\"b\"",
+  []() -> float { return(levelRead); });
+
+// Fixed buffer, so that writing does not allocate either
+class TestPrint : public Print
+{
+  public:
+    char buf[8192];
+    size_t length = 0;
+
+    size_t write(uint8_t c) override
+    {
+      if(length >= sizeof(buf)) return(0);
+      buf[length++] = c;
+      return(1);
+    }
+};
+
+static std::string document()
+{
+  TestPrint out;
+  for(int i=0 ; metricsWrite(&out, i) ; i++);
+  return(std::string(out.buf, out.length));
+}
+
+static std::vector<std::string> lines(const std::string &text)
+{
+  std::vector<std::string> result;
+  std::istringstream in(text);
+  std::string line;
+
+  while(std::getline(in, line)) result.push_back(line);
+  return(result);
+}
+
+// Sample of the metric with the given name and labels, "" if none
+static std::string sample(const char *series)
+{
+  for(const std::string &l : lines(document()))
+    if(!l.compare(0, strlen(series) + 1, std::string(series) + " "))
+      return(l.substr(strlen(series) + 1));
+
+  return("");
+}
+
+TEST(metricsRegistration)
+{
+  std::vector<std::string> order;
+
+  // Families together, the first registration decides the place
+  for(const Metric *m = Metric::first() ; m ; m = m->next)
+    if(!strncmp(m->name, "test_", 5)) order.push_back(m->labels ? m->labels : m->name);
+
+  CHECK(order == std::vector<std::string>({ "source=\"tcp\"", "source=\"ws\"", "test_level_volts", "kind=\"a\",unit=\"b\"" }));
+
+  // The firmware metrics are all there, none of them twice
+  std::set<std::string> names;
+  int count = 0;
+  for(const Metric *m = Metric::first() ; m ; m = m->next, count++)
+    names.insert(std::string(m->name) + (m->labels ? m->labels : ""));
+  CHECK_EQ(names.size(), count);
+  CHECK(names.count("atsmini_uptime_seconds"));
+  CHECK(names.count("atsmini_loop_iterations_total"));
+  CHECK(names.count("atsmini_remote_commands_total" "source=\"web\""));
+}
+
+TEST(metricsExposition)
+{
+  metricTcp.add(3);
+  metricLevel.set(NAN);
+  levelRead = NAN;
+  std::string doc = document();
+
+  // Counters from zero, both samples under one HELP and TYPE
+  CHECK(doc.find(
+    "# HELP test_requests_total Requests served\n"
+    "# TYPE test_requests_total counter\n"
+    "test_requests_total{source=\"tcp\"} 3\n"
+    "test_requests_total{source=\"ws\"} 0\n") != std::string::npos);
+
+  // A gauge without a value has its family description only
+  CHECK(doc.find(
+    "# HELP test_level_volts Input level\n"
+    "# TYPE test_level_volts gauge\n"
+    "# HELP test_read_ratio Read when served\n"
+    "# TYPE test_read_ratio gauge\n") != std::string::npos);
+
+  // Every line is a description or a sample of the family described
+  // last, each family is described once
+  std::set<std::string> described;
+  std::string family;
+  for(const std::string &l : lines(doc))
+  {
+    char name[64], type[16];
+    if(sscanf(l.c_str(), "# TYPE %63s %15s", name, type) == 2)
+    {
+      CHECK(!described.count(name));
+      CHECK(!strcmp(type, "counter") || !strcmp(type, "gauge"));
+      described.insert(family = name);
+    }
+    else if(l.compare(0, 7, "# HELP "))
+    {
+      size_t end = l.find_first_of("{ ");
+      CHECK(l.substr(0, end) == family);
+      CHECK(l.find(' ') != std::string::npos && l.back() != ' ');
+    }
+  }
+
+  // Gauges read when served, and with the Wi-Fi up
+  CHECK(sample("atsmini_wifi_rssi_dbm") == "");
+  WiFi.hostNetworks = { { "home", "secret", -60 } };
+  WiFi.mode(WIFI_STA);
+  WiFi.begin("home", "secret");
+  hostAdvance(WiFi.hostJoinTime);
+  CHECK(sample("atsmini_wifi_rssi_dbm") == "-60");
+  WiFi.disconnect();
+  CHECK(sample("atsmini_psram_free_bytes") == "");
+  CHECK(sample("atsmini_heap_free_bytes") == "180000");
+}
+
+TEST(metricsValues)
+{
+  static const struct { float value; const char *text; } values[] =
+  {
+    { 0,             "0" },
+    { 0.1f,          "0.1" },
+    { -0.5f,         "-0.5" },
+    { 3.3f,          "3.3" },
+    { 1e-9f,         "1e-09" },
+    { 12345678.0f,   "1.234568e+07" },
+    { 4051,          "4051" },
+    { INFINITY,      "+Inf" },
+    { -INFINITY,     "-Inf" },
+  };
+
+  for(const auto &v : values)
+  {
+    metricLevel.set(v.value);
+    levelRead = v.value;
+    std::string text = sample("test_level_volts");
+    if(text != v.text) printf("  %g: \"%s\"\n", v.value, text.c_str());
+    CHECK(text == v.text);
+    CHECK(sample("test_read_ratio{kind=\"a\",unit=\"b\"}") == v.text);
+  }
+
+  // Counters wrap around as unsigned 32 bit values
+  metricWs.add(UINT32_MAX);
+  CHECK(sample("test_requests_total{source=\"ws\"}") == "4294967295");
+  metricWs.add();
+  CHECK(sample("test_requests_total{source=\"ws\"}") == "0");
+}
+
+TEST(metricsLoopTime)
+{
+  // One slow loop iteration shows up once its window is over
+  for(int t=0 ; t<METRICS_WINDOW + 500 ; t++)
+  {
+    hostAdvance(1);
+    metricsTickTime();
+  }
+  CHECK(sample("atsmini_loop_time_max_seconds") == "0.001");
+
+  hostAdvance(37);
+  std::string max;
+  for(int t=0 ; t<METRICS_WINDOW + 500 && (max = sample("atsmini_loop_time_max_seconds")) == "0.001" ; t+=100)
+    for(int j=0 ; j<100 ; j++)
+    {
+      metricsTickTime();
+      hostAdvance(1);
+    }
+  CHECK(max == "0.037");
+
+  char uptime[32];
+  snprintf(uptime, sizeof(uptime), "%.7g", (float)(hostTime / 1000000.0f));
+  CHECK(sample("atsmini_uptime_seconds") == uptime);
+}
+
+TEST(metricsNoAllocations)
+{
+  TestPrint out;
+  int i, before = allocations;
+
+  // Updates and a full document, with every metric registered
+  metricTcp.add();
+  metricLevel.set(1.5f);
+  metricsTickTime();
+  for(i=0 ; metricsWrite(&out, i) ; i++);
+
+  CHECK_EQ(allocations, before);
+  CHECK(i > 10);
+  CHECK(!metricsWrite(&out, i + 1));
+
+  // Allocations are seen
+  std::vector<int> v(100);
+  CHECK_EQ(allocations, before + 1);
+}
+
+TEST(metricsEndpoint)
+{
+  AsyncWebServer server;
+  AsyncWebServerRequest r;
+
+  metricsInit(&server);
+  r.chunkSize = 100;
+  server.handler("/metrics", HTTP_GET)->request(&r);
+
+  CHECK_EQ(r.code, 200);
+  CHECK(r.type == "text/plain; version=0.0.4");
+  CHECK(r.body == document());
+  CHECK(r.chunks > 1);
+}
@@ -0,0 +1,285 @@
+#include "test.h"
+#include "Common.h"
+#include "Storage.h"
+#include "Metrics.h"
+#include "Api.h"
+#include "Mqtt.h"
+#include <AsyncTCP.h>
+#include <Preferences.h>
+#include <string>
+#include <vector>
+
+//
+// MQTT telemetry against a broker played by the test: the remaining
+// length encoding, received packets split and joined in any way or
+// too large to keep, and messages waiting in the ring buffer while the
+// broker is away, dropped oldest first and published in order when it
+// is back, also when they wrap around the buffer end
+//
+
+String loginUsername = "";
+String loginPassword = "";
+
+// Network status, as Network.cpp reports it
+static bool online = false;
+int8_t getWiFiStatus() { return(online ? 2 : -1); }
+bool ntpIsAvailable() { return(false); }
+
+static AsyncClient *client = NULL;
+
+typedef struct
+{
+  uint8_t type;
+  std::string body;
+} Packet;
+
+// Remaining length, returns the bytes it took, 0 if incomplete
+static size_t getLength(const std::string &data, size_t pos, uint32_t *length)
+{
+  *length = 0;
+  for(size_t n=0 ; n<4 && pos + n < data.size() ; n++)
+  {
+    *length |= (uint32_t)(data[pos + n] & 0x7F) << (7 * n);
+    if(!(data[pos + n] & 0x80)) return(n + 1);
+  }
+  return(0);
+}
+
+static std::string packet(uint8_t type, const std::string &body)
+{
+  uint8_t length[4];
+  size_t n = mqttPutLength(length, body.size());
+  return(std::string(1, (char)type) + std::string((const char *)length, n) + body);
+}
+
+static std::string publish(const std::string &topic, const std::string &payload)
+{
+  return(packet(0x30, std::string(1, (char)(topic.size() >> 8)) + (char)topic.size() + topic + payload));
+}
+
+// Packets sent to the broker since the last call, the TCP stack has
+// sent them all
+static std::vector<Packet> sent()
+{
+  std::vector<Packet> result;
+  uint32_t length;
+  size_t n;
+
+  for(size_t pos = 0 ; pos < client->added.size() ; pos += 1 + n + length)
+  {
+    n = getLength(client->added, pos + 1, &length);
+    CHECK(n && pos + 1 + n + length <= client->added.size());
+    if(!n) break;
+    result.push_back({ (uint8_t)client->added[pos], client->added.substr(pos + 1 + n, length) });
+  }
+
+  client->sendSpace += client->added.size();
+  client->added.clear();
+  return(result);
+}
+
+static uint32_t total(const char *name)
+{
+  for(const Metric *m = Metric::first() ; m ; m = m->next)
+    if(!strcmp(m->name, name)) return(m->total());
+  return(0);
+}
+
+// Apply what was queued, returns the number of changes
+static int apply()
+{
+  int n = 0;
+  while(apiDoCommand()) n++;
+  return(n);
+}
+
+// Broker at "broker:1884", topics under "t", a message every second
+static void configure()
+{
+  Preferences prefs;
+
+  prefs.begin("network", false, STORAGE_PARTITION);
+  prefs.putString("mqttbroker", "broker:1884");
+  prefs.putString("mqtttopic", "t");
+  prefs.putUShort("mqttinterval", 1);
+  prefs.end();
+
+  mqttRequestReload();
+  wifiModeIdx = NET_CONNECT;
+  selectBand(0, false);
+}
+
+// Connect and subscribe, the broker accepts
+static void connect()
+{
+  online = true;
+  AsyncClient::connecting = NULL;
+  for(int i=0 ; i<3 && !AsyncClient::connecting ; i++) mqttTickTime();
+  client = AsyncClient::connecting;
+  CHECK(client && client->host == "broker" && client->port == 1884);
+  if(!client) return;
+
+  client->accept();
+  mqttTickTime();
+  std::vector<Packet> p = sent();
+  CHECK(p.size() == 1 && p[0].type == 0x10);
+  CHECK(p.size() && !p[0].body.compare(0, 7, std::string("\0\4MQTT\4", 7)));
+
+  client->receive(std::string("\x20\x02\x00\x00", 4));
+  mqttTickTime();
+  p = sent();
+  CHECK(p.size() == 1 && p[0].type == 0x82);
+  CHECK(p.size() && p[0].body == std::string("\0\1\0\5t/set\0", 10));
+}
+
+TEST(mqttRemainingLength)
+{
+  static const struct { uint32_t length; const char *bytes; size_t size; } lengths[] =
+  {
+    { 0,         "\x00",             1 },
+    { 127,       "\x7F",             1 },
+    { 128,       "\x80\x01",         2 },
+    { 321,       "\xC1\x02",         2 },
+    { 16383,     "\xFF\x7F",         2 },
+    { 16384,     "\x80\x80\x01",     3 },
+    { 2097151,   "\xFF\xFF\x7F",     3 },
+    { 2097152,   "\x80\x80\x80\x01", 4 },
+    { 268435455, "\xFF\xFF\xFF\x7F", 4 },
+  };
+
+  for(const auto &l : lengths)
+  {
+    uint8_t p[5] = { 0 };
+    uint32_t decoded;
+
+    CHECK_EQ(mqttPutLength(p, l.length), l.size);
+    CHECK(!memcmp(p, l.bytes, l.size));
+    CHECK_EQ(p[l.size], 0);
+    CHECK_EQ(getLength(std::string((const char *)p, l.size), 0, &decoded), l.size);
+    CHECK_EQ(decoded, l.length);
+  }
+}
+
+TEST(mqttReceive)
+{
+  configure();
+  connect();
+  if(!client) return;
+  apply();
+
+  // Split anywhere, or together with the next packet
+  std::string set = publish("t/set", "{\"volume\":20}");
+  for(size_t i=0 ; i<=set.size() ; i++)
+  {
+    volume = 35;
+    client->receive(set.substr(0, i));
+    client->receive(set.substr(i) + set);
+    CHECK_EQ(apply(), 2);
+    CHECK_EQ(volume, 20);
+  }
+
+  // One byte at a time, with a two byte length
+  std::string padded = publish("t/set", "{\"volume\":21}" + std::string(400, ' '));
+  CHECK_EQ((uint8_t)padded[2], 0x03);
+  for(char c : padded) client->receive(std::string(1, c));
+  CHECK_EQ(apply(), 1);
+  CHECK_EQ(volume, 21);
+
+  // Other topics, and acknowledgements in between
+  client->receive(publish("t/status", "{\"volume\":1}") + packet(0xD0, "") + packet(0x90, std::string("\0\1\0", 3)));
+  CHECK_EQ(apply(), 0);
+
+  // Packets too large to keep, with two to four length bytes, are
+  // skipped in pieces and the one after them is taken
+  for(size_t size : { MQTT_RX_SIZE, 20000, 2100000 })
+  {
+    std::string big = publish("t/set", "{\"volume\":1" + std::string(size, ' ') + "}") + publish("t/set", "{\"volume\":22}");
+    for(size_t i=0 ; i<big.size() ; i+=1436) client->receive(big.substr(i, 1436));
+    CHECK_EQ(apply(), 1);
+    CHECK_EQ(volume, 22);
+    volume = 35;
+  }
+
+  // Five length bytes is not MQTT
+  CHECK(!client->aborted);
+  client->receive(std::string("\x30\xFF\xFF\xFF\xFF\x01", 6));
+  CHECK(client->aborted);
+  CHECK_EQ(apply(), 0);
+  mqttStop();
+}
+
+TEST(mqttStoreAndForward)
+{
+  configure();
+  online = false;
+  mqttTickTime();
+  uint32_t dropped = total("atsmini_mqtt_dropped_total");
+  uint32_t acked = total("atsmini_mqtt_messages_total");
+
+  // Messages of different sizes while the broker is away, more than
+  // the buffer takes
+  std::vector<std::string> messages;
+  size_t bytes = 0;
+  for(int i=0 ; bytes < 2 * MQTT_BUFFER ; i++)
+  {
+    char text[160];
+    uint32_t start = millis();
+    mqttSample(i % 128, i % 7);
+    hostAdvance(1000);
+    mqttTickTime();
+
+    snprintf(text, sizeof(text),
+      "{\"time\":null,\"uptime\":%lu,\"band\":\"VHF\",\"mode\":\"FM\",\"station\":\"\",\"text\":\"\",\"samples\":[[0,103900000,%d,%d]]}",
+      (unsigned long)(start / 1000), i % 128, i % 7);
+    messages.push_back(text);
+    bytes += 2 + strlen(text);
+  }
+
+  // The oldest ones are gone, only as many as needed
+  size_t kept = messages.size() - (total("atsmini_mqtt_dropped_total") - dropped);
+  size_t used = 0;
+  for(size_t i=messages.size() - kept ; i<messages.size() ; i++) used += 2 + messages[i].size();
+  CHECK(kept > 0 && kept < messages.size());
+  if(!kept || kept >= messages.size()) return;
+  size_t oldest = messages.size() - kept - 1;
+  CHECK(used <= MQTT_BUFFER);
+  CHECK(used + 2 + messages[oldest].size() > MQTT_BUFFER);
+
+  // Back online, published one at a time in order, across the buffer
+  // end too
+  connect();
+  if(!client) return;
+  size_t next = messages.size() - kept;
+  uint16_t id = 0;
+  for(int i=0 ; i<2 * (int)kept && next < messages.size() ; i++)
+  {
+    mqttTickTime();
+    std::vector<Packet> p = sent();
+    if(p.empty()) continue;
+    CHECK_EQ(p.size(), 1);
+    CHECK_EQ(p[0].type, 0x32);
+
+    std::string expected = std::string("\0\x08t/status", 10);
+    CHECK(!p[0].body.compare(0, 10, expected));
+    uint16_t got = ((uint8_t)p[0].body[10] << 8) | (uint8_t)p[0].body[11];
+    if(id) CHECK_EQ(got, id + 1);
+    id = got;
+    if(p[0].body.substr(12) != messages[next])
+    {
+      printf("  message %zu: %s\n", next, p[0].body.substr(12).c_str());
+      CHECK(p[0].body.substr(12) == messages[next]);
+    }
+
+    // The next one only goes once this one is acknowledged
+    mqttTickTime();
+    CHECK(sent().empty());
+    client->receive(packet(0x40, std::string(1, (char)(id >> 8)) + (char)id));
+    next++;
+  }
+
+  mqttTickTime();
+  CHECK_EQ(next, messages.size());
+  CHECK_EQ(total("atsmini_mqtt_messages_total") - acked, kept);
+  CHECK(sent().empty());
+  mqttStop();
+}
@@ -0,0 +1,226 @@
+#include "test.h"
+#include "Common.h"
+#include "Storage.h"
+#include <ESPAsyncWebServer.h>
+#include <ESPmDNS.h>
+#include <Preferences.h>
+#include <Update.h>
+#include <WiFi.h>
+#include <esp_ota_ops.h>
+#include <esp_sntp.h>
+
+//
+// Network bring-up on a fake Wi-Fi driver, timed on the host clock.
+// setup() draws the first frame and turns the audio on right before
+// netInit(), waking up from light sleep does the same, so the receiver
+// answers and redraws from the first main loop pass after netInit().
+// The time until then and the longest netTickTime() call are what the
+// network costs the listener, the rest of the timeline is how long
+// connecting takes with the driver working in the background.
+//
+
+#define NTP_DELAY 300  // SNTP server answer time (ms)
+
+UpdateClass Update;
+esp_partition_t hostRunningPartition = { ESP_OTA_IMG_VALID };
+extern AsyncWebServer server;
+extern int screenDraws;
+extern int hostClockSets;
+
+// Solar/DX data, fetched as soon as it is asked for
+static int propagationFetches = 0;
+void updatePropagationData() { propagationFetches++; }
+bool propagationBusy() { return(false); }
+
+// Times from the netInit() call (ms), -1 if it did not happen
+typedef struct
+{
+  int32_t init;       // netInit() returned
+  int32_t firstPass;  // First main loop pass done
+  int32_t longest;    // Longest netTickTime() call
+  int32_t services;   // Web server and mDNS up
+  int32_t joined;     // Connected to a network
+  int32_t clock;      // Clock set from NTP
+} Timeline;
+
+// Known networks, as saved from the config page
+static void saveNetworks(std::initializer_list<std::pair<const char *, const char *>> networks)
+{
+  Preferences prefs;
+  int j = 1;
+
+  prefs.begin("network", false, STORAGE_PARTITION);
+  prefs.clear();
+  for(const auto &n : networks)
+  {
+    char name[16];
+    sprintf(name, "wifissid%d", j);
+    prefs.putString(name, n.first);
+    sprintf(name, "wifipass%d", j++);
+    prefs.putString(name, n.second);
+  }
+  prefs.end();
+}
+
+static void reset(std::vector<WiFiClass::Network> inRange)
+{
+  netStop();
+  WiFi.hostNetworks = inRange;
+  WiFi.hostScans = WiFi.hostJoins = 0;
+  propagationFetches = 0;
+}
+
+// netInit() and then the main loop, 1 ms a pass, for the given time
+static Timeline bringUp(uint8_t mode, bool showStatus, uint32_t duration)
+{
+  Timeline t = { -1, -1, 0, -1, -1, -1 };
+  int clockSets = hostClockSets;
+  uint32_t start = millis();
+
+  netInit(mode, showStatus);
+  t.init = millis() - start;
+
+  while(millis() - start < duration)
+  {
+    uint32_t before = millis();
+    netTickTime();
+    t.longest = max(t.longest, (int32_t)(millis() - before));
+    if(t.firstPass < 0) t.firstPass = millis() - start;
+
+    // SNTP answers a while after it was started
+    if(hostSntpRunning && !ntpIsAvailable() && millis() - hostSntpStart >= NTP_DELAY)
+      hostSntpCallback(NULL);
+
+    int32_t now = millis() - start;
+    if(t.services < 0 && MDNS.services) t.services = now;
+    if(t.joined < 0 && WiFi.status() == WL_CONNECTED) t.joined = now;
+    if(t.clock < 0 && hostClockSets != clockSets) t.clock = now;
+    hostAdvance(1);
+  }
+
+  return(t);
+}
+
+static void print(const char *name, const Timeline &t)
+{
+  printf("  %s: first loop pass at %d ms, longest tick %d ms, services at %d ms, connected at %d ms, clock at %d ms\n",
+    name, t.firstPass, t.longest, t.services, t.joined, t.clock);
+}
+
+TEST(netPowerOn)
+{
+  reset({ { "neighbour", "", -40 }, { "home", "secret", -70 } });
+  saveNetworks({ { "home", "secret" } });
+  int draws = screenDraws;
+
+  // Only starting the radio is waited for
+  Timeline t = bringUp(NET_CONNECT, true, 10000);
+  print("power on", t);
+  CHECK_EQ(t.init, WiFi.hostModeTime);
+  CHECK_EQ(t.firstPass, t.init);
+  CHECK_EQ(t.longest, 0);
+
+  // Scan, join, then the services and the clock
+  CHECK_EQ(t.joined, t.init + WiFi.hostScanTime + WiFi.hostJoinTime);
+  CHECK_EQ(t.services, t.joined);
+  CHECK(t.clock >= t.joined + NTP_DELAY && t.clock <= t.joined + NTP_DELAY + 1);
+  CHECK_EQ(WiFi.hostScans, 1);
+  CHECK_EQ(WiFi.hostJoins, 1);
+  CHECK_EQ(propagationFetches, 1);
+  CHECK(server.started);
+  CHECK(MDNS.hostname == "atsmini");
+
+  // The status was shown on the way
+  CHECK(screenDraws > draws);
+  CHECK_EQ(getWiFiStatus(), 2);
+  CHECK(!strcmp(getWiFiIPAddress(), "192.168.1.42"));
+}
+
+TEST(netWakeUp)
+{
+  reset({ { "home", "secret", -70 } });
+  saveNetworks({ { "home", "secret" } });
+  bringUp(NET_CONNECT, true, 10000);
+  int draws = screenDraws;
+
+  // Going to sleep stops everything, waking up starts again quietly
+  netStop();
+  CHECK_EQ(getWiFiStatus(), 0);
+  CHECK_EQ(MDNS.services, 0);
+
+  Timeline t = bringUp(NET_CONNECT, false, 10000);
+  print("wake up", t);
+  CHECK_EQ(t.firstPass, WiFi.hostModeTime);
+  CHECK_EQ(t.longest, 0);
+  CHECK_EQ(t.joined, t.init + WiFi.hostScanTime + WiFi.hostJoinTime);
+  CHECK(t.clock > t.joined);
+  CHECK_EQ(screenDraws, draws);
+
+  const char *line1, *line2;
+  CHECK(!netGetStatus(&line1, &line2));
+}
+
+TEST(netAccessPoint)
+{
+  reset({ { "home", "secret", -70 } });
+  saveNetworks({ { "home", "secret" } });
+
+  // The access point and its services come up in netInit(), its
+  // status stays on screen before the scan starts
+  Timeline t = bringUp(NET_AP_CONNECT, true, 10000);
+  print("access point", t);
+  CHECK_EQ(t.init, WiFi.hostModeTime + WiFi.hostAPTime);
+  CHECK_EQ(t.longest, 0);
+  CHECK_EQ(t.services, t.init);
+  CHECK(t.joined >= t.init + 2000 + (int32_t)(WiFi.hostScanTime + WiFi.hostJoinTime));
+  CHECK(t.clock > t.joined);
+
+  // Without a network to join, nothing else happens
+  reset({ });
+  t = bringUp(NET_AP_ONLY, true, 5000);
+  CHECK_EQ(t.services, t.init);
+  CHECK_EQ(WiFi.hostScans, 0);
+  CHECK_EQ(t.joined, -1);
+  CHECK_EQ(getWiFiStatus(), -1);
+}
+
+TEST(netJoinOrder)
+{
+  // The strongest known network first, a wrong password costs the
+  // join timeout, one not seen in the scan is tried last
+  reset({ { "office", "other", -50 }, { "home", "secret", -70 } });
+  saveNetworks({ { "hidden", "x" }, { "home", "secret" }, { "office", "wrong" } });
+
+  Timeline t = bringUp(NET_CONNECT, false, 30000);
+  print("wrong password", t);
+  CHECK_EQ(t.longest, 0);
+  CHECK_EQ(WiFi.hostJoins, 2);
+  CHECK(WiFi.SSID() == "home");
+  CHECK_EQ(t.joined, t.init + WiFi.hostScanTime + 10000 + WiFi.hostJoinTime);
+
+  // No known network around, the services still come up
+  reset({ { "neighbour", "", -40 } });
+  t = bringUp(NET_CONNECT, false, 60000);
+  CHECK_EQ(t.longest, 0);
+  CHECK_EQ(t.joined, -1);
+  CHECK_EQ(t.clock, -1);
+  CHECK_EQ(WiFi.hostJoins, 3);
+  CHECK(t.services > 0);
+  CHECK_EQ(propagationFetches, 0);
+}
+
+TEST(netSyncOnly)
+{
+  reset({ { "home", "secret", -70 } });
+  saveNetworks({ { "home", "secret" } });
+
+  // Connected for the clock and the Solar/DX data only
+  Timeline t = bringUp(NET_SYNC, false, 10000);
+  print("sync only", t);
+  CHECK_EQ(t.longest, 0);
+  CHECK(t.clock > t.joined && t.joined > 0);
+  CHECK_EQ(t.services, -1);
+  CHECK_EQ(propagationFetches, 1);
+  CHECK_EQ(WiFi.getMode(), WIFI_MODE_NULL);
+  CHECK_EQ(getWiFiStatus(), 0);
+}
@@ -0,0 +1,262 @@
+#include "test.h"
+#include "Common.h"
+#include "Storage.h"
+#include "Ota.h"
+#include <ESPAsyncWebServer.h>
+#include <Update.h>
+#include <esp_ota_ops.h>
+#include <mbedtls/sha256.h>
+#include <random>
+#include <string>
+#include <vector>
+
+//
+// Firmware update pipeline with a fake partition instead of the flash
+//
+
+UpdateClass Update;
+esp_partition_t hostRunningPartition = { ESP_OTA_IMG_PENDING_VERIFY };
+String loginUsername = "";
+String loginPassword = "";
+
+static int prefsSaves = 0;
+void prefsRequestSave(uint32_t what, bool now) { prefsSaves++; }
+void prefsTickTime() {}
+
+// Inactive partition: 3MB, bootable once end() has checked the image
+static std::vector<uint8_t> partition;
+static bool writing = false;
+static bool bootable = false;
+static int aborts = 0;
+
+static const OtaWriter fakePartition =
+{
+  []()
+  {
+    partition.clear();
+    bootable = false;
+    writing = true;
+    return(true);
+  },
+  [](const uint8_t *data, size_t size)
+  {
+    if(!writing || partition.size() + size > 0x300000) return(false);
+    partition.insert(partition.end(), data, data + size);
+    return(true);
+  },
+  []()
+  {
+    writing = false;
+    bootable = partition[0] == OTA_IMAGE_MAGIC;
+    return(bootable);
+  },
+  []()
+  {
+    writing = false;
+    aborts++;
+  },
+};
+
+static std::vector<uint8_t> image(size_t size, unsigned seed)
+{
+  std::mt19937 rng(seed);
+  std::vector<uint8_t> data(size);
+
+  for(auto &b : data) b = rng();
+  data[0] = OTA_IMAGE_MAGIC;
+  return(data);
+}
+
+static std::string sha256(const uint8_t *data, size_t size)
+{
+  mbedtls_sha256_context ctx;
+  uint8_t hash[32];
+  char hex[65];
+
+  mbedtls_sha256_init(&ctx);
+  mbedtls_sha256_starts(&ctx, 0);
+  mbedtls_sha256_update(&ctx, data, size);
+  mbedtls_sha256_finish(&ctx, hash);
+  for(int i=0 ; i<32 ; i++) sprintf(hex + 2 * i, "%02x", hash[i]);
+  return(hex);
+}
+
+static std::string sha256(const std::vector<uint8_t> &data)
+{
+  return(sha256(data.data(), data.size()));
+}
+
+// Pass the image to otaWrite() in random pieces
+static bool write(const std::vector<uint8_t> &data, unsigned seed)
+{
+  std::mt19937 rng(seed);
+
+  for(size_t i=0 ; i<data.size() ; )
+  {
+    size_t n = std::min(data.size() - i, (size_t)(1 + rng() % 5744));
+    if(!otaWrite(&data[i], n)) return(false);
+    i += n;
+  }
+
+  return(true);
+}
+
+// Upload the image to /update, up to the given size
+static void upload(AsyncWebServer &server, AsyncWebServerRequest &request, const std::vector<uint8_t> &data, size_t size)
+{
+  auto &handler = *server.handler("/update", HTTP_POST);
+
+  for(size_t i=0 ; i<size ; i+=1436)
+  {
+    size_t n = std::min(size - i, (size_t)1436);
+    handler.upload(&request, "firmware.bin", i, (uint8_t *)&data[i], n, i + n == data.size());
+  }
+
+  if(size == data.size()) handler.request(&request);
+}
+
+TEST(otaSha256)
+{
+  // FIPS 180-4 examples, the second one is two blocks long
+  CHECK(sha256((const uint8_t *)"abc", 3) == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+  const char *two = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+  CHECK(sha256((const uint8_t *)two, strlen(two)) == "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+}
+
+TEST(otaImage)
+{
+  std::vector<uint8_t> img = image(1500000, 1);
+
+  CHECK(otaBegin(&fakePartition));
+  CHECK(write(img, 2));
+  CHECK(otaEnd(sha256(img).c_str()));
+  CHECK(partition == img);
+  CHECK(bootable);
+
+  // Upper case hash
+  std::string upper = sha256(img);
+  for(auto &c : upper) c = toupper(c);
+  CHECK(otaBegin(&fakePartition) && write(img, 3) && otaEnd(upper.c_str()));
+  CHECK(bootable);
+}
+
+TEST(otaRejects)
+{
+  std::vector<uint8_t> img = image(200000, 4);
+  std::vector<uint8_t> bad = img;
+  bad[100000] ^= 1;
+
+  aborts = 0;
+  CHECK(otaBegin(&fakePartition) && write(bad, 5));
+  CHECK(!otaEnd(sha256(img).c_str()));
+  CHECK(!strcmp(otaGetError(), "SHA-256 does not match the image"));
+  CHECK(!bootable && aborts == 1);
+
+  CHECK(otaBegin(&fakePartition) && write(img, 6) && !otaEnd("1234"));
+  CHECK(otaBegin(&fakePartition) && write(img, 6) && !otaEnd(""));
+  CHECK(!bootable);
+
+  std::vector<uint8_t> notImage = img;
+  notImage[0] = 0x7F;
+  CHECK(otaBegin(&fakePartition) && !write(notImage, 7));
+  CHECK(!strcmp(otaGetError(), "Not a firmware image"));
+  CHECK(!otaEnd(sha256(notImage).c_str()));
+
+  std::vector<uint8_t> big = image(0x300001, 8);
+  CHECK(otaBegin(&fakePartition) && !write(big, 9));
+  CHECK(strstr(otaGetError(), "too large"));
+
+  CHECK(otaBegin(&fakePartition) && !otaEnd(sha256(NULL, 0).c_str()));
+  CHECK(!strcmp(otaGetError(), "Empty image"));
+
+  // One update at a time
+  CHECK(otaBegin(&fakePartition) && !otaBegin(&fakePartition));
+  CHECK(!strcmp(otaGetError(), "Another update is in progress"));
+  otaAbort();
+  CHECK(!writing && !bootable);
+}
+
+TEST(otaUpload)
+{
+  AsyncWebServer server;
+  std::vector<uint8_t> img = image(1000000, 10);
+  std::vector<uint8_t> bad = img;
+  bad[1] ^= 1;
+
+  otaInit(&server, &fakePartition);
+
+  {
+    AsyncWebServerRequest r;
+    upload(server, r, img, img.size());
+    CHECK_EQ(r.code, 403);
+    CHECK(partition.empty());
+  }
+
+  loginUsername = "admin";
+  loginPassword = "secret";
+
+  {
+    AsyncWebServerRequest r;
+    r.login = "admin:wrong";
+    upload(server, r, img, img.size());
+    CHECK_EQ(r.code, 401);
+    CHECK(partition.empty());
+  }
+
+  {
+    // Client goes away half way
+    AsyncWebServerRequest r;
+    r.login = "admin:secret";
+    r.post["sha256"] = sha256(img);
+    aborts = 0;
+    upload(server, r, img, 600000);
+    r.disconnected();
+    CHECK(aborts == 1 && !writing && !bootable);
+  }
+
+  {
+    AsyncWebServerRequest r;
+    r.login = "admin:secret";
+    r.post["sha256"] = sha256(bad);
+    upload(server, r, img, img.size());
+    CHECK_EQ(r.code, 400);
+    CHECK(r.body.find("SHA-256") != std::string::npos);
+    CHECK(!bootable);
+  }
+
+  {
+    AsyncWebServerRequest r;
+    r.login = "admin:secret";
+    server.handler("/update", HTTP_POST)->request(&r);
+    CHECK_EQ(r.code, 400);
+    CHECK(r.body == "No firmware image\r\n");
+  }
+
+  {
+    AsyncWebServerRequest r;
+    r.login = "admin:secret";
+    r.query["sha256"] = sha256(img);
+    upload(server, r, img, img.size());
+    CHECK_EQ(r.code, 200);
+    CHECK(bootable && partition == img);
+  }
+
+  // Reboots once the reply is sent, with the preferences saved
+  otaTickTime();
+  CHECK_EQ(hostRestarts, 0);
+  hostAdvance(OTA_REBOOT_TIME);
+  otaTickTime();
+  CHECK_EQ(hostRestarts, 1);
+  CHECK_EQ(prefsSaves, 1);
+}
+
+TEST(otaRollback)
+{
+  // The new image is kept once it has been running for a while
+  hostTime = 0;
+  otaTickTime();
+  CHECK_EQ(hostRunningPartition.state, ESP_OTA_IMG_PENDING_VERIFY);
+  hostAdvance(OTA_CONFIRM_TIME);
+  otaTickTime();
+  CHECK_EQ(hostRunningPartition.state, ESP_OTA_IMG_VALID);
+}
@@ -0,0 +1,174 @@
+#include "test.h"
+#include "Common.h"
+#include "Themes.h"
+
+//
+// The 8-bit palette sprite has to look exactly like the stock 16-bit
+// sprite on the display, for every theme and for partial pushes
+//
+
+// Draw the same kind of things the layouts draw. This is a template
+// because PaletteSprite hides, rather than overrides, fillSprite()
+template<class Sprite> static void drawScene(Sprite &s)
+{
+  s.fillSprite(TH.bg);
+
+  // Menu box with anti-aliased corners, blended against the sprite
+  s.fillSmoothRoundRect(10, 10, 80, 110, 4, TH.menu_border);
+  s.fillSmoothRoundRect(11, 11, 78, 108, 4, TH.menu_bg);
+  s.setTextDatum(MC_DATUM);
+  s.setTextColor(TH.menu_hdr, TH.menu_bg);
+  s.drawString("Menu", 50, 22, 2);
+  s.drawLine(11, 32, 88, 32, TH.menu_border);
+  s.fillRoundRect(16, 60, 68, 16, 2, TH.menu_hl_bg);
+
+  // Meter bars, triangle, text
+  for(int j=0 ; j<15 ; j++)
+    s.fillRect(120 + j * 4, 140, 3, 10, j < 9 ? TH.smeter_bar : TH.smeter_bar_plus);
+  s.fillTriangle(250, 20, 270, 40, 230, 40, TH.text_warn);
+  s.setTextDatum(TL_DATUM);
+  s.setTextColor(TH.text);
+  s.drawString("14.074", 150, 60, 4);
+  s.fillSmoothRoundRect(200, 100, 60, 30, 8, TH.text_muted);
+}
+
+// Draw the scene into both sprites and push them to two displays
+static void render(TFT_eSPI &tft16, TFT_eSPI &tft8, TFT_eSprite &s16, PaletteSprite &s8)
+{
+  drawScene(s16);
+  drawScene(s8);
+  s16.pushSprite(0, 0);
+  s8.pushSprite(0, 0);
+}
+
+static int differences(TFT_eSPI &a, TFT_eSPI &b)
+{
+  int n = 0;
+  for(int j=0 ; j<a.width() * a.height() ; j++) n += a.frame[j] != b.frame[j];
+  return(n);
+}
+
+TEST(paletteMatchesAllThemes)
+{
+  TFT_eSPI tft16, tft8;
+  TFT_eSprite s16(&tft16);
+  PaletteSprite s8(&tft8);
+
+  s16.createSprite(320, 170);
+  s8.setColorDepth(8);
+  s8.createSprite(320, 170);
+
+  for(themeIdx=0 ; themeIdx<getTotalThemes() ; themeIdx++)
+  {
+    render(tft16, tft8, s16, s8);
+    CHECK_EQ(differences(tft16, tft8), 0);
+    CHECK(s8.paletteUsed() < PALETTE_SIZE);
+  }
+
+  themeIdx = 0;
+}
+
+TEST(paletteReadPixelCopy)
+{
+  // Copying pixels through readPixel() keeps the true colors, as
+  // when compositing a cached sprite into the screen sprite
+  TFT_eSPI tft16, tft8;
+  TFT_eSprite src16(&tft16), s16(&tft16);
+  PaletteSprite src8(&tft8), s8(&tft8);
+
+  src16.createSprite(100, 120);
+  s16.createSprite(320, 170);
+  src8.setColorDepth(8);
+  src8.createSprite(100, 120);
+  s8.setColorDepth(8);
+  s8.createSprite(320, 170);
+
+  for(themeIdx=0 ; themeIdx<getTotalThemes() ; themeIdx++)
+  {
+    drawScene(src16);
+    drawScene(src8);
+    s16.fillSprite(TH.bg);
+    s8.fillSprite(TH.bg);
+
+    for(int y=0 ; y<120 ; y++)
+      for(int x=0 ; x<100 ; x++)
+      {
+        s16.drawPixel(x + 150, y + 30, src16.readPixel(x, y));
+        s8.drawPixel(x + 150, y + 30, src8.readPixel(x, y));
+      }
+
+    s16.pushSprite(0, 0);
+    s8.pushSprite(0, 0);
+    CHECK_EQ(differences(tft16, tft8), 0);
+  }
+
+  themeIdx = 0;
+}
+
+TEST(palettePushSpriteClipping)
+{
+  TFT_eSPI tft16, tft8;
+  TFT_eSprite s16(&tft16);
+  PaletteSprite s8(&tft8);
+
+  s16.createSprite(320, 170);
+  s8.setColorDepth(8);
+  s8.createSprite(320, 170);
+  drawScene(s16);
+  drawScene(s8);
+
+  // Inside, negative source offsets, past the right and bottom
+  // edges, and entirely outside the sprite
+  static const int32_t rects[][6] =
+  {
+    {   5,   5,   0,   0, 320, 170 },
+    {  40,  30,  10,  20, 100,  60 },
+    {  40,  30, -15, -25, 100,  60 },
+    { 200, 100, 250, 120, 100,  80 },
+    {   0,   0, 330,   0,  20,  20 },
+    {   0,   0,   0, -40,  20,  30 },
+  };
+
+  for(unsigned j=0 ; j<ITEM_COUNT(rects) ; j++)
+  {
+    const int32_t *r = rects[j];
+    tft16.fillScreen(TFT_BLUE);
+    tft8.fillScreen(TFT_BLUE);
+    tft16.pixelsPushed = tft8.pixelsPushed = 0;
+
+    bool ok16 = s16.pushSprite(r[0], r[1], r[2], r[3], r[4], r[5]);
+    bool ok8  = s8.pushSprite(r[0], r[1], r[2], r[3], r[4], r[5]);
+
+    CHECK_EQ(ok8, ok16);
+    CHECK_EQ(tft8.pixelsPushed, tft16.pixelsPushed);
+    CHECK_EQ(differences(tft16, tft8), 0);
+  }
+}
+
+TEST(paletteFullUsesNearest)
+{
+  TFT_eSPI tft;
+  PaletteSprite s(&tft);
+
+  s.setColorDepth(8);
+  s.createSprite(64, 64);
+  s.fillSprite(TH.bg);
+
+  // Fill the palette with an even spread of colors
+  for(int j=0 ; j<256 ; j++)
+    s.drawPixel(j % 64, j / 64, ((j & 0xE0) << 8) | ((j & 0x1C) << 6) | ((j & 0x03) << 3));
+
+  CHECK_EQ(s.paletteUsed(), PALETTE_SIZE);
+
+  // Any other color lands within a grid step or two (the theme colors
+  // seeded first keep the last few grid colors out)
+  for(int j=0 ; j<64 * 64 ; j++)
+  {
+    uint16_t want = j * 16 + j / 256 + 7;
+    s.drawPixel(j % 64, j / 64, want);
+    uint16_t got = s.readPixel(j % 64, j / 64);
+    CHECK(abs((want >> 11) - (got >> 11)) <= 9);
+    CHECK(abs(((want >> 5) & 0x3F) - ((got >> 5) & 0x3F)) <= 12);
+    CHECK(abs((want & 0x1F) - (got & 0x1F)) <= 12);
+  }
+}
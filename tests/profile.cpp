@@ -0,0 +1,106 @@
+#include "test.h"
+#include "Common.h"
+#include "Profile.h"
+
+TEST(profileBucketEdges)
+{
+  // Bucket N holds times below 2^N us
+  CHECK_EQ(profileBucket(0), 0);
+  CHECK_EQ(profileBucket(1), 1);
+  CHECK_EQ(profileBucket(2), 2);
+  CHECK_EQ(profileBucket(3), 2);
+  CHECK_EQ(profileBucket(4), 3);
+  CHECK_EQ(profileBucket(1023), 10);
+  CHECK_EQ(profileBucket(1024), 11);
+  CHECK_EQ(profileBucket((1UL << 14) - 1), 14);
+
+  // The last bucket takes everything longer
+  CHECK_EQ(profileBucket(1UL << 14), PROF_BUCKETS - 1);
+  CHECK_EQ(profileBucket(1UL << 20), PROF_BUCKETS - 1);
+  CHECK_EQ(profileBucket(UINT32_MAX), PROF_BUCKETS - 1);
+}
+
+TEST(profileStatWindow)
+{
+  ProfileStat s = {};
+  uint32_t min, avg, max;
+
+  CHECK(!profileStatGet(&s, &min, &avg, &max));
+
+  // Partial window reports what it has
+  profileStatAdd(&s, 300);
+  profileStatAdd(&s, 100);
+  profileStatAdd(&s, 200);
+  CHECK(profileStatGet(&s, &min, &avg, &max));
+  CHECK_EQ(min, 100);
+  CHECK_EQ(avg, 200);
+  CHECK_EQ(max, 300);
+
+  // Complete the window: 3 samples above plus 61 of 1000
+  for(int j=3 ; j<PROF_WINDOW ; j++) profileStatAdd(&s, 1000);
+  CHECK(s.lastValid);
+  CHECK_EQ(s.count, 0);
+  CHECK(profileStatGet(&s, &min, &avg, &max));
+  CHECK_EQ(min, 100);
+  CHECK_EQ(avg, (600 + 1000 * (PROF_WINDOW - 3)) / PROF_WINDOW);
+  CHECK_EQ(max, 1000);
+
+  // The next window starts afresh, but the last one is reported
+  // until it completes
+  for(int j=0 ; j<PROF_WINDOW - 1 ; j++) profileStatAdd(&s, 5000);
+  CHECK(profileStatGet(&s, &min, &avg, &max));
+  CHECK_EQ(max, 1000);
+  profileStatAdd(&s, 7);
+  CHECK(profileStatGet(&s, &min, &avg, &max));
+  CHECK_EQ(min, 7);
+  CHECK_EQ(max, 5000);
+
+  // Histogram keeps every sample since boot
+  uint32_t total = 0;
+  for(int b=0 ; b<PROF_BUCKETS ; b++) total += s.hist[b];
+  CHECK_EQ(total, 2 * PROF_WINDOW);
+  CHECK_EQ(s.hist[profileBucket(5000)], PROF_WINDOW - 1);
+  CHECK_EQ(s.hist[profileBucket(1000)], PROF_WINDOW - 3);
+}
+
+struct Capture : public Print
+{
+  char text[4096];
+  size_t len = 0;
+  size_t write(uint8_t c) override { if(len < sizeof(text) - 1) text[len++] = c; text[len] = 0; return(1); }
+};
+
+TEST(profileFrameStages)
+{
+  Capture out;
+
+  // Widgets timed twice in one frame add up, skipped stages are not
+  // counted, nested frames are ignored
+  profileBegin(PROF_UI_SMETER);
+  hostTime += 100;
+  profileLap(PROF_CLEAR);
+  hostTime += 250;
+  profileLap(PROF_WIDGETS);
+  profileBegin(PROF_UI_ABOUT);
+  hostTime += 50;
+  profileLap(PROF_GRAPHS);
+  hostTime += 30;
+  profileLap(PROF_WIDGETS);
+  hostTime += 2000;
+  profileLap(PROF_PUSH);
+  profileEnd();
+  profileEnd();
+
+  profilePrint(&out);
+
+  const char *hdr = "screen,stage,min_us,avg_us,max_us,lt1,lt2,lt4,";
+  CHECK(!strncmp(out.text, hdr, strlen(hdr)));
+  CHECK(strstr(out.text, ",lt16384,ge16384\r\n"));
+  CHECK(strstr(out.text, "\r\nS-Meter,clear,100,100,100,"));
+  CHECK(strstr(out.text, "\r\nS-Meter,widgets,280,280,280,"));
+  CHECK(strstr(out.text, "\r\nS-Meter,graphs,50,50,50,"));
+  CHECK(strstr(out.text, "\r\nS-Meter,push,2000,2000,2000,"));
+  CHECK(strstr(out.text, "\r\nS-Meter,frame,2430,2430,2430,"));
+  CHECK(!strstr(out.text, "S-Meter,sidebar"));
+  CHECK(!strstr(out.text, "About,"));
+}
@@ -0,0 +1,159 @@
+#include "test.h"
+#include "Propagation.h"
+#include <random>
+#include <string>
+#include <vector>
+
+//
+// Solar/DX data parser fed recorded style payloads in random pieces,
+// checked against the indexOf() scanner it replaced, and malformed
+// payloads
+//
+
+// Payload layouts seen from the service and similar ones
+static const std::vector<std::string> payloads =
+{
+  // Bands as keys
+  "{\"sfi\": 155.0, \"kp\": 2.33, \"a\": 7, \"updated\": \"2025-06-01T12:00:00Z\","
+  " \"bands\": {\"80m\": {\"rating\": \"Good\", \"snr\": -12.5}, \"40m\": {\"rating\": \"Good\"},"
+  " \"20m\": {\"rating\": \"Fair\"}, \"10m\": {\"rating\": \"Poor\", \"spots\": [1, 2, 3]}}}",
+
+  // Bands as values in an array, pretty printed
+  "{\n  \"sfi\":98,\n  \"kp\":4.67,\n  \"bands\":[\n    {\"band\":\"10m\",\"rating\":\"Poor\",\"muf\":false},\n"
+  "    {\"band\":\"20m\",\"rating\":\"Good\",\"muf\":true},\n    {\"band\":\"40m\",\"rating\":\"Fair\",\"note\":null},\n"
+  "    {\"band\":\"80m\",\"rating\":\"Fair\"}\n  ]\n}\n",
+
+  // Some bands missing, extra nesting and escapes
+  "{\"meta\":{\"source\":\"wspr \\\"live\\\"\",\"list\":[[],{},[{}]]},\"sfi\":201.5,\"kp\":0,"
+  "\"bands\":{\"20m\":{\"rating\":\"Good\"},\"40m\":{\"rating\":\"Poor\"}}}",
+
+  // Negative and exponent numbers elsewhere
+  "{\"x\":-1.5e3,\"kp\":1.0,\"sfi\":70,\"bands\":{\"10m\":{\"rating\":\"Fair\"}}}",
+};
+
+// The scanner the parser replaced, as the reference
+static float oldNumber(const std::string &json, const char *key)
+{
+  size_t k = json.find(key);
+  if(k == std::string::npos) return(0);
+  size_t c = json.find(':', k);
+  if(c == std::string::npos) return(0);
+
+  size_t s = c + 1;
+  while(s < json.size() && (json[s] == ' ' || json[s] == '\t')) s++;
+  size_t e = s;
+  while(e < json.size() && (isdigit(json[e]) || json[e] == '.' || json[e] == '-')) e++;
+  return(atof(json.substr(s, e - s).c_str()));
+}
+
+static std::string oldRating(const std::string &json, const char *band)
+{
+  size_t b = json.find(std::string("\"") + band + "\"");
+  if(b == std::string::npos) return("--");
+  size_t r = json.find("\"rating\"", b);
+  if(r == std::string::npos) return("--");
+  size_t q1 = json.find('"', r + 8);
+  size_t q2 = json.find('"', q1 + 1);
+  return(q2 == std::string::npos ? "--" : json.substr(q1 + 1, q2 - q1 - 1));
+}
+
+// Feed pieces of 1 to maxPiece bytes
+static bool parse(const std::string &json, PropData *data, std::mt19937 &rng, int maxPiece)
+{
+  PropParser parser;
+
+  for(size_t i=0 ; i<json.size() ; )
+  {
+    size_t n = std::min<size_t>(json.size() - i, 1 + rng() % maxPiece);
+    if(!parser.feed(json.data() + i, n))
+    {
+      parser.finish(data);
+      return(false);
+    }
+    i += n;
+  }
+
+  return(parser.finish(data));
+}
+
+TEST(propRecorded)
+{
+  std::mt19937 rng(1);
+
+  for(auto &json : payloads)
+    for(int maxPiece : { 1, 3, 17, 128, 100000 })
+      for(int run=0 ; run<20 ; run++)
+      {
+        PropData d;
+
+        CHECK(parse(json, &d, rng, maxPiece));
+        CHECK(d.valid);
+        CHECK(d.sfi == oldNumber(json, "\"sfi\""));
+        CHECK(d.kp == oldNumber(json, "\"kp\""));
+        for(int b=0 ; b<PROP_BANDS ; b++)
+          CHECK(oldRating(json, propBands[b]) == d.rating[b]);
+      }
+}
+
+TEST(propTruncated)
+{
+  std::mt19937 rng(2);
+
+  // A payload cut anywhere before its end is rejected
+  for(auto &json : payloads)
+    for(size_t n=0 ; n<json.find_last_of('}') ; n++)
+    {
+      PropData d;
+      CHECK(!parse(json.substr(0, n), &d, rng, 7));
+      CHECK(!d.valid);
+    }
+}
+
+TEST(propMalformed)
+{
+  std::mt19937 rng(3);
+  const std::vector<std::string> bad =
+  {
+    "", "   ", "<html><body>502 Bad Gateway</body></html>",
+    "{\"sfi\":155,}", "{\"sfi\" 155}", "{\"sfi\":155]", "[\"sfi\",155}",
+    "{\"sfi\":155}}", "{\"sfi\":155} x", "{\"sfi\":1.5.5.5x}", "{\"sfi\":tru}",
+    "{\"sfi\":\"15\n5\"}", "{sfi:155}", "{\"sfi\":155,\"kp\":}", "{\"kp\":2 3}",
+    std::string(40, '[') + std::string(40, ']'),
+    "{\"sfi\":\"" + std::string(500, 'x') + "\"",
+    // Well formed, but no data
+    "{\"a\":1}",
+  };
+
+  for(auto &json : bad)
+  {
+    PropData d;
+    CHECK(!parse(json, &d, rng, 5));
+    CHECK(!d.valid);
+  }
+}
+
+TEST(propLongValues)
+{
+  std::mt19937 rng(4);
+  std::string json = "{\"sfi\":1,\"10m\":{\"rating\":\"" + std::string(300, 'G') + "\"}}";
+  PropData d;
+
+  // Cut, not overflowed
+  CHECK(parse(json, &d, rng, 9));
+  CHECK_EQ(strlen(d.rating[0]), sizeof(d.rating[0]) - 1);
+}
+
+TEST(propGarbage)
+{
+  std::mt19937 rng(5);
+
+  // Must not crash, the sanitizers are watching
+  for(int i=0 ; i<20000 ; i++)
+  {
+    std::string json = payloads[i % payloads.size()];
+    for(int k=0 ; k<4 ; k++) json[rng() % json.size()] = "{}[]\",:\\ a1-"[rng() % 13];
+
+    PropData d;
+    parse(json, &d, rng, 11);
+  }
+}
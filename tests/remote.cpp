@@ -0,0 +1,199 @@
+#include "test.h"
+#include "Common.h"
+#include "Themes.h"
+#include "Menu.h"
+#include "Remote.h"
+#include "Script.h"
+#include "Metrics.h"
+#include <string>
+#include <random>
+
+//
+// Remote commands arrive in arbitrary pieces (USB packets, TCP
+// segments). Whatever the fragmentation, the parser has to produce
+// the same output and the same receiver state.
+//
+
+extern int bandIdx;
+
+// Input is released up to 'limit', everything written is kept
+struct TestStream : public Stream
+{
+  std::string in, out;
+  size_t pos = 0, limit = 0;
+
+  int available() override { return(pos < limit); }
+  int read() override { return(pos < limit ? (uint8_t)in[pos++] : -1); }
+  int peek() override { return(pos < limit ? (uint8_t)in[pos] : -1); }
+  size_t write(uint8_t c) override { out += (char)c; return(1); }
+};
+
+struct Result
+{
+  std::string out;
+  int commands;
+  uint8_t volume;
+  int band;
+  uint32_t memory5;
+  ColorTheme theme;
+
+  bool operator==(const Result &r) const
+  {
+    return(out == r.out && commands == r.commands && volume == r.volume &&
+      band == r.band && memory5 == r.memory5 && !memcmp(&theme, &r.theme, sizeof(theme)));
+  }
+};
+
+static ColorTheme savedTheme;
+
+static void resetReceiver()
+{
+  static bool saved = false;
+  if(!saved) { savedTheme = theme[0]; saved = true; }
+
+  theme[0] = savedTheme;
+  themeIdx = 0;
+  switchThemeEditor(1);
+  memset(memories, 0, sizeof(Memory) * getTotalMemories());
+  volume = 35;
+  selectBand(0, false);
+}
+
+//
+// Run input through the parser, releasing 'chunk(rng)' bytes at a
+// time, or one byte at a time without a generator
+//
+static Result run(const std::string &input, std::mt19937 *rng = NULL)
+{
+  TestStream s;
+  RemoteState state;
+  Result r;
+
+  resetReceiver();
+  s.in = input;
+  r.commands = 0;
+
+  while(s.pos < s.in.size())
+  {
+    s.limit = std::min(s.in.size(), s.limit + (rng ? 1 + (*rng)() % 9 : 1));
+    while(remoteDoInput(&s, &state, false)) r.commands++;
+    hostAdvance(10);
+  }
+
+  r.out     = s.out;
+  r.volume  = volume;
+  r.band    = bandIdx;
+  r.memory5 = memories[4].freq;
+  r.theme   = theme[0];
+  return(r);
+}
+
+static std::string themeString(uint16_t first)
+{
+  std::string s;
+  char buf[8];
+  const uint8_t *p = (const uint8_t *)&theme[0].bg;
+
+  // Current colors, with the first one replaced
+  for(size_t j=0 ; j<sizeof(ColorTheme)-offsetof(ColorTheme, bg) ; j+=2)
+  {
+    snprintf(buf, sizeof(buf), "x%02X%02X", j ? p[j+1] : first >> 8, j ? p[j] : first & 0xFF);
+    s += buf;
+  }
+
+  return(s);
+}
+
+static std::string script()
+{
+  resetReceiver();
+  return("VV#05,MW,999000,AM\rB^" + themeString(0x1234) + "vH9^x00\rV^x0001xZZZZx0003\rb");
+}
+
+TEST(remoteByteAtATime)
+{
+  Result r = run(script());
+
+  CHECK_EQ(r.volume, 35 + 2 - 1 + 1);
+  CHECK_EQ(r.band, 0);
+  CHECK_EQ(r.memory5, 999000);
+  CHECK_EQ(r.theme.bg, 0x0001);
+  CHECK_EQ(r.theme.text, savedTheme.text);
+  CHECK(r.out.find(" Ok") != std::string::npos);
+  CHECK(r.out.find("Invalid history level") != std::string::npos);
+}
+
+TEST(remoteRandomFragments)
+{
+  const std::string input = script();
+  Result ref = run(input);
+  std::mt19937 rng(1);
+
+  for(int j=0 ; j<500 ; j++)
+  {
+    Result r = run(input, &rng);
+    CHECK(r == ref);
+    if(!(r == ref)) break;
+  }
+
+  // All the input arriving at once
+  TestStream s;
+  RemoteState state;
+  Result r;
+
+  resetReceiver();
+  s.in = input;
+  s.limit = input.size();
+  r.commands = 0;
+  while(s.available()) r.commands += !!remoteDoInput(&s, &state, false);
+  CHECK_EQ(r.commands, ref.commands);
+  CHECK(s.out == ref.out);
+}
+
+TEST(remoteThemeNewline)
+{
+  // A newline anywhere ends the color string
+  Result r = run("^x00\rV");
+
+  CHECK(r.out.find(" Err") != std::string::npos);
+  CHECK_EQ(r.volume, 36);
+  CHECK_EQ(r.theme.bg, savedTheme.bg);
+
+  r = run("^x0042\nV");
+  CHECK(r.out.find(" Err") != std::string::npos);
+  CHECK_EQ(r.theme.bg, 0x0042);
+  CHECK_EQ(r.volume, 36);
+}
+
+TEST(remoteThemeKeepsPipelinedInput)
+{
+  // A bad color stops the theme, but commands sent right after the
+  // string still run
+  resetReceiver();
+  std::string bad = themeString(0x4321);
+  bad[7] = 'G';
+  Result r = run("^" + bad + "VV");
+
+  CHECK(r.out.find(" Err") != std::string::npos);
+  CHECK_EQ(r.theme.bg, 0x4321);
+  CHECK_EQ(r.theme.text, savedTheme.text);
+  CHECK_EQ(r.volume, 37);
+}
+
+TEST(remoteTimeout)
+{
+  TestStream s;
+  RemoteState state;
+
+  resetReceiver();
+  s.in = "#01,MW";
+  s.limit = s.in.size();
+  remoteDoInput(&s, &state, false);
+
+  hostAdvance(REMOTE_TIMEOUT + 1);
+  s.in += "V";
+  s.limit = s.in.size();
+  CHECK(remoteDoInput(&s, &state, false));
+  CHECK(s.out.find("Timeout") != std::string::npos);
+  CHECK_EQ(volume, 36);
+}
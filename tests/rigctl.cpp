@@ -0,0 +1,194 @@
+#include "test.h"
+#include "Common.h"
+#include "Menu.h"
+#include "Remote.h"
+#include "RigCtl.h"
+#include "Utils.h"
+#include <sstream>
+#include <string>
+#include <vector>
+
+//
+// rigctld protocol as Hamlib clients parse it: the \dump_state layout
+// read by the NET rigctl backend, extended responses, and RPRT codes
+//
+
+struct TestStream : public Stream
+{
+  std::string out;
+
+  int available() override { return(0); }
+  int read() override { return(-1); }
+  int peek() override { return(-1); }
+  size_t write(uint8_t c) override { out += (char)c; return(1); }
+};
+
+static int events;
+
+// Execute a command line, returns what was sent
+static std::string run(const char *command)
+{
+  TestStream s;
+  char line[64];
+
+  snprintf(line, sizeof(line), "%s", command);
+  events = rigCtlExecute(&s, line);
+  return(s.out);
+}
+
+static std::vector<std::string> lines(const std::string &text)
+{
+  std::vector<std::string> result;
+  std::istringstream in(text);
+  std::string line;
+
+  while(std::getline(in, line)) result.push_back(line);
+  return(result);
+}
+
+static void reset()
+{
+  selectBand(2, false);
+  volume = 35;
+}
+
+TEST(rigctlDumpState)
+{
+  reset();
+  std::vector<std::string> l = lines(run("\\dump_state"));
+  size_t i = 0;
+
+  // The way netrigctl_open() reads it
+  CHECK(l.size() > 30);
+  if(l.size() <= 30) return;
+  CHECK(l[i++] == "1");   // Protocol version
+  CHECK(l[i++] == "2");   // Rig model
+  CHECK(l[i++] == "1");   // ITU region
+
+  // Receive ranges, up to an all zero line
+  int ranges = 0;
+  for( ; i < l.size() && l[i] != "0 0 0 0 0 0 0" ; i++, ranges++)
+  {
+    double start, end;
+    unsigned modes, vfo, ant;
+    int low, high;
+    CHECK_EQ(sscanf(l[i].c_str(), "%lf %lf %x %d %d %x %x", &start, &end, &modes, &low, &high, &vfo, &ant), 7);
+    CHECK(start < end && modes);
+  }
+  CHECK_EQ(ranges, 2);
+
+  // No transmit ranges
+  CHECK(l[++i] == "0 0 0 0 0 0 0");
+  i++;
+
+  // Tuning steps and filters, each list ends with "0 0"
+  for(int list=0 ; list<2 ; list++)
+  {
+    int entries = 0;
+    for( ; i < l.size() && l[i] != "0 0" ; i++, entries++)
+    {
+      unsigned modes;
+      long value;
+      CHECK_EQ(sscanf(l[i].c_str(), "%x %ld", &modes, &value), 2);
+      CHECK(modes && value > 0);
+    }
+    CHECK(entries > 0);
+    i++;
+  }
+
+  // Max RIT, XIT, IF shift, announces, then empty preamp and
+  // attenuator lists
+  for(int j=0 ; j<4 ; j++) CHECK(l[i++] == "0");
+  CHECK(l[i++] == "");
+  CHECK(l[i++] == "");
+
+  // Functions, levels and parameters (get, set)
+  unsigned long masks[6];
+  for(int j=0 ; j<6 ; j++) CHECK_EQ(sscanf(l[i++].c_str(), "0x%lx", &masks[j]), 1);
+  CHECK(masks[2] && (masks[2] & masks[3]) == masks[3]);
+
+  // Protocol 1 tail: key=value lines up to "done"
+  for( ; i < l.size() - 1 ; i++) CHECK(l[i].find('=') != std::string::npos);
+  CHECK(l.back() == "done");
+  CHECK(run("\\dump_state").find("RPRT") == std::string::npos);
+}
+
+TEST(rigctlPlainResponses)
+{
+  reset();
+  char freq[32];
+  snprintf(freq, sizeof(freq), "%lu\n", (unsigned long)getCurrentFrequencyHz());
+
+  // Get commands send just the values
+  CHECK(run("f") == freq);
+  CHECK(run("\\get_freq") == freq);
+  CHECK_EQ(events, 0);
+  CHECK(run("m") == "AM\n6000\n");
+
+  // Set commands send RPRT 0, with or without a space
+  CHECK(run("F 7100000") == "RPRT 0\n");
+  CHECK_EQ(events, REMOTE_CHANGED | REMOTE_PREFS);
+  CHECK_EQ(getCurrentFrequencyHz(), 7100000);
+  CHECK(run("F7200000") == "RPRT 0\n");
+  CHECK_EQ(getCurrentFrequencyHz(), 7200000);
+  CHECK(run("\\set_level AF 0.5") == "RPRT 0\n");
+  CHECK_EQ(volume, 32);
+}
+
+TEST(rigctlExtendedResponses)
+{
+  reset();
+  char freq[32];
+  snprintf(freq, sizeof(freq), "%lu", (unsigned long)getCurrentFrequencyHz());
+
+  // '+': labeled values, one per line, then RPRT
+  CHECK(run("+f") == std::string("get_freq:\nFrequency: ") + freq + "\nRPRT 0\n");
+  CHECK(run("+\\get_mode") == "get_mode:\nMode: AM\nPassband: 6000\nRPRT 0\n");
+  CHECK(run("+F 7100000") == "set_freq: 7100000\nRPRT 0\n");
+
+  // ';', '|', ',': all on one line
+  CHECK(run(";\\get_split_vfo") == "get_split_vfo:;Split: 0;TX VFO: VFOA;RPRT 0\n");
+  CHECK(run("|v") == "get_vfo:|VFO: VFOA|RPRT 0\n");
+  CHECK(run(",l AF") == "get_level: AF,AF: 0.555556,RPRT 0\n");
+
+  // Errors are echoed the same way
+  CHECK(run("+l FOO") == "get_level: FOO\nRPRT -1\n");
+  CHECK(run(";\\foo") == "\\foo:;RPRT -4\n");
+}
+
+TEST(rigctlErrors)
+{
+  reset();
+  uint32_t freq = getCurrentFrequencyHz();
+
+  // Unknown commands
+  CHECK(run("x") == "RPRT -4\n");
+  CHECK(run("\\get_bogus") == "RPRT -4\n");
+  CHECK(run("\\") == "RPRT -4\n");
+  CHECK_EQ(events, 0);
+
+  // Missing or invalid arguments
+  CHECK(run("F") == "RPRT -1\n");
+  CHECK(run("L AF") == "RPRT -1\n");
+  CHECK(run("F abc") == "RPRT -1\n");
+  CHECK(run("F 1") == "RPRT -1\n");
+  CHECK(run("M XYZ") == "RPRT -1\n");
+  CHECK(run("L AF 2") == "RPRT -1\n");
+  CHECK(run("l FOO") == "RPRT -1\n");
+  CHECK_EQ(events, 0);
+  CHECK_EQ(getCurrentFrequencyHz(), freq);
+  CHECK_EQ(volume, 35);
+
+  // Receive only
+  CHECK(run("T 1") == "RPRT -11\n");
+  CHECK(run("T 0") == "RPRT 0\n");
+  CHECK(run("S 1 VFOB") == "RPRT -11\n");
+
+  // Quit closes without a reply, empty lines do nothing
+  CHECK(run("q") == "");
+  CHECK_EQ(events, REMOTE_CLOSE);
+  CHECK(run("\\quit") == "");
+  CHECK(run("") == "");
+  CHECK(run("   ") == "");
+  CHECK_EQ(events, 0);
+}
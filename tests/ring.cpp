@@ -0,0 +1,155 @@
+#include "test.h"
+#include "Ring.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+//
+// Command ring with producers and the consumer on their own threads
+//
+
+struct Command
+{
+  uint16_t producer;
+  uint16_t count;   // Commands posted together
+  uint32_t seq;     // Per producer sequence number
+  uint32_t first;   // Sequence number of the first one posted together
+};
+
+TEST(ringBatches)
+{
+  CommandRing<Command, 8> ring;
+  Command c[8];
+  uint32_t ticket;
+
+  for(int i=0 ; i<8 ; i++) c[i] = { 0, 1, (uint32_t)i, (uint32_t)i };
+
+  CHECK(!ring.front());
+  CHECK(ring.push(c, 5, &ticket));
+  CHECK_EQ(ticket, 5);
+  CHECK(!ring.finished(ticket));
+
+  // All or nothing
+  CHECK(!ring.push(c, 4));
+  CHECK(ring.push(c + 5, 3));
+  CHECK(!ring.push(c, 1));
+  CHECK(!ring.push(c, 9));
+
+  for(int i=0 ; i<8 ; i++)
+  {
+    CHECK(ring.front() && ring.front()->seq == (uint32_t)i);
+    ring.pop();
+  }
+
+  CHECK(!ring.front());
+  CHECK(ring.finished(ticket));
+
+  // Nothing posted, the ticket is done already
+  CHECK(ring.push(c, 0, &ticket));
+  CHECK(ring.finished(ticket));
+  CHECK(ring.wait(ticket, 0));
+}
+
+TEST(ringWaitTimeout)
+{
+  CommandRing<Command, 8> ring;
+  Command c = { 0, 1, 0, 0 };
+  uint32_t ticket;
+
+  ring.push(&c, 1, &ticket);
+
+  TickType_t start = xTaskGetTickCount();
+  CHECK(!ring.wait(ticket, 50));
+  CHECK(xTaskGetTickCount() - start >= 50);
+}
+
+TEST(ringWaitWakesUp)
+{
+  CommandRing<Command, 8> ring;
+  Command c = { 0, 1, 0, 0 };
+  uint32_t ticket;
+
+  ring.push(&c, 1, &ticket);
+
+  std::thread consumer([&ring]
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ring.pop();
+  });
+
+  // Woken up by pop(), long before the timeout
+  TickType_t start = xTaskGetTickCount();
+  CHECK(ring.wait(ticket, 5000));
+  CHECK(xTaskGetTickCount() - start < 1000);
+  consumer.join();
+}
+
+TEST(ringStress)
+{
+  const int producers = 8;
+  const uint32_t commands = 20000;
+  static CommandRing<Command, 64> ring;
+  std::atomic<int> running{producers};
+  std::atomic<int> waitFailures{0};
+  std::vector<std::thread> threads;
+
+  for(int p=0 ; p<producers ; p++)
+    threads.emplace_back([&, p]
+    {
+      uint32_t seq = 0, r = p * 7 + 1;
+
+      while(seq < commands)
+      {
+        Command c[8];
+        uint32_t count, ticket;
+
+        r = r * 1103515245 + 12345;
+        count = min(1 + (r >> 16) % 8, commands - seq);
+        for(uint32_t i=0 ; i<count ; i++)
+          c[i] = { (uint16_t)p, (uint16_t)count, seq + i, seq };
+
+        while(!ring.push(c, count, &ticket)) std::this_thread::yield();
+        seq += count;
+
+        // Now and then wait for the consumer, like the web server
+        if(!((r >> 8) & 255) && (!ring.wait(ticket, 5000) || !ring.finished(ticket)))
+          waitFailures++;
+      }
+
+      running--;
+    });
+
+  // Commands come in order per producer, the ones posted together
+  // come one after another
+  std::vector<uint32_t> next(producers, 0);
+  uint32_t total = 0, wrong = 0;
+  Command *c;
+
+  while(running || ring.front())
+  {
+    if(!(c = ring.front()))
+    {
+      std::this_thread::yield();
+      continue;
+    }
+
+    Command first = *c;
+    wrong += first.seq != next[first.producer] || first.seq != first.first;
+
+    for(uint32_t i=0 ; i<first.count ; i++)
+    {
+      while(!(c = ring.front())) std::this_thread::yield();
+      wrong += c->producer != first.producer || c->seq != first.seq + i;
+      next[c->producer] = c->seq + 1;
+      ring.pop();
+      total++;
+    }
+  }
+
+  for(auto &t : threads) t.join();
+
+  CHECK_EQ(wrong, 0);
+  CHECK_EQ(waitFailures, 0);
+  CHECK_EQ(total, producers * commands);
+  for(int p=0 ; p<producers ; p++) CHECK_EQ(next[p], commands);
+}
@@ -0,0 +1,232 @@
+#include "test.h"
+#include "Common.h"
+#include "Remote.h"
+#include "Script.h"
+#include "Utils.h"
+#include <LittleFS.h>
+#include <string>
+
+//
+// Script interpreter on a simulated clock. The test moves the time,
+// the interpreter must never wait for it.
+//
+
+struct TestStream : public Stream
+{
+  std::string out;
+
+  int available() override { return(0); }
+  int read() override { return(-1); }
+  int peek() override { return(-1); }
+  size_t write(uint8_t c) override { out += (char)c; return(1); }
+};
+
+// Main loop for the given time, returns the remote events
+static int run(uint32_t ms, uint32_t step = 10)
+{
+  int event = 0;
+
+  for(uint32_t t=0 ; t<ms ; t+=step)
+  {
+    uint64_t start = hostTime;
+    event |= scriptTickTime();
+    CHECK_EQ(hostTime, start);
+    hostAdvance(step);
+  }
+
+  return(event);
+}
+
+static std::string save(const char *text)
+{
+  TestStream s;
+  scriptSave(text, &s);
+  return(s.out);
+}
+
+static std::string logText()
+{
+  fs::File file = LittleFS.open(SCRIPT_LOG_PATH, "rb");
+  std::string s(file.size(), '\0');
+  file.read((uint8_t *)s.data(), s.size());
+  return(s);
+}
+
+static int count(const std::string &s, const std::string &what)
+{
+  int n = 0;
+  for(size_t p=0 ; (p = s.find(what, p)) != std::string::npos ; p += what.size()) n++;
+  return(n);
+}
+
+// Ad hoc serial commands
+static std::string remote(RemoteState *state, const char *text)
+{
+  TestStream s;
+  while(*text) remoteDoCommand(&s, state, *text++);
+  return(s.out);
+}
+
+TEST(scriptSyntax)
+{
+  CHECK(save("wait 5x\n").find("Line 1: Invalid time") != std::string::npos);
+  CHECK(save("# comment\n\nfoo\n").find("Line 3: Unknown statement") != std::string::npos);
+  CHECK(save("wait5\n").find("Unknown statement") != std::string::npos);
+  CHECK(save("repeat 2\nprint x\n").find("Repeat without end") != std::string::npos);
+  CHECK(save("end\n").find("End without repeat") != std::string::npos);
+  CHECK(save("repeat\nrepeat\nrepeat\nrepeat\nrepeat\nend\nend\nend\nend\nend\n").find("nested too deep") != std::string::npos);
+  CHECK(save("at 24:00\n").find("Invalid time of day") != std::string::npos);
+  CHECK(save("at 12:00:60\n").find("Invalid time of day") != std::string::npos);
+  CHECK(save("repeat 0\nend\n").find("Invalid repeat count") != std::string::npos);
+  CHECK(save("stop now\n").find("Unexpected argument") != std::string::npos);
+  CHECK(save("rig\n").find("Missing command") != std::string::npos);
+  CHECK(save("wait 5000000h\n").find("Invalid time") != std::string::npos);
+
+  // Keywords are not case sensitive, indentation is allowed
+  CHECK(save("WAIT 1h\nRepeat 2\n  Print  hi\nEND\nat 23:59:59\n").find("Script saved, 5 statements") != std::string::npos);
+}
+
+TEST(scriptLoops)
+{
+  save("repeat 3\nprint a\nrepeat 2\nprint b\nend\nend\nprint c\n");
+  CHECK(scriptStart(NULL));
+  run(100);
+  CHECK(!scriptRunning());
+
+  std::string log = logText();
+  CHECK_EQ(count(log, " a\r\n"), 3);
+  CHECK_EQ(count(log, " b\r\n"), 6);
+  CHECK_EQ(count(log, " c\r\n"), 1);
+  CHECK(log.find("Script finished") != std::string::npos);
+}
+
+TEST(scriptEndlessLoopYields)
+{
+  // A loop without waits runs a few statements per main loop pass
+  save("repeat\nend\n");
+  scriptStart(NULL);
+  run(1000);
+  CHECK(scriptRunning());
+  scriptStop();
+  CHECK(!scriptRunning());
+}
+
+TEST(scriptWait)
+{
+  TestStream s;
+
+  save("print start\nkey V\nwait 10m\nkey v\nprint done\n");
+  volume = 35;
+  scriptStart(NULL);
+
+  CHECK(run(100) & REMOTE_CHANGED);
+  CHECK_EQ(volume, 36);
+
+  // Status tells the time left
+  run(60 * 1000, 1000);
+  scriptStatus(&s);
+  CHECK(s.out.find("waiting at line 3, 539 s left") != std::string::npos);
+
+  run(9 * 60 * 1000 - 1000, 1000);
+  CHECK(scriptRunning());
+  CHECK_EQ(volume, 36);
+
+  run(2000);
+  CHECK(!scriptRunning());
+  CHECK_EQ(volume, 35);
+
+  // Log lines have the time since start without a clock
+  std::string log = logText();
+  CHECK(log.find("+0s start\r\n") != std::string::npos);
+  CHECK(log.find("+600s done\r\n") != std::string::npos);
+}
+
+TEST(scriptClockTrigger)
+{
+  save("repeat\nat 12:00\nprint noon\nend\n");
+  clockReset();
+  scriptStart(NULL);
+
+  // Waits for the clock to be set
+  run(5000);
+  CHECK_EQ(count(logText(), "noon"), 0);
+
+  clockSet(11, 59, 50);
+  run(9900);
+  CHECK_EQ(count(logText(), "noon"), 0);
+  run(200);
+  CHECK_EQ(count(logText(), "12:00:00 noon"), 1);
+
+  // Once a day
+  run(5000);
+  CHECK_EQ(count(logText(), "noon"), 1);
+  run(86400 * 1000, 1000);
+  CHECK_EQ(count(logText(), "noon"), 2);
+
+  scriptStop();
+  CHECK(logText().find("Script stopped at line 2") != std::string::npos);
+  clockReset();
+}
+
+TEST(scriptUpload)
+{
+  RemoteState state, other;
+
+  CHECK(remote(&state, "xu\r\nprint from serial\r\nwait 2s\r\n.\r\n").find("Script saved, 2 statements") != std::string::npos);
+  CHECK(remote(&state, "xp\n").find("print from serial\nwait 2s\n\r\n.") != std::string::npos);
+  CHECK(remote(&state, "xr\n").find("Script started") != std::string::npos);
+  run(10);
+  CHECK(remote(&state, "x\n").find("waiting at line 2, 1 s left") != std::string::npos);
+  run(2000);
+  CHECK(remote(&state, "x\n").find("Script stopped") != std::string::npos);
+  CHECK(remote(&state, "xl\n").find("from serial") != std::string::npos);
+
+  // A bad script keeps the old one
+  CHECK(remote(&state, "xu\nbogus\n.\n").find("Line 1: Unknown statement") != std::string::npos);
+  CHECK(remote(&state, "xp\n").find("from serial") != std::string::npos);
+
+  // One upload at a time, until the abandoned one times out
+  remote(&state, "xu\nprint x\n");
+  CHECK(remote(&other, "xu\n").find("Upload in progress") != std::string::npos);
+  run(SCRIPT_UPLOAD_TIMEOUT + 10);
+  CHECK(remote(&other, "xu\nprint other\n.\n").find("Script saved") != std::string::npos);
+  CHECK(remote(&state, "x\n").find("Script stopped") != std::string::npos);
+
+  // Too large
+  std::string big = "xu\n";
+  for(int i=0 ; i<500 ; i++) big += "print 0123456789\n";
+  CHECK(remote(&state, (big + ".\n").c_str()).find("Script too large") != std::string::npos);
+}
+
+TEST(scriptControl)
+{
+  // Scripts can not start or upload scripts
+  save("key xr\nkey xu\nprint after\n");
+  scriptRequestRun(true);
+  run(100);
+  std::string log = logText();
+  CHECK_EQ(count(log, "Not allowed in a script"), 2);
+  CHECK(log.find("after") != std::string::npos);
+
+  // Web server requests are served by the main loop
+  save("wait 1h\n");
+  scriptRequestRun(true);
+  CHECK(!scriptRunning());
+  run(10);
+  CHECK(scriptRunning());
+  scriptRequestRun(false);
+  run(10);
+  CHECK(!scriptRunning());
+}
+
+TEST(scriptLogLimit)
+{
+  save("repeat\nprint 0123456789012345678901234567890123456789\nend\n");
+  scriptStart(NULL);
+  run(10000);
+  scriptStop();
+
+  size_t size = logText().size();
+  CHECK(size <= SCRIPT_MAX_LOG);
+  CHECK(size > SCRIPT_MAX_LOG - 100);
+}
@@ -0,0 +1,275 @@
+#include "test.h"
+#include "Common.h"
+#include "Storage.h"
+#include "Themes.h"
+#include "Menu.h"
+#include "esp_rom_crc.h"
+#include <string>
+
+//
+// Settings, bands and memories records in the in-memory NVS: saving
+// only what changed, reading them back at boot, rejecting damaged
+// records and migrating the earlier layout with a key per item
+//
+
+// Restart with the flash as it is: nvsErase() forgets what is known
+// to be stored, the namespaces are put back
+static void reboot()
+{
+  auto nvs = Preferences::nvs;
+  nvsErase();
+  Preferences::nvs = nvs;
+  Preferences::reads = 0;
+  Preferences::writes = 0;
+}
+
+// Empty flash and default settings
+static void reset()
+{
+  nvsErase();
+  Preferences::reads = 0;
+  Preferences::writes = 0;
+
+  volume = 35;
+  bandIdx = 0;
+  themeIdx = 0;
+  locationLat = locationLon = INT16_MIN;
+  bands[1].currentFreq = 810;
+  bands[1].usbCal = 0;
+  memset(memories, 0, MEMORY_COUNT * sizeof(Memory));
+}
+
+static void put(const char *space, const char *key, const void *data, size_t size)
+{
+  Preferences p;
+  p.begin(space, false, STORAGE_PARTITION);
+  p.putBytes(key, data, size);
+}
+
+static std::string &record(const char *space)
+{
+  return(Preferences::nvs[space]["Record"]);
+}
+
+TEST(saveOnlyChanges)
+{
+  reset();
+
+  // Nothing is known to be stored yet
+  prefsSave(SAVE_ALL);
+  CHECK(prefsAreWritten());
+  CHECK(Preferences::writes > 0);
+  CHECK_EQ(Preferences::opened, 0);
+
+  // Saving again writes nothing
+  Preferences::writes = 0;
+  prefsSave(SAVE_ALL);
+  prefsSave(SAVE_CUR_BAND);
+  CHECK_EQ(Preferences::writes, 0);
+  CHECK(!prefsAreWritten());
+
+  // One record for one change
+  volume = 20;
+  prefsSave(SAVE_ALL);
+  CHECK_EQ(Preferences::writes, 1);
+  CHECK(prefsAreWritten());
+
+  bands[1].currentFreq = 1000;
+  Preferences::writes = 0;
+  prefsSave(SAVE_CUR_BAND);
+  CHECK_EQ(Preferences::writes, 1);
+}
+
+TEST(bootReads)
+{
+  reset();
+  volume = 12;
+  locationLat = 4750;
+  bands[1].currentFreq = 999;
+  memories[3].freq = 7100000;
+  prefsSave(SAVE_ALL);
+  reboot();
+
+  volume = 35;
+  locationLat = INT16_MIN;
+  bands[1].currentFreq = 810;
+  memories[3].freq = 0;
+
+  // One length and one record read per namespace
+  CHECK(prefsLoad(SAVE_ALL));
+  CHECK_EQ(Preferences::reads, 6);
+  CHECK_EQ(Preferences::writes, 0);
+  CHECK_EQ(Preferences::opened, 0);
+
+  CHECK_EQ(volume, 12);
+  CHECK_EQ(locationLat, 4750);
+  CHECK_EQ(bands[1].currentFreq, 999);
+  CHECK_EQ(memories[3].freq, 7100000);
+
+  // What was read is what is stored, saving writes nothing
+  prefsSave(SAVE_ALL);
+  CHECK_EQ(Preferences::writes, 0);
+}
+
+TEST(currentBandOnly)
+{
+  reset();
+  bands[1].currentFreq = 999;
+  bands[2].currentFreq = 9999;
+  prefsSave(SAVE_ALL);
+  reboot();
+
+  bands[1].currentFreq = 810;
+  bands[2].currentFreq = 15200;
+  bandIdx = 1;
+  CHECK(prefsLoad(SAVE_CUR_BAND));
+  CHECK_EQ(bands[1].currentFreq, 999);
+  CHECK_EQ(bands[2].currentFreq, 15200);
+  bandIdx = 0;
+}
+
+TEST(damagedRecords)
+{
+  reset();
+  volume = 12;
+  prefsSave(SAVE_ALL);
+  std::string good = record("settings");
+
+  // Bad CRC
+  record("settings")[good.size() - 1] ^= 1;
+  reboot();
+  volume = 35;
+  CHECK(!prefsLoad(SAVE_SETTINGS|SAVE_VERIFY));
+  CHECK_EQ(volume, 35);
+
+  // Size not matching the header
+  record("settings") = good.substr(0, good.size() - 1);
+  reboot();
+  CHECK(!prefsLoad(SAVE_SETTINGS|SAVE_VERIFY));
+  CHECK_EQ(volume, 35);
+
+  // Version without a migration
+  record("settings") = good;
+  record("settings")[0] = 70;
+  reboot();
+  CHECK(!prefsLoad(SAVE_SETTINGS|SAVE_VERIFY));
+  CHECK_EQ(volume, 35);
+
+  // Without SAVE_VERIFY the rest still loads
+  record("settings")[0] ^= 1;
+  CHECK(prefsLoad(SAVE_ALL));
+
+  // A damaged record is not known to be stored, it gets rewritten
+  prefsSave(SAVE_SETTINGS);
+  CHECK_EQ(Preferences::writes, 2);
+  reboot();
+  CHECK(prefsLoad(SAVE_SETTINGS|SAVE_VERIFY));
+}
+
+TEST(newerRecord)
+{
+  reset();
+  volume = 12;
+  prefsSave(SAVE_SETTINGS);
+
+  // Newer firmware added fields at the end
+  std::string r = record("settings") + "\x01\x02\x03";
+  uint16_t size = r.size() - 8;
+  uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)r.data() + 8, size);
+  memcpy(&r[2], &size, 2);
+  memcpy(&r[4], &crc, 4);
+  record("settings") = r;
+  reboot();
+
+  volume = 35;
+  CHECK(prefsLoad(SAVE_SETTINGS|SAVE_VERIFY));
+  CHECK_EQ(volume, 12);
+
+  // Not what is stored, the next save writes it
+  prefsSave(SAVE_SETTINGS);
+  CHECK_EQ(Preferences::writes, 2);
+}
+
+TEST(migrateSettings)
+{
+  reset();
+  uint8_t version = 71, vol = 17, theme = 2;
+  int16_t lat = -3387;
+  put("settings", "Version", &version, 1);
+  put("settings", "Volume", &vol, 1);
+  put("settings", "Theme", &theme, 1);
+  put("settings", "Latitude", &lat, 2);
+  Preferences::writes = 0;
+
+  CHECK(prefsLoad(SAVE_SETTINGS|SAVE_VERIFY));
+  CHECK_EQ(volume, 17);
+  CHECK_EQ(themeIdx, 2);
+  CHECK_EQ(locationLat, -3387);
+  CHECK_EQ(locationLon, INT16_MIN);
+
+  // Stored as a record of the current version right away, without
+  // the old keys
+  CHECK_EQ(Preferences::nvs["settings"].size(), 1);
+  CHECK_EQ(*(uint16_t *)record("settings").data(), VER_SETTINGS);
+  CHECK_EQ(Preferences::opened, 0);
+
+  prefsSave(SAVE_SETTINGS);
+  reboot();
+  volume = 35;
+  CHECK(prefsLoad(SAVE_SETTINGS|SAVE_VERIFY));
+  CHECK_EQ(volume, 17);
+  CHECK_EQ(Preferences::writes, 0);
+}
+
+TEST(migrateBands)
+{
+  reset();
+
+  // Unpacked band of the earlier layout
+  struct
+  {
+    uint8_t bandMode;
+    uint16_t currentFreq;
+    int8_t currentStepIdx;
+    int8_t bandwidthIdx;
+    int16_t usbCal;
+    int16_t lsbCal;
+  } old = { AM, 999, 1, 2, -30, 40 };
+  uint8_t version = 72;
+
+  put("bands", "Version", &version, 1);
+  put("bands", "Band-1", &old, sizeof(old));
+
+  CHECK(prefsLoad(SAVE_BANDS|SAVE_VERIFY));
+  CHECK_EQ(bands[1].currentFreq, 999);
+  CHECK_EQ(bands[1].currentStepIdx, 1);
+  CHECK_EQ(bands[1].bandwidthIdx, 2);
+  CHECK_EQ(bands[1].usbCal, -30);
+  CHECK_EQ(bands[1].lsbCal, 40);
+
+  // Bands that were not stored keep their defaults
+  CHECK_EQ(bands[2].currentFreq, 15200);
+
+  CHECK_EQ(Preferences::nvs["bands"].size(), 1);
+  CHECK_EQ(*(uint16_t *)record("bands").data(), VER_BANDS);
+}
+
+TEST(migrateMemories)
+{
+  reset();
+  Memory m = { 7100000, 3, LSB, "40m" };
+  uint8_t version = 71;
+
+  put("memories", "Version", &version, 1);
+  put("memories", "Memory-5", &m, sizeof(m));
+
+  CHECK(prefsLoad(SAVE_MEMORIES|SAVE_VERIFY));
+  CHECK_EQ(memories[5].freq, 7100000);
+  CHECK_EQ(memories[5].band, 3);
+  CHECK_EQ(memories[5].mode, LSB);
+  CHECK(!strcmp(memories[5].name, "40m"));
+  CHECK_EQ(memories[4].freq, 0);
+
+  CHECK_EQ(Preferences::nvs["memories"].size(), 1);
+  CHECK_EQ(*(uint16_t *)record("memories").data(), VER_MEMORIES);
+}
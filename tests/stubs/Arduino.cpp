@@ -0,0 +1,76 @@
+#include "Arduino.h"
+#include "WiFi.h"
+#include "ESPmDNS.h"
+
+uint64_t hostTime = 0;
+EspClass ESP;
+int hostRestarts = 0;
+uint32_t hostFreeHeap = 180000;
+WiFiClass WiFi;
+MDNSResponder MDNS;
+
+void hostAdvance(uint32_t ms) { hostTime += (uint64_t)ms * 1000; }
+
+uint32_t millis() { return(hostTime / 1000); }
+uint32_t micros() { return(hostTime); }
+void delay(uint32_t ms) { hostAdvance(ms); }
+void yield() {}
+
+uint16_t hostAnalogValue = 2380;
+int hostAnalogReads = 0;
+
+int analogRead(uint8_t pin)
+{
+  hostAnalogReads++;
+  return(hostAnalogValue);
+}
+
+size_t Print::write(const uint8_t *data, size_t size)
+{
+  size_t n = 0;
+  while(size--) n += write(*data++);
+  return(n);
+}
+
+size_t Print::print(long n, int base)
+{
+  char buf[24];
+  snprintf(buf, sizeof(buf), base == HEX ? "%lX" : "%ld", n);
+  return(print(buf));
+}
+
+size_t Print::print(unsigned long n, int base)
+{
+  char buf[24];
+  snprintf(buf, sizeof(buf), base == HEX ? "%lX" : "%lu", n);
+  return(print(buf));
+}
+
+size_t Print::print(double n, int digits)
+{
+  char buf[48];
+  snprintf(buf, sizeof(buf), "%.*f", digits, n);
+  return(print(buf));
+}
+
+size_t Print::printf(const char *format, ...)
+{
+  char buf[256];
+  va_list args;
+
+  va_start(args, format);
+  int n = vsnprintf(buf, sizeof(buf), format, args);
+  va_end(args);
+
+  if(n < 0) return(0);
+  if(n < (int)sizeof(buf)) return(write((const uint8_t *)buf, n));
+
+  // Long output
+  char *big = (char *)malloc(n + 1);
+  va_start(args, format);
+  vsnprintf(big, n + 1, format, args);
+  va_end(args);
+  size_t result = write((const uint8_t *)big, n);
+  free(big);
+  return(result);
+}
@@ -0,0 +1,148 @@
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+//
+// Just enough of the Arduino core to build firmware modules on the
+// host. Time only moves when a test says so (hostAdvance()) or when
+// the code under test calls delay().
+//
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <ctype.h>
+#include <arpa/inet.h>
+#include <algorithm>
+#include <string>
+
+using std::min;
+using std::max;
+
+#define PROGMEM
+#define IRAM_ATTR
+#define F(s)      (s)
+#define HIGH      1
+#define LOW       0
+#define DEC       10
+#define HEX       16
+
+#define constrain(amt, low, high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+
+typedef uint8_t byte;
+
+// Host clock (microseconds since "boot")
+extern uint64_t hostTime;
+void hostAdvance(uint32_t ms);
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void yield();
+
+// ADC input (millivolts at the pin), reads are counted
+extern uint16_t hostAnalogValue;
+extern int hostAnalogReads;
+int analogRead(uint8_t pin);
+
+// No backlight or other PWM outputs
+inline void ledcWrite(uint8_t pin, uint32_t duty) {}
+
+// CPU cycle counter runs at 80MHz off the host clock, restarts are
+// only counted, free heap is what a test sets
+extern int hostRestarts;
+extern uint32_t hostFreeHeap;
+
+class EspClass
+{
+  public:
+    uint32_t getCpuFreqMHz() { return(80); }
+    uint32_t getCycleCount() { return(hostTime * getCpuFreqMHz()); }
+    uint32_t getFreeHeap() { return(hostFreeHeap); }
+    uint32_t getMinFreeHeap() { return(hostFreeHeap); }
+    uint32_t getFreePsram() { return(0); }
+    void restart() { hostRestarts++; }
+};
+
+extern EspClass ESP;
+
+// No PSRAM on the host
+inline bool psramFound() { return(false); }
+inline void *ps_malloc(size_t size) { return(malloc(size)); }
+
+class String : public std::string
+{
+  public:
+    String(const char *s = "") : std::string(s ? s : "") {}
+    String(const std::string &s) : std::string(s) {}
+    explicit String(char c) : std::string(1, c) {}
+    explicit String(int n, unsigned char base = 10) : String((long)n, base) {}
+    explicit String(unsigned n, unsigned char base = 10) : String((unsigned long)n, base) {}
+    explicit String(long n, unsigned char base = 10) : std::string(format(base == 16 ? "%lx" : "%ld", n)) {}
+    explicit String(unsigned long n, unsigned char base = 10) : std::string(format(base == 16 ? "%lx" : "%lu", n)) {}
+    explicit String(double n, unsigned char decimals = 2) : std::string(format("%.*f", decimals, n)) {}
+
+    long toInt() const { return(atol(c_str())); }
+    float toFloat() const { return(atof(c_str())); }
+
+    int indexOf(char c, size_t from = 0) const { size_t i = find(c, from); return(i == npos ? -1 : (int)i); }
+    String substring(size_t from, size_t to = npos) const { return(from < size() ? substr(from, to < from ? 0 : to - from) : ""); }
+
+    void trim()
+    {
+      erase(0, std::min(find_first_not_of(" \t\r\n"), size()));
+      erase(find_last_not_of(" \t\r\n") + 1);
+    }
+
+    void replace(const String &from, const String &to)
+    {
+      for(size_t i = find(from) ; from.size() && i != npos ; i = find(from, i + to.size()))
+        std::string::replace(i, from.size(), to);
+    }
+
+  private:
+    template<typename... T> static std::string format(const char *f, T... args)
+    {
+      char buf[64];
+      snprintf(buf, sizeof(buf), f, args...);
+      return(buf);
+    }
+};
+
+class Print
+{
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *data, size_t size);
+    size_t write(const char *s) { return(write((const uint8_t *)s, strlen(s))); }
+
+    size_t print(const char *s) { return(write(s)); }
+    size_t print(char c) { return(write((uint8_t)c)); }
+    size_t print(int n, int base = DEC) { return(print((long)n, base)); }
+    size_t print(unsigned n, int base = DEC) { return(print((unsigned long)n, base)); }
+    size_t print(long n, int base = DEC);
+    size_t print(unsigned long n, int base = DEC);
+    size_t print(double n, int digits = 2);
+
+    size_t println() { return(print("\r\n")); }
+    template<typename T> size_t println(T v) { size_t n = print(v); return(n + println()); }
+    template<typename T> size_t println(T v, int f) { size_t n = print(v, f); return(n + println()); }
+
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+    virtual void flush() {}
+};
+
+class Stream : public Print
+{
+  public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+};
+
+#endif // ARDUINO_H
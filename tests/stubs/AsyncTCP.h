@@ -0,0 +1,156 @@
+#ifndef ASYNCTCP_H
+#define ASYNCTCP_H
+
+#include <Arduino.h>
+#include <string>
+
+//
+// Connections without a network. A test plays the network task: it
+// calls the handlers the firmware installs, decides how much the TCP
+// stack takes (sendSpace), and sees what was sent and acknowledged.
+//
+
+class AsyncClient;
+
+typedef void (*AcConnectHandler)(void *arg, AsyncClient *client);
+typedef void (*AcDataHandler)(void *arg, AsyncClient *client, void *data, size_t len);
+typedef void (*AcAckHandler)(void *arg, AsyncClient *client, size_t len, uint32_t time);
+
+class AsyncClient
+{
+  public:
+    // Handlers installed by the firmware
+    AcConnectHandler connectHandler = NULL;
+    AcDataHandler dataHandler = NULL;
+    AcConnectHandler pollHandler = NULL;
+    AcAckHandler ackHandler = NULL;
+    AcConnectHandler disconnectHandler = NULL;
+    void *connectArg = NULL, *dataArg = NULL, *pollArg = NULL, *ackArg = NULL, *disconnectArg = NULL;
+
+    std::string host;        // Passed to connect()
+    uint16_t port = 0;
+    int connects = 0;
+    std::string added;       // Passed to add()
+    std::string sent;        // Passed to add() before the last send()
+    size_t sendSpace = 5744; // Free TCP send buffer
+    size_t unacked = 0;      // Received, but not acknowledged yet
+    bool closed = false;
+    bool aborted = false;
+    bool *deleted = NULL;    // Set when the firmware deletes the client
+
+    static inline AsyncClient *connecting = NULL;  // Last to connect()
+
+    ~AsyncClient() { if(deleted) *deleted = true; }
+
+    void setNoDelay(bool) {}
+    void onConnect(AcConnectHandler cb, void *arg = NULL) { connectHandler = cb; connectArg = arg; }
+    void onData(AcDataHandler cb, void *arg = NULL) { dataHandler = cb; dataArg = arg; }
+    void onPoll(AcConnectHandler cb, void *arg = NULL) { pollHandler = cb; pollArg = arg; }
+    void onAck(AcAckHandler cb, void *arg = NULL) { ackHandler = cb; ackArg = arg; }
+    void onDisconnect(AcConnectHandler cb, void *arg = NULL) { disconnectHandler = cb; disconnectArg = arg; }
+
+    // Connecting, until the test calls accept()
+    bool connect(const char *host, uint16_t port)
+    {
+      this->host = host;
+      this->port = port;
+      connects++;
+      connecting = this;
+      closed = aborted = false;
+      added.clear();
+      sent.clear();
+      return(true);
+    }
+
+    bool connected() { return(!closed); }
+    size_t space() { return(closed ? 0 : sendSpace); }
+
+    size_t add(const char *data, size_t size)
+    {
+      size = min(size, space());
+      added.append(data, size);
+      sendSpace -= size;
+      return(size);
+    }
+
+    bool send() { sent = added; return(true); }
+
+    void ackLater() { ackPending = false; }
+
+    size_t ack(size_t len)
+    {
+      len = min(len, unacked - inCallback);
+      unacked -= len;
+      return(len);
+    }
+
+    void close(bool now = false) { closed = true; aborted |= now; }
+
+    // Network: deliver data, acknowledged right away unless the
+    // handler asks for ackLater()
+    void receive(const std::string &data)
+    {
+      ackPending = true;
+      unacked += data.size();
+      // Like AsyncTCP, only data from earlier calls can be acknowledged
+      inCallback = data.size();
+      dataHandler(dataArg, this, (void *)data.data(), data.size());
+      inCallback = 0;
+      if(ackPending) unacked -= data.size();
+    }
+
+    // Network: the peer took length bytes of output
+    void peerAck(size_t length)
+    {
+      sendSpace += length;
+      ackHandler(ackArg, this, length, 0);
+    }
+
+    // Network: the connection was made
+    void accept() { connectHandler(connectArg, this); }
+
+    void poll() { pollHandler(pollArg, this); }
+    void disconnect() { closed = true; disconnectHandler(disconnectArg, this); }
+
+  private:
+    bool ackPending = true;
+    size_t inCallback = 0;
+};
+
+class AsyncServer
+{
+  public:
+    AsyncServer(uint16_t port) : port(port) { servers[count++] = this; }
+
+    // Server listening on the port
+    static AsyncServer *find(uint16_t port)
+    {
+      for(int i=0 ; i<count ; i++)
+        if(servers[i]->port == port) return(servers[i]);
+      return(NULL);
+    }
+
+    void onClient(AcConnectHandler cb, void *arg) { handler = cb; handlerArg = arg; }
+    void begin() { running = true; }
+    void end() { running = false; }
+
+    // Network: a client connects
+    AsyncClient *connect()
+    {
+      AsyncClient *client = new AsyncClient();
+      handler(handlerArg, client);
+      return(client);
+    }
+
+    uint16_t port;
+    bool running = false;
+
+  private:
+    AcConnectHandler handler = NULL;
+    void *handlerArg = NULL;
+
+    static inline AsyncServer *servers[8];
+    static inline int count = 0;
+};
+
+#endif // ASYNCTCP_H
@@ -0,0 +1,287 @@
+#ifndef ESPASYNCWEBSERVER_H
+#define ESPASYNCWEBSERVER_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <functional>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+//
+// Web server without a network. A test fills in a request, calls the
+// handlers registered with on() and looks at the reply. Chunked
+// responses are taken in chunkSize pieces as soon as they are sent.
+// WebSocket clients are connected, fed messages and dropped by the
+// test, which then looks at what each of them was sent.
+//
+
+enum WebRequestMethod { HTTP_GET = 1, HTTP_POST = 2, HTTP_PUT = 4, HTTP_ANY = 255 };
+
+typedef std::function<size_t(uint8_t *buffer, size_t maxLen, size_t index)> AwsResponseFiller;
+
+class AsyncWebServerResponse
+{
+  public:
+    int code = 200;
+    std::string type;
+    std::map<std::string, std::string> headers;
+    std::string content;         // Sent as it is, without a filler
+    AwsResponseFiller filler;
+
+    virtual ~AsyncWebServerResponse() {}
+    void setCode(int code) { this->code = code; }
+    void addHeader(const String &name, const String &value) { headers[name] = value; }
+};
+
+class AsyncResponseStream : public AsyncWebServerResponse, public Print
+{
+  public:
+    size_t write(uint8_t c) override { content += (char)c; return(1); }
+    size_t write(const uint8_t *data, size_t size) override { content.append((const char *)data, size); return(size); }
+};
+
+class AsyncWebParameter
+{
+  public:
+    String text;
+    const String &value() const { return(text); }
+};
+
+class AsyncWebServerRequest
+{
+  public:
+    std::map<std::string, std::string> query;  // URL parameters
+    std::map<std::string, std::string> post;   // Form fields
+    std::string login;                         // "user:password"
+    std::map<std::string, std::string> requestHeaders;
+    std::function<void()> disconnected;
+    void *_tempObject = NULL;                  // Freed with the request
+    size_t chunkSize = 1436;                   // Largest chunk taken
+
+    // Reply
+    int code = 0;
+    std::string body;
+    std::string type;
+    std::map<std::string, std::string> headers;
+    int chunks = 0;
+
+    ~AsyncWebServerRequest() { free(_tempObject); }
+
+    bool authenticate(const char *user, const char *password) { return(login == std::string(user) + ":" + password); }
+    void requestAuthentication() { code = 401; }
+
+    bool hasHeader(const char *name) { return(requestHeaders.count(name)); }
+    String header(const char *name) { return(requestHeaders[name]); }
+
+    bool hasParam(const char *name, bool isPost = false) { return((isPost ? post : query).count(name)); }
+
+    AsyncWebParameter *getParam(const char *name, bool isPost = false)
+    {
+      param.text = (isPost ? post : query)[name];
+      return(&param);
+    }
+
+    void send(int code, const char *type, const String &body) { this->code = code; this->type = type; this->body = body; }
+
+    void send(fs::FS &fs, const char *path, const char *type)
+    {
+      fs::File file = fs.open(path);
+      send(file ? 200 : 404, type, "");
+      for(int c ; (c = file.read()) >= 0 ; ) body += (char)c;
+    }
+
+    AsyncWebServerResponse *beginResponse(int code, const char *type = "", const uint8_t *data = NULL, size_t size = 0)
+    {
+      AsyncWebServerResponse *response = new AsyncWebServerResponse();
+      response->code = code;
+      response->type = type;
+      response->content.assign((const char *)data, data ? size : 0);
+      return(response);
+    }
+
+    AsyncResponseStream *beginResponseStream(const char *type)
+    {
+      AsyncResponseStream *response = new AsyncResponseStream();
+      response->type = type;
+      return(response);
+    }
+
+    AsyncWebServerResponse *beginChunkedResponse(const char *type, AwsResponseFiller filler)
+    {
+      AsyncWebServerResponse *response = new AsyncWebServerResponse();
+      response->type = type;
+      response->filler = filler;
+      return(response);
+    }
+
+    // The whole response is taken right away, up to an empty chunk
+    void send(AsyncWebServerResponse *response)
+    {
+      std::vector<uint8_t> buf(chunkSize);
+      size_t n;
+
+      code = response->code;
+      type = response->type;
+      headers = response->headers;
+      body = response->content;
+      while(response->filler && (n = response->filler(buf.data(), chunkSize, body.size())) > 0)
+      {
+        body.append((const char *)buf.data(), n);
+        chunks++;
+      }
+      delete response;
+    }
+    void redirect(const char *url) { code = 302; body = url; }
+    void onDisconnect(std::function<void()> handler) { disconnected = handler; }
+
+  private:
+    AsyncWebParameter param;
+};
+
+typedef std::function<void(AsyncWebServerRequest *request)> ArRequestHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest *request, const String &filename, size_t index, uint8_t *data, size_t len, bool final)> ArUploadHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)> ArBodyHandlerFunction;
+
+class AsyncWebHandler
+{
+  public:
+    virtual ~AsyncWebHandler() {}
+};
+
+//
+// WebSocket
+//
+
+enum AwsEventType { WS_EVT_CONNECT, WS_EVT_DISCONNECT, WS_EVT_PONG, WS_EVT_ERROR, WS_EVT_DATA };
+enum AwsFrameType { WS_CONTINUATION = 0, WS_TEXT = 1, WS_BINARY = 2, WS_DISCONNECT = 8, WS_PING = 9, WS_PONG = 10 };
+
+typedef struct
+{
+  uint8_t message_opcode;
+  uint32_t num;
+  uint8_t final;
+  uint8_t masked;
+  uint8_t opcode;
+  uint64_t len;
+  uint8_t mask[4];
+  uint64_t index;
+} AwsFrameInfo;
+
+class AsyncWebSocketClient
+{
+  public:
+    std::vector<std::string> messages;  // Sent to this client
+    bool closed = false;
+
+    AsyncWebSocketClient(uint32_t id) : clientId(id) {}
+
+    uint32_t id() const { return(clientId); }
+    void close() { closed = true; }
+    void text(const char *message) { if(!closed) messages.push_back(message); }
+    void text(const uint8_t *message, size_t len) { if(!closed) messages.push_back(std::string((const char *)message, len)); }
+
+  private:
+    uint32_t clientId;
+};
+
+class AsyncWebSocket;
+
+typedef std::function<void(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len)> AwsEventHandler;
+
+class AsyncWebSocket : public AsyncWebHandler
+{
+  public:
+    std::list<AsyncWebSocketClient> clients;
+
+    AsyncWebSocket(const char *url) : url(url) {}
+
+    void onEvent(AwsEventHandler handler) { this->handler = handler; }
+
+    size_t count() const
+    {
+      size_t n = 0;
+      for(const auto &c : clients) n += !c.closed;
+      return(n);
+    }
+
+    // Close the oldest clients over the limit. Closed clients are kept,
+    // so that a test can still look at them.
+    void cleanupClients(uint16_t maxClients)
+    {
+      size_t n = count();
+      for(auto &c : clients) if(n > maxClients && !c.closed) { c.close(); n--; }
+    }
+
+    void textAll(const uint8_t *message, size_t len) { for(auto &c : clients) c.text(message, len); }
+    void closeAll() { for(auto &c : clients) if(!c.closed) disconnect(&c); }
+
+    // Test side: a client connecting with the given request, sending
+    // a text message and going away
+    AsyncWebSocketClient *connect(AsyncWebServerRequest *request)
+    {
+      clients.emplace_back(++lastId);
+      AsyncWebSocketClient *client = &clients.back();
+      handler(this, client, WS_EVT_CONNECT, request, NULL, 0);
+      return(client);
+    }
+
+    void receive(AsyncWebSocketClient *client, const std::string &message)
+    {
+      AwsFrameInfo info = { WS_TEXT, 0, 1, 1, WS_TEXT, message.size(), { 0 }, 0 };
+      handler(this, client, WS_EVT_DATA, &info, (uint8_t *)message.data(), message.size());
+    }
+
+    void disconnect(AsyncWebSocketClient *client)
+    {
+      client->close();
+      handler(this, client, WS_EVT_DISCONNECT, NULL, NULL, 0);
+    }
+
+    const char *url;
+
+  private:
+    AwsEventHandler handler;
+    uint32_t lastId = 0;
+};
+
+class AsyncWebServer
+{
+  public:
+    struct Handler
+    {
+      int method;
+      ArRequestHandlerFunction request;
+      ArUploadHandlerFunction upload;
+      ArBodyHandlerFunction body;
+    };
+
+    std::multimap<std::string, Handler> handlers;
+    std::vector<AsyncWebHandler *> added;
+    ArRequestHandlerFunction notFound;
+    bool started = false;
+
+    AsyncWebServer(uint16_t port = 80) {}
+    void begin() { started = true; }
+    void end() { started = false; }
+
+    void on(const char *uri, int method, ArRequestHandlerFunction request, ArUploadHandlerFunction upload = NULL, ArBodyHandlerFunction body = NULL)
+    {
+      handlers.insert({ uri, { method, request, upload, body } });
+    }
+
+    void addHandler(AsyncWebHandler *handler) { added.push_back(handler); }
+    void onNotFound(ArRequestHandlerFunction handler) { notFound = handler; }
+
+    // Handler for the method, NULL if there is none
+    Handler *handler(const char *uri, int method = HTTP_ANY)
+    {
+      auto range = handlers.equal_range(uri);
+      for(auto i = range.first ; i != range.second ; ++i)
+        if(i->second.method & method) return(&i->second);
+      return(NULL);
+    }
+};
+
+#endif // ESPASYNCWEBSERVER_H
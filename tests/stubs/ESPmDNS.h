@@ -0,0 +1,23 @@
+#ifndef ESPMDNS_H
+#define ESPMDNS_H
+
+#include <Arduino.h>
+
+//
+// mDNS responder that remembers its hostname and services
+//
+
+class MDNSResponder
+{
+  public:
+    String hostname;
+    int services = 0;
+
+    bool begin(const char *name) { hostname = name; return(true); }
+    void end() { hostname = ""; services = 0; }
+    bool addService(const char *service, const char *proto, uint16_t port) { services++; return(true); }
+};
+
+extern MDNSResponder MDNS;
+
+#endif // ESPMDNS_H
@@ -0,0 +1,107 @@
+#ifndef LITTLEFS_H
+#define LITTLEFS_H
+
+#include <Arduino.h>
+#include <map>
+#include <memory>
+#include <string>
+
+//
+// Flash file system in memory. Tests look at and change the files
+// through LittleFS.files.
+//
+
+namespace fs
+{
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+class File : public Stream
+{
+  public:
+    File() {}
+    File(std::shared_ptr<std::string> data) : data(data) {}
+
+    operator bool() const { return(!!data); }
+
+    size_t size() const { return(data ? data->size() : 0); }
+    size_t position() const { return(pos); }
+
+    bool seek(uint32_t offset, SeekMode mode = SeekSet)
+    {
+      size_t at = mode == SeekSet ? 0 : mode == SeekCur ? pos : size();
+      if(!data || at + offset > size()) return(false);
+      pos = at + offset;
+      return(true);
+    }
+
+    size_t write(uint8_t c) override { return(write(&c, 1)); }
+
+    size_t write(const uint8_t *buf, size_t size) override
+    {
+      if(!data) return(0);
+      data->replace(pos, size, (const char *)buf, size);
+      pos += size;
+      return(size);
+    }
+
+    size_t read(uint8_t *buf, size_t size)
+    {
+      if(!data) return(0);
+      size = data->copy((char *)buf, size, pos);
+      pos += size;
+      return(size);
+    }
+
+    int available() override { return(size() - pos); }
+    int read() override { return(pos < size() ? (uint8_t)(*data)[pos++] : -1); }
+    int peek() override { return(pos < size() ? (uint8_t)(*data)[pos] : -1); }
+    void flush() override {}
+    void close() { data.reset(); pos = 0; }
+
+  private:
+    std::shared_ptr<std::string> data;
+    size_t pos = 0;
+};
+
+class FS
+{
+  public:
+    std::map<std::string, std::shared_ptr<std::string>> files;
+
+    bool begin(bool formatOnFail = false, const char *base = "/littlefs", uint8_t maxOpen = 10, const char *label = "spiffs") { return(true); }
+    void end() {}
+    bool format() { files.clear(); return(true); }
+
+    File open(const char *path, const char *mode = "r")
+    {
+      auto f = files.find(path);
+
+      if(mode[0] == 'r')
+        return(f == files.end() ? File() : File(f->second));
+
+      if(mode[0] == 'w' || f == files.end())
+        f = files.insert_or_assign(path, std::make_shared<std::string>()).first;
+
+      File file(f->second);
+      if(mode[0] == 'a') file.seek(0, SeekEnd);
+      return(file);
+    }
+
+    bool exists(const char *path) { return(files.count(path)); }
+    bool remove(const char *path) { return(files.erase(path)); }
+    size_t totalBytes() { return(1024 * 1024); }
+
+    size_t usedBytes()
+    {
+      size_t n = 0;
+      for(auto &f : files) n += f.second->size();
+      return(n);
+    }
+};
+
+}
+
+extern fs::FS LittleFS;
+
+#endif // LITTLEFS_H
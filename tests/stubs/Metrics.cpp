@@ -0,0 +1,8 @@
+#include "Metrics.h"
+
+//
+// Metrics count, but are not served on the host
+//
+
+Metric::Metric(const char *name, const char *help, uint8_t type, const char *labels, float (*get)()) :
+  name(name), help(help), labels(labels), type(type), next(NULL), get(get), count(0), value(0) {}
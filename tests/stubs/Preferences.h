@@ -0,0 +1,123 @@
+#ifndef PREFERENCES_H
+#define PREFERENCES_H
+
+#include <Arduino.h>
+#include <map>
+#include <string>
+
+//
+// NVS in memory, shared by all Preferences objects like the real one.
+// Tests look at and change it through Preferences::nvs, and count the
+// flash reads and writes.
+//
+
+class Preferences
+{
+  public:
+    typedef std::map<std::string, std::string> Namespace;
+
+    static inline std::map<std::string, Namespace> nvs;
+    static inline int reads = 0;
+    static inline int writes = 0;
+    static inline int opened = 0;  // Namespaces open now
+
+    ~Preferences() { end(); }
+
+    bool begin(const char *name, bool readOnly = false, const char *partition = NULL)
+    {
+      if(ns) return(false);
+      ns = &nvs[name];
+      this->readOnly = readOnly;
+      opened++;
+      return(true);
+    }
+
+    void end()
+    {
+      if(ns) opened--;
+      ns = NULL;
+    }
+
+    bool clear()
+    {
+      if(!ns || readOnly) return(false);
+      writes++;
+      ns->clear();
+      return(true);
+    }
+
+    bool remove(const char *key)
+    {
+      if(!ns || readOnly) return(false);
+      writes++;
+      return(ns->erase(key));
+    }
+
+    bool isKey(const char *key) { return(ns && ns->count(key)); }
+
+    size_t putBytes(const char *key, const void *value, size_t size)
+    {
+      if(!ns || readOnly) return(0);
+      writes++;
+      (*ns)[key].assign((const char *)value, size);
+      return(size);
+    }
+
+    size_t getBytesLength(const char *key)
+    {
+      const std::string *v = find(key);
+      return(v ? v->size() : 0);
+    }
+
+    size_t getBytes(const char *key, void *buf, size_t size)
+    {
+      const std::string *v = find(key);
+      if(!v || v->size() > size) return(0);
+      memcpy(buf, v->data(), v->size());
+      return(v->size());
+    }
+
+    size_t putUChar(const char *key, uint8_t value)   { return(put(key, value)); }
+    size_t putUShort(const char *key, uint16_t value) { return(put(key, value)); }
+    size_t putShort(const char *key, int16_t value)   { return(put(key, value)); }
+    size_t putUInt(const char *key, uint32_t value)   { return(put(key, value)); }
+    size_t putBool(const char *key, bool value)       { return(put(key, (uint8_t)value)); }
+
+    uint8_t getUChar(const char *key, uint8_t value = 0)    { return(get(key, value)); }
+    uint16_t getUShort(const char *key, uint16_t value = 0) { return(get(key, value)); }
+    int16_t getShort(const char *key, int16_t value = 0)    { return(get(key, value)); }
+    uint32_t getUInt(const char *key, uint32_t value = 0)   { return(get(key, value)); }
+    bool getBool(const char *key, bool value = false)       { return(get(key, (uint8_t)value)); }
+
+    size_t putString(const char *key, const char *value) { return(putBytes(key, value, strlen(value))); }
+    size_t putString(const char *key, const String &value) { return(putString(key, value.c_str())); }
+
+    String getString(const char *key, const String &value = String())
+    {
+      const std::string *v = find(key);
+      return(v ? String(*v) : value);
+    }
+
+  private:
+    Namespace *ns = NULL;
+    bool readOnly = false;
+
+    const std::string *find(const char *key)
+    {
+      if(!ns) return(NULL);
+      reads++;
+      auto v = ns->find(key);
+      return(v == ns->end() ? NULL : &v->second);
+    }
+
+    template<typename T> size_t put(const char *key, T value) { return(putBytes(key, &value, sizeof(value))); }
+
+    template<typename T> T get(const char *key, T value)
+    {
+      const std::string *v = find(key);
+      if(v && v->size() == sizeof(value)) memcpy(&value, v->data(), sizeof(value));
+      return(value);
+    }
+};
+
+#endif // PREFERENCES_H
@@ -0,0 +1,233 @@
+#include "Common.h"
+#include "Menu.h"
+#include "Utils.h"
+#include "Draw.h"
+
+//
+// The rest of the sketch, for modules that drive the receiver. State
+// lives in plain globals, the do*() handlers step it like the menus
+// do, and the radio tunes wherever it is told to.
+//
+
+SI4735_fixed rx;
+TFT_eSPI tft;
+#ifdef PALETTE_SPRITE
+PaletteSprite spr(&tft);
+#else
+TFT_eSprite spr(&tft);
+#endif
+
+uint8_t rssi = 0;
+uint8_t snr = 0;
+uint8_t volume = 35;
+uint8_t currentSquelch = 0;
+uint16_t currentFrequency = 10390;
+int16_t currentBFO = 0;
+uint8_t currentMode = FM;
+uint8_t uiLayoutIdx = UI_DEFAULT;
+uint8_t historyZoomIdx = 0;
+int8_t agcIdx = 0;
+int8_t agcNdx = 0;
+int bandIdx = 0;
+
+// Settings kept by Storage.cpp
+int8_t FmAgcIdx = 0;
+int8_t AmAgcIdx = 0;
+int8_t SsbAgcIdx = 0;
+int8_t AmAvcIdx = 48;
+int8_t SsbAvcIdx = 48;
+int8_t AmSoftMuteIdx = 4;
+int8_t SsbSoftMuteIdx = 4;
+uint8_t FmRegionIdx = 0;
+uint16_t currentBrt = 130;
+uint16_t currentSleep = 30;
+bool zoomMenu = false;
+int8_t scrollDirection = 1;
+uint8_t rdsModeIdx = 0;
+uint8_t sleepModeIdx = 0;
+uint8_t utcOffsetIdx = 8;
+uint8_t usbModeIdx = 0;
+uint8_t bleModeIdx = 0;
+uint8_t wifiModeIdx = 0;
+uint8_t propRefresh = 60;
+int16_t locationLat = INT16_MIN;
+int16_t locationLon = INT16_MIN;
+
+// Number of times the screen has been redrawn
+int screenDraws = 0;
+
+Band bands[] =
+{
+  {"VHF", FM_BAND_TYPE, FM,  6400, 10800, 10390, 2, 0, 0, 0},
+  {"MW",  MW_BAND_TYPE, AM,   150,  1800,   810, 0, 4, 0, 0},
+  {"SW",  SW_BAND_TYPE, AM,  1800, 30000, 15200, 0, 4, 0, 0},
+  {"20M", SW_BAND_TYPE, USB, 14000, 14350, 14074, 0, 4, 0, 0},
+};
+
+Memory memories[MEMORY_COUNT];
+const char *bandModeDesc[] = { "FM", "LSB", "USB", "AM" };
+
+static const Step steps[] = { {1, "1k", 1}, {5, "5k", 5}, {10, "10k", 10} };
+static const Bandwidth bandwidths[] = { {0, "6.0k"}, {1, "4.0k"}, {2, "3.0k"}, {3, "2.0k"} };
+static int stepIdx = 0;
+static int bandwidthIdx = 0;
+static bool sleeping = false;
+
+int getTotalBands() { return(ITEM_COUNT(bands)); }
+int getTotalModes() { return(ITEM_COUNT(bandModeDesc)); }
+int getTotalMemories() { return(ITEM_COUNT(memories)); }
+Band *getCurrentBand() { return(&bands[bandIdx]); }
+const Step *getCurrentStep() { return(&steps[stepIdx]); }
+const Bandwidth *getCurrentBandwidth() { return(&bandwidths[bandwidthIdx]); }
+int getLastBandwidth(int mode) { return(LAST_ITEM(bandwidths)); }
+int getLastAgc() { return(currentMode == FM ? 27 : isSSB() ? 1 : 37); }
+// Station name, RDS or schedule, as a test sets it
+const char *hostStationName = "";
+const char *getStationName() { return(hostStationName); }
+const char *getRadioText() { return(""); }
+
+static int wrap(int value, int enc, int count)
+{
+  return(((value + enc) % count + count) % count);
+}
+
+void doVolume(int16_t enc) { volume = constrain(volume + enc, 0, 63); }
+void doSquelch(int16_t enc) { currentSquelch = constrain(currentSquelch + enc, 0, 127); }
+void doStep(int16_t enc) { stepIdx = wrap(stepIdx, enc, ITEM_COUNT(steps)); }
+void doBandwidth(int16_t enc) { bandwidthIdx = wrap(bandwidthIdx, enc, ITEM_COUNT(bandwidths)); }
+void doAgc(int16_t enc) { agcIdx = agcNdx = wrap(agcIdx, enc, getLastAgc() + 1); }
+void doBrt(int16_t enc) {}
+void doCal(int16_t enc) {}
+
+void selectBand(uint8_t idx, bool drawLoadingSSB)
+{
+  bandIdx = idx;
+  currentFrequency = bands[idx].currentFreq;
+  currentMode = bands[idx].bandMode;
+  currentBFO = 0;
+}
+
+void doBand(int16_t enc)
+{
+  bands[bandIdx].currentFreq = currentFrequency;
+  selectBand(wrap(bandIdx, enc, ITEM_COUNT(bands)));
+}
+
+bool selectMode(uint8_t mode)
+{
+  if(mode >= ITEM_COUNT(bandModeDesc) || (mode == FM) != (currentMode == FM)) return(false);
+  currentMode = mode;
+  return(true);
+}
+
+void doMode(int16_t enc)
+{
+  // FM bands have just the one mode
+  if(currentMode != FM) selectMode(wrap(currentMode - 1, enc, 3) + 1);
+}
+
+bool updateFrequency(int newFreq, bool wrap)
+{
+  const Band *band = getCurrentBand();
+  if(newFreq < band->minimumFreq || newFreq > band->maximumFreq) return(false);
+  currentFrequency = newFreq;
+  return(true);
+}
+
+bool tuneToFrequency(uint32_t freq, bool anyBand)
+{
+  for(int j=0 ; j<getTotalBands() ; j++)
+  {
+    if(!anyBand && j != bandIdx) continue;
+
+    uint16_t f = freqFromHz(freq, bands[j].bandMode);
+    if(f < bands[j].minimumFreq || f > bands[j].maximumFreq) continue;
+
+    if(j != bandIdx) selectBand(j);
+    currentFrequency = f;
+    currentBFO = isSSB() ? freq % 1000 : 0;
+    return(true);
+  }
+
+  return(false);
+}
+
+uint16_t freqFromHz(uint32_t freq, uint8_t mode) { return(mode == FM ? freq / 10000 : freq / 1000); }
+uint16_t bfoFromHz(uint32_t freq) { return(freq % 1000); }
+uint32_t freqToHz(uint16_t freq, uint8_t mode) { return(mode == FM ? freq * 10000 : freq * 1000); }
+uint32_t getCurrentFrequencyHz() { return(freqToHz(currentFrequency, currentMode) + (isSSB() ? currentBFO : 0)); }
+
+bool isMemoryInBand(const Band *band, const Memory *memory)
+{
+  uint16_t freq = freqFromHz(memory->freq, memory->mode);
+  if(freq < band->minimumFreq || freq > band->maximumFreq) return(false);
+  return((memory->mode == FM) == (band->bandMode == FM));
+}
+
+// Settings menus
+const FMRegion fmRegions[] = { { 0x1, "EU/JP/AU" }, { 0x2, "US" } };
+int getTotalFmRegions() { return(ITEM_COUNT(fmRegions)); }
+const UTCOffset utcOffsets[] =
+{
+  { -48, "UTC-12" }, { -44, "UTC-11" }, { -40, "UTC-10" }, { -38, "UTC-9:30" }, { -36, "UTC-9" },
+  { -32, "UTC-8" }, { -28, "UTC-7" }, { -24, "UTC-6" }, { -20, "UTC-5" }, { -16, "UTC-4" },
+  { -14, "UTC-3:30" }, { -12, "UTC-3" }, { -10, "UTC-2:30" }, { -8, "UTC-2" }, { -4, "UTC-1" },
+  { 0, "UTC+0" }, { 4, "UTC+1" }, { 8, "UTC+2" }, { 12, "UTC+3" }, { 14, "UTC+3:30" },
+  { 16, "UTC+4" }, { 18, "UTC+4:30" }, { 20, "UTC+5" }, { 22, "UTC+5:30" }, { 23, "UTC+5:45" },
+  { 24, "UTC+6" }, { 26, "UTC+6:30" }, { 28, "UTC+7" }, { 32, "UTC+8" }, { 35, "UTC+8:45" },
+  { 36, "UTC+9" }, { 38, "UTC+9:30" }, { 40, "UTC+10" }, { 42, "UTC+10:30" }, { 44, "UTC+11" },
+  { 48, "UTC+12" }, { 51, "UTC+12:45" }, { 52, "UTC+13" }, { 55, "UTC+13:45" }, { 56, "UTC+14" },
+};
+int getTotalUTCOffsets() { return(ITEM_COUNT(utcOffsets)); }
+int getTotalUSBModes() { return(5); }
+
+const char *getVersion(bool shorter) { return("F/W: v2.33 Jan  1 2026"); }
+const char *getMACAddress() { return("02:00:00:00:00:01"); }
+
+// UTC clock running on the host time once set, i.e. from NTP
+static bool clockOn = false;
+static uint32_t clockBase = 0;  // Seconds of the day at boot
+int hostClockSets = 0;
+
+bool clockSet(uint8_t hours, uint8_t minutes, uint8_t seconds)
+{
+  hostClockSets++;
+  clockOn = true;
+  clockBase = (hours * 3600 + minutes * 60 + seconds + 86400 - millis() / 1000 % 86400) % 86400;
+  return(true);
+}
+
+void clockReset() { clockOn = false; }
+
+bool clockGetHMS(uint8_t *hours, uint8_t *minutes, uint8_t *seconds)
+{
+  if(!clockOn) return(false);
+
+  uint32_t t = (clockBase + millis() / 1000) % 86400;
+  *hours   = t / 3600;
+  *minutes = t / 60 % 60;
+  *seconds = t % 60;
+  return(true);
+}
+
+const char *clockGet()
+{
+  static char text[8];
+  uint8_t h, m, s;
+
+  if(!clockGetHMS(&h, &m, &s)) return(NULL);
+  snprintf(text, sizeof(text), "%02d:%02d", h, m);
+  return(text);
+}
+
+void clockRefreshTime() {}
+
+int getStrength(int rssi) { return(constrain(rssi / 6 + 1, 1, 17)); }
+
+bool sleepOn(int x)
+{
+  if(x == 0 || x == 1) sleeping = x;
+  return(sleeping);
+}
+
+void drawScreen(const char *statusLine1, const char *statusLine2) { screenDraws++; }
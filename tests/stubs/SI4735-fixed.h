@@ -0,0 +1,23 @@
+#ifndef SI4735_FIXED_H
+#define SI4735_FIXED_H
+
+#include <Arduino.h>
+
+// Radio chip, reporting whatever signal a test sets
+class SI4735_fixed
+{
+  public:
+    uint8_t rssi = 0;
+    uint8_t snr = 0;
+    uint16_t frequency = 0;
+    uint16_t capacitor = 0;
+
+    void getCurrentReceivedSignalQuality() {}
+    uint8_t getCurrentRSSI() { return(rssi); }
+    uint8_t getCurrentSNR() { return(snr); }
+    uint16_t getFrequency() { return(frequency); }
+    uint16_t getAntennaTuningCapacitor() { return(capacitor); }
+    void setFMDeEmphasis(uint8_t) {}
+};
+
+#endif // SI4735_FIXED_H
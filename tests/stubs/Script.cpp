@@ -0,0 +1,15 @@
+#include "Common.h"
+#include "Script.h"
+
+//
+// No scripts on the host, LittleFS is not there
+//
+
+bool scriptStart(Print *out) { return(false); }
+void scriptStop() {}
+void scriptStatus(Print *out) {}
+void scriptPrint(Print *out) {}
+void scriptPrintLog(Print *out) {}
+bool scriptUploadStart(const void *owner, Print *out) { return(false); }
+bool scriptUploadActive(const void *owner) { return(false); }
+void scriptUploadChar(const void *owner, Print *out, char c) {}
@@ -0,0 +1,436 @@
+#include "TFT_eSPI.h"
+
+static inline uint16_t swap16(uint16_t c)
+{
+  return((c >> 8) | (c << 8));
+}
+
+static inline uint8_t rgb332(uint16_t c)
+{
+  return(((c & 0xE000) >> 8) | ((c & 0x0700) >> 6) | ((c & 0x0018) >> 3));
+}
+
+static inline uint16_t expand332(uint8_t b)
+{
+  return(
+    ((b & 0xE0) << 8) | ((b & 0xC0) << 5) |
+    ((b & 0x1C) << 6) | ((b & 0x1C) << 3) |
+    ((b & 0x03) << 3) | ((b & 0x03) << 1) | ((b & 0x03) >> 1)
+  );
+}
+
+// Square root of a fraction, as 8-bit value (same as TFT_eSPI)
+static uint8_t sqrtFraction(uint32_t num)
+{
+  if(num > 0x40000000) return(0);
+
+  uint32_t bsh = 0x00004000;
+  uint32_t fpr = 0;
+  uint32_t osh = 0;
+
+  while(num > bsh) { bsh <<= 2; osh++; }
+
+  do
+  {
+    uint32_t bod = bsh + fpr;
+    if(num >= bod) { num -= bod; fpr = bsh + bod; }
+    num <<= 1;
+  }
+  while(bsh >>= 1);
+
+  return(fpr >> osh);
+}
+
+uint16_t TFT_eSPI::alphaBlend(uint8_t alpha, uint16_t fg, uint16_t bg)
+{
+  uint32_t rxb = bg & 0xF81F;
+  rxb += ((fg & 0xF81F) - rxb) * (alpha >> 2) >> 6;
+  uint32_t xgx = bg & 0x07E0;
+  xgx += ((fg & 0x07E0) - xgx) * alpha >> 8;
+  return((rxb & 0xF81F) | (xgx & 0x07E0));
+}
+
+TFT_eSPI::TFT_eSPI(int16_t w, int16_t h) :
+  frame(NULL), pixelsPushed(0), _width(w), _height(h), swapBytes(false),
+  textDatum(TL_DATUM), textFont(1), textFg(TFT_WHITE), textBg(TFT_BLACK), textBgFill(false),
+  cursorX(0), cursorY(0)
+{
+  if(w > 0 && h > 0) frame = (uint16_t *)calloc(w * h, sizeof(uint16_t));
+  resetViewport();
+}
+
+void TFT_eSPI::setViewport(int32_t x, int32_t y, int32_t w, int32_t h, bool vpDatum)
+{
+  (void)vpDatum;
+  _vpX = max(x, (int32_t)0);
+  _vpY = max(y, (int32_t)0);
+  _vpW = min(x + w, _width);
+  _vpH = min(y + h, _height);
+}
+
+void TFT_eSPI::resetViewport()
+{
+  _vpX = 0;
+  _vpY = 0;
+  _vpW = _width;
+  _vpH = _height;
+}
+
+bool TFT_eSPI::clip(int32_t *x, int32_t *y, int32_t *w, int32_t *h)
+{
+  if(*x < _vpX) { *w -= _vpX - *x; *x = _vpX; }
+  if(*y < _vpY) { *h -= _vpY - *y; *y = _vpY; }
+  if(*x + *w > _vpW) *w = _vpW - *x;
+  if(*y + *h > _vpH) *h = _vpH - *y;
+  return(*w > 0 && *h > 0);
+}
+
+void TFT_eSPI::drawPixel(int32_t x, int32_t y, uint32_t color)
+{
+  TFT_eSPI::fillRect(x, y, 1, 1, color);
+}
+
+void TFT_eSPI::drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color)
+{
+  TFT_eSPI::fillRect(x, y, 1, h, color);
+}
+
+void TFT_eSPI::drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color)
+{
+  TFT_eSPI::fillRect(x, y, w, 1, color);
+}
+
+void TFT_eSPI::fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color)
+{
+  if(!clip(&x, &y, &w, &h)) return;
+
+  for(int32_t j=y ; j<y+h ; j++)
+    for(int32_t i=x ; i<x+w ; i++) frame[i + j * _width] = color;
+}
+
+uint16_t TFT_eSPI::readPixel(int32_t x, int32_t y)
+{
+  if(x < _vpX || y < _vpY || x >= _vpW || y >= _vpH) return(0);
+  return(frame[x + y * _width]);
+}
+
+uint16_t TFT_eSPI::drawPixel(int32_t x, int32_t y, uint32_t color, uint8_t alpha, uint32_t bg)
+{
+  if(bg == 0x00FFFFFF) bg = readPixel(x, y);
+  color = alphaBlend(alpha, color, bg);
+  drawPixel(x, y, color);
+  return(color);
+}
+
+void TFT_eSPI::drawLine(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t color)
+{
+  if(y0 == y1) { drawFastHLine(min(x0, x1), y0, abs(x1 - x0) + 1, color); return; }
+  if(x0 == x1) { drawFastVLine(x0, min(y0, y1), abs(y1 - y0) + 1, color); return; }
+
+  int32_t dx = abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+  int32_t dy = -abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+  int32_t err = dx + dy;
+
+  for(;;)
+  {
+    drawPixel(x0, y0, color);
+    if(x0 == x1 && y0 == y1) break;
+    int32_t e2 = 2 * err;
+    if(e2 >= dy) { err += dy; x0 += sx; }
+    if(e2 <= dx) { err += dx; y0 += sy; }
+  }
+}
+
+void TFT_eSPI::drawRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color)
+{
+  drawFastHLine(x, y, w, color);
+  drawFastHLine(x, y + h - 1, w, color);
+  drawFastVLine(x, y, h, color);
+  drawFastVLine(x + w - 1, y, h, color);
+}
+
+void TFT_eSPI::drawRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t r, uint32_t color)
+{
+  r = min(r, min(w / 2, h / 2));
+  drawFastHLine(x + r, y, w - 2 * r, color);
+  drawFastHLine(x + r, y + h - 1, w - 2 * r, color);
+  drawFastVLine(x, y + r, h - 2 * r, color);
+  drawFastVLine(x + w - 1, y + r, h - 2 * r, color);
+
+  // Corners, a pixel per row with the same insets as fillRoundRect()
+  for(int32_t j=0 ; j<r ; j++)
+  {
+    int32_t dy = r - j;
+    int32_t dx = r - (int32_t)sqrtf((float)(r * r - (dy - 0.5f) * (dy - 0.5f)) + 0.5f);
+    drawPixel(x + dx, y + j, color);
+    drawPixel(x + w - 1 - dx, y + j, color);
+    drawPixel(x + dx, y + h - 1 - j, color);
+    drawPixel(x + w - 1 - dx, y + h - 1 - j, color);
+  }
+}
+
+void TFT_eSPI::fillRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t r, uint32_t color)
+{
+  r = min(r, min(w / 2, h / 2));
+  fillRect(x, y + r, w, h - 2 * r, color);
+
+  for(int32_t j=0 ; j<r ; j++)
+  {
+    // Inset of row j from the top (and bottom) edge
+    int32_t dy = r - j;
+    int32_t dx = r - (int32_t)sqrtf((float)(r * r - (dy - 0.5f) * (dy - 0.5f)) + 0.5f);
+    drawFastHLine(x + dx, y + j, w - 2 * dx, color);
+    drawFastHLine(x + dx, y + h - 1 - j, w - 2 * dx, color);
+  }
+}
+
+void TFT_eSPI::fillSmoothRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t r, uint32_t color, uint32_t bg)
+{
+  // Same steps as TFT_eSPI, so that edges blend the same way
+  if(r < 0) r = 0;
+  if(r > w / 2) r = w / 2;
+  if(r > h / 2) r = h / 2;
+
+  y += r;
+  h -= 2 * r;
+  fillRect(x, y, w, h, color);
+
+  h--;
+  x += r;
+  w -= 2 * r + 1;
+
+  int32_t xs = 0;
+  int32_t cx = 0;
+  int32_t r1 = r * r;
+  r++;
+  int32_t r2 = r * r;
+
+  for(int32_t cy = r - 1 ; cy > 0 ; cy--)
+  {
+    int32_t dy2 = (r - cy) * (r - cy);
+    for(cx = xs ; cx < r ; cx++)
+    {
+      int32_t hyp2 = (r - cx) * (r - cx) + dy2;
+      if(hyp2 <= r1) break;
+      if(hyp2 >= r2) continue;
+
+      uint8_t alpha = ~sqrtFraction(hyp2);
+      if(alpha > 246) break;
+      xs = cx;
+      if(alpha < 9) continue;
+
+      drawPixel(x + cx - r, y + cy - r, color, alpha, bg);
+      drawPixel(x - cx + r + w, y + cy - r, color, alpha, bg);
+      drawPixel(x - cx + r + w, y - cy + r + h, color, alpha, bg);
+      drawPixel(x + cx - r, y - cy + r + h, color, alpha, bg);
+    }
+    drawFastHLine(x + cx - r, y + cy - r, 2 * (r - cx) + 1 + w, color);
+    drawFastHLine(x + cx - r, y - cy + r + h, 2 * (r - cx) + 1 + w, color);
+  }
+}
+
+void TFT_eSPI::fillTriangle(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint32_t color)
+{
+  int32_t ymin = min(y0, min(y1, y2));
+  int32_t ymax = max(y0, max(y1, y2));
+
+  for(int32_t y=ymin ; y<=ymax ; y++)
+  {
+    // Crossings of the scan line with the three edges
+    int32_t xa = INT32_MAX, xb = INT32_MIN;
+    const int32_t px[] = { x0, x1, x2 }, py[] = { y0, y1, y2 };
+
+    for(int e=0 ; e<3 ; e++)
+    {
+      int32_t ax = px[e], ay = py[e], bx = px[(e + 1) % 3], by = py[(e + 1) % 3];
+      if((y < ay && y < by) || (y > ay && y > by)) continue;
+      int32_t x = ay == by ? ax : ax + (bx - ax) * (y - ay) / (by - ay);
+      xa = min(xa, ay == by ? min(ax, bx) : x);
+      xb = max(xb, ay == by ? max(ax, bx) : x);
+    }
+
+    if(xa <= xb) drawFastHLine(xa, y, xb - xa + 1, color);
+  }
+}
+
+//
+// Made up fixed width font: font 0 and 1 cells are 6x8, font 2 cells
+// 8x16, larger fonts 14x26. Glyph bits are derived from the character.
+//
+static void fontCell(uint8_t font, int16_t *w, int16_t *h)
+{
+  if(font <= 1)      { *w = 6; *h = 8; }
+  else if(font == 2) { *w = 8; *h = 16; }
+  else               { *w = 14; *h = 26; }
+}
+
+int16_t TFT_eSPI::textWidth(const char *s, uint8_t font)
+{
+  int16_t w, h;
+  fontCell(font, &w, &h);
+  return(strlen(s) * w);
+}
+
+int16_t TFT_eSPI::fontHeight(uint8_t font)
+{
+  int16_t w, h;
+  fontCell(font, &w, &h);
+  return(h);
+}
+
+int16_t TFT_eSPI::drawString(const char *s, int32_t x, int32_t y, uint8_t font)
+{
+  int16_t cw, ch;
+  fontCell(font, &cw, &ch);
+  int32_t w = strlen(s) * cw;
+
+  // Position by the datum
+  if(textDatum % 3 == 1) x -= w / 2;
+  if(textDatum % 3 == 2) x -= w;
+  if(textDatum / 3 == 1) y -= ch / 2;
+  if(textDatum / 3 == 2) y -= ch;
+
+  for(const char *p = s ; *p ; p++, x += cw)
+  {
+    if(textBgFill) fillRect(x, y, cw, ch, textBg);
+
+    for(int16_t j=1 ; j<ch-1 ; j++)
+    {
+      uint32_t bits = ((uint8_t)*p * 2654435761u) >> (j % 16);
+      for(int16_t i=1, n ; i<cw-1 ; i+=n)
+      {
+        bool on = bits & (1 << i);
+        for(n=1 ; i+n<cw-1 && !!(bits & (1 << (i + n))) == on ; n++);
+        if(on) drawFastHLine(x + i, y + j, n, textFg);
+      }
+    }
+  }
+
+  return(w);
+}
+
+size_t TFT_eSPI::write(uint8_t c)
+{
+  char s[2] = { (char)c, 0 };
+  uint8_t datum = textDatum;
+
+  textDatum = TL_DATUM;
+  cursorX += drawString(s, cursorX, cursorY, textFont);
+  textDatum = datum;
+  return(1);
+}
+
+void TFT_eSPI::pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t *data)
+{
+  for(int32_t j=0 ; j<h ; j++)
+    for(int32_t i=0 ; i<w ; i++)
+    {
+      uint16_t c = data[i + j * w];
+      if(x + i < 0 || y + j < 0 || x + i >= _width || y + j >= _height) continue;
+      // Sprites keep colors byte-swapped, as the display wants them
+      frame[x + i + (y + j) * _width] = swapBytes ? c : swap16(c);
+    }
+
+  pixelsPushed += w * h;
+}
+
+TFT_eSprite::TFT_eSprite(TFT_eSPI *tft) :
+  TFT_eSPI(0, 0), _tft(tft), _img(NULL), _img8(NULL), _created(false),
+  _iwidth(0), _iheight(0), _bpp(16)
+{
+}
+
+void *TFT_eSprite::createSprite(int16_t w, int16_t h)
+{
+  if(_created) return(getPointer());
+
+  if(_bpp == 8)
+    _img8 = (uint8_t *)calloc(w * h, 1);
+  else
+    _img = (uint16_t *)calloc(w * h, 2);
+
+  _created = _img || _img8;
+  _width = _iwidth = _created ? w : 0;
+  _height = _iheight = _created ? h : 0;
+  resetViewport();
+  return(getPointer());
+}
+
+void TFT_eSprite::deleteSprite()
+{
+  free(_img);
+  free(_img8);
+  _img = NULL;
+  _img8 = NULL;
+  _created = false;
+  _width = _height = _iwidth = _iheight = 0;
+  resetViewport();
+}
+
+void TFT_eSprite::drawPixel(int32_t x, int32_t y, uint32_t color)
+{
+  TFT_eSprite::fillRect(x, y, 1, 1, color);
+}
+
+void TFT_eSprite::drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color)
+{
+  TFT_eSprite::fillRect(x, y, 1, h, color);
+}
+
+void TFT_eSprite::drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color)
+{
+  TFT_eSprite::fillRect(x, y, w, 1, color);
+}
+
+void TFT_eSprite::fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color)
+{
+  if(!_created || !clip(&x, &y, &w, &h)) return;
+
+  for(int32_t j=y ; j<y+h ; j++)
+    for(int32_t i=x ; i<x+w ; i++)
+      if(_bpp == 8)
+        _img8[i + j * _iwidth] = rgb332(color);
+      else
+        _img[i + j * _iwidth] = swap16(color);
+}
+
+uint16_t TFT_eSprite::readPixel(int32_t x, int32_t y)
+{
+  if(!_created || x < _vpX || y < _vpY || x >= _vpW || y >= _vpH) return(0xFFFF);
+  return(_bpp == 8 ? expand332(_img8[x + y * _iwidth]) : swap16(_img[x + y * _iwidth]));
+}
+
+void TFT_eSprite::pushSprite(int32_t x, int32_t y)
+{
+  pushSprite(x, y, 0, 0, _iwidth, _iheight);
+}
+
+bool TFT_eSprite::pushSprite(int32_t tx, int32_t ty, int32_t sx, int32_t sy, int32_t sw, int32_t sh)
+{
+  if(!_created) return(false);
+
+  // Clip to the sprite
+  if(sx < 0) { tx -= sx; sw += sx; sx = 0; }
+  if(sy < 0) { ty -= sy; sh += sy; sy = 0; }
+  if(sx + sw > _iwidth)  sw = _iwidth - sx;
+  if(sy + sh > _iheight) sh = _iheight - sy;
+  if(sw <= 0 || sh <= 0) return(false);
+
+  uint16_t *line = (uint16_t *)malloc(sw * sizeof(uint16_t));
+  bool oldSwapBytes = _tft->getSwapBytes();
+  _tft->setSwapBytes(false);
+
+  for(int32_t j=0 ; j<sh ; j++)
+  {
+    for(int32_t i=0 ; i<sw ; i++)
+      line[i] = _bpp == 8 ?
+        swap16(expand332(_img8[sx + i + (sy + j) * _iwidth])) :
+        _img[sx + i + (sy + j) * _iwidth];
+
+    _tft->pushImage(tx, ty + j, sw, 1, line);
+  }
+
+  _tft->setSwapBytes(oldSwapBytes);
+  free(line);
+  return(true);
+}
@@ -0,0 +1,128 @@
+#ifndef TFT_ESPI_H
+#define TFT_ESPI_H
+
+#include <Arduino.h>
+
+//
+// Host model of the TFT_eSPI display and sprites. Only the calls the
+// firmware modules under test use are here, and they go through the
+// same virtual primitives as the library: shapes call fillRect(),
+// drawFastHLine() and drawPixel(), anti-aliased edges blend with
+// readPixel(). Text uses a made up fixed width font.
+//
+
+#define TFT_BLACK       0x0000
+#define TFT_WHITE       0xFFFF
+#define TFT_RED         0xF800
+#define TFT_GREEN       0x07E0
+#define TFT_BLUE        0x001F
+
+#define TL_DATUM        0
+#define TC_DATUM        1
+#define TR_DATUM        2
+#define ML_DATUM        3
+#define MC_DATUM        4
+#define MR_DATUM        5
+#define BL_DATUM        6
+#define BC_DATUM        7
+#define BR_DATUM        8
+
+#define TFT_WIDTH       320
+#define TFT_HEIGHT      170
+
+class TFT_eSPI : public Print
+{
+  public:
+    TFT_eSPI(int16_t w = TFT_WIDTH, int16_t h = TFT_HEIGHT);
+    virtual ~TFT_eSPI() { free(frame); }
+
+    virtual void drawPixel(int32_t x, int32_t y, uint32_t color);
+    virtual void drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color);
+    virtual void drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color);
+    virtual void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color);
+    virtual uint16_t readPixel(int32_t x, int32_t y);
+
+    uint16_t drawPixel(int32_t x, int32_t y, uint32_t color, uint8_t alpha, uint32_t bg = 0x00FFFFFF);
+    void drawLine(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t color);
+    void drawRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color);
+    void drawRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t r, uint32_t color);
+    void fillRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t r, uint32_t color);
+    void fillSmoothRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t r, uint32_t color, uint32_t bg = 0x00FFFFFF);
+    void fillTriangle(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint32_t color);
+    void fillScreen(uint32_t color) { fillRect(0, 0, _width, _height, color); }
+
+    void setTextDatum(uint8_t d) { textDatum = d; }
+    void setTextColor(uint16_t fg) { textFg = fg; textBgFill = false; }
+    void setTextColor(uint16_t fg, uint16_t bg, bool fill = false) { textFg = fg; textBg = bg; textBgFill = fill || fg != bg; }
+    void setTextFont(uint8_t f) { textFont = f; }
+    int16_t textWidth(const char *s, uint8_t font);
+    int16_t fontHeight(uint8_t font);
+    int16_t drawString(const char *s, int32_t x, int32_t y, uint8_t font);
+    int16_t drawString(const char *s, int32_t x, int32_t y) { return(drawString(s, x, y, textFont)); }
+    size_t write(uint8_t c) override;
+
+    // Clipping window, only vpDatum false (coordinates stay as they
+    // are) is modelled
+    void setViewport(int32_t x, int32_t y, int32_t w, int32_t h, bool vpDatum = true);
+    void resetViewport();
+
+    void pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t *data);
+    void setSwapBytes(bool swap) { swapBytes = swap; }
+    bool getSwapBytes() { return(swapBytes); }
+    void startWrite() {}
+    void endWrite() {}
+
+    int16_t width() { return(_width); }
+    int16_t height() { return(_height); }
+
+    // Display contents (RGB565) and counters for tests
+    uint16_t *frame;
+    uint32_t pixelsPushed;
+
+    static uint16_t alphaBlend(uint8_t alpha, uint16_t fg, uint16_t bg);
+
+  protected:
+    int32_t _width, _height;
+    int32_t _vpX, _vpY, _vpW, _vpH;   // Clipping window, _vpW and _vpH are the right and bottom edges
+    bool swapBytes;
+    uint8_t textDatum, textFont;
+    uint16_t textFg, textBg;
+    bool textBgFill;
+    int32_t cursorX, cursorY;
+
+    bool clip(int32_t *x, int32_t *y, int32_t *w, int32_t *h);
+};
+
+class TFT_eSprite : public TFT_eSPI
+{
+  public:
+    explicit TFT_eSprite(TFT_eSPI *tft);
+    ~TFT_eSprite() { deleteSprite(); }
+
+    void setColorDepth(int8_t bpp) { _bpp = bpp; }
+    void *createSprite(int16_t w, int16_t h);
+    void deleteSprite();
+    bool created() { return(_created); }
+    void *getPointer() { return(_bpp == 8 ? (void *)_img8 : (void *)_img); }
+
+    void fillSprite(uint32_t color) { TFT_eSprite::fillRect(0, 0, _iwidth, _iheight, color); }
+    void drawPixel(int32_t x, int32_t y, uint32_t color) override;
+    void drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color) override;
+    void drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color) override;
+    void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) override;
+    uint16_t readPixel(int32_t x, int32_t y) override;
+    using TFT_eSPI::drawPixel;
+
+    void pushSprite(int32_t x, int32_t y);
+    bool pushSprite(int32_t tx, int32_t ty, int32_t sx, int32_t sy, int32_t sw, int32_t sh);
+
+  protected:
+    TFT_eSPI *_tft;
+    uint16_t *_img;     // 16 bpp, byte-swapped RGB565 as on the device
+    uint8_t *_img8;     // 8 bpp, RGB332
+    bool _created;
+    int32_t _iwidth, _iheight;
+    uint8_t _bpp;
+};
+
+#endif // TFT_ESPI_H
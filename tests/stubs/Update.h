@@ -0,0 +1,25 @@
+#ifndef UPDATE_H
+#define UPDATE_H
+
+#include <Arduino.h>
+
+//
+// Flash updates are written through an OtaWriter in the tests, this is
+// only here for the firmware to build
+//
+
+#define UPDATE_SIZE_UNKNOWN 0xFFFFFFFF
+#define U_FLASH             0
+
+class UpdateClass
+{
+  public:
+    bool begin(size_t size, int command) { return(false); }
+    size_t write(uint8_t *data, size_t size) { return(0); }
+    bool end(bool evenIfRemaining = false) { return(false); }
+    void abort() {}
+};
+
+extern UpdateClass Update;
+
+#endif // UPDATE_H
@@ -0,0 +1,149 @@
+#ifndef WIFI_H
+#define WIFI_H
+
+#include <Arduino.h>
+#include <vector>
+
+//
+// Fake Wi-Fi driver on the host clock. Tests put networks in range,
+// scans and joins finish after the times set here, and the calls
+// that block on the real driver charge their time with delay().
+//
+
+typedef enum
+{
+  WL_IDLE_STATUS = 0, WL_NO_SSID_AVAIL = 1, WL_CONNECTED = 3, WL_CONNECT_FAILED = 4, WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum { WIFI_MODE_NULL = 0, WIFI_MODE_STA, WIFI_MODE_AP, WIFI_MODE_APSTA } wifi_mode_t;
+
+#define WIFI_STA    WIFI_MODE_STA
+#define WIFI_AP     WIFI_MODE_AP
+#define WIFI_AP_STA WIFI_MODE_APSTA
+
+#define WIFI_SCAN_RUNNING (-1)
+#define WIFI_SCAN_FAILED  (-2)
+
+class IPAddress
+{
+  public:
+    IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : addr{ a, b, c, d } {}
+
+    String toString() const
+    {
+      char buf[16];
+      snprintf(buf, sizeof(buf), "%u.%u.%u.%u", addr[0], addr[1], addr[2], addr[3]);
+      return(buf);
+    }
+
+  private:
+    uint8_t addr[4];
+};
+
+class WiFiClass
+{
+  public:
+    struct Network { String ssid, pass; int8_t rssi; };
+
+    // Networks in range, and how long the driver takes
+    std::vector<Network> hostNetworks;
+    uint32_t hostModeTime = 50;    // Starting the radio
+    uint32_t hostAPTime   = 100;   // Starting the access point
+    uint32_t hostScanTime = 2500;  // Listening on every channel
+    uint32_t hostJoinTime = 1500;  // Association and DHCP
+    int hostScans = 0;
+    int hostJoins = 0;
+
+    bool mode(wifi_mode_t m)
+    {
+      if(m != WIFI_MODE_NULL && wifiMode == WIFI_MODE_NULL) delay(hostModeTime);
+      if(!(m & WIFI_MODE_STA)) disconnect();
+      wifiMode = m;
+      return(true);
+    }
+
+    wifi_mode_t getMode() { return(wifiMode); }
+
+    int16_t scanNetworks(bool async = false)
+    {
+      if(!(wifiMode & WIFI_MODE_STA)) return(WIFI_SCAN_FAILED);
+      hostScans++;
+      scanStart = millis();
+      scanning = true;
+      if(async) return(WIFI_SCAN_RUNNING);
+      delay(hostScanTime);
+      return(scanComplete());
+    }
+
+    int16_t scanComplete()
+    {
+      if(!scanning) return(WIFI_SCAN_FAILED);
+      if(millis() - scanStart < hostScanTime) return(WIFI_SCAN_RUNNING);
+      return(hostNetworks.size());
+    }
+
+    void scanDelete() { scanning = false; }
+
+    String SSID(uint8_t i) { return(i < hostNetworks.size() ? hostNetworks[i].ssid : ""); }
+    int32_t RSSI(uint8_t i) { return(i < hostNetworks.size() ? hostNetworks[i].rssi : 0); }
+
+    wl_status_t begin(const char *ssid, const char *pass)
+    {
+      if(!(wifiMode & WIFI_MODE_STA)) return(WL_CONNECT_FAILED);
+      hostJoins++;
+      joinSSID = ssid;
+      joinPass = pass ? pass : "";
+      joinStart = millis();
+      joining = true;
+      connected = -1;
+      return(WL_DISCONNECTED);
+    }
+
+    wl_status_t status()
+    {
+      if(joining && millis() - joinStart >= hostJoinTime)
+      {
+        joining = false;
+        for(size_t i=0 ; i<hostNetworks.size() ; i++)
+          if(hostNetworks[i].ssid == joinSSID && hostNetworks[i].pass == joinPass) connected = i;
+      }
+
+      return(connected >= 0 ? WL_CONNECTED : joining ? WL_DISCONNECTED : WL_NO_SSID_AVAIL);
+    }
+
+    bool disconnect(bool wifiOff = false)
+    {
+      joining = false;
+      connected = -1;
+      return(true);
+    }
+
+    String SSID() { return(status() == WL_CONNECTED ? hostNetworks[connected].ssid : ""); }
+    int8_t RSSI() { return(status() == WL_CONNECTED ? hostNetworks[connected].rssi : 0); }
+    IPAddress localIP() { return(status() == WL_CONNECTED ? IPAddress(192, 168, 1, 42) : IPAddress()); }
+
+    bool softAP(const char *ssid, const char *pass = NULL, int channel = 1, bool hidden = false, int clients = 4)
+    {
+      if(!(wifiMode & WIFI_MODE_AP)) return(false);
+      delay(hostAPTime);
+      return(true);
+    }
+
+    bool softAPConfig(IPAddress ip, IPAddress gateway, IPAddress subnet) { return(true); }
+    bool softAPdisconnect(bool wifiOff = false) { return(true); }
+    uint8_t softAPgetStationNum() { return(0); }
+    IPAddress softAPIP() { return(wifiMode & WIFI_MODE_AP ? IPAddress(10, 1, 1, 1) : IPAddress()); }
+
+  private:
+    wifi_mode_t wifiMode = WIFI_MODE_NULL;
+    bool scanning = false;
+    uint32_t scanStart = 0;
+    bool joining = false;
+    uint32_t joinStart = 0;
+    String joinSSID, joinPass;
+    int connected = -1;  // Index in hostNetworks
+};
+
+extern WiFiClass WiFi;
+
+#endif // WIFI_H
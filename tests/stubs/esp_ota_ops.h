@@ -0,0 +1,41 @@
+#ifndef ESP_OTA_OPS_H
+#define ESP_OTA_OPS_H
+
+//
+// Running partition state, set by the tests
+//
+
+typedef int esp_err_t;
+
+#define ESP_OK    0
+#define ESP_FAIL -1
+
+typedef enum
+{
+  ESP_OTA_IMG_NEW,
+  ESP_OTA_IMG_PENDING_VERIFY,
+  ESP_OTA_IMG_VALID,
+  ESP_OTA_IMG_INVALID,
+  ESP_OTA_IMG_ABORTED,
+  ESP_OTA_IMG_UNDEFINED = -1,
+} esp_ota_img_states_t;
+
+typedef struct { esp_ota_img_states_t state; } esp_partition_t;
+
+extern esp_partition_t hostRunningPartition;
+
+inline const esp_partition_t *esp_ota_get_running_partition() { return(&hostRunningPartition); }
+
+inline esp_err_t esp_ota_get_state_partition(const esp_partition_t *partition, esp_ota_img_states_t *state)
+{
+  *state = partition->state;
+  return(ESP_OK);
+}
+
+inline esp_err_t esp_ota_mark_app_valid_cancel_rollback()
+{
+  hostRunningPartition.state = ESP_OTA_IMG_VALID;
+  return(ESP_OK);
+}
+
+#endif // ESP_OTA_OPS_H
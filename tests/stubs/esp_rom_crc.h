@@ -0,0 +1,21 @@
+#ifndef ESP_ROM_CRC_H
+#define ESP_ROM_CRC_H
+
+#include <stdint.h>
+
+//
+// CRC32 as computed by the ROM (IEEE 802.3, reflected)
+//
+
+inline uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+  crc = ~crc;
+  while(len--)
+  {
+    crc ^= *buf++;
+    for(int i=0 ; i<8 ; i++) crc = crc & 1 ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+  }
+  return(~crc);
+}
+
+#endif // ESP_ROM_CRC_H
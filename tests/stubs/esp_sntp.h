@@ -0,0 +1,28 @@
+#ifndef ESP_SNTP_H
+#define ESP_SNTP_H
+
+#include <Arduino.h>
+#include <sys/time.h>
+
+//
+// SNTP client that never talks to a server. Tests see when it was
+// started and call the sync notification themselves.
+//
+
+typedef void (*sntp_sync_time_cb_t)(struct timeval *tv);
+
+inline sntp_sync_time_cb_t hostSntpCallback = NULL;
+inline bool hostSntpRunning = false;
+inline uint32_t hostSntpStart = 0;
+
+inline void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t cb) { hostSntpCallback = cb; }
+inline void sntp_set_sync_interval(uint32_t ms) {}
+inline void esp_sntp_stop() { hostSntpRunning = false; }
+
+inline void configTime(long gmtOffset, int daylightOffset, const char *server)
+{
+  hostSntpRunning = true;
+  hostSntpStart = millis();
+}
+
+#endif // ESP_SNTP_H
@@ -0,0 +1,9 @@
+#ifndef ESP_TIMER_H
+#define ESP_TIMER_H
+
+#include <Arduino.h>
+
+// Microseconds since boot, off the host clock
+inline int64_t esp_timer_get_time() { return(hostTime); }
+
+#endif // ESP_TIMER_H
@@ -0,0 +1,18 @@
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+#include <stdint.h>
+
+//
+// FreeRTOS types on the host, ticks are milliseconds
+//
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+
+#define pdFALSE            0
+#define pdTRUE             1
+#define pdMS_TO_TICKS(ms)  ((TickType_t)(ms))
+#define portMAX_DELAY      0xFFFFFFFF
+
+#endif // FREERTOS_H
@@ -0,0 +1,67 @@
+#ifndef TASK_H
+#define TASK_H
+
+#include "FreeRTOS.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+//
+// Task notifications on the host, every thread is a task. Time is
+// real time here, not the simulated Arduino clock.
+//
+
+struct HostTask
+{
+  std::mutex lock;
+  std::condition_variable wake;
+  uint32_t count = 0;
+};
+
+typedef HostTask *TaskHandle_t;
+
+// Tasks outlive their threads, a late notification is harmless
+inline TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+  static std::mutex lock;
+  static std::deque<HostTask> tasks;
+  static thread_local TaskHandle_t task = NULL;
+
+  if(!task)
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    task = &tasks.emplace_back();
+  }
+
+  return(task);
+}
+
+inline TickType_t xTaskGetTickCount()
+{
+  using namespace std::chrono;
+  static const steady_clock::time_point boot = steady_clock::now();
+  return(duration_cast<milliseconds>(steady_clock::now() - boot).count());
+}
+
+inline BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+  std::lock_guard<std::mutex> guard(task->lock);
+  task->count++;
+  task->wake.notify_one();
+  return(pdTRUE);
+}
+
+inline uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks)
+{
+  TaskHandle_t task = xTaskGetCurrentTaskHandle();
+  std::unique_lock<std::mutex> guard(task->lock);
+
+  task->wake.wait_for(guard, std::chrono::milliseconds(ticks), [task] { return(task->count > 0); });
+
+  uint32_t count = task->count;
+  if(count) task->count = clear ? 0 : count - 1;
+  return(count);
+}
+
+#endif // TASK_H
@@ -0,0 +1,20 @@
+#ifndef NVS_FLASH_H
+#define NVS_FLASH_H
+
+#include <Preferences.h>
+
+//
+// Erasing NVS empties the in-memory namespaces of Preferences
+//
+
+typedef int esp_err_t;
+
+#define ESP_OK    0
+#define ESP_FAIL -1
+
+inline esp_err_t nvs_flash_init() { return(ESP_OK); }
+inline esp_err_t nvs_flash_init_partition(const char *label) { return(ESP_OK); }
+inline esp_err_t nvs_flash_erase() { Preferences::nvs.clear(); return(ESP_OK); }
+inline esp_err_t nvs_flash_erase_partition(const char *label) { Preferences::nvs.clear(); return(ESP_OK); }
+
+#endif // NVS_FLASH_H
@@ -0,0 +1,217 @@
+#include "test.h"
+#include "Common.h"
+#include "Remote.h"
+#include "RemoteTcp.h"
+#include "Utils.h"
+#include <AsyncTCP.h>
+#include <string>
+
+//
+// TCP remote control with the test as the network task. The main
+// loop must never wait for the network: received data is held until
+// the main loop reads it, replies until the client takes them.
+//
+
+// Network task: connect a client to the port
+static AsyncClient *connect(uint16_t port)
+{
+  return(AsyncServer::find(port)->connect());
+}
+
+// Main loop: a few passes, returns the number of commands executed
+static int loop()
+{
+  uint64_t start = hostTime;
+  int events = 0;
+
+  for(int i=0 ; i<4 ; i++)
+  {
+    while(remoteTcpDoCommand()) events++;
+    remoteTcpTickTime();
+  }
+
+  // Nothing waited
+  CHECK_EQ(hostTime, start);
+  return(events);
+}
+
+// Network task: drop the connection, the main loop frees the slot
+static void disconnect(AsyncClient *client)
+{
+  bool deleted = false;
+
+  client->deleted = &deleted;
+  client->disconnect();
+  loop();
+  CHECK(deleted);
+}
+
+TEST(tcpCommands)
+{
+  remoteTcpInit();
+  volume = 35;
+
+  AsyncClient *adHoc = connect(REMOTE_TCP_ADHOC_PORT);
+  AsyncClient *rigCtl = connect(REMOTE_TCP_RIGCTL_PORT);
+
+  adHoc->receive("VV");
+  rigCtl->receive("f\n");
+  CHECK_EQ(loop(), 2);
+  CHECK_EQ(volume, 37);
+
+  // Replies go to the client that asked
+  CHECK(adHoc->sent.empty());
+  CHECK_EQ(atol(rigCtl->sent.c_str()), getCurrentFrequencyHz());
+  CHECK(rigCtl->sent == rigCtl->added);
+
+  // Quit waits for the replies
+  rigCtl->receive("f\nq\n");
+  loop();
+  CHECK(rigCtl->closed && !rigCtl->aborted);
+  disconnect(rigCtl);
+  disconnect(adHoc);
+}
+
+TEST(tcpReceiveBackpressure)
+{
+  AsyncClient *client = connect(REMOTE_TCP_ADHOC_PORT);
+  const size_t total = 8 * REMOTE_TCP_BUFFER;
+  size_t posted = 0;
+  int events = 0;
+
+  volume = 35;
+
+  // The peer sends as much as the window allows, the main loop takes
+  // a few commands at a time
+  while(posted < total)
+  {
+    size_t window = REMOTE_TCP_BUFFER - client->unacked;
+    size_t n = min(window, total - posted);
+
+    if(n)
+    {
+      std::string data;
+      for(size_t i=0 ; i<n ; i++) data += (posted + i) & 1 ? 'v' : 'V';
+      client->receive(data);
+      posted += n;
+    }
+    else
+      client->poll();
+
+    CHECK(client->unacked <= REMOTE_TCP_BUFFER);
+    CHECK(!client->closed);
+
+    for(int i=0 ; i<100 && remoteTcpDoCommand() ; i++) events++;
+  }
+
+  events += loop();
+  client->poll();
+
+  // Every byte was received and acknowledged
+  CHECK_EQ(events, total);
+  CHECK_EQ(volume, 35);
+  CHECK_EQ(client->unacked, 0);
+  disconnect(client);
+}
+
+// Screenshot as the serial port gets it
+static std::string screenshot()
+{
+  struct : public Stream
+  {
+    std::string out;
+    int available() override { return(0); }
+    int read() override { return(-1); }
+    int peek() override { return(-1); }
+    size_t write(uint8_t c) override { out += (char)c; return(1); }
+  } serial;
+  RemoteState state;
+
+  remoteDoCommand(&serial, &state, 'C');
+  return(serial.out);
+}
+
+TEST(tcpSendBackpressure)
+{
+  AsyncClient *client = connect(REMOTE_TCP_ADHOC_PORT);
+
+  spr.createSprite(320, 170);
+  spr.fillSprite(TFT_RED);
+  spr.fillRect(10, 10, 100, 50, TFT_BLUE);
+  client->sendSpace = 1000;
+  volume = 35;
+
+  // Screenshot is much larger than the TCP send buffer
+  client->receive("CV");
+  CHECK_EQ(loop(), 1);
+  CHECK_EQ(client->added.size(), 1000);
+  CHECK_EQ(volume, 35);
+
+  // The rest goes out as the client takes it, then the next command runs
+  int events = 0;
+  for(int i=0 ; i<1000 && client->added.size() < 300000 ; i++)
+  {
+    size_t before = client->added.size();
+    client->peerAck(1000);
+    events += loop();
+    if(client->added.size() == before) break;
+  }
+
+  CHECK(client->added == screenshot());
+  CHECK(client->sent == client->added);
+  CHECK_EQ(events, 1);
+  CHECK_EQ(volume, 36);
+  CHECK(!client->closed);
+
+  spr.deleteSprite();
+  disconnect(client);
+}
+
+TEST(tcpSendTimeout)
+{
+  AsyncClient *client = connect(REMOTE_TCP_ADHOC_PORT);
+
+  spr.createSprite(320, 170);
+  client->sendSpace = 1000;
+  client->receive("C");
+  loop();
+
+  // Client stops reading
+  hostAdvance(REMOTE_TCP_TIMEOUT / 2);
+  loop();
+  CHECK(!client->closed);
+  hostAdvance(REMOTE_TCP_TIMEOUT);
+  loop();
+  CHECK(client->aborted);
+
+  spr.deleteSprite();
+  disconnect(client);
+}
+
+TEST(tcpSlots)
+{
+  AsyncClient *clients[REMOTE_TCP_CLIENTS];
+
+  for(int i=0 ; i<REMOTE_TCP_CLIENTS ; i++)
+    clients[i] = connect(REMOTE_TCP_ADHOC_PORT);
+
+  // No free slots, the client is dropped
+  AsyncClient *extra = connect(REMOTE_TCP_ADHOC_PORT);
+  CHECK(extra->aborted);
+  extra->disconnect();
+
+  // Client leaves before the main loop sees it, the slot is reused
+  disconnect(clients[1]);
+  clients[1] = connect(REMOTE_TCP_RIGCTL_PORT);
+  CHECK(!clients[1]->closed);
+  clients[1]->receive("f\n");
+  loop();
+  CHECK(!clients[1]->sent.empty());
+
+  remoteTcpStop();
+  for(int i=0 ; i<REMOTE_TCP_CLIENTS ; i++)
+  {
+    CHECK(clients[i]->aborted);
+    disconnect(clients[i]);
+  }
+}
@@ -0,0 +1,207 @@
+#include "test.h"
+#include "Common.h"
+#include "Menu.h"
+#include "Telemetry.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+//
+// Telemetry frames on the host clock: the subscribed fields only,
+// deltas with periodic full frames, the frame rate, and battery
+// readings taken from the cache instead of the ADC on every frame
+//
+
+struct TestStream : public Stream
+{
+  std::string out;
+
+  int available() override { return(0); }
+  int read() override { return(-1); }
+  int peek() override { return(-1); }
+  size_t write(uint8_t c) override { out += (char)c; return(1); }
+};
+
+// Lines sent, without the line ends
+static std::vector<std::string> frames(TestStream &s)
+{
+  std::vector<std::string> result;
+  size_t pos = 0, end;
+
+  while((end = s.out.find("\r\n", pos)) != std::string::npos)
+  {
+    result.push_back(s.out.substr(pos, end - pos));
+    pos = end + 2;
+  }
+
+  s.out.clear();
+  return(result);
+}
+
+static void reset(TelemetryState *state)
+{
+  *state = TelemetryState();
+  selectBand(3, false);
+  rssi = 30;
+  snr = 10;
+}
+
+TEST(telemetrySubscribe)
+{
+  TelemetryState state;
+  reset(&state);
+
+  CHECK(telemetrySubscribe(&state, "rnf,10"));
+  CHECK_EQ(state.fields, (1 << TM_RSSI) | (1 << TM_SNR) | (1 << TM_FREQ));
+  CHECK_EQ(state.rate, 10);
+  CHECK(telemetrySubscribe(&state, "*"));
+  CHECK_EQ(state.fields, (1 << TM_COUNT) - 1);
+  CHECK_EQ(state.rate, TELEMETRY_DEF_RATE);
+  CHECK(telemetrySubscribe(&state, "v," "20"));
+  CHECK_EQ(state.rate, TELEMETRY_MAX_RATE);
+
+  // Bad fields or rates leave the subscription alone
+  CHECK(!telemetrySubscribe(&state, "rx"));
+  CHECK(!telemetrySubscribe(&state, "r,0"));
+  CHECK(!telemetrySubscribe(&state, "r,21"));
+  CHECK(!telemetrySubscribe(&state, "r,"));
+  CHECK(!telemetrySubscribe(&state, "r,5x"));
+  CHECK_EQ(state.fields, 1 << TM_VOLTS);
+
+  // No fields, no frames
+  TestStream s;
+  CHECK(telemetrySubscribe(&state, ""));
+  telemetryTick(&s, &state);
+  CHECK(s.out.empty());
+}
+
+TEST(telemetryFields)
+{
+  TelemetryState state;
+  TestStream s;
+  reset(&state);
+
+  // Only the subscribed fields, in the TM_* order
+  telemetrySubscribe(&state, "fr");
+  telemetryTick(&s, &state);
+  CHECK(s.out == "=0 r30 f14074000\r\n");
+
+  telemetrySubscribe(&state, "nb");
+  currentBFO = -120;
+  telemetryTick(&s, &state);
+  CHECK(frames(s) == std::vector<std::string>({ "=0 r30 f14074000", "=1 n10 b-120" }));
+  currentBFO = 0;
+}
+
+TEST(telemetryDelta)
+{
+  TelemetryState state;
+  TestStream s;
+  reset(&state);
+
+  telemetrySubscribe(&state, "rnf,10");
+  telemetryTick(&s, &state);
+
+  // Unchanged fields are left out, nothing changed sends nothing
+  rssi = 31;
+  hostAdvance(100);
+  telemetryTick(&s, &state);
+  hostAdvance(100);
+  telemetryTick(&s, &state);
+  snr = 12;
+  currentFrequency = 14075;
+  hostAdvance(100);
+  telemetryTick(&s, &state);
+  CHECK(frames(s) == std::vector<std::string>({ "=0 r30 n10 f14074000", "~1 r31", "~2 n12 f14075000" }));
+
+  // Full frame every TELEMETRY_FULL_TIME, even without changes
+  int full = 0, delta = 0;
+  for(int t=0 ; t<=2 * TELEMETRY_FULL_TIME ; t+=100)
+  {
+    rssi = 30 + t / 1000;
+    hostAdvance(100);
+    telemetryTick(&s, &state);
+  }
+  for(const std::string &f : frames(s))
+  {
+    if(f[0] == '=') { full++; CHECK(f.find(" r") != std::string::npos && f.find(" n12 f14075000") != std::string::npos); }
+    else { delta++; CHECK(f.find(" n") == std::string::npos && f.find(" f") == std::string::npos); }
+  }
+  CHECK_EQ(full, 2);
+  CHECK(delta >= 8);
+
+  // Sequence numbers count sent frames only
+  telemetryTick(&s, &state);
+  rssi++;
+  hostAdvance(100);
+  telemetryTick(&s, &state);
+  std::vector<std::string> f = frames(s);
+  CHECK_EQ(f.size(), 1);
+  if(f.size()) CHECK_EQ(atoi(f[0].c_str() + 1), state.seq - 1);
+}
+
+TEST(telemetryRate)
+{
+  TelemetryState state;
+  TestStream s;
+
+  // Values change all the time, ticks come every millisecond or in
+  // uneven steps
+  for(int rate : { 1, 2, 10, TELEMETRY_MAX_RATE })
+    for(int step : { 1, 7, 30 })
+    {
+      char args[16];
+      reset(&state);
+      sprintf(args, "r,%d", rate);
+      telemetrySubscribe(&state, args);
+
+      int n = 0, gap = 1000000;
+      uint32_t last = 0;
+      for(int t=0 ; t<5000 ; t+=step)
+      {
+        rssi = t & 0x7F;
+        telemetryTick(&s, &state);
+        if(!s.out.empty())
+        {
+          if(n++) gap = std::min(gap, (int)(millis() - last));
+          last = millis();
+          s.out.clear();
+        }
+        hostAdvance(step);
+      }
+
+      // Average rate kept, and no two frames closer than a period
+      // (less the tick step making up for a late one)
+      if(n < rate * 5 || n > rate * 5 + 1 || gap < 1000 / rate - step)
+      {
+        printf("  %d Hz, ticks every %d ms: %d frames in 5 s, %d ms apart at least\n", rate, step, n, gap);
+        CHECK(n >= rate * 5 && n <= rate * 5 + 1);
+        CHECK(gap >= 1000 / rate - step);
+      }
+    }
+}
+
+TEST(telemetryBattery)
+{
+  TelemetryState state;
+  TestStream s;
+  reset(&state);
+
+  // Voltage changes every second, frames would read the ADC 20 times
+  // a second
+  telemetrySubscribe(&state, "v,20");
+  hostAnalogReads = 0;
+  for(int t=0 ; t<5000 ; t+=10)
+  {
+    hostAnalogValue = 2380 + t / 1000 % 2;
+    telemetryTick(&s, &state);
+    hostAdvance(10);
+  }
+
+  std::vector<std::string> f = frames(s);
+  CHECK(f.size() >= 5);
+  CHECK(f.size() && f[0] == "=0 v4051");
+  CHECK(hostAnalogReads > 0);
+  CHECK(hostAnalogReads <= 6 * 10);
+  hostAnalogValue = 2380;
+}
@@ -0,0 +1,39 @@
+#include "test.h"
+#include <string.h>
+
+static TestCase *first = NULL;
+static TestCase **last = &first;
+int testFailures = 0;
+
+TestCase::TestCase(const char *name, TestFunc func) : name(name), func(func), next(NULL)
+{
+  // Run in the order of declaration
+  *last = this;
+  last = &next;
+}
+
+//
+// Run all tests, or the ones whose names are given. Benchmarks (names
+// starting with "bench") only run when named or with --bench.
+//
+int main(int argc, char **argv)
+{
+  int run = 0;
+
+  for(TestCase *t=first ; t ; t=t->next)
+  {
+    bool bench = !strncmp(t->name, "bench", 5);
+    bool selected = argc < 2 && !bench;
+    for(int j=1 ; j<argc ; j++)
+      selected |= !strcmp(argv[j], t->name) || (bench && !strcmp(argv[j], "--bench"));
+    if(!selected) continue;
+
+    int before = testFailures;
+    t->func();
+    printf("%s %s\n", testFailures == before ? "ok  " : "FAIL", t->name);
+    run++;
+  }
+
+  printf("%d tests, %d failures\n", run, testFailures);
+  return(testFailures ? 1 : 0);
+}
@@ -0,0 +1,42 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+
+//
+// Host test helpers. A test is a function declared with TEST(), all of
+// them are run by main() in test.cpp. CHECK() records a failure and
+// carries on, so that one run shows every broken expectation.
+//
+
+typedef void (*TestFunc)();
+
+struct TestCase
+{
+  TestCase(const char *name, TestFunc func);
+
+  const char *name;
+  TestFunc func;
+  TestCase *next;
+};
+
+extern int testFailures;
+
+#define TEST(name) \
+  static void name(); \
+  static TestCase name##Case(#name, name); \
+  static void name()
+
+#define CHECK(cond) \
+  do { if(!(cond)) { testFailures++; \
+    printf("  %s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); } } while(0)
+
+#define CHECK_EQ(a, b) \
+  do { long long _a = (long long)(a), _b = (long long)(b); if(_a != _b) { testFailures++; \
+    printf("  %s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #a, #b, _a, _b); } } while(0)
+
+#define CHECK_NEAR(a, b, eps) \
+  do { double _a = (a), _b = (b); if(!(_a >= _b - (eps) && _a <= _b + (eps))) { testFailures++; \
+    printf("  %s:%d: CHECK_NEAR(%s, %s) failed: %g != %g\n", __FILE__, __LINE__, #a, #b, _a, _b); } } while(0)
+
+#endif // TEST_H
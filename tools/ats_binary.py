@@ -0,0 +1,372 @@
+#!/usr/bin/env python3
+"""Reference client for the ATS Mini binary remote protocol.
+
+Set Settings -> USB Mode to "Binary" on the receiver, then:
+
+    ats_binary.py -p /dev/ttyACM0 get freq mode band volume rssi snr
+    ats_binary.py -p /dev/ttyACM0 set freq=7200000 volume=30
+    ats_binary.py -p /dev/ttyACM0 get mem=1 mem=2
+    ats_binary.py -p /dev/ttyACM0 set mem=5,3,3,9500000     # slot,band,mode,Hz
+    ats_binary.py -p /dev/ttyACM0 bench
+    ats_binary.py --loopback bench                       # pty emulator
+
+Each frame is COBS encoded and terminated with a zero byte. A decoded
+frame is id (u16) | length (u16) | body | crc (u16), little endian, with
+CRC-16/CCITT-FALSE over id, length and body. See ats-mini/Binary.h.
+"""
+
+import argparse
+import os
+import pty
+import select
+import statistics
+import struct
+import sys
+import termios
+import threading
+import time
+import tty
+
+OP_FRAME = 0x00
+OP_FREQ = 0x01
+OP_MODE = 0x02
+OP_BAND = 0x03
+OP_BANDWIDTH = 0x04
+OP_AGC = 0x05
+OP_VOLUME = 0x06
+OP_MEMORY = 0x07
+OP_RSSI = 0x08
+OP_SNR = 0x09
+OP_BANDNAME = 0x0A
+OP_VERSION = 0x0B
+SET = 0x80
+
+OPS = {
+    "freq": OP_FREQ,
+    "mode": OP_MODE,
+    "band": OP_BAND,
+    "bw": OP_BANDWIDTH,
+    "agc": OP_AGC,
+    "volume": OP_VOLUME,
+    "mem": OP_MEMORY,
+    "rssi": OP_RSSI,
+    "snr": OP_SNR,
+    "bandname": OP_BANDNAME,
+    "version": OP_VERSION,
+}
+OP_NAMES = {v: k for k, v in OPS.items()} | {OP_FRAME: "frame"}
+
+STATUS = [
+    "ok",
+    "unknown operation",
+    "truncated arguments",
+    "out of range",
+    "read only",
+    "bad crc",
+    "bad length",
+    "frame too large",
+    "too many operations",
+]
+
+T_NONE, T_U8, T_U16, T_U32, T_STR, T_MEMORY = range(6)
+
+MODES = ["FM", "LSB", "USB", "AM"]
+
+
+def crc16(data, crc=0xFFFF):
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_encode(data):
+    out = bytearray([0])
+    code = 0
+    for b in data:
+        if b:
+            out.append(b)
+        if not b or len(out) - code == 0xFF:
+            out[code] = len(out) - code
+            code = len(out)
+            out.append(0)
+    out[code] = len(out) - code
+    return bytes(out)
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        i += 1
+        if not code or i + code - 1 > len(data):
+            raise ValueError("bad COBS block")
+        out += data[i : i + code - 1]
+        i += code - 1
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def make_frame(frame_id, body):
+    payload = struct.pack("<HH", frame_id, len(body)) + bytes(body)
+    payload += struct.pack("<H", crc16(payload))
+    return cobs_encode(payload) + b"\0"
+
+
+def parse_frame(encoded):
+    """Decode a frame (without the terminating zero) into (id, body)"""
+    data = cobs_decode(encoded)
+    if len(data) < 6:
+        raise ValueError("short frame")
+    frame_id, length = struct.unpack_from("<HH", data)
+    if length != len(data) - 6:
+        raise ValueError("bad length")
+    if crc16(data[:-2]) != struct.unpack_from("<H", data, len(data) - 2)[0]:
+        raise ValueError("bad CRC")
+    return frame_id, data[4:-2]
+
+
+def encode_op(name, value=None, set_value=False):
+    """Encode a get operation, or a set operation if set_value is true"""
+    op = OPS[name]
+    if not set_value:
+        if op in (OP_MEMORY, OP_BANDNAME):
+            if value is None:
+                raise ValueError(f"{name} needs a slot or band number")
+            return bytes([op, int(value)])
+        return bytes([op])
+    if op == OP_FREQ:
+        return struct.pack("<BI", op | SET, int(value))
+    if op == OP_MEMORY:
+        slot, band, mode, freq = value if isinstance(value, tuple) else value.split(",")
+        mode = MODES.index(mode) if mode in MODES else int(mode)
+        return struct.pack("<BBBBI", op | SET, int(slot), int(band), mode, int(freq))
+    if op in (OP_RSSI, OP_SNR, OP_VERSION):
+        # Read only, the receiver will report an error
+        return bytes([op | SET])
+    if op == OP_MODE and value in MODES:
+        value = MODES.index(value)
+    return bytes([op | SET, int(value)])
+
+
+def parse_results(body):
+    """Split response body into a list of (op, status, value)"""
+    results = []
+    i = 0
+    while i < len(body):
+        op, status, vtype = body[i : i + 3]
+        i += 3
+        if vtype == T_U8:
+            value = body[i]
+            i += 1
+        elif vtype == T_U16:
+            (value,) = struct.unpack_from("<H", body, i)
+            i += 2
+        elif vtype == T_U32:
+            (value,) = struct.unpack_from("<I", body, i)
+            i += 4
+        elif vtype == T_STR:
+            value = body[i + 1 : i + 1 + body[i]].decode("ascii", "replace")
+            i += 1 + body[i]
+        elif vtype == T_MEMORY:
+            value = struct.unpack_from("<BBBI", body, i)
+            i += 7
+        else:
+            value = None
+        results.append((op, status, value))
+    return results
+
+
+class Client:
+    def __init__(self, fd):
+        self.fd = fd
+        self.frame_id = 0
+        self.rx = bytearray()
+
+    @classmethod
+    def open(cls, path):
+        fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+        tty.setraw(fd)
+        attrs = termios.tcgetattr(fd)
+        attrs[4] = attrs[5] = termios.B115200
+        termios.tcsetattr(fd, termios.TCSANOW, attrs)
+        termios.tcflush(fd, termios.TCIOFLUSH)
+        return cls(fd)
+
+    def send(self, body):
+        self.frame_id = (self.frame_id + 1) & 0xFFFF
+        os.write(self.fd, make_frame(self.frame_id, body))
+        return self.frame_id
+
+    def receive(self, timeout=2.0):
+        deadline = time.monotonic() + timeout
+        while b"\0" not in self.rx:
+            left = deadline - time.monotonic()
+            if left <= 0 or not select.select([self.fd], [], [], left)[0]:
+                raise TimeoutError("no response")
+            self.rx += os.read(self.fd, 4096)
+        end = self.rx.index(b"\0")
+        encoded, self.rx = bytes(self.rx[:end]), self.rx[end + 1 :]
+        return parse_frame(encoded)
+
+    def request(self, body, timeout=2.0):
+        frame_id = self.send(body)
+        while True:
+            rid, rbody = self.receive(timeout)
+            # Frame errors may not carry a valid id
+            if rid == frame_id or (rbody and rbody[0] == OP_FRAME):
+                return parse_results(rbody)
+
+
+class Emulator(threading.Thread):
+    """Minimal receiver emulator, used for the loopback benchmark"""
+
+    def __init__(self, fd):
+        super().__init__(daemon=True)
+        self.fd = fd
+        self.state = {OP_FREQ: 7200000, OP_MODE: 3, OP_BAND: 10, OP_BANDWIDTH: 4, OP_AGC: 0, OP_VOLUME: 35}
+        self.memories = {}
+
+    def execute(self, body):
+        out = bytearray()
+        i = 0
+        while i < len(body):
+            op = body[i]
+            base, is_set = op & ~SET, bool(op & SET)
+            i += 1
+            if base == OP_FREQ:
+                if is_set:
+                    (self.state[base],) = struct.unpack_from("<I", body, i)
+                    i += 4
+                out += struct.pack("<BBBI", op, 0, T_U32, self.state[base])
+            elif base in (OP_MODE, OP_BAND, OP_BANDWIDTH, OP_AGC, OP_VOLUME):
+                if is_set:
+                    self.state[base] = body[i]
+                    i += 1
+                out += bytes([op, 0, T_U8, self.state[base]])
+            elif base == OP_MEMORY:
+                slot = body[i]
+                if is_set:
+                    self.memories[slot] = struct.unpack_from("<BBI", body, i + 1)
+                band, mode, freq = self.memories.get(slot, (0, 0, 0))
+                out += struct.pack("<BBBBBBI", op, 0, T_MEMORY, slot, band, mode, freq)
+                i += 7 if is_set else 1
+            elif base == OP_BANDNAME:
+                name = f"B{body[i]}".encode()
+                out += bytes([op, 0, T_STR, len(name)]) + name
+                i += 1
+            elif base in (OP_RSSI, OP_SNR, OP_VERSION) and is_set:
+                out += bytes([op, 4, T_NONE])
+            elif base in (OP_RSSI, OP_SNR):
+                out += bytes([op, 0, T_U8, 20])
+            elif base == OP_VERSION:
+                out += struct.pack("<BBBH", op, 0, T_U16, 233)
+            else:
+                out += bytes([op, 1, T_NONE])
+                break
+        return bytes(out)
+
+    def run(self):
+        rx = bytearray()
+        while True:
+            try:
+                rx += os.read(self.fd, 4096)
+            except OSError:
+                return
+            while b"\0" in rx:
+                end = rx.index(b"\0")
+                frame_id, body = parse_frame(bytes(rx[:end]))
+                del rx[: end + 1]
+                os.write(self.fd, make_frame(frame_id, self.execute(body)))
+
+
+def format_result(op, status, value):
+    name = OP_NAMES.get(op & ~SET, f"0x{op:02x}")
+    if status:
+        return f"{name}: error: {STATUS[status] if status < len(STATUS) else status}"
+    if op & ~SET == OP_MODE and value < len(MODES):
+        value = MODES[value]
+    elif op & ~SET == OP_MEMORY:
+        slot, band, mode, freq = value
+        value = f"#{slot:02d} band {band} {MODES[mode] if mode < len(MODES) else mode} {freq} Hz" if freq else f"#{slot:02d} empty"
+    return f"{name}: {value}"
+
+
+def benchmark(client, count):
+    # Latency: one get per frame
+    times = []
+    for _ in range(count):
+        start = time.perf_counter()
+        client.request(bytes([OP_FREQ]))
+        times.append(time.perf_counter() - start)
+    times.sort()
+    print(
+        f"latency (1 op/frame, {count} frames): "
+        f"min {times[0] * 1e3:.3f} ms, median {statistics.median(times) * 1e3:.3f} ms, "
+        f"p99 {times[int(len(times) * 0.99) - 1] * 1e3:.3f} ms, max {times[-1] * 1e3:.3f} ms"
+    )
+
+    # Throughput: batches of gets, several frames in flight
+    batch = bytes([OP_FREQ, OP_MODE, OP_BAND, OP_BANDWIDTH, OP_AGC, OP_VOLUME, OP_RSSI, OP_SNR] * 4)
+    window = 4
+    frames = count
+    sent = received = nbytes = 0
+    start = time.perf_counter()
+    while received < frames:
+        while sent < frames and sent - received < window:
+            client.send(batch)
+            sent += 1
+        _, body = client.receive()
+        nbytes += len(body)
+        received += 1
+    elapsed = time.perf_counter() - start
+    print(
+        f"throughput ({len(batch)} ops/frame, {window} frames in flight): "
+        f"{frames * len(batch) / elapsed:.0f} ops/s, {frames / elapsed:.0f} frames/s, "
+        f"{nbytes / elapsed / 1024:.1f} KiB/s of responses"
+    )
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("-p", "--port", help="serial port of the receiver")
+    parser.add_argument("--loopback", action="store_true", help="talk to a built-in emulator through a pty")
+    parser.add_argument("--count", type=int, default=500, help="benchmark frame count")
+    parser.add_argument("command", choices=["get", "set", "bench"])
+    parser.add_argument("items", nargs="*", help="name or name=value")
+    args = parser.parse_args()
+
+    if args.loopback:
+        master, slave = pty.openpty()
+        Emulator(master).start()
+        client = Client.open(os.ttyname(slave))
+    elif args.port:
+        client = Client.open(args.port)
+    else:
+        parser.error("a serial port or --loopback is required")
+
+    if args.command == "bench":
+        benchmark(client, args.count)
+        return
+
+    body = bytearray()
+    for item in args.items:
+        name, _, value = item.partition("=")
+        if name not in OPS:
+            parser.error(f"{name}: unknown, expected one of {', '.join(OPS)}")
+        if args.command == "set" and not value:
+            parser.error(f"{item}: expected name=value")
+        body += encode_op(name, value or None, args.command == "set")
+
+    results = client.request(bytes(body))
+    for result in results:
+        print(format_result(*result))
+    if any(status for _, status, _ in results):
+        sys.exit(1)
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,161 @@
+#!/usr/bin/env python3
+"""Capture a screenshot from the ATS Mini over the USB serial port.
+
+Set Settings -> USB Mode to "Ad hoc" on the receiver, then:
+
+    ats_screenshot.py -p /dev/ttyACM0 screen.png            # PackBits (c1)
+    ats_screenshot.py -p /dev/ttyACM0 --raw screen.png      # uncompressed (c0)
+    ats_screenshot.py -p /dev/ttyACM0 --hex screen.png      # legacy HEX BMP (C)
+    ats_screenshot.py -p /dev/ttyACM0 --compare             # time all three
+    ats_screenshot.py --decode capture.bin screen.png       # saved c0/c1 output
+
+The binary stream starts with "ATSS", width (u16), height (u16), format
+(u8, 0 - raw, 1 - PackBits) and bits per pixel (u8, 16), followed by one
+chunk per row: length (u16) and the row data. Pixels are RGB565 with the
+high byte first. Numbers are little endian. See ats-mini/Remote.cpp.
+"""
+
+import argparse
+import os
+import select
+import struct
+import sys
+import termios
+import time
+import tty
+import zlib
+
+
+def unpack_bits(data, width):
+    """Decode a PackBits compressed row of 16-bit pixels"""
+    row = bytearray()
+    i = 0
+    while i < len(data):
+        n = data[i]
+        i += 1
+        if n < 128:
+            row += data[i : i + (n + 1) * 2]
+            i += (n + 1) * 2
+        else:
+            row += data[i : i + 2] * (257 - n)
+            i += 2
+    if len(row) != width * 2:
+        raise ValueError(f"row decodes to {len(row) // 2} pixels, expected {width}")
+    return bytes(row)
+
+
+def decode_binary(data):
+    """Decode the c0/c1 stream into (width, height, rows of RGB565 big endian)"""
+    start = data.find(b"ATSS")
+    if start < 0:
+        raise ValueError("no screenshot header")
+    width, height, fmt, bpp = struct.unpack_from("<HHBB", data, start + 4)
+    if bpp != 16 or fmt not in (0, 1):
+        raise ValueError(f"unsupported format {fmt}, {bpp} bpp")
+    pos = start + 10
+    rows = []
+    for _ in range(height):
+        (size,) = struct.unpack_from("<H", data, pos)
+        chunk = data[pos + 2 : pos + 2 + size]
+        if len(chunk) != size:
+            raise ValueError("truncated screenshot")
+        rows.append(unpack_bits(chunk, width) if fmt else chunk)
+        pos += 2 + size
+    return width, height, rows
+
+
+def decode_hex_bmp(text):
+    """Decode the legacy C command output into (width, height, rows)"""
+    hexdata = "".join(c for c in text.decode("ascii", "ignore") if c in "0123456789abcdefABCDEF")
+    bmp = bytes.fromhex(hexdata[: len(hexdata) // 2 * 2])
+    offset, _, width, height = struct.unpack_from("<IIii", bmp, 10)
+    rows = []
+    for y in range(height):
+        # BMP rows are bottom up, pixels are little endian
+        line = bmp[offset + (height - 1 - y) * width * 2 : offset + (height - y) * width * 2]
+        rows.append(bytes(b for i in range(0, len(line), 2) for b in (line[i + 1], line[i])))
+    return width, height, rows
+
+
+def write_png(path, width, height, rows):
+    raw = bytearray()
+    for row in rows:
+        raw.append(0)
+        for i in range(0, width * 2, 2):
+            p = (row[i] << 8) | row[i + 1]
+            r, g, b = (p >> 11) & 0x1F, (p >> 5) & 0x3F, p & 0x1F
+            raw += bytes(((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2)))
+
+    def chunk(kind, data):
+        return struct.pack(">I", len(data)) + kind + data + struct.pack(">I", zlib.crc32(kind + data))
+
+    with open(path, "wb") as f:
+        f.write(b"\x89PNG\r\n\x1a\n")
+        f.write(chunk(b"IHDR", struct.pack(">IIBBBBB", width, height, 8, 2, 0, 0, 0)))
+        f.write(chunk(b"IDAT", zlib.compress(bytes(raw), 9)))
+        f.write(chunk(b"IEND", b""))
+
+
+def open_port(path):
+    fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+    tty.setraw(fd)
+    termios.tcflush(fd, termios.TCIOFLUSH)
+    return fd
+
+
+def capture(fd, command, idle=0.5):
+    """Send a command and collect the output until the port goes quiet"""
+    os.write(fd, command)
+    data = bytearray()
+    start = time.perf_counter()
+    last = None
+    while True:
+        if not select.select([fd], [], [], idle if data else 5.0)[0]:
+            break
+        data += os.read(fd, 65536)
+        last = time.perf_counter()
+    if not data:
+        raise TimeoutError("no response, is the USB mode set to Ad hoc?")
+    return bytes(data), last - start
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("-p", "--port", help="serial port of the receiver")
+    mode = parser.add_mutually_exclusive_group()
+    mode.add_argument("--raw", action="store_true", help="uncompressed binary transfer")
+    mode.add_argument("--hex", action="store_true", help="legacy HEX BMP transfer")
+    mode.add_argument("--compare", action="store_true", help="time the HEX, raw and PackBits transfers")
+    mode.add_argument("--decode", metavar="FILE", help="decode saved binary output instead of capturing")
+    parser.add_argument("output", nargs="?", default="screenshot.png", help="PNG file name")
+    args = parser.parse_args()
+
+    if args.decode:
+        with open(args.decode, "rb") as f:
+            write_png(args.output, *decode_binary(f.read()))
+        return
+
+    if not args.port:
+        parser.error("a serial port is required")
+    fd = open_port(args.port)
+
+    if args.compare:
+        for name, command, decode in (
+            ("HEX (C)", b"C", decode_hex_bmp),
+            ("raw (c0)", b"c0", decode_binary),
+            ("PackBits (c1)", b"c1", decode_binary),
+        ):
+            data, elapsed = capture(fd, command)
+            decode(data)
+            print(f"{name:14} {len(data):7} bytes {elapsed:6.2f} s {len(data) / elapsed / 1024:7.1f} KiB/s")
+        return
+
+    command = b"C" if args.hex else b"c0" if args.raw else b"c1"
+    data, elapsed = capture(fd, command)
+    image = decode_hex_bmp(data) if args.hex else decode_binary(data)
+    write_png(args.output, *image)
+    print(f"{args.output}: {image[0]}x{image[1]}, {len(data)} bytes in {elapsed:.2f} s", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
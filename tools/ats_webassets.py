@@ -0,0 +1,183 @@
+#!/usr/bin/env python3
+"""Generate ats-mini/WebAssets.h from the static web files in ats-mini/web.
+
+Each file is gzip compressed and stored as a PROGMEM array, together with
+its content type and an ETag made from the hash of its contents. The web
+server sends the compressed bytes as they are, with Content-Encoding: gzip.
+
+References to other assets in the HTML files ('/style.css') get the ETag
+of the referenced file appended as a query ('/style.css?v=...'), so that
+those can be cached for a long time and still change with the firmware.
+
+    ats_webassets.py                        # regenerate the header
+    ats_webassets.py --check                # fail if the header is stale
+    ats_webassets.py --verify http://atsmini.local
+                                            # compare served bytes and 304s
+"""
+
+import argparse
+import gzip
+import hashlib
+import os
+import sys
+import urllib.error
+import urllib.request
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "ats-mini")
+WEB_DIR = os.path.join(ROOT, "web")
+HEADER = os.path.join(ROOT, "WebAssets.h")
+
+TYPES = {
+    ".html": "text/html",
+    ".css": "text/css",
+    ".js": "application/javascript",
+}
+
+# Served as "/" instead of its own name
+INDEX = "index.html"
+
+
+def url_path(name):
+    return "/" if name == INDEX else "/" + name
+
+
+def etag_of(data):
+    return hashlib.sha256(data).hexdigest()[:16]
+
+
+def load_assets():
+    """Return [(name, type, etag, source bytes, gzip bytes)], HTML last."""
+    names = sorted(
+        (n for n in os.listdir(WEB_DIR) if os.path.splitext(n)[1] in TYPES),
+        key=lambda n: (n.endswith(".html"), n),
+    )
+    etags = {}
+    assets = []
+
+    for name in names:
+        with open(os.path.join(WEB_DIR, name), "rb") as f:
+            data = f.read()
+
+        if name.endswith(".html"):
+            for other, tag in etags.items():
+                for quote in (b"'", b'"'):
+                    ref = quote + url_path(other).encode() + quote
+                    data = data.replace(ref, quote + f"{url_path(other)}?v={tag}".encode() + quote)
+
+        etags[name] = etag_of(data)
+        packed = gzip.compress(data, compresslevel=9, mtime=0)
+        assets.append((name, TYPES[os.path.splitext(name)[1]], etags[name], data, packed))
+
+    return assets
+
+
+def c_name(name):
+    return "webAsset_" + "".join(c if c.isalnum() else "_" for c in name)
+
+
+def render(assets):
+    out = [
+        "// Generated by tools/ats_webassets.py from the files in web/, do not edit",
+        "#ifndef WEB_ASSETS_H",
+        "#define WEB_ASSETS_H",
+        "",
+        "#include <Arduino.h>",
+        "",
+        "typedef struct",
+        "{",
+        "  const char *path;     // URL path",
+        "  const char *type;     // Content type",
+        "  const char *etag;     // Hash of the contents",
+        "  bool immutable;       // Referenced with the hash, can be cached for long",
+        "  const uint8_t *data;  // Gzip compressed contents",
+        "  size_t size;",
+        "} WebAsset;",
+        "",
+    ]
+
+    for name, ctype, etag, data, packed in assets:
+        out.append(f"// {name}: {len(data)} bytes, {len(packed)} compressed")
+        out.append(f"static const uint8_t {c_name(name)}[] PROGMEM =")
+        out.append("{")
+        for i in range(0, len(packed), 16):
+            out.append("  " + ", ".join(f"0x{b:02x}" for b in packed[i:i + 16]) + ",")
+        out.append("};")
+        out.append("")
+
+    out.append("static const WebAsset webAssets[] =")
+    out.append("{")
+    for name, ctype, etag, data, packed in assets:
+        immutable = "false" if name.endswith(".html") else "true"
+        out.append(
+            f'  {{ "{url_path(name)}", "{ctype}", "{etag}", {immutable}, '
+            f"{c_name(name)}, sizeof({c_name(name)}) }},"
+        )
+    out.append("};")
+    out.append("")
+    out.append("#endif // WEB_ASSETS_H")
+    out.append("")
+    return "\n".join(out)
+
+
+def verify(base):
+    """Fetch every asset and check the bytes, headers and 304 replies."""
+    failed = 0
+
+    for name, ctype, etag, data, packed in load_assets():
+        url = base.rstrip("/") + url_path(name)
+        req = urllib.request.Request(url, headers={"Accept-Encoding": "gzip"})
+        with urllib.request.urlopen(req) as r:
+            body = r.read()
+            checks = [
+                ("status 200", r.status == 200),
+                ("gzip encoding", r.headers.get("Content-Encoding") == "gzip"),
+                ("content type", (r.headers.get("Content-Type") or "").startswith(ctype)),
+                ("etag", r.headers.get("ETag") == f'"{etag}"'),
+                ("cache control", "max-age" in (r.headers.get("Cache-Control") or "")),
+                ("compressed bytes", body == packed),
+                ("decompressed bytes", gzip.decompress(body) == data),
+            ]
+
+        req = urllib.request.Request(url, headers={"If-None-Match": f'"{etag}"'})
+        try:
+            with urllib.request.urlopen(req) as r:
+                checks.append(("304 for the current etag", False))
+        except urllib.error.HTTPError as e:
+            checks.append(("304 for the current etag", e.code == 304 and not e.read()))
+
+        req = urllib.request.Request(url, headers={"If-None-Match": '"stale"', "Accept-Encoding": "gzip"})
+        with urllib.request.urlopen(req) as r:
+            checks.append(("200 for a stale etag", r.status == 200 and r.read() == packed))
+
+        for what, ok in checks:
+            print(f"{'ok  ' if ok else 'FAIL'} {url_path(name)}: {what}")
+            failed += not ok
+
+    return failed == 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--check", action="store_true", help="fail if the generated header is out of date")
+    parser.add_argument("--verify", metavar="URL", help="check the assets served by a receiver")
+    args = parser.parse_args()
+
+    if args.verify:
+        return 0 if verify(args.verify) else 1
+
+    text = render(load_assets())
+
+    if args.check:
+        with open(HEADER) as f:
+            if f.read() != text:
+                print(f"{HEADER} is out of date, run {sys.argv[0]}", file=sys.stderr)
+                return 1
+        return 0
+
+    with open(HEADER, "w") as f:
+        f.write(text)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())